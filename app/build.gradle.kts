@@ -41,6 +41,11 @@ android {
             isDebuggable = true
             applicationIdSuffix = ".debug"
             versionNameSuffix = "-debug"
+            externalNativeBuild {
+                cmake {
+                    arguments += "-DKTIMAZ_ENABLE_TRACING=ON"
+                }
+            }
         }
         
         release {
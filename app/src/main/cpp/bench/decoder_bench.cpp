@@ -0,0 +1,342 @@
+// ktimaz-bench-decoder: decoder, formatting and marshalling microbenchmarks.
+//
+// Every benchmark runs over a deterministic synthetic stream (fixed seed and
+// size), so numbers from two commits built the same way are comparable:
+// save one run with --json and pass it to the next as --baseline to get the
+// change per benchmark. Streams are either uniformly random words, which
+// reach every decoder path including the invalid ones, or a mix weighted
+// like compiled code (data processing, loads and stores, calls, branches,
+// push/pop, literal pool words). --file adds a sweep of a real binary.
+//
+// Reported per benchmark: median instructions/second over the repetitions,
+// the best run, and heap allocations and bytes per instruction, counted by
+// the replaced global operator new below.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/arm_disassembler.h"
+#include "../include/code_sweep.h"
+#include "../include/trace.h"
+#include "synthetic_code.h"
+
+// Allocation counting
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+void* counted_allocate(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size) { return counted_allocate(size); }
+void* operator new[](size_t size) { return counted_allocate(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+constexpr uint64_t kBaseAddress = 0x10000;
+
+// Results are added here so the compiler cannot drop the work
+volatile uint64_t g_sink = 0;
+
+struct Options {
+    size_t stream_bytes = 4 << 20;
+    int repetitions = 7;
+    std::string filter;
+    std::string file;       // Optional real binary to sweep
+    std::string json_path;  // Write results as JSON Lines
+    std::string baseline;   // Earlier --json output to compare against
+};
+
+struct Result {
+    std::string name;
+    uint64_t instructions = 0;   // Per repetition
+    double median_ips = 0;       // Instructions per second
+    double best_ips = 0;
+    double allocations = 0;      // Per instruction
+    double allocated_bytes = 0;  // Per instruction
+};
+
+// Runs `body` (one pass, returning the instructions it handled) once to
+// warm up, then `repetitions` times under the clock and the allocation
+// counters.
+Result measure(const std::string& name, int repetitions, const std::function<uint64_t()>& body) {
+    Result result;
+    result.name = name;
+    result.instructions = body();
+
+    std::vector<double> rates;
+    uint64_t allocations = 0, bytes = 0, instructions = 0;
+    for (int r = 0; r < repetitions; ++r) {
+        uint64_t allocations_before = g_allocations.load(std::memory_order_relaxed);
+        uint64_t bytes_before = g_allocated_bytes.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t count = body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocations_before;
+        bytes += g_allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+        instructions += count;
+        rates.push_back(seconds > 0 ? count / seconds : 0);
+    }
+    std::sort(rates.begin(), rates.end());
+    result.median_ips = rates[rates.size() / 2];
+    result.best_ips = rates.back();
+    result.allocations = instructions ? static_cast<double>(allocations) / instructions : 0;
+    result.allocated_bytes = instructions ? static_cast<double>(bytes) / instructions : 0;
+    return result;
+}
+
+// Reads the results of an earlier --json run: name -> median_ips.
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line);) {
+        size_t name_at = line.find("\"name\":\"");
+        size_t ips_at = line.find("\"median_ips\":");
+        if (name_at == std::string::npos || ips_at == std::string::npos) continue;
+        name_at += 8;
+        std::string name = line.substr(name_at, line.find('"', name_at) - name_at);
+        baseline[name] = strtod(line.c_str() + ips_at + 13, nullptr);
+    }
+    if (baseline.empty()) fprintf(stderr, "warning: no results in baseline %s\n", path.c_str());
+    return baseline;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc && arg != "-h" && arg != "--help") {
+            fprintf(stderr, "%s needs a value\n", arg.c_str());
+            return false;
+        }
+        if (arg == "--size") {
+            options.stream_bytes = std::max(1024L, strtol(argv[++i], nullptr, 10)) & ~size_t(3);
+        } else if (arg == "--repeat") {
+            options.repetitions = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (arg == "--file") {
+            options.file = argv[++i];
+        } else if (arg == "--json") {
+            options.json_path = argv[++i];
+        } else if (arg == "--baseline") {
+            options.baseline = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-bench-decoder [options]\n"
+        "  --size BYTES       synthetic stream size (default 4194304)\n"
+        "  --repeat N         timed repetitions per benchmark, median reported (default 7)\n"
+        "  --filter TEXT      run only benchmarks whose name contains TEXT\n"
+        "  --file ELF         also sweep the executable sections of ELF\n"
+        "  --json FILE        write results as JSON Lines\n"
+        "  --baseline FILE    compare against an earlier --json FILE\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+    if (tracing_enabled()) {
+        fprintf(stderr, "warning: built with KTIMAZ_ENABLE_TRACING; numbers include trace overhead\n");
+    }
+
+    struct Stream {
+        const char* name;
+        std::vector<uint8_t> bytes;
+        bool thumb;
+    };
+    std::vector<Stream> streams;
+    size_t size = options.stream_bytes;
+    streams.push_back({"arm.mix", synthetic_code(SyntheticCode::ArmMix, kSyntheticSeed ^ 1, size), false});
+    streams.push_back({"arm.random", synthetic_code(SyntheticCode::Random, kSyntheticSeed ^ 4, size), false});
+    streams.push_back({"thumb16.mix", synthetic_code(SyntheticCode::Thumb16Mix, kSyntheticSeed ^ 2, size), true});
+    streams.push_back({"thumb2.mix", synthetic_code(SyntheticCode::Thumb2Mix, kSyntheticSeed ^ 3, size), true});
+    streams.push_back({"thumb.random", synthetic_code(SyntheticCode::Random, kSyntheticSeed ^ 5, size), true});
+
+    ArmDisassembler disassembler;
+    std::vector<Result> results;
+    auto run = [&](const std::string& name, const std::function<uint64_t()>& body) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+        results.push_back(measure(name, options.repetitions, body));
+    };
+
+    // Decoding into a reused buffer, as the sweeps do, and into a fresh
+    // vector per block, as disassemble_block() callers do
+    std::vector<DisassembledInstruction> buffer;
+    for (const Stream& stream : streams) {
+        run(std::string("decode.") + stream.name, [&]() {
+            disassembler.disassemble_block_into(stream.bytes.data(), stream.bytes.size(), kBaseAddress,
+                                                stream.thumb, buffer);
+            return static_cast<uint64_t>(buffer.size());
+        });
+    }
+    for (const Stream& stream : streams) {
+        run(std::string("decode_block.") + stream.name, [&]() {
+            // Page-sized blocks, the size the disassembly view asks for
+            constexpr size_t kBlock = 4096;
+            uint64_t count = 0;
+            for (size_t offset = 0; offset < stream.bytes.size(); offset += kBlock) {
+                size_t size = std::min(kBlock, stream.bytes.size() - offset);
+                count += disassembler.disassemble_block(stream.bytes.data() + offset, size,
+                                                        kBaseAddress + offset, stream.thumb).size();
+            }
+            return count;
+        });
+    }
+    run("decode_one.thumb2.mix", [&]() {
+        const Stream& stream = streams[3];
+        uint64_t count = 0;
+        for (size_t offset = 0; offset < stream.bytes.size(); ++count) {
+            offset += disassembler.decode_one(stream.bytes.data() + offset, stream.bytes.size() - offset,
+                                              kBaseAddress + offset, true).size;
+        }
+        return count;
+    });
+
+    // Text formatting and marshalling work on a decoded mix; every eighth
+    // instruction gets a comment like the ones OperandResolver writes
+    std::vector<DisassembledInstruction> decoded;
+    disassembler.disassemble_block_into(streams[3].bytes.data(), streams[3].bytes.size(), kBaseAddress, true, decoded);
+    static const char kComment[] = "=0x0001F3A8 \"Failed to open \xE2\x80\x9C%s\xE2\x80\x9D\"";
+    for (size_t i = 0; i < decoded.size(); i += 8) decoded[i].comment = kComment;
+
+    std::string listing;
+    run("format.listing_line", [&]() {
+        listing.clear();
+        for (const auto& instr : decoded) {
+            append_listing_line(listing, instr);
+            listing += '\n';
+        }
+        return static_cast<uint64_t>(decoded.size());
+    });
+    run("format.listing_line.fresh_string", [&]() {
+        size_t total = 0;
+        for (const auto& instr : decoded) {
+            std::string line;
+            append_listing_line(line, instr);
+            total += line.size();
+        }
+        g_sink = g_sink + total;
+        return static_cast<uint64_t>(decoded.size());
+    });
+
+    // What the JNI layer does per instruction before any JNI call: the
+    // UTF-16 form of mnemonic, operands and comment
+    std::vector<uint16_t> utf16;
+    run("marshal.utf16", [&]() {
+        uint64_t units = 0;
+        for (const auto& instr : decoded) {
+            utf16.clear();
+            utf8_to_utf16(instr.mnemonic.view(), utf16);
+            utf8_to_utf16(instr.operands.view(), utf16);
+            utf8_to_utf16(instr.comment, utf16);
+            units += utf16.size();
+        }
+        g_sink = g_sink + units;
+        return static_cast<uint64_t>(decoded.size());
+    });
+
+    // A real binary, swept the way the analysis does it
+    MappedFile file{nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser;
+    if (!options.file.empty()) {
+        file = map_file(options.file);
+        try {
+            if (file.data) {
+                parser = std::make_unique<ElfParser>(file);
+                if (!parser->parse()) parser.reset();
+            }
+        } catch (const std::exception&) {
+            parser.reset();
+        }
+        if (!parser) {
+            fprintf(stderr, "cannot parse %s\n", options.file.c_str());
+            unmap_file(file);
+            return 1;
+        }
+        ModeMap mode_map(*parser, default_code_mode(*parser));
+        std::vector<SweepChunk> chunks = plan_sweep_chunks(*parser, mode_map, executable_section_indices(*parser));
+        run("decode.file", [&]() {
+            uint64_t count = 0;
+            for (const SweepChunk& chunk : chunks) {
+                sweep_chunk(*parser, disassembler, chunk,
+                    [&](size_t, const std::vector<DisassembledInstruction>& instructions) {
+                        count += instructions.size();
+                    }, buffer);
+            }
+            return count;
+        });
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty()) baseline = read_baseline(options.baseline);
+
+    printf("%-34s %12s %10s %10s %10s %11s%s\n", "benchmark", "instrs", "M instr/s", "best", "allocs/i",
+           "bytes/i", baseline.empty() ? "" : "   vs base");
+    for (const Result& result : results) {
+        printf("%-34s %12llu %10.2f %10.2f %10.4f %11.2f", result.name.c_str(),
+               static_cast<unsigned long long>(result.instructions), result.median_ips / 1e6,
+               result.best_ips / 1e6, result.allocations, result.allocated_bytes);
+        auto base = baseline.find(result.name);
+        if (base != baseline.end() && base->second > 0) {
+            printf("   %+7.1f%%", (result.median_ips / base->second - 1) * 100);
+        }
+        printf("\n");
+    }
+
+    if (!options.json_path.empty()) {
+        FILE* json = fopen(options.json_path.c_str(), "w");
+        if (!json) {
+            fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+            return 1;
+        }
+        for (const Result& result : results) {
+            fprintf(json,
+                "{\"name\":\"%s\",\"instructions\":%llu,\"median_ips\":%.0f,\"best_ips\":%.0f,"
+                "\"allocs_per_instr\":%.6f,\"bytes_per_instr\":%.3f,\"stream_bytes\":%zu,\"repetitions\":%d}\n",
+                result.name.c_str(), static_cast<unsigned long long>(result.instructions), result.median_ips,
+                result.best_ips, result.allocations, result.allocated_bytes, options.stream_bytes,
+                options.repetitions);
+        }
+        fclose(json);
+    }
+
+    parser.reset();
+    if (file.data) unmap_file(file);
+    return 0;
+}
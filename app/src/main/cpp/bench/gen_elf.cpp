@@ -0,0 +1,69 @@
+// ktimaz-gen-elf: writes a deterministic synthetic ELF file for load tests.
+//
+// The same options always give a byte-identical file, so one generated on
+// a workstation and one generated on a device are the same input.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "synthetic_code.h"
+
+namespace {
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-gen-elf [options] -o FILE\n"
+        "  --class 32|64      ELF class (default 32)\n"
+        "  --arm              ARM code instead of Thumb-2\n"
+        "  --code-mb N        code size in MB (default 64)\n"
+        "  --sections N       number of code sections (default 16)\n"
+        "  --symbols N        function symbols (default 200000)\n"
+        "  --dynamic N        of those, also in .dynsym (default 20000)\n"
+        "  --rodata-mb N      string data in MB (default 8)\n"
+        "  --seed N           generator seed\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SyntheticElfSpec spec;
+    std::string output;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--arm") {
+            spec.thumb = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage();
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "-o") {
+            output = value;
+        } else if (arg == "--class") {
+            spec.is_64bit = atoi(value) == 64;
+        } else if (arg == "--code-mb") {
+            spec.code_bytes = strtoull(value, nullptr, 10) << 20;
+        } else if (arg == "--sections") {
+            spec.code_sections = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (arg == "--symbols") {
+            spec.symbols = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (arg == "--dynamic") {
+            spec.dynamic_symbols = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (arg == "--rodata-mb") {
+            spec.rodata_bytes = strtoull(value, nullptr, 10) << 20;
+        } else if (arg == "--seed") {
+            spec.seed = strtoull(value, nullptr, 0);
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (output.empty()) {
+        print_usage();
+        return 2;
+    }
+    return write_synthetic_elf(output, spec) ? 0 : 1;
+}
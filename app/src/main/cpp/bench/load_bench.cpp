@@ -0,0 +1,391 @@
+// ktimaz-bench-load: end-to-end load benchmark.
+//
+// Drives what opening a library in the app does: map_file, ElfParser::parse,
+// disassembly of the first window of the entry section, building the symbol
+// index and a first symbol query. For every stage it records wall time, the
+// page faults taken and resident memory (current and the stage's peak), and
+// reports the time to first row (map + parse + first window).
+//
+// Inputs are files given on the command line and/or synthetic files of the
+// sizes given with --sizes, generated with write_synthetic_elf() so a
+// scaling curve can be measured anywhere. Each run happens in a fresh
+// process, with the file evicted from the page cache first unless --warm
+// is given, so runs neither share memory nor warm each other's cache.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/arm_disassembler.h"
+#include "../include/code_sweep.h"
+#include "../include/symbol_index.h"
+#include "synthetic_code.h"
+
+namespace {
+
+enum Stage { kMap, kParse, kFirstWindow, kSymbolIndex, kSymbolQuery, kStageCount };
+const char* const kStageNames[kStageCount] = {"map", "parse", "first_window", "symbol_index", "symbol_query"};
+
+// Sent from the measuring child to the parent through a pipe, so plain data.
+struct StageSample {
+    double ms;
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t rss_kb;      // Resident at the end of the stage
+    uint64_t peak_rss_kb; // Highest resident size during the stage
+};
+
+struct RunSample {
+    bool ok;
+    bool peak_per_stage; // False when the peak could not be reset between stages
+    uint64_t instructions;
+    uint64_t symbols;
+    uint64_t matches;
+    StageSample stages[kStageCount];
+};
+
+struct Options {
+    std::vector<std::string> files;
+    std::vector<uint64_t> sizes_mb;  // Synthetic files to generate
+    std::string directory;           // Where to put them
+    bool keep = false;
+    bool is_64bit = false;
+    bool arm = false;
+    bool warm = false;
+    size_t window = 64 * 1024;       // 0: the whole section, as the disassembly view decodes today
+    std::string query = "Handler";
+    int repetitions = 3;
+    std::string json_path;
+};
+
+// VmRSS and VmHWM from /proc/self/status, in KB.
+void read_rss(uint64_t& rss_kb, uint64_t& peak_kb) {
+    rss_kb = peak_kb = 0;
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.compare(0, 6, "VmRSS:") == 0) rss_kb = strtoull(line.c_str() + 6, nullptr, 10);
+        if (line.compare(0, 6, "VmHWM:") == 0) peak_kb = strtoull(line.c_str() + 6, nullptr, 10);
+    }
+    if (peak_kb == 0) {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        peak_kb = static_cast<uint64_t>(usage.ru_maxrss);
+    }
+}
+
+// Sets the peak resident size back to the current one (Linux 4.0+).
+bool reset_peak_rss() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+class StageMeter {
+public:
+    explicit StageMeter(RunSample& run) : run_(run) {}
+
+    void begin() {
+        if (!reset_peak_rss()) run_.peak_per_stage = false;
+        getrusage(RUSAGE_SELF, &usage_);
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    void end(Stage stage) {
+        auto now = std::chrono::steady_clock::now();
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        StageSample& sample = run_.stages[stage];
+        sample.ms = std::chrono::duration<double, std::milli>(now - start_).count();
+        sample.minor_faults = static_cast<uint64_t>(usage.ru_minflt - usage_.ru_minflt);
+        sample.major_faults = static_cast<uint64_t>(usage.ru_majflt - usage_.ru_majflt);
+        read_rss(sample.rss_kb, sample.peak_rss_kb);
+    }
+
+private:
+    RunSample& run_;
+    rusage usage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// One measured load; runs in the child process.
+RunSample measure_load(const std::string& path, const Options& options) {
+    RunSample run{};
+    run.peak_per_stage = true;
+    StageMeter meter(run);
+
+    meter.begin();
+    MappedFile file = map_file(path);
+    meter.end(kMap);
+    if (!file.data) return run;
+
+    try {
+        meter.begin();
+        ElfParser parser(file);
+        bool parsed = parser.parse();
+        meter.end(kParse);
+        if (!parsed) return run;
+        run.symbols = parser.get_symbols().size();
+
+        // The entry point's section, else .text, else the first code section
+        meter.begin();
+        std::vector<DisassembledInstruction> instructions;
+        const ElfHeader& header = parser.get_header();
+        int section = header.e_entry != 0 ? parser.find_section_by_address(header.e_entry & ~1ULL) : -1;
+        if (section >= 0 && !(parser.get_section_headers()[section].sh_flags & SHF_EXECINSTR)) section = -1;
+        if (section < 0) {
+            std::vector<size_t> code = executable_section_indices(parser);
+            for (size_t index : code) {
+                if (parser.get_section_headers()[index].name == ".text") section = static_cast<int>(index);
+            }
+            if (section < 0 && !code.empty()) section = static_cast<int>(code.front());
+        }
+        if (section >= 0) {
+            const SectionHeader& code = parser.get_section_headers()[section];
+            size_t size = options.window == 0 ? code.sh_size : std::min<size_t>(options.window, code.sh_size);
+            ArmDisassembler disassembler;
+            disassembler.disassemble_block_into(parser.get_section_data_by_index(section), size, code.sh_addr,
+                                                default_code_mode(parser) == CodeMode::Thumb, instructions);
+        }
+        run.instructions = instructions.size();
+        meter.end(kFirstWindow);
+
+        meter.begin();
+        SymbolIndex index(parser);
+        meter.end(kSymbolIndex);
+
+        meter.begin();
+        SymbolQuery query;
+        query.text = options.query;
+        run.matches = index.query(query).total_matches;
+        meter.end(kSymbolQuery);
+        run.ok = true;
+    } catch (const std::exception& e) {
+        log_error(std::string("Load failed: ") + e.what());
+    }
+    unmap_file(file);
+    return run;
+}
+
+// Drops the file's pages from the page cache so the run sees cold I/O.
+void evict_from_page_cache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd); // Dirty pages (a file just generated) cannot be dropped
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+}
+
+bool run_in_child(const std::string& path, const Options& options, RunSample& sample) {
+    if (!options.warm) evict_from_page_cache(path);
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        RunSample run = measure_load(path, options);
+        bool sent = write(fds[1], &run, sizeof(run)) == static_cast<ssize_t>(sizeof(run));
+        _exit(sent ? 0 : 1);
+    }
+    close(fds[1]);
+    size_t received = 0;
+    while (received < sizeof(sample)) {
+        ssize_t n = read(fds[0], reinterpret_cast<char*>(&sample) + received, sizeof(sample) - received);
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return received == sizeof(sample) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+double time_to_first_row(const RunSample& run) {
+    return run.stages[kMap].ms + run.stages[kParse].ms + run.stages[kFirstWindow].ms;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keep") { options.keep = true; continue; }
+        if (arg == "--arm") { options.arm = true; continue; }
+        if (arg == "--warm") { options.warm = true; continue; }
+        if (arg == "-h" || arg == "--help") return false;
+        if (arg.empty() || arg[0] != '-') {
+            options.files.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "--sizes") {
+            for (size_t at = 0; at < value.size();) {
+                size_t comma = value.find(',', at);
+                if (comma == std::string::npos) comma = value.size();
+                options.sizes_mb.push_back(strtoull(value.substr(at, comma - at).c_str(), nullptr, 10));
+                at = comma + 1;
+            }
+        } else if (arg == "--dir") {
+            options.directory = value;
+        } else if (arg == "--class") {
+            options.is_64bit = value == "64";
+        } else if (arg == "--window") {
+            options.window = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--query") {
+            options.query = value;
+        } else if (arg == "--repeat") {
+            options.repetitions = std::max(1, atoi(value.c_str()));
+        } else if (arg == "--json") {
+            options.json_path = value;
+        } else {
+            return false;
+        }
+    }
+    return !options.files.empty() || !options.sizes_mb.empty();
+}
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-bench-load [options] [ELF files...]\n"
+        "  --sizes MB,MB,...  generate synthetic files with this much code (e.g. 100,200,500)\n"
+        "  --class 32|64      class of generated files (default 32)\n"
+        "  --arm              generated files hold ARM instead of Thumb-2 code\n"
+        "  --dir DIR          where to generate (default $TMPDIR or /tmp)\n"
+        "  --keep             keep the generated files\n"
+        "  --window BYTES     first-window size (default 65536; 0 = whole section)\n"
+        "  --query TEXT       symbol query text (default Handler)\n"
+        "  --repeat N         runs per file, the median one by time to first row is reported (default 3)\n"
+        "  --warm             do not evict files from the page cache before each run\n"
+        "  --json FILE        write results as JSON Lines\n");
+}
+
+// Symbols, sections and strings grow with the code, roughly like real
+// libraries (about 3000 functions and 1/8 as much string data per MB).
+SyntheticElfSpec spec_for_size(uint64_t code_mb, const Options& options) {
+    SyntheticElfSpec spec;
+    spec.is_64bit = options.is_64bit;
+    spec.thumb = !options.arm;
+    spec.code_bytes = code_mb << 20;
+    spec.code_sections = static_cast<uint32_t>(std::max<uint64_t>(4, code_mb / 8));
+    spec.symbols = static_cast<uint32_t>(std::min<uint64_t>(code_mb * 3000, UINT32_MAX / 2));
+    spec.dynamic_symbols = spec.symbols / 10;
+    spec.rodata_bytes = (code_mb << 20) / 8;
+    return spec;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    std::vector<std::string> generated;
+    if (!options.sizes_mb.empty()) {
+        std::string directory = options.directory;
+        if (directory.empty()) directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+        for (uint64_t size : options.sizes_mb) {
+            std::string path = directory + "/ktimaz-synthetic-" + std::to_string(size) + "mb-" +
+                               (options.is_64bit ? "64" : "32") + ".elf";
+            fprintf(stderr, "generating %s\n", path.c_str());
+            if (!write_synthetic_elf(path, spec_for_size(size, options))) return 1;
+            generated.push_back(path);
+            options.files.push_back(path);
+        }
+    }
+
+    FILE* json = nullptr;
+    if (!options.json_path.empty() && !(json = fopen(options.json_path.c_str(), "w"))) {
+        fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+        return 2;
+    }
+
+    bool all_ok = true;
+    bool peak_per_stage = true;
+    printf("%-44s %8s %-13s %10s %9s %8s %9s %9s\n", "file", "MB", "stage", "ms", "minflt", "majflt",
+           "rss MB", "peak MB");
+    for (const std::string& path : options.files) {
+        std::vector<RunSample> runs;
+        for (int r = 0; r < options.repetitions; ++r) {
+            RunSample sample{};
+            if (run_in_child(path, options, sample) && sample.ok) runs.push_back(sample);
+        }
+        if (runs.empty()) {
+            fprintf(stderr, "%s: load failed\n", path.c_str());
+            all_ok = false;
+            continue;
+        }
+        std::sort(runs.begin(), runs.end(), [](const RunSample& a, const RunSample& b) {
+            return time_to_first_row(a) < time_to_first_row(b);
+        });
+        const RunSample& run = runs[runs.size() / 2];
+        peak_per_stage = peak_per_stage && run.peak_per_stage;
+
+        struct stat info;
+        double file_mb = stat(path.c_str(), &info) == 0 ? info.st_size / 1048576.0 : 0;
+        std::string label = path.size() > 44 ? "..." + path.substr(path.size() - 41) : path;
+        uint64_t peak_kb = 0;
+        for (int s = 0; s < kStageCount; ++s) {
+            const StageSample& stage = run.stages[s];
+            peak_kb = std::max(peak_kb, stage.peak_rss_kb);
+            printf("%-44s %8.1f %-13s %10.2f %9llu %8llu %9.1f %9.1f\n", s == 0 ? label.c_str() : "",
+                   file_mb, kStageNames[s], stage.ms, static_cast<unsigned long long>(stage.minor_faults),
+                   static_cast<unsigned long long>(stage.major_faults), stage.rss_kb / 1024.0,
+                   stage.peak_rss_kb / 1024.0);
+        }
+        printf("%-44s %8s %-13s %10.2f %9s %8s %9s %9.1f\n", "", "", "first row", time_to_first_row(run), "", "",
+               "", peak_kb / 1024.0);
+
+        if (json) {
+            fprintf(json, "{\"file\":\"%s\",\"mb\":%.2f,\"runs\":%zu,\"window\":%zu,\"symbols\":%llu,"
+                          "\"instructions\":%llu,\"matches\":%llu,\"time_to_first_row_ms\":%.3f,"
+                          "\"peak_rss_kb\":%llu,\"stages\":[",
+                    path.c_str(), file_mb, runs.size(), options.window,
+                    static_cast<unsigned long long>(run.symbols), static_cast<unsigned long long>(run.instructions),
+                    static_cast<unsigned long long>(run.matches), time_to_first_row(run),
+                    static_cast<unsigned long long>(peak_kb));
+            for (int s = 0; s < kStageCount; ++s) {
+                const StageSample& stage = run.stages[s];
+                fprintf(json, "%s{\"name\":\"%s\",\"ms\":%.3f,\"minor_faults\":%llu,\"major_faults\":%llu,"
+                              "\"rss_kb\":%llu,\"peak_rss_kb\":%llu}",
+                        s ? "," : "", kStageNames[s], stage.ms, static_cast<unsigned long long>(stage.minor_faults),
+                        static_cast<unsigned long long>(stage.major_faults),
+                        static_cast<unsigned long long>(stage.rss_kb),
+                        static_cast<unsigned long long>(stage.peak_rss_kb));
+            }
+            fprintf(json, "]}\n");
+        }
+    }
+    if (!peak_per_stage) {
+        fprintf(stderr, "note: peak RSS could not be reset per stage; peaks are cumulative\n");
+    }
+    if (json) fclose(json);
+
+    if (!options.keep) {
+        for (const std::string& path : generated) unlink(path.c_str());
+    }
+    return all_ok ? 0 : 1;
+}
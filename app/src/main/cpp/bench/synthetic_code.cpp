@@ -0,0 +1,416 @@
+#include "synthetic_code.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+void put16(std::vector<uint8_t>& out, uint32_t halfword) {
+    out.push_back(static_cast<uint8_t>(halfword));
+    out.push_back(static_cast<uint8_t>(halfword >> 8));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t word) {
+    put16(out, word & 0xFFFF);
+    put16(out, word >> 16);
+}
+
+// Thumb-2 instructions are stored as two little-endian halfwords, first first.
+void put_thumb32(std::vector<uint8_t>& out, uint32_t first, uint32_t second) {
+    put16(out, first);
+    put16(out, second);
+}
+
+uint32_t register_mask(SyntheticRandom& random, uint32_t always) {
+    return (random.below(0xFF) | always) & 0xFFFF;
+}
+
+// ARM code as compilers emit it, by weight out of 100.
+void arm_mix_instruction(SyntheticRandom& random, std::vector<uint8_t>& out) {
+    uint32_t pick = random.below(100);
+    uint32_t rd = random.below(13), rn = random.below(13);
+    uint32_t cond = random.below(10) == 0 ? random.below(14) : 0xE;
+    if (pick < 30) {
+        // Data processing (MOV, ADD, SUB, CMP, AND, ORR...), register or immediate
+        static const uint32_t opcodes[] = {0xD, 0x4, 0x2, 0xA, 0x0, 0xC, 0x1, 0x3};
+        uint32_t immediate = random.below(2);
+        uint32_t operand = immediate ? random.below(0x1000) : random.below(13) | (random.below(4) << 5);
+        uint32_t opcode = opcodes[random.below(8)];
+        uint32_t set_flags = opcode == 0xA ? 1 : random.below(4) == 0;
+        put32(out, (cond << 28) | (immediate << 25) | (opcode << 21) | (set_flags << 20) |
+                   (rn << 16) | (rd << 12) | operand);
+    } else if (pick < 55) {
+        // LDR/STR/LDRB/STRB with an immediate offset, some PC-relative
+        uint32_t load = random.below(3) != 0;
+        uint32_t base = load && random.below(4) == 0 ? 15 : rn;
+        uint32_t byte = random.below(5) == 0;
+        put32(out, (cond << 28) | 0x05800000 | (byte << 22) | (load << 20) | (base << 16) |
+                   (rd << 12) | random.below(0x100) * 4);
+    } else if (pick < 65) {
+        put32(out, 0xEB000000 | (random.next() & 0xFFFFFF)); // BL
+    } else if (pick < 75) {
+        uint32_t offset = (random.below(0x400) - 0x200) & 0xFFFFFF;
+        put32(out, (random.below(14) << 28) | 0x0A000000 | offset); // B<cond>, short
+    } else if (pick < 83) {
+        bool push = random.below(2) == 0;
+        put32(out, push ? 0xE92D0000 | register_mask(random, 1u << 14)
+                        : 0xE8BD0000 | register_mask(random, 1u << 15));
+    } else if (pick < 88) {
+        put32(out, 0xE12FFF1E); // BX LR
+    } else if (pick < 93) {
+        put32(out, 0xE0000090 | (rd << 16) | (rn << 8) | random.below(13)); // MUL
+    } else {
+        put32(out, static_cast<uint32_t>(random.next())); // Literal pool word
+    }
+}
+
+void thumb16_mix_instruction(SyntheticRandom& random, std::vector<uint8_t>& out) {
+    uint32_t pick = random.below(100);
+    uint32_t rd = random.below(8), rn = random.below(8);
+    if (pick < 15) {
+        put16(out, 0x2000 | (rd << 8) | random.below(256));                 // MOVS Rd, #imm
+    } else if (pick < 25) {
+        put16(out, 0x1800 | (random.below(2) << 9) | (random.below(8) << 6) | (rn << 3) | rd); // ADDS/SUBS
+    } else if (pick < 32) {
+        put16(out, 0x2800 | (rd << 8) | random.below(256));                 // CMP Rn, #imm
+    } else if (pick < 40) {
+        put16(out, 0x4800 | (rd << 8) | random.below(256));                 // LDR Rt, [PC, #imm]
+    } else if (pick < 58) {
+        put16(out, (random.below(2) ? 0x6800 : 0x6000) | (random.below(32) << 6) | (rn << 3) | rd); // LDR/STR
+    } else if (pick < 64) {
+        put16(out, 0xB500 | random.below(256));                             // PUSH {..., LR}
+    } else if (pick < 70) {
+        put16(out, 0xBD00 | random.below(256));                             // POP {..., PC}
+    } else if (pick < 80) {
+        put16(out, 0xD000 | (random.below(14) << 8) | random.below(256));   // B<cond>
+    } else if (pick < 84) {
+        put16(out, 0xE000 | random.below(0x800));                           // B
+    } else if (pick < 87) {
+        put16(out, 0x4770);                                                  // BX LR
+    } else if (pick < 93) {
+        put16(out, 0x4600 | (random.below(16) << 3) | rd);                   // MOV Rd, Rm
+    } else if (pick < 96) {
+        put16(out, 0x4000 | (random.below(16) << 6) | (rn << 3) | rd);       // ALU register ops
+    } else {
+        put16(out, 0xB000 | random.below(256));                              // ADD/SUB SP, #imm
+    }
+}
+
+// Thumb-2 code: mostly 16-bit, about a quarter 32-bit encodings.
+void thumb2_mix_instruction(SyntheticRandom& random, std::vector<uint8_t>& out) {
+    uint32_t pick = random.below(100);
+    uint32_t rt = random.below(13), rn = random.below(13);
+    if (pick < 75) {
+        thumb16_mix_instruction(random, out);
+    } else if (pick < 85) {
+        put_thumb32(out, 0xF000 | random.below(0x400), 0xF800 | random.below(0x800)); // BL
+    } else if (pick < 92) {
+        put_thumb32(out, 0xF8D0 | rn, (rt << 12) | random.below(0x1000));            // LDR.W
+    } else if (pick < 96) {
+        put_thumb32(out, 0xF04F, (rt << 8) | random.below(256));                      // MOV.W
+    } else {
+        put_thumb32(out, 0xE92D, register_mask(random, 1u << 14));                   // PUSH.W
+    }
+}
+
+constexpr uint64_t kImageBase = 0x10000;
+constexpr uint16_t kMachineArm = 40;
+constexpr uint16_t kMachineAArch64 = 183;
+
+constexpr uint32_t kShtProgbits = 1, kShtSymtab = 2, kShtStrtab = 3, kShtDynsym = 11;
+constexpr uint64_t kShfAlloc = 0x2, kShfExecinstr = 0x4;
+
+const char* const kNouns[] = {
+    "Audio", "Buffer", "Cache", "Decoder", "Engine", "Frame", "Graph", "Handler", "Index", "Job",
+    "Kernel", "Layout", "Mesh", "Node", "Parser", "Queue", "Render", "Shader", "Texture", "Vertex",
+    "Widget", "Stream", "Socket", "Codec", "Surface"
+};
+const char* const kVerbs[] = {
+    "init", "update", "draw", "flush", "reset", "read", "write", "process", "dispatch", "release"
+};
+
+// Name of function symbol `index`: mostly Itanium-mangled methods, the
+// rest C and JNI-style names, all unique.
+void function_name(uint64_t seed, uint32_t index, std::string& name) {
+    SyntheticRandom random(seed ^ ((index + 1) * 0x9E3779B97F4A7C15ULL));
+    std::string space = kNouns[random.below(25)];
+    std::string type = kNouns[random.below(25)];
+    std::string method = std::string(kVerbs[random.below(10)]) + std::to_string(index);
+    uint32_t form = random.below(10);
+    name.clear();
+    if (form < 6) {
+        name += "_ZN" + std::to_string(space.size()) + space + std::to_string(type.size()) + type +
+                std::to_string(method.size()) + method + "Ev";
+    } else if (form < 9) {
+        for (char c : space) name += static_cast<char>(c | 0x20);
+        name += '_' + method;
+    } else {
+        name += "Java_com_example_" + type + '_' + method;
+    }
+}
+
+struct SectionRecord {
+    uint32_t name;     // Offset in .shstrtab
+    uint32_t type;
+    uint64_t flags;
+    uint64_t address;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t align;
+    uint64_t entsize;
+};
+
+// Little-endian output with a running file offset.
+class ElfWriter {
+public:
+    ElfWriter(FILE* file, bool is_64bit) : file_(file), is_64bit_(is_64bit) {}
+
+    void bytes(const void* data, size_t size) {
+        if (size != 0 && fwrite(data, 1, size, file_) != size) failed_ = true;
+        offset_ += size;
+    }
+    void u8(uint8_t value) { bytes(&value, 1); }
+    void u16(uint16_t value) { uint8_t b[2] = {uint8_t(value), uint8_t(value >> 8)}; bytes(b, 2); }
+    void u32(uint32_t value) { u16(value & 0xFFFF); u16(value >> 16); }
+    void u64(uint64_t value) { u32(value & 0xFFFFFFFF); u32(value >> 32); }
+    void word(uint64_t value) { is_64bit_ ? u64(value) : u32(static_cast<uint32_t>(value)); }
+
+    void align(uint64_t alignment) {
+        static const uint8_t zeros[16] = {};
+        while (offset_ % alignment != 0) bytes(zeros, std::min<uint64_t>(alignment - offset_ % alignment, 16));
+    }
+
+    void symbol(uint32_t name, uint64_t value, uint64_t size, uint8_t info, uint16_t shndx) {
+        if (is_64bit_) {
+            u32(name); u8(info); u8(0); u16(shndx); u64(value); u64(size);
+        } else {
+            u32(name); u32(static_cast<uint32_t>(value)); u32(static_cast<uint32_t>(size)); u8(info); u8(0); u16(shndx);
+        }
+    }
+
+    void section_header(const SectionRecord& s) {
+        u32(s.name); u32(s.type); word(s.flags); word(s.address); word(s.offset); word(s.size);
+        u32(s.link); u32(s.info); word(s.align); word(s.entsize);
+    }
+
+    uint64_t offset() const { return offset_; }
+    bool failed() const { return failed_; }
+
+private:
+    FILE* file_;
+    bool is_64bit_;
+    uint64_t offset_ = 0;
+    bool failed_ = false;
+};
+
+} // namespace
+
+void append_synthetic_code(SyntheticCode kind, SyntheticRandom& random, size_t bytes, std::vector<uint8_t>& out) {
+    size_t target = out.size() + bytes;
+    while (out.size() < target) {
+        switch (kind) {
+            case SyntheticCode::Random: put32(out, static_cast<uint32_t>(random.next())); break;
+            case SyntheticCode::ArmMix: arm_mix_instruction(random, out); break;
+            case SyntheticCode::Thumb16Mix: thumb16_mix_instruction(random, out); break;
+            case SyntheticCode::Thumb2Mix: thumb2_mix_instruction(random, out); break;
+        }
+    }
+}
+
+std::vector<uint8_t> synthetic_code(SyntheticCode kind, uint64_t seed, size_t bytes) {
+    SyntheticRandom random(seed);
+    std::vector<uint8_t> out;
+    out.reserve(bytes + 4);
+    append_synthetic_code(kind, random, bytes, out);
+    // Never end on half of a 32-bit instruction
+    out.resize(kind == SyntheticCode::Thumb2Mix ? bytes & ~size_t(3) : bytes);
+    return out;
+}
+
+bool write_synthetic_elf(const std::string& path, const SyntheticElfSpec& spec) {
+    const bool wide = spec.is_64bit;
+    const uint32_t code_sections = std::max<uint32_t>(1, std::min<uint32_t>(spec.code_sections, 0xF000));
+    const uint64_t per_section = std::max<uint64_t>(4, spec.code_bytes / code_sections & ~uint64_t(3));
+    const uint64_t code_bytes = per_section * code_sections;
+    const uint32_t symbols = spec.symbols;
+    const uint32_t dynamic_symbols = std::min(spec.dynamic_symbols, symbols);
+    const uint64_t spacing = symbols ? std::max<uint64_t>(4, code_bytes / symbols & ~uint64_t(3)) : 0;
+    const size_t symbol_size = wide ? 24 : 16;
+
+    std::unique_ptr<FILE, int (*)(FILE*)> file(fopen(path.c_str(), "wb"), fclose);
+    if (!file) {
+        log_error("Cannot create " + path);
+        return false;
+    }
+    setvbuf(file.get(), nullptr, _IOFBF, 1 << 20);
+    ElfWriter out(file.get(), wide);
+
+    std::string shstrtab(1, '\0');
+    auto section_name = [&](const std::string& name) {
+        uint32_t offset = static_cast<uint32_t>(shstrtab.size());
+        shstrtab += name;
+        shstrtab += '\0';
+        return offset;
+    };
+    std::vector<SectionRecord> sections(1, SectionRecord{});
+
+    // The header is rewritten once the section header table's offset is known
+    const size_t header_size = wide ? 64 : 52;
+    std::vector<uint8_t> placeholder(header_size, 0);
+    out.bytes(placeholder.data(), placeholder.size());
+
+    // Code, generated and written a chunk at a time
+    SyntheticRandom random(spec.seed);
+    SyntheticCode kind = spec.thumb ? SyntheticCode::Thumb2Mix : SyntheticCode::ArmMix;
+    std::vector<uint8_t> chunk;
+    out.align(4);
+    const uint64_t code_offset = out.offset();
+    for (uint32_t i = 0; i < code_sections; ++i) {
+        SectionRecord section{section_name(i == 0 ? ".text" : ".text." + std::to_string(i)), kShtProgbits,
+                              kShfAlloc | kShfExecinstr, kImageBase + out.offset(), out.offset(), per_section,
+                              0, 0, 4, 0};
+        for (uint64_t left = per_section; left > 0;) {
+            size_t want = static_cast<size_t>(std::min<uint64_t>(left, 1 << 20));
+            chunk.clear();
+            append_synthetic_code(kind, random, want, chunk);
+            if (chunk.size() > want) {
+                // Cut through a 32-bit instruction: end on a NOP instead
+                chunk.resize(want);
+                chunk[want - 2] = 0x00;
+                chunk[want - 1] = 0xBF;
+            }
+            out.bytes(chunk.data(), chunk.size());
+            left -= want;
+        }
+        sections.push_back(section);
+    }
+
+    // Strings for the string table stage
+    out.align(4);
+    SectionRecord rodata{section_name(".rodata"), kShtProgbits, kShfAlloc, kImageBase + out.offset(),
+                         out.offset(), spec.rodata_bytes, 0, 0, 4, 0};
+    std::string text;
+    for (uint64_t left = spec.rodata_bytes; left > 0;) {
+        text.clear();
+        for (uint32_t words = 1 + random.below(8); words > 0; --words) {
+            text += random.below(4) == 0 ? kVerbs[random.below(10)] : kNouns[random.below(25)];
+            text += words > 1 ? " " : (random.below(3) == 0 ? ": %d" : "");
+        }
+        text += '\0';
+        size_t take = static_cast<size_t>(std::min<uint64_t>(left, text.size()));
+        if (take < text.size()) text[take - 1] = '\0';
+        out.bytes(text.data(), take);
+        left -= take;
+    }
+    sections.push_back(rodata);
+
+    // Function symbols are laid out evenly over the code; the symbol tables
+    // are streamed, and their string tables regenerate the same names
+    const uint32_t symtab_index = static_cast<uint32_t>(sections.size());
+    auto symbol_value = [&](uint32_t index) { return kImageBase + code_offset + index * spacing + (spec.thumb ? 1 : 0); };
+    auto symbol_section = [&](uint32_t index) {
+        return static_cast<uint16_t>(1 + std::min<uint64_t>(index * spacing / per_section, code_sections - 1));
+    };
+    auto dynamic_symbol = [&](uint32_t k) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(k) * symbols / std::max<uint32_t>(dynamic_symbols, 1));
+    };
+    std::string name;
+
+    out.align(8);
+    const char mapping_names[] = "\0$a\0$t"; // Offsets 1 and 4
+    SectionRecord symtab{section_name(".symtab"), kShtSymtab, 0, 0, out.offset(), 0, symtab_index + 1,
+                         1 + code_sections, 8, symbol_size};
+    out.symbol(0, 0, 0, 0, 0);
+    for (uint32_t i = 0; i < code_sections; ++i) {
+        out.symbol(spec.thumb ? 4 : 1, sections[1 + i].address, 0, 0x00 /* STB_LOCAL, STT_NOTYPE */, 1 + i);
+    }
+    uint32_t name_offset = sizeof(mapping_names);
+    for (uint32_t i = 0; i < symbols; ++i) {
+        function_name(spec.seed, i, name);
+        out.symbol(name_offset, symbol_value(i), spacing, 0x12 /* STB_GLOBAL, STT_FUNC */, symbol_section(i));
+        name_offset += static_cast<uint32_t>(name.size() + 1);
+    }
+    symtab.size = out.offset() - symtab.offset;
+    sections.push_back(symtab);
+
+    SectionRecord strtab{section_name(".strtab"), kShtStrtab, 0, 0, out.offset(), 0, 0, 0, 1, 0};
+    out.bytes(mapping_names, sizeof(mapping_names));
+    for (uint32_t i = 0; i < symbols; ++i) {
+        function_name(spec.seed, i, name);
+        out.bytes(name.c_str(), name.size() + 1);
+    }
+    strtab.size = out.offset() - strtab.offset;
+    sections.push_back(strtab);
+
+    out.align(8);
+    SectionRecord dynsym{section_name(".dynsym"), kShtDynsym, kShfAlloc, 0, out.offset(), 0, symtab_index + 3,
+                         1, 8, symbol_size};
+    dynsym.address = kImageBase + dynsym.offset;
+    out.symbol(0, 0, 0, 0, 0);
+    name_offset = 1;
+    for (uint32_t k = 0; k < dynamic_symbols; ++k) {
+        uint32_t i = dynamic_symbol(k);
+        function_name(spec.seed, i, name);
+        out.symbol(name_offset, symbol_value(i), spacing, 0x12, symbol_section(i));
+        name_offset += static_cast<uint32_t>(name.size() + 1);
+    }
+    dynsym.size = out.offset() - dynsym.offset;
+    sections.push_back(dynsym);
+
+    SectionRecord dynstr{section_name(".dynstr"), kShtStrtab, kShfAlloc, kImageBase + out.offset(), out.offset(),
+                         0, 0, 0, 1, 0};
+    out.u8(0);
+    for (uint32_t k = 0; k < dynamic_symbols; ++k) {
+        function_name(spec.seed, dynamic_symbol(k), name);
+        out.bytes(name.c_str(), name.size() + 1);
+    }
+    dynstr.size = out.offset() - dynstr.offset;
+    sections.push_back(dynstr);
+
+    const uint32_t shstrtab_index = static_cast<uint32_t>(sections.size());
+    SectionRecord shstrtab_section{section_name(".shstrtab"), kShtStrtab, 0, 0, out.offset(), 0, 0, 0, 1, 0};
+    shstrtab_section.size = shstrtab.size();
+    out.bytes(shstrtab.data(), shstrtab.size());
+    sections.push_back(shstrtab_section);
+
+    out.align(8);
+    const uint64_t section_headers = out.offset();
+    for (const SectionRecord& section : sections) out.section_header(section);
+
+    if (!wide && out.offset() > UINT32_MAX) {
+        log_error("Synthetic ELF32 would exceed 4 GB: " + path);
+        return false;
+    }
+
+    // ELF header
+    if (fseek(file.get(), 0, SEEK_SET) != 0) {
+        log_error("Cannot rewind " + path);
+        return false;
+    }
+    ElfWriter header(file.get(), wide);
+    const uint8_t ident[16] = {0x7F, 'E', 'L', 'F', uint8_t(wide ? 2 : 1), 1 /* little-endian */, 1};
+    header.bytes(ident, sizeof(ident));
+    header.u16(2); // ET_EXEC
+    header.u16(wide ? kMachineAArch64 : kMachineArm);
+    header.u32(1); // EV_CURRENT
+    header.word(sections[1].address + (spec.thumb ? 1 : 0));
+    header.word(0); // No program headers
+    header.word(section_headers);
+    header.u32(wide ? 0 : 0x05000000); // EF_ARM_EABI_VER5
+    header.u16(static_cast<uint16_t>(header_size));
+    header.u16(0);
+    header.u16(0);
+    header.u16(static_cast<uint16_t>(wide ? 64 : 40));
+    header.u16(static_cast<uint16_t>(sections.size()));
+    header.u16(static_cast<uint16_t>(shstrtab_index));
+
+    if (out.failed() || header.failed() || fflush(file.get()) != 0) {
+        log_error("Write failed: " + path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_SYNTHETIC_CODE_H
+#define MOBILE_ARM_DISASSEMBLER_SYNTHETIC_CODE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Deterministic synthetic inputs for the benchmarks: instruction streams and
+// whole ELF files. The same seed gives the same bytes on every platform and
+// build, so results from different commits are comparable.
+
+constexpr uint64_t kSyntheticSeed = 0x6B74696D617A3031ULL; // Never change: keeps runs comparable
+
+// xorshift64*: small, fast and identical on every platform.
+class SyntheticRandom {
+public:
+    explicit SyntheticRandom(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>(next() % bound); }
+
+private:
+    uint64_t state_;
+};
+
+enum class SyntheticCode {
+    Random,     // Uniformly random words: every decoder path, invalid ones included
+    ArmMix,     // ARM code weighted like compiler output, with literal pool words
+    Thumb16Mix, // 16-bit Thumb only
+    Thumb2Mix   // Mostly 16-bit Thumb, about a quarter 32-bit Thumb-2 encodings
+};
+
+// Appends whole instructions of `kind` to `out` until it has grown by at
+// least `bytes` (a Thumb-2 stream may overshoot by two bytes).
+void append_synthetic_code(SyntheticCode kind, SyntheticRandom& random, size_t bytes, std::vector<uint8_t>& out);
+
+// A stream of exactly `bytes` bytes (a multiple of 4 for Thumb2Mix).
+std::vector<uint8_t> synthetic_code(SyntheticCode kind, uint64_t seed, size_t bytes);
+
+// Shape of a generated ELF file. Code is split evenly over the code
+// sections, function symbols evenly over the code.
+struct SyntheticElfSpec {
+    bool is_64bit = false;         // ELF64 files are EM_AARCH64, but still hold ARM/Thumb code
+    bool thumb = true;             // Thumb-2 code (entry point with the Thumb bit), else ARM
+    uint64_t code_bytes = 64ULL << 20;
+    uint32_t code_sections = 16;
+    uint32_t symbols = 200000;     // Function symbols in .symtab
+    uint32_t dynamic_symbols = 20000; // Of those, also exported through .dynsym
+    uint64_t rodata_bytes = 8ULL << 20; // NUL-terminated strings
+    uint64_t seed = kSyntheticSeed;
+};
+
+// Writes the file without holding it in memory; false (and a log_error)
+// on I/O failure.
+bool write_synthetic_elf(const std::string& path, const SyntheticElfSpec& spec);
+
+#endif //MOBILE_ARM_DISASSEMBLER_SYNTHETIC_CODE_H
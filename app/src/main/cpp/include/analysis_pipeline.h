@@ -0,0 +1,87 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_ANALYSIS_PIPELINE_H
+#define MOBILE_ARM_DISASSEMBLER_ANALYSIS_PIPELINE_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "task_scheduler.h"
+
+// Results computed after a file is parsed, in rough dependency order.
+enum class AnalysisStage : int {
+    SymbolIndex = 0, // Symbol query index and operand name resolution
+    ModeMap = 1,     // ARM/Thumb/data map from mapping symbols
+    Strings = 2,     // String extraction
+    Sweep = 3,       // Whole-binary decode: search index, xrefs, string references
+    Functions = 4,   // Function table
+    CallGraph = 5,
+    EntryCfg = 6,    // Control flow graph of the entry point's function
+    ContentMap = 7   // Entropy and code/data/packed classification of the file
+};
+constexpr int kAnalysisStageCount = 8;
+
+// Runs analysis stages on the scheduler as their dependencies complete.
+//
+// Every stage starts as background work and publishes its result itself as
+// soon as it is done, so the file is usable right after parsing and gets
+// richer over time. promote() moves a stage the user is waiting for, and
+// everything it depends on, to the interactive lane. All tasks share one
+// cancellation group; cancelling it abandons the rest of the pipeline.
+class AnalysisPipeline : public std::enable_shared_from_this<AnalysisPipeline> {
+public:
+    // Computes and publishes a stage; returns false if it gave up because
+    // the pipeline was cancelled. `priority` is the lane it runs in, for any
+    // work it fans out.
+    using StageFunction = std::function<bool(TaskPriority priority)>;
+    using StageListener = std::function<void(AnalysisStage stage)>;
+
+    AnalysisPipeline(TaskScheduler& scheduler, std::shared_ptr<CancellationGroup> group);
+
+    // Only before start().
+    void add_stage(AnalysisStage stage, std::vector<AnalysisStage> dependencies, StageFunction function);
+    void set_listener(StageListener listener);
+
+    void start();
+    void promote(AnalysisStage stage);
+    void cancel() { group_->cancel(); }
+
+    bool is_cancelled() const { return group_->is_cancelled(); }
+    bool is_complete(AnalysisStage stage) const { return completed_ & (1u << static_cast<int>(stage)); }
+    uint32_t completed_mask() const { return completed_; }
+
+private:
+    enum class StageState : uint8_t {
+        Unused,
+        Waiting,   // For dependencies
+        Queued,
+        Running,
+        Done,
+        Abandoned
+    };
+    struct Stage {
+        StageState state = StageState::Unused;
+        bool promoted = false;
+        std::vector<AnalysisStage> dependencies;
+        StageFunction function;
+    };
+
+    TaskScheduler& scheduler_;
+    std::shared_ptr<CancellationGroup> group_;
+    std::atomic<uint32_t> completed_{0};
+
+    std::mutex mutex_; // Guards everything below
+    Stage stages_[kAnalysisStageCount];
+    StageListener listener_;
+    bool started_ = false;
+
+    bool dependencies_done(const Stage& stage) const;
+    void submit_locked(AnalysisStage stage, TaskPriority priority);
+    void submit_ready_locked();
+    void promote_locked(AnalysisStage stage);
+    void run_stage(AnalysisStage stage, TaskPriority priority);
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_ANALYSIS_PIPELINE_H
@@ -0,0 +1,182 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_ARENA_H
+#define MOBILE_ARM_DISASSEMBLER_ARENA_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Subsystems whose native memory is accounted separately.
+enum class MemoryCategory : uint8_t {
+    Symbols = 0,     // Section headers, symbol table and symbol index
+    Strings = 1,     // String table
+    Decode = 2,      // Decoded instruction buffers and listing text
+    SearchIndex = 3, // Instruction search index
+    Xrefs = 4,       // Xref index
+    Functions = 5,   // Function table and call graph
+    Cfg = 6,         // Control flow graphs
+    Count = 7
+};
+
+const char* memory_category_name(MemoryCategory category);
+
+struct MemoryUsage {
+    size_t bytes[static_cast<size_t>(MemoryCategory::Count)] = {};
+    size_t peak_bytes[static_cast<size_t>(MemoryCategory::Count)] = {};
+
+    size_t total() const;
+};
+
+// Adds `delta` bytes to a category's live total (lock-free).
+void memory_account(MemoryCategory category, ptrdiff_t delta);
+MemoryUsage memory_usage();
+
+// Heap bytes reserved by containers, for MemoryCharge::set().
+template <typename T, typename Allocator>
+size_t capacity_bytes(const std::vector<T, Allocator>& container) { return container.capacity() * sizeof(T); }
+inline size_t capacity_bytes(const std::string& text) { return text.capacity(); }
+
+template <typename First, typename... Rest>
+size_t capacity_bytes(const First& first, const Rest&... rest) {
+    return capacity_bytes(first) + capacity_bytes(rest...);
+}
+
+// Bytes held by one long-lived object, charged to its category for as long
+// as the object exists. Owners call set() once their size is known.
+class MemoryCharge {
+public:
+    explicit MemoryCharge(MemoryCategory category) : category_(category) {}
+    ~MemoryCharge() { set(0); }
+    MemoryCharge(const MemoryCharge&) = delete;
+    MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+    void set(size_t bytes);
+    size_t bytes() const { return bytes_; }
+
+private:
+    MemoryCategory category_;
+    size_t bytes_ = 0;
+};
+
+// Bump allocator for objects that die together.
+//
+// Memory comes from blocks that grow geometrically up to a cap; allocating
+// is a pointer bump and nothing is freed individually. reset() drops every
+// allocation at once while keeping the first block for reuse, so releasing
+// a page or a document costs one free per block, independent of how many
+// objects were made. Only trivially destructible objects may be created.
+class Arena {
+public:
+    explicit Arena(MemoryCategory category, size_t initial_block_size = 4096);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Copies `text` into the arena; the view stays valid until reset().
+    std::string_view copy(std::string_view text);
+
+    // Drops all allocations, keeping the first block for reuse.
+    void reset();
+    // Drops all allocations and frees every block.
+    void release();
+
+    size_t bytes_used() const { return used_; }
+    size_t bytes_reserved() const { return reserved_; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    static constexpr size_t kMaxBlockSize = 1 << 20;
+
+    MemoryCategory category_;
+    size_t initial_block_size_;
+    std::vector<Block> blocks_;
+    char* cursor_ = nullptr;
+    char* limit_ = nullptr;
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+
+    void add_block(size_t minimum_size);
+};
+
+// STL allocator handing out arena memory; deallocate() is a no-op, so it
+// suits node-based build-time structures that are dropped as a whole.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena_->allocate(sizeof(T) * count, alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    Arena* arena_;
+};
+
+// Recycles heavyweight objects (decode buffers and the like) between
+// short-lived users on any thread. acquire() hands out an idle object or
+// makes a new one; release() makes it available again without freeing what
+// it has grown. Objects live until the pool is destroyed or clear()ed.
+template <typename T>
+class ObjectPool {
+public:
+    T* acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            T* object = idle_.back();
+            idle_.pop_back();
+            return object;
+        }
+        objects_.push_back(std::make_unique<T>());
+        return objects_.back().get();
+    }
+
+    void release(T* object) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(object);
+    }
+
+    // Frees every object; none may be in use.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.clear();
+        objects_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return objects_.size();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<T>> objects_;
+    std::vector<T*> idle_;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_ARENA_H
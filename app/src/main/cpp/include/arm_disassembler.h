@@ -2,20 +2,95 @@
 #define MOBILE_ARM_DISASSEMBLER_ARM_DISASSEMBLER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
-// Represents a disassembled instruction
+// How an instruction transfers control (for CFG and call graph construction)
+enum class BranchKind : uint8_t {
+    None = 0,
+    Jump,         // Direct branch (B, CBZ, ...), see is_conditional
+    Call,         // Direct call (BL/BLX imm), returns to the next instruction
+    IndirectJump, // BX Rm, MOV PC, Rm, LDR PC, ...
+    IndirectCall, // BLX Rm
+    Return        // BX LR, POP/LDM {..., PC}, MOV PC, LR
+};
+
+// Value of the DisassembledInstruction register fields when unused
+constexpr uint8_t NO_REGISTER = 0xFF;
+
+// Fixed-capacity, NUL-terminated text stored inline, so decoding needs no
+// heap allocation. Text beyond the capacity is cut off.
+template <size_t Capacity>
+class InlineText {
+public:
+    InlineText() { text_[0] = '\0'; }
+    InlineText(std::string_view text) { assign(text); }
+
+    InlineText& operator=(std::string_view text) { return assign(text); }
+    InlineText& operator+=(std::string_view text) { return append(text); }
+    InlineText& operator+=(char c) { return append(std::string_view(&c, 1)); }
+
+    InlineText& assign(std::string_view text) {
+        length_ = 0;
+        return append(text);
+    }
+    InlineText& append(std::string_view text) {
+        size_t count = text.size() < Capacity - length_ ? text.size() : Capacity - length_;
+        if (count != 0) memcpy(text_ + length_, text.data(), count);
+        length_ += static_cast<uint8_t>(count);
+        text_[length_] = '\0';
+        return *this;
+    }
+    void clear() { assign(std::string_view()); }
+
+    bool empty() const { return length_ == 0; }
+    size_t size() const { return length_; }
+    const char* c_str() const { return text_; }
+    std::string_view view() const { return std::string_view(text_, length_); }
+    operator std::string_view() const { return view(); }
+
+    bool operator==(std::string_view other) const { return view() == other; }
+    bool operator!=(std::string_view other) const { return view() != other; }
+
+private:
+    static_assert(Capacity < 256, "length is stored in one byte");
+    uint8_t length_ = 0;
+    char text_[Capacity + 1];
+};
+
+// Represents a disassembled instruction. Trivially copyable: text is stored
+// inline, and the optional comment points into an Arena owned by whoever
+// annotated the instruction (see OperandResolver::annotate).
 struct DisassembledInstruction {
     uint64_t address;
-    uint32_t bytes;      // Raw instruction bytes (e.g., 4 bytes for ARM/ARM64, 2/4 for Thumb)
-    std::string mnemonic;
-    std::string operands;
-    std::string comment; // For potential inline comments (e.g., resolved symbol)
+    uint32_t bytes;      // Raw instruction bytes; Thumb-2 holds the first halfword in the upper 16 bits
+    uint8_t size;        // Instruction length in bytes (2 or 4)
+    InlineText<15> mnemonic;
+    InlineText<79> operands;  // Longest form: "R10!, " plus a full register list
+    std::string_view comment; // For potential inline comments (e.g., resolved symbol)
     bool is_branch;
-    uint64_t branch_target; // If it's a branch, its target address
+    BranchKind branch_kind;
+    bool is_conditional;    // Executes only if its condition holds (may fall through)
+    uint64_t branch_target; // If it's a direct branch, its target address
+    uint64_t data_target;   // PC-relative literal/ADR address, 0 if none
+    uint8_t data_size;      // Bytes loaded from data_target (0 when only its address is formed)
+    uint8_t data_register;  // Register receiving the literal/address or PC add result, or NO_REGISTER
+    uint8_t pc_add_register; // Rm of ADD Rd, PC, Rm / ADD Rdn, PC, else NO_REGISTER
 };
 
+// True for the placeholders the decoder emits for encodings it does not
+// handle ("???", "UNK", "T16_UNK", "T32_UNK").
+inline bool is_undecodable(const DisassembledInstruction& instr) {
+    std::string_view mnemonic = instr.mnemonic;
+    return mnemonic == "???" || (mnemonic.size() >= 3 && mnemonic.substr(mnemonic.size() - 3) == "UNK");
+}
+
+// Appends the listing form of `instr`, "0000A1B4  MOV R0, R1", to `out`
+// (without a newline or the comment). Allocates only when `out` grows.
+void append_listing_line(std::string& out, const DisassembledInstruction& instr);
+
 // Simplified ARM/Thumb/ARM64 Disassembler Interface
 class ArmDisassembler {
 public:
@@ -30,6 +105,15 @@ public:
     std::vector<DisassembledInstruction> disassemble_block(
         const uint8_t* data, size_t data_size, uint64_t base_address, bool is_thumb_mode);
 
+    // disassemble_block() into `out`, replacing its contents. Reusing one
+    // buffer across blocks keeps bulk decoding free of allocations.
+    void disassemble_block_into(const uint8_t* data, size_t data_size, uint64_t base_address,
+                                bool is_thumb_mode, std::vector<DisassembledInstruction>& out);
+
+    // Decode the single instruction at `data`; `available` bytes may be read.
+    DisassembledInstruction decode_one(
+        const uint8_t* data, size_t available, uint64_t address, bool is_thumb_mode);
+
 private:
     // Internal helper for decoding a single instruction
     DisassembledInstruction decode_instruction(
@@ -37,16 +121,20 @@ private:
 
     // ARM instruction decoding methods
     void decode_arm_instruction(uint32_t instruction, DisassembledInstruction& instr, uint64_t current_address);
-    void decode_data_processing(uint32_t instruction, DisassembledInstruction& instr, const std::string& cond_suffix);
-    void decode_load_store(uint32_t instruction, DisassembledInstruction& instr, const std::string& cond_suffix);
-    
+    void decode_data_processing(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix);
+    void decode_load_store(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix);
+    void decode_block_transfer(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix);
+
     // Thumb instruction decoding methods
     void decode_thumb16_instruction(uint16_t instruction, DisassembledInstruction& instr);
     void decode_thumb32_instruction(uint32_t instruction, DisassembledInstruction& instr);
     void decode_thumb_data_processing(uint16_t instruction, DisassembledInstruction& instr);
     
     // Helper methods
-    std::string get_condition_suffix(uint8_t condition);
+    static const char* get_condition_suffix(uint8_t condition);
+    static const char* register_name(uint32_t reg);
+    template <size_t Capacity>
+    static void append_register_list(InlineText<Capacity>& text, uint32_t mask);
 
     // Placeholder for actual ARM/Thumb/ARM64 decoding logic
     // In a real implementation, this would involve complex bitwise operations
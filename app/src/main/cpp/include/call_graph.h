@@ -0,0 +1,115 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_CALL_GRAPH_H
+#define MOBILE_ARM_DISASSEMBLER_CALL_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "elf_parser.h"
+#include "function_table.h"
+#include "xref_index.h"
+#include "arena.h"
+
+// A PLT stub and the dynamic symbol its GOT slot is bound to.
+struct PltImport {
+    uint64_t stub_address;
+    uint32_t symbol_index; // Into ElfParser::get_symbols()
+};
+
+// Decodes ARM PLT entries (ADD ip, pc / ADD ip, ip / LDR pc, [ip, #]!, with
+// an optional Thumb "BX pc; NOP" prefix) and matches their GOT slots with
+// R_ARM_JUMP_SLOT relocations. Sorted by stub address.
+std::vector<PltImport> resolve_plt_imports(const ElfParser& parser);
+
+enum CallGraphNodeFlags : uint32_t {
+    CALL_NODE_IMPORT    = 0x1, // PLT stub of an imported function
+    CALL_NODE_RECURSIVE = 0x2  // In a cycle (SCC of size > 1 or self call)
+};
+
+enum class CallGraphQuery : int {
+    Callers = 0,
+    Callees = 1,
+    ReachableFrom = 2, // Transitive callees
+    Reaching = 3       // Transitive callers
+};
+
+struct CallGraphPage {
+    size_t total_matches = 0;
+    std::vector<uint32_t> nodes;
+};
+
+// Function-level call graph over a FunctionTable.
+//
+// Nodes are the table's functions (same indices); edges come from direct
+// call xrefs and from jumps that land on another function's start (tail
+// calls), deduplicated and stored as CSR in both directions. PLT stubs are
+// named after the import they resolve to, so "callers of dlopen" works on
+// stripped binaries.
+//
+// Tarjan's algorithm condenses the graph into strongly connected components
+// once. Transitive queries walk the condensed DAG and the sorted node list
+// per start component is kept in a small LRU cache, so paging through a
+// large closure does not recompute it.
+class CallGraph {
+public:
+    CallGraph(const ElfParser& parser, const FunctionTable& functions, const XrefIndex& xrefs);
+
+    size_t node_count() const { return node_flags_.size(); }
+    size_t edge_count() const { return callees_.size(); }
+    size_t component_count() const { return component_offsets_.size() - 1; }
+
+    uint64_t address(uint32_t node) const { return functions_.function(node).start; }
+    std::string name(uint32_t node) const;
+    uint32_t flags(uint32_t node) const { return node_flags_[node]; }
+    uint32_t component(uint32_t node) const { return component_of_[node]; }
+
+    // Node for a function containing `address`, or -1.
+    long find_by_address(uint64_t address) const;
+    // Node whose name (symbol or import) equals `name`, or -1.
+    long find_by_name(const std::string& name) const;
+
+    CallGraphPage query(uint32_t node, CallGraphQuery kind, size_t offset, size_t limit) const;
+
+    // Nodes of a shortest call chain from `from` to `to` (both included),
+    // empty when `to` is unreachable.
+    std::vector<uint32_t> shortest_path(uint32_t from, uint32_t to) const;
+
+private:
+    const ElfParser& parser_;
+    const FunctionTable& functions_;
+
+    std::vector<uint32_t> node_flags_;
+    std::vector<int32_t> import_symbol_; // Node -> import symbol index, -1 if none
+    std::unordered_map<std::string, uint32_t> by_name_;
+
+    std::vector<uint32_t> callee_offsets_, callees_; // CSR by caller
+    std::vector<uint32_t> caller_offsets_, callers_; // CSR by callee
+
+    // SCCs: component_of_ per node, members of each component as CSR, and
+    // the condensed DAG in both directions.
+    std::vector<uint32_t> component_of_;
+    std::vector<uint32_t> component_offsets_, component_members_;
+    std::vector<uint32_t> dag_offsets_, dag_successors_;
+    std::vector<uint32_t> dag_pred_offsets_, dag_predecessors_;
+
+    static constexpr size_t kClosureCacheSize = 32;
+    mutable std::mutex cache_mutex_;
+    using CacheKey = std::pair<uint32_t, bool>; // (component, towards callers)
+    struct CacheKeyHash {
+        size_t operator()(const CacheKey& key) const { return (static_cast<size_t>(key.first) << 1) | key.second; }
+    };
+    mutable std::list<std::pair<CacheKey, std::vector<uint32_t>>> closure_lru_;
+    mutable std::unordered_map<CacheKey, decltype(closure_lru_)::iterator, CacheKeyHash> closure_cache_;
+
+    MemoryCharge memory_{MemoryCategory::Functions}; // Excludes the closure cache
+
+    void build_edges(const XrefIndex& xrefs);
+    void condense();
+    std::vector<uint32_t> closure(uint32_t component, bool towards_callers) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_CALL_GRAPH_H
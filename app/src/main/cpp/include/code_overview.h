@@ -0,0 +1,99 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_CODE_OVERVIEW_H
+#define MOBILE_ARM_DISASSEMBLER_CODE_OVERVIEW_H
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "code_sweep.h"
+#include "task_scheduler.h"
+#include "arena.h"
+
+// What one stretch of a section holds. Instructions are counted in the
+// bucket their first byte is in.
+struct OverviewBucket {
+    uint32_t branches = 0;     // Jumps and returns, direct or indirect
+    uint32_t calls = 0;        // Direct and indirect calls
+    uint32_t loads_stores = 0; // LDR/STR/LDM/STM/PUSH/POP and friends
+    uint32_t other = 0;        // Decoded, none of the above
+    uint32_t unknown = 0;      // Undecodable encodings
+    uint32_t data_bytes = 0;   // Bytes in data runs ($d)
+    uint32_t zero_bytes = 0;   // 0x00 bytes, mostly padding
+    uint32_t symbols = 0;      // Named symbols starting here
+    uint16_t entropy = 0;      // Shannon entropy in 1/256 bits per byte (0..2048)
+};
+
+// One level of a section's pyramid: bucket i covers
+// [start + i * bucket_bytes, start + (i + 1) * bucket_bytes), the last one
+// cut at the section end.
+struct OverviewLevel {
+    uint64_t start = 0;
+    uint64_t bucket_bytes = 0;
+    const OverviewBucket* buckets = nullptr;
+    size_t bucket_count = 0;
+};
+
+// Multi-resolution summary of the executable sections, for minimaps and
+// heat strips.
+//
+// Each section gets a pyramid: the finest level has fixed-size buckets
+// (at most kMaxBuckets of them), and every coarser level halves the bucket
+// count by merging neighbours, down to a single bucket. Counts add up;
+// entropy is the byte-weighted mean of the finer buckets, i.e. how random
+// the bytes look locally rather than over the merged range. Any zoom level
+// is then one level() lookup whose buckets can be drawn directly, without
+// touching instructions.
+//
+// Instruction counts come from the first sweep (add_instructions(), safe
+// from several sweep threads at once); finalize() adds the byte
+// statistics, data runs and symbols and builds the coarser levels.
+class CodeOverview {
+public:
+    static constexpr uint64_t kMinBucketBytes = 512;
+    static constexpr size_t kMaxBuckets = 64 * 1024;
+
+    CodeOverview(const ElfParser& parser, const std::vector<size_t>& sections);
+
+    void add_instructions(size_t section_index, const std::vector<DisassembledInstruction>& instructions);
+    void finalize(const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                  TaskPriority priority);
+
+    // Recounts [start, end) of a section after its bytes changed; costs a
+    // decode of the finest buckets it touches. Callers serialise it with
+    // readers.
+    void refresh(const ElfParser& parser, const ModeMap& mode_map, ArmDisassembler& disassembler,
+                 size_t section_index, uint64_t start, uint64_t end);
+
+    // The coarsest level of the section with at least `min_buckets` buckets,
+    // or its finest level if none has that many. False if the section has
+    // no overview. The buckets stay valid until the next refresh().
+    bool level(size_t section_index, size_t min_buckets, OverviewLevel& out) const;
+
+    size_t memory_bytes() const { return memory_.bytes(); }
+
+private:
+    struct Pyramid {
+        size_t section_index;
+        uint64_t start;
+        uint64_t size;
+        uint64_t bucket_bytes;              // Of the finest level
+        std::vector<size_t> level_offsets;  // Into buckets, finest first; one extra at the end
+        std::vector<OverviewBucket> buckets;
+    };
+
+    std::vector<Pyramid> pyramids_; // By section index
+    std::mutex add_mutex_;          // Guards instruction counts during the sweep
+    MemoryCharge memory_{MemoryCategory::Decode};
+
+    Pyramid* find(size_t section_index);
+    const Pyramid* find(size_t section_index) const;
+    void count_instructions(Pyramid& pyramid, const std::vector<DisassembledInstruction>& instructions,
+                            uint64_t start, uint64_t end);
+    static void scan_bytes(const ElfParser& parser, const ModeMap& mode_map, Pyramid& pyramid,
+                           size_t first, size_t last);
+    static void merge_levels(Pyramid& pyramid, size_t first, size_t last);
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_CODE_OVERVIEW_H
@@ -0,0 +1,93 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_CODE_SWEEP_H
+#define MOBILE_ARM_DISASSEMBLER_CODE_SWEEP_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+
+enum class CodeMode : uint8_t {
+    Arm,
+    Thumb,
+    Data
+};
+
+// Address -> instruction set map built from ARM ELF mapping symbols
+// ($a/$t/$d) and odd-valued STT_FUNC symbols (Thumb interworking bit).
+class ModeMap {
+public:
+    ModeMap(const ElfParser& parser, CodeMode default_mode);
+
+    CodeMode mode_at(uint64_t address) const;
+
+    // Splits [start, end) into consecutive runs of a single mode.
+    struct Run {
+        uint64_t start;
+        uint64_t end;
+        CodeMode mode;
+    };
+    std::vector<Run> runs(uint64_t start, uint64_t end) const;
+
+    CodeMode default_mode() const { return default_mode_; }
+
+private:
+    struct Transition {
+        uint64_t address;
+        CodeMode mode;
+    };
+    std::vector<Transition> transitions_; // Sorted by address
+    CodeMode default_mode_;
+};
+
+// Thumb for ARM executables whose entry point has the interworking bit set,
+// ARM otherwise.
+CodeMode default_code_mode(const ElfParser& parser);
+
+// Receives one decoded run of an executable section.
+using SweepSink = std::function<void(size_t section_index, const std::vector<DisassembledInstruction>& instructions)>;
+
+// Indices of SHF_EXECINSTR sections that have file contents.
+std::vector<size_t> executable_section_indices(const ElfParser& parser);
+
+// Decodes one executable section run by run (data runs are skipped) and
+// hands every run to `sink`.
+void sweep_section(const ElfParser& parser, ArmDisassembler& disassembler,
+                   const ModeMap& mode_map, size_t section_index, const SweepSink& sink);
+
+// A single-mode piece of an executable section, the unit of parallel sweeps.
+struct SweepChunk {
+    size_t section_index;
+    uint64_t start;
+    uint64_t end;
+    bool thumb;
+};
+
+// Splits the code runs of `sections` into chunks of at most roughly
+// `max_chunk_bytes`. Runs are only cut where instruction boundaries are
+// certain (mode transitions, 4-byte steps inside ARM runs, and inside Thumb
+// runs after a halfword that cannot start a 32-bit encoding), so decoding
+// the chunks independently gives exactly the result of a sequential sweep.
+std::vector<SweepChunk> plan_sweep_chunks(const ElfParser& parser, const ModeMap& mode_map,
+                                          const std::vector<size_t>& sections,
+                                          size_t max_chunk_bytes = 256 * 1024);
+
+// Decodes into `buffer`, which is handed to the sink and may be reused for
+// the next chunk.
+void sweep_chunk(const ElfParser& parser, ArmDisassembler& disassembler,
+                 const SweepChunk& chunk, const SweepSink& sink,
+                 std::vector<DisassembledInstruction>& buffer);
+
+// After the bytes in [changed_start, changed_end) of a run decoded from
+// `run_start` changed, returns in [span_start, span_end) the instructions
+// whose boundaries or encodings may differ; `run_data` holds the run's
+// current bytes. Everything outside the span decodes exactly as before.
+// ARM spans are the changed words. A Thumb span is widened to boundaries
+// that hold in any decode: the position after a halfword that is not the
+// first half of a 32-bit encoding, or the run's ends.
+void affected_instruction_span(const uint8_t* run_data, uint64_t run_start, uint64_t run_end, bool thumb,
+                               uint64_t changed_start, uint64_t changed_end,
+                               uint64_t& span_start, uint64_t& span_end);
+
+#endif //MOBILE_ARM_DISASSEMBLER_CODE_SWEEP_H
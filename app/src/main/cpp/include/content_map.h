@@ -0,0 +1,90 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_CONTENT_MAP_H
+#define MOBILE_ARM_DISASSEMBLER_CONTENT_MAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "elf_parser.h"
+#include "code_sweep.h"
+#include "task_scheduler.h"
+#include "arena.h"
+
+enum class ContentClass : uint8_t {
+    Code = 0,       // Looks like ARM/Thumb code
+    Data = 1,       // Anything else of ordinary entropy: tables, strings, ...
+    Compressed = 2, // Near-random bytes: compressed, encrypted or packed
+    ZeroFill = 3    // Almost all zero bytes
+};
+
+// Counts of each byte value in `size` bytes at `data`, into `histogram`.
+void byte_histogram(const uint8_t* data, size_t size, uint32_t histogram[256]);
+
+// byte_histogram() split by position: lanes[k] counts the bytes at offsets
+// i with i % 4 == k.
+void byte_histogram_lanes(const uint8_t* data, size_t size, uint32_t lanes[4][256]);
+
+// Shannon entropy of bytes with that histogram, in 1/256 bits per byte
+// (0..2048).
+uint16_t histogram_entropy(const uint32_t histogram[256], size_t size);
+
+struct ContentBlock {
+    uint16_t entropy;    // 1/256 bits per byte
+    uint8_t code_score;  // How much the bytes look like code, 0..255
+    ContentClass content;
+};
+
+// Consecutive blocks of one class; entropy and code score are the means.
+struct ContentRegion {
+    uint64_t file_offset;
+    uint64_t size;
+    ContentClass content;
+    uint16_t entropy;
+    uint8_t code_score;
+};
+
+// Classification of the whole mapped file into fixed-size blocks.
+//
+// Each block gets a byte histogram (by position modulo 4, in one pass),
+// its entropy, and a code-likeness score in the block's instruction set
+// where mapping symbols say, the file's default otherwise. The decoder
+// accepts nearly every ARM word and leaves much of Thumb-2 unnamed, so the
+// score uses encoding statistics instead of decode success: for ARM the
+// share of words with condition AL, for Thumb how much lower the entropy of
+// the halfwords' high (opcode) bytes is than of their low bytes, in 1/256
+// bits. Neither needs a decode, so the whole file is scanned at histogram
+// speed, in parallel, a few hundred KB per task.
+class ContentMap {
+public:
+    static constexpr size_t kBlockBytes = 4096;
+    static constexpr uint16_t kCompressedEntropy = 7 * 256 + 128; // 7.5 bits per byte
+    static constexpr uint16_t kMinCodeEntropy = 5 * 256;          // Below that: tables, text
+    static constexpr uint8_t kCodeScore = 128;                    // Half the words AL, or a 0.5 bit gap
+    static constexpr uint32_t kZeroFillPercent = 90;
+
+    ContentMap(const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+               TaskPriority priority);
+
+    size_t block_count() const { return blocks_.size(); }
+    const ContentBlock& block(size_t index) const { return blocks_[index]; }
+    ContentClass class_at(uint64_t file_offset) const;
+
+    // Classifies the blocks overlapping [file_offset, file_offset + size)
+    // again after a patch changed those bytes.
+    void refresh(const ElfParser& parser, const ModeMap& mode_map, uint64_t file_offset, uint64_t size);
+
+    std::vector<ContentRegion> regions() const;
+
+    // False if every block overlapping the file range is compressed or zero
+    // fill, i.e. disassembling it can only produce noise.
+    bool worth_disassembling(uint64_t file_offset, uint64_t size) const;
+
+    size_t memory_bytes() const { return memory_.bytes(); }
+
+private:
+    std::vector<ContentBlock> blocks_;
+    uint64_t file_size_;
+    MemoryCharge memory_{MemoryCategory::Decode};
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_CONTENT_MAP_H
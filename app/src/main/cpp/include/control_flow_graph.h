@@ -0,0 +1,148 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_CONTROL_FLOW_GRAPH_H
+#define MOBILE_ARM_DISASSEMBLER_CONTROL_FLOW_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "code_sweep.h"
+#include "arena.h"
+
+enum class CfgEdgeKind : uint8_t {
+    Unconditional = 0, // B label
+    Taken = 1,         // Conditional branch taken
+    NotTaken = 2,      // Conditional branch falling through
+    Fallthrough = 3    // Sequential flow into the next block
+};
+
+// Block flag bits
+enum CfgBlockFlags : uint32_t {
+    CFG_BLOCK_ENTRY       = 0x1,
+    CFG_BLOCK_LOOP_HEADER = 0x2,
+    CFG_BLOCK_EXIT        = 0x4, // Returns, jumps indirectly or leaves the function
+    CFG_BLOCK_HAS_CALL    = 0x8
+};
+
+// Visible part of the layout, as block and edge indices.
+struct CfgViewport {
+    std::vector<uint32_t> blocks;
+    std::vector<uint32_t> edges;
+};
+
+// Basic blocks, edges, dominators, loops and a layered layout of one function.
+//
+// Blocks are discovered by recursive traversal from the entry, following
+// direct jumps that stay inside [function_start, function_end) and falling
+// through calls. Edges are stored as CSR successor/predecessor arrays,
+// dominators are computed with the Cooper-Harvey-Kennedy iteration over
+// reverse postorder, and every block whose dominated predecessor jumps back
+// to it is a loop header.
+//
+// The layout is a simplified Sugiyama scheme in text units (x/width in
+// characters, y/height in lines): retreating edges are ignored, blocks are
+// layered by longest path, ordered within layers by barycenter sweeps and
+// centered. viewport() returns just what intersects a rectangle, so the UI
+// never needs the whole graph.
+class ControlFlowGraph {
+public:
+    struct Block {
+        uint64_t start;
+        uint64_t end; // Address after the last instruction
+        uint32_t first_instruction;
+        uint32_t instruction_count;
+        uint32_t flags;
+    };
+
+    struct Edge {
+        uint32_t from;
+        uint32_t to;
+        CfgEdgeKind kind;
+    };
+
+    struct Node {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+        uint32_t layer;
+    };
+
+    static constexpr uint32_t kNoBlock = 0xFFFFFFFF;
+
+    ControlFlowGraph(const ElfParser& parser, ArmDisassembler& disassembler, uint64_t entry,
+                     bool thumb, uint64_t function_start, uint64_t function_end,
+                     size_t max_instructions = 200000);
+
+    uint64_t entry() const { return entry_; }
+    bool empty() const { return blocks_.empty(); }
+    bool truncated() const { return truncated_; }
+
+    size_t block_count() const { return blocks_.size(); }
+    size_t edge_count() const { return edges_.size(); }
+    size_t loop_count() const { return loop_count_; }
+    size_t memory_bytes() const { return memory_.bytes(); }
+    const Block& block(uint32_t index) const { return blocks_[index]; }
+    const Edge& edge(uint32_t index) const { return edges_[index]; }
+    const Node& node(uint32_t index) const { return nodes_[index]; }
+
+    // Edge indices leaving / entering a block.
+    std::pair<const uint32_t*, const uint32_t*> successors(uint32_t block) const;
+    std::pair<const uint32_t*, const uint32_t*> predecessors(uint32_t block) const;
+
+    uint32_t immediate_dominator(uint32_t block) const { return idom_[block]; }
+    bool dominates(uint32_t a, uint32_t b) const;
+
+    uint32_t block_at(uint64_t address) const; // Block starting at or containing `address`
+    bool overlaps(uint64_t start, uint64_t end) const; // Any block decoded from [start, end)
+
+    int32_t layout_width() const { return layout_width_; }
+    int32_t layout_height() const { return layout_height_; }
+
+    CfgViewport viewport(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const;
+
+    // One line per instruction: "ADDRESS  MNEMONIC OPERANDS".
+    std::string block_text(uint32_t block) const;
+
+private:
+    uint64_t entry_;
+    bool truncated_ = false;
+    size_t loop_count_ = 0;
+
+    std::vector<DisassembledInstruction> instructions_; // Sorted by address
+    std::vector<Block> blocks_;                         // Sorted by start
+    std::vector<Edge> edges_;
+
+    std::vector<uint32_t> succ_offsets_, succ_edges_; // CSR by source block
+    std::vector<uint32_t> pred_offsets_, pred_edges_; // CSR by target block
+
+    std::vector<uint32_t> rpo_;        // Blocks in reverse postorder
+    std::vector<uint32_t> rpo_index_;  // Block -> position in rpo_ (kNoBlock if unreachable)
+    std::vector<uint32_t> idom_;
+    std::vector<uint32_t> dom_pre_, dom_post_; // Dominator tree DFS intervals
+
+    std::vector<Node> nodes_;
+    std::vector<std::vector<uint32_t>> layers_; // Block ids per layer, in x order
+    std::vector<int32_t> layer_y_, layer_height_;
+    int32_t layout_width_ = 0;
+    int32_t layout_height_ = 0;
+
+    MemoryCharge memory_{MemoryCategory::Cfg};
+
+    void discover(const ElfParser& parser, ArmDisassembler& disassembler, bool thumb,
+                  uint64_t function_start, uint64_t function_end, size_t max_instructions);
+    void build_blocks(const std::vector<uint64_t>& leaders);
+    void build_edges(uint64_t function_start, uint64_t function_end);
+    void compute_dominators();
+    void find_loops();
+    void compute_layout();
+};
+
+// Bounds of the function containing `address`: the covering STT_FUNC symbol
+// if there is one, otherwise from `address` to the end of its section.
+// Returns false if the address is not in a loaded section.
+bool find_function_bounds(const ElfParser& parser, uint64_t address, uint64_t& start, uint64_t& end);
+
+#endif //MOBILE_ARM_DISASSEMBLER_CONTROL_FLOW_GRAPH_H
@@ -0,0 +1,60 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_DEMANGLER_H
+#define MOBILE_ARM_DISASSEMBLER_DEMANGLER_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+#include "task_scheduler.h"
+#include "arena.h"
+
+// True for Itanium C++ ABI names ("_Z...").
+bool is_mangled_name(std::string_view name);
+
+// Demangles one name with __cxa_demangle into `out`; false if it is not a
+// valid mangled name.
+bool demangle_name(std::string_view mangled, std::string& out);
+
+// Demangled symbol names, computed on first use and kept.
+//
+// Symbol names are views into the mapped file, so a name is identified by
+// its offset in the file: symbols sharing a string table entry (.symtab and
+// .dynsym often do) share one cache entry, and the key is a single integer.
+// Demangled text lives in an arena, so the views handed out stay valid as
+// long as the cache. Names that are not mangled, or fail to demangle, map
+// to themselves without a copy.
+//
+// All methods are safe to call from several threads.
+class DemangleCache {
+public:
+    // `data`/`size`: the mapped file the names point into.
+    DemangleCache(const uint8_t* data, size_t size);
+
+    std::string_view demangle(std::string_view name);
+
+    // Fills the cache for all of `names`, demangling the misses in parallel;
+    // for bulk users (search, export) about to ask for many names.
+    void demangle_all(const std::vector<std::string_view>& names, TaskScheduler& scheduler,
+                      TaskPriority priority);
+
+    size_t size() const;
+
+private:
+    static constexpr uint64_t kNoKey = ~0ULL;
+
+    const char* data_;
+    size_t size_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, std::string_view> names_; // Name offset -> demangled name
+    Arena arena_{MemoryCategory::Symbols, 64 * 1024};
+    MemoryCharge memory_{MemoryCategory::Symbols};         // The map; the arena accounts for itself
+
+    uint64_t key(std::string_view name) const;
+    // Caller holds mutex_.
+    std::string_view store(uint64_t key, std::string_view name, const std::string* demangled);
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_DEMANGLER_H
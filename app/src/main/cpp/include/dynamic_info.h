@@ -0,0 +1,72 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_DYNAMIC_INFO_H
+#define MOBILE_ARM_DISASSEMBLER_DYNAMIC_INFO_H
+
+#include <vector>
+#include <string_view>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "arena.h"
+
+// Dynamic section tags
+enum DynamicTag : uint64_t {
+    DT_NULL       = 0,
+    DT_NEEDED     = 1,  // Library this one depends on
+    DT_SONAME     = 14, // Name of this library
+    DT_RPATH      = 15, // Search path (deprecated)
+    DT_RUNPATH    = 29, // Search path
+    DT_VERSYM     = 0x6ffffff0,
+    DT_VERDEF     = 0x6ffffffc,
+    DT_VERDEFNUM  = 0x6ffffffd,
+    DT_VERNEED    = 0x6ffffffe,
+    DT_VERNEEDNUM = 0x6fffffff
+};
+
+// An undefined (import) or defined (export) dynamic symbol.
+struct DynamicSymbol {
+    uint32_t symbol;                // Index in ElfParser::get_symbols()
+    std::string_view name;
+    std::string_view version;       // Empty when unversioned
+    std::string_view version_file;  // Imports: library the version is required from
+    bool hidden;                    // Exports: non-default version (name@V, not name@@V)
+    bool weak;
+};
+
+// What a shared object says about linking: its own name, the libraries it
+// needs, and its dynamic symbols split into imports and exports with their
+// symbol versions.
+//
+// .dynamic is read through the string table its section links to.
+// Versions come from the GNU sections: .gnu.version holds one index per
+// .dynsym entry, resolved through .gnu.version_d (versions this library
+// defines) or .gnu.version_r (versions it requires, per needed library).
+// Index 0 is local, 1 is the unversioned base, and bit 15 hides an export
+// from unversioned references. Files without these sections simply have no
+// versions; every table is bounds-checked, so a damaged one is skipped, not
+// trusted. Names are views into the mapped file.
+class DynamicInfo {
+public:
+    explicit DynamicInfo(const ElfParser& parser);
+
+    bool is_dynamic() const { return dynamic_section_ >= 0; }
+    std::string_view soname() const { return soname_; }
+    const std::vector<std::string_view>& needed() const { return needed_; }
+    std::string_view runpath() const { return runpath_; } // DT_RUNPATH, else DT_RPATH
+
+    const std::vector<DynamicSymbol>& imports() const { return imports_; }
+    const std::vector<DynamicSymbol>& exports() const { return exports_; }
+    // Versions defined by this library, the base (its own name) excluded.
+    const std::vector<std::string_view>& defined_versions() const { return defined_versions_; }
+
+private:
+    long dynamic_section_ = -1;
+    std::string_view soname_;
+    std::string_view runpath_;
+    std::vector<std::string_view> needed_;
+    std::vector<DynamicSymbol> imports_;
+    std::vector<DynamicSymbol> exports_;
+    std::vector<std::string_view> defined_versions_;
+    MemoryCharge memory_{MemoryCategory::Symbols};
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_DYNAMIC_INFO_H
@@ -5,12 +5,64 @@
 #include <string>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string_view>
 
+#include "arena.h"
+
 // Forward declaration
 struct MappedFile;
 
+// Section types
+enum SectionType {
+    SHT_NULL     = 0,  // Inactive
+    SHT_PROGBITS = 1,  // Program data
+    SHT_SYMTAB   = 2,  // Symbol table
+    SHT_STRTAB   = 3,  // String table
+    SHT_RELA     = 4,  // Relocation entries, addends
+    SHT_HASH     = 5,  // Symbol hash table
+    SHT_DYNAMIC  = 6,  // Dynamic linking information
+    SHT_NOTE     = 7,  // Notes
+    SHT_NOBITS   = 8,  // Program space with no data (bss)
+    SHT_REL      = 9,  // Relocation entries, no addends
+    SHT_SHLIB    = 10, // Reserved
+    SHT_DYNSYM   = 11, // Dynamic linker symbol table
+    SHT_GNU_verdef  = 0x6ffffffd, // Symbol versions defined
+    SHT_GNU_verneed = 0x6ffffffe, // Symbol versions required
+    SHT_GNU_versym  = 0x6fffffff, // Version index per dynamic symbol
+    SHT_ARM_EXIDX = 0x70000001 // ARM unwind index table
+};
+
+// Special section indices
+enum SectionIndex {
+    SHN_UNDEF = 0 // Undefined section
+};
+
+// Section flags
+enum SectionFlags : uint64_t {
+    SHF_WRITE     = 0x1,   // Writable
+    SHF_ALLOC     = 0x2,   // Occupies memory during execution
+    SHF_EXECINSTR = 0x4,   // Executable
+    SHF_TLS       = 0x400  // Thread-local storage template
+};
+
+// Symbol types (low nibble of st_info)
+enum SymbolType {
+    STT_NOTYPE  = 0, // Unspecified
+    STT_OBJECT  = 1, // Data object
+    STT_FUNC    = 2, // Code object
+    STT_SECTION = 3, // Section
+    STT_FILE    = 4  // Source file
+};
+
+// Symbol bindings (high nibble of st_info)
+enum SymbolBinding {
+    STB_LOCAL  = 0, // Local symbol
+    STB_GLOBAL = 1, // Global symbol
+    STB_WEAK   = 2  // Weak symbol
+};
+
 // ELF Header structure (simplified for common fields)
 struct ElfHeader {
     uint8_t  e_ident[16];   // ELF Identification
@@ -45,7 +97,7 @@ struct SectionHeader {
     uint64_t sh_addralign;  // Section alignment
     uint64_t sh_entsize;    // Entry size if section holds table
 
-    std::string name;       // Resolved section name
+    std::string_view name;  // Resolved section name, points into the mapped file
 };
 
 // Symbol Table Entry structure (simplified)
@@ -57,10 +109,15 @@ struct SymbolEntry {
     uint64_t st_value;      // Symbol value
     uint64_t st_size;       // Symbol size
 
-    std::string name;       // Resolved symbol name
+    std::string_view name;  // Resolved symbol name, points into the mapped file
 };
 
-// Main ELF Parser class
+// Main ELF Parser class.
+//
+// Section and symbol names are views into the mapped file's string tables,
+// so parsing copies no strings and the headers and symbols are plain
+// records: dropping a parser frees two arrays. The file must stay mapped
+// for as long as the parser (and any name taken from it) is in use.
 class ElfParser {
 public:
     explicit ElfParser(const MappedFile& file);
@@ -74,6 +131,19 @@ public:
     const uint8_t* get_section_data(const std::string& section_name) const;
     size_t get_section_size(const std::string& section_name) const;
     uint64_t get_section_address(const std::string& section_name) const;
+    const uint8_t* get_section_data_by_index(size_t section_index) const;
+    const MappedFile& get_file() const { return file_; }
+
+    // File bytes backing [address, address + size) in a loaded section, or
+    // nullptr if the range is unmapped, in .bss or straddles a section end.
+    const uint8_t* get_data_at_address(uint64_t address, size_t size) const;
+
+    // Index of the loaded section containing `address`, or -1.
+    int find_section_by_address(uint64_t address) const;
+
+    // Index in get_symbols() of entry 0 of the symbol table in section
+    // `section_index`, or -1 if that section's symbols were not read.
+    long first_symbol_of_table(size_t section_index) const;
 
 private:
     const MappedFile& file_;
@@ -84,6 +154,19 @@ private:
     std::string_view strtab_data_;   // String Table data (for symbols)
     std::string_view dynstrtab_data_; // Dynamic String Table data (for dynamic symbols)
 
+    // Each symbol table names its string table through sh_link; remember
+    // which run of symbols_ came from which table so names resolve correctly.
+    struct SymbolTableRun {
+        size_t first_symbol;
+        uint32_t strtab_index;
+        size_t symtab_index;
+    };
+    std::vector<SymbolTableRun> symbol_table_runs_;
+
+    std::vector<uint32_t> sections_by_address_; // SHF_ALLOC sections sorted by sh_addr
+
+    MemoryCharge memory_{MemoryCategory::Symbols};
+
     bool read_elf_header();
     bool read_section_headers();
     bool resolve_section_names();
@@ -98,4 +181,11 @@ private:
 // Helper function declaration
 bool sh_type_is_dynamic(uint32_t sh_type);
 
+// Replaces the file held in `file` and `parser` with `path`. The old parser
+// is destroyed before its mapping goes away, since its names point into it.
+// On failure both are left empty (never a parser over an unmapped file) and
+// `error` says why.
+bool reload_elf_file(const std::string& path, MappedFile& file, std::unique_ptr<ElfParser>& parser,
+                     std::string& error);
+
 #endif //MOBILE_ARM_DISASSEMBLER_ELF_PARSER_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_FUNCTION_DIFF_H
+#define MOBILE_ARM_DISASSEMBLER_FUNCTION_DIFF_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "code_sweep.h"
+#include "function_table.h"
+#include "task_scheduler.h"
+
+// What a function's code looks like, independent of where it was linked.
+struct FunctionFingerprint {
+    uint64_t hash = 0;          // Normalised instruction stream
+    uint64_t shape = 0;         // Blocks, edges, calls and successor counts
+    uint32_t instructions = 0;
+    uint32_t blocks = 0;
+    uint32_t edges = 0;
+    uint32_t calls = 0;
+};
+
+enum class FunctionChange : uint8_t {
+    Unchanged = 0,
+    Changed = 1,
+    Added = 2,   // Only in the new binary
+    Removed = 3  // Only in the old binary
+};
+
+// Which evidence paired the two functions.
+enum class FunctionMatch : uint8_t {
+    None = 0,       // Added or removed
+    Symbol = 1,     // Same symbol name
+    Hash = 2,       // Identical normalised code, under another name or none
+    Shape = 3,      // Same control flow shape and similar size
+    Neighbours = 4  // Same place between two matched pairs
+};
+
+struct FunctionDiffEntry {
+    FunctionChange change;
+    FunctionMatch matched_by;
+    int64_t old_index; // In the old FunctionTable, -1 if added
+    int64_t new_index; // In the new FunctionTable, -1 if removed
+};
+
+struct FunctionDiffResult {
+    // Matched and added functions in new-binary order, then removed ones
+    // in old-binary order
+    std::vector<FunctionDiffEntry> entries;
+    size_t unchanged = 0;
+    size_t changed = 0;
+    size_t added = 0;
+    size_t removed = 0;
+};
+
+// One binary's side of a diff.
+struct FunctionDiffInput {
+    const ElfParser& parser;
+    const ModeMap& mode_map;
+    const FunctionTable& functions;
+};
+
+// Bits of an instruction encoding that do not depend on where the code was
+// linked: all but branch and call offsets, PC-relative literal offsets,
+// load/store offsets and data-processing immediates. `size` is 2 or 4;
+// 32-bit Thumb encodings hold the first halfword in the upper 16 bits.
+uint32_t stable_encoding_bits(uint32_t encoding, uint32_t size, bool thumb);
+
+// Hash of the stable bits of `code` in order, and of its length.
+uint64_t normalized_code_hash(const std::vector<DisassembledInstruction>& code, bool thumb);
+
+// Fingerprints every function of `input`, in parallel.
+//
+// Each function's code runs are decoded (data runs such as literal pools
+// are skipped) and every instruction is reduced to its encoding with the
+// position-dependent fields masked: branch and call offsets, PC-relative
+// literal offsets, load/store offsets and data-processing immediates. The
+// hash covers those normalised encodings in order, so a function moved or
+// relinked elsewhere hashes the same, while a changed register, opcode or
+// branch structure does not. The shape comes from the same pass: basic
+// blocks are split at branches and at in-function branch targets.
+std::vector<FunctionFingerprint> fingerprint_functions(const FunctionDiffInput& input, TaskScheduler& scheduler,
+                                                       TaskPriority priority);
+
+// Pairs the functions of two builds of a binary and classifies each.
+//
+// Matching goes from the strongest evidence to the weakest, each step only
+// considering what is still unpaired: symbol names, then code hashes, then
+// CFG shapes whose instruction counts are within a factor of two, and
+// last, functions left alone between two matched pairs. A name or hash held
+// by equally many functions on both sides pairs them in address order;
+// shapes must be unique on both sides. A pair is unchanged when the hashes
+// are equal. Fingerprinting is parallel per function; matching is a few
+// hash-table passes.
+FunctionDiffResult diff_functions(const FunctionDiffInput& old_input, const FunctionDiffInput& new_input,
+                                  TaskScheduler& scheduler, TaskPriority priority);
+
+// Sweeps the code of a binary outside the analysis pipeline for its call
+// targets and builds its function table, as the Functions stage does.
+std::unique_ptr<FunctionTable> build_function_table(const ElfParser& parser, const ModeMap& mode_map,
+                                                    TaskScheduler& scheduler, TaskPriority priority);
+
+#endif //MOBILE_ARM_DISASSEMBLER_FUNCTION_DIFF_H
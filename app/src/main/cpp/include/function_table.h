@@ -0,0 +1,72 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_FUNCTION_TABLE_H
+#define MOBILE_ARM_DISASSEMBLER_FUNCTION_TABLE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "code_sweep.h"
+#include "arena.h"
+
+// Where a function start was found (bit set; a start can have several)
+enum FunctionSourceFlags : uint8_t {
+    FUNCTION_FROM_SYMBOL   = 0x1,
+    FUNCTION_FROM_EXIDX    = 0x2,  // .ARM.exidx entry
+    FUNCTION_FROM_EH_FRAME = 0x4,  // .eh_frame FDE or .eh_frame_hdr table
+    FUNCTION_FROM_CALL     = 0x8,  // Target of a direct call
+    FUNCTION_FROM_PROLOGUE = 0x10  // PUSH {..., LR} after a terminator
+};
+
+struct FunctionInfo {
+    uint64_t start;
+    uint64_t end;          // Exclusive
+    int32_t symbol_index;  // Naming symbol in ElfParser::get_symbols(), -1 if none
+    uint8_t sources;       // FunctionSourceFlags
+    bool thumb;
+};
+
+// Sorted table of function extents, for stripped binaries as well.
+//
+// Starts are merged from function symbols, .ARM.exidx entries (prel31 with
+// the Thumb bit), .eh_frame FDEs and the .eh_frame_hdr search table, direct
+// call targets collected by the sweep, and finally PUSH {..., LR} prologues
+// found in code no other source covers. A function ends at its known size
+// (symbol or FDE range) or else at the next function start, never past its
+// section; starts without a size that fall inside a sized function are
+// dropped rather than splitting it.
+class FunctionTable {
+public:
+    FunctionTable(const ElfParser& parser, const ModeMap& mode_map,
+                  const std::vector<uint64_t>& call_targets);
+
+    size_t size() const { return functions_.size(); }
+    const FunctionInfo& function(uint32_t index) const { return functions_[index]; }
+
+    // Index of the function containing `address`, or -1.
+    long find_containing(uint64_t address) const;
+
+    // Symbol name, else the recovered name, else "sub_<ADDRESS>".
+    std::string name(uint32_t index) const;
+
+    // Names found for functions by other means than the symbol table, such
+    // as library signatures. Not thread-safe against readers of the table.
+    void set_recovered_name(uint32_t index, std::string_view name);
+    std::string_view recovered_name(uint32_t index) const;
+    size_t recovered_name_count() const { return recovered_count_; }
+
+    // Takes over the recovered names of functions starting at the same
+    // address in `other`, e.g. when the table is rebuilt after a patch.
+    void copy_recovered_names(const FunctionTable& other);
+
+private:
+    const ElfParser& parser_;
+    std::vector<FunctionInfo> functions_; // Sorted by start, non-overlapping
+    std::vector<std::string_view> recovered_names_; // Empty until the first name, then one per function
+    size_t recovered_count_ = 0;
+    Arena recovered_arena_{MemoryCategory::Functions};
+    MemoryCharge memory_{MemoryCategory::Functions};
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_FUNCTION_TABLE_H
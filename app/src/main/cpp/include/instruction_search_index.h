@@ -0,0 +1,93 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_INSTRUCTION_SEARCH_INDEX_H
+#define MOBILE_ARM_DISASSEMBLER_INSTRUCTION_SEARCH_INDEX_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+#include "arm_disassembler.h"
+#include "arena.h"
+
+struct InstructionSearchResult {
+    size_t total_matches = 0;
+    std::vector<uint64_t> addresses;
+};
+
+// Inverted index over decoded instructions, filled while sweeping code.
+//
+// Every instruction contributes terms for its mnemonic, registers, immediate
+// values and other operand words; instructions that start a 16-byte address
+// block also contribute hex trigrams of that block's address. After
+// finalize() the postings are stored as sorted CSR arrays keyed by term.
+//
+// Query syntax (terms are ANDed, case-insensitive):
+//   LDR R0        mnemonic (first word) plus register
+//   BL 0x1234     mnemonic plus immediate/branch target value
+//   #16, -0x4     immediate values in hex or decimal
+//   @1a2b         address whose hex form contains "1a2b"
+class InstructionSearchIndex {
+public:
+    // Adds a decoded run; only valid before finalize().
+    void add_instructions(const std::vector<DisassembledInstruction>& instructions);
+
+    // Sorts documents by address and compacts postings into CSR form.
+    void finalize();
+
+    bool is_finalized() const { return finalized_; }
+    size_t instruction_count() const { return addresses_.size(); }
+
+    // Replaces the documents in [start, end) with `instructions` after that
+    // code was decoded again; only valid after finalize(). Replacements are
+    // kept beside the CSR arrays and matched by a scan, which suits the few
+    // small ranges byte patches touch.
+    void replace_range(uint64_t start, uint64_t end, const std::vector<DisassembledInstruction>& instructions);
+
+    // Matches inside [range_start, range_end), paged in address order.
+    InstructionSearchResult search(const std::string& query, uint64_t range_start, uint64_t range_end,
+                                   size_t offset, size_t limit) const;
+
+    size_t memory_bytes() const { return memory_.bytes(); }
+
+private:
+    std::vector<uint64_t> addresses_; // doc id -> address
+    bool finalized_ = false;
+
+    // Build state, released by finalize(): each document's term ids are
+    // stored contiguously starting at pending_start_[doc]. The term map's
+    // nodes come from build_arena_ and are freed in a few block frees.
+    using TermMap = std::unordered_map<uint64_t, uint32_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                       ArenaAllocator<std::pair<const uint64_t, uint32_t>>>;
+    Arena build_arena_{MemoryCategory::SearchIndex, 64 * 1024};
+    TermMap term_ids_{0, std::hash<uint64_t>(), std::equal_to<uint64_t>(),
+                      ArenaAllocator<std::pair<const uint64_t, uint32_t>>(build_arena_)};
+    std::vector<uint64_t> id_terms_;
+    std::vector<uint32_t> pending_terms_;
+    std::vector<uint32_t> pending_start_;
+
+    uint32_t term_id(uint64_t term);
+
+    std::vector<uint64_t> terms_;     // Sorted unique terms
+    std::vector<uint32_t> offsets_;   // terms_.size() + 1 entries into postings_
+    std::vector<uint32_t> postings_;  // Doc ids, ascending within each term
+
+    // Documents of replaced ranges; the CSR documents inside them are ignored.
+    struct PatchedDocument {
+        uint64_t address;
+        std::vector<uint64_t> terms; // Sorted unique
+    };
+    std::vector<std::pair<uint64_t, uint64_t>> replaced_ranges_; // Sorted, disjoint [start, end)
+    std::vector<PatchedDocument> patched_documents_;              // Sorted by address
+
+    MemoryCharge memory_{MemoryCategory::SearchIndex};
+
+    std::pair<const uint32_t*, const uint32_t*> postings_for(uint64_t term) const;
+    std::vector<uint32_t> match_documents(const std::vector<uint64_t>& terms,
+                                          std::vector<std::string> address_fragments,
+                                          uint64_t range_start, uint64_t range_end) const;
+    std::vector<uint32_t> address_candidates(std::string_view hex_fragment, uint32_t first_doc, uint32_t last_doc) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_INSTRUCTION_SEARCH_INDEX_H
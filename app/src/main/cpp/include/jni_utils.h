@@ -0,0 +1,39 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_JNI_UTILS_H
+#define MOBILE_ARM_DISASSEMBLER_JNI_UTILS_H
+
+#include <jni.h>
+#include <string>
+#include <string_view>
+
+// String conversions and reference helpers for the JNI layer; kept out of
+// utils.h so the core library builds without JNI headers.
+
+// Converts a wide character string to UTF-8 (Android JNI specific)
+std::string jstring_to_cpp_string(JNIEnv* env, jstring jstr);
+
+// Converts a C++ string to Java string (Android JNI specific)
+jstring cpp_string_to_jstring(JNIEnv* env, const std::string& cpp_str);
+
+// Converts standard UTF-8 (which may contain 4-byte sequences that
+// NewStringUTF rejects) to a Java string via UTF-16
+jstring utf8_to_jstring(JNIEnv* env, std::string_view utf8);
+
+// Owns a global reference handed to a task on another thread. reset()
+// deletes it with the task's env; if an exit path skips that, the
+// destructor deletes it, attaching the thread for the call if needed.
+class ScopedGlobalRef {
+public:
+    ScopedGlobalRef(JavaVM* vm, jobject ref) : vm_(vm), ref_(ref) {}
+    ~ScopedGlobalRef();
+    ScopedGlobalRef(const ScopedGlobalRef&) = delete;
+    ScopedGlobalRef& operator=(const ScopedGlobalRef&) = delete;
+
+    jobject get() const { return ref_; }
+    void reset(JNIEnv* env);
+
+private:
+    JavaVM* vm_;
+    jobject ref_;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_JNI_UTILS_H
@@ -0,0 +1,88 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_LINK_GRAPH_H
+#define MOBILE_ARM_DISASSEMBLER_LINK_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "dynamic_info.h"
+#include "task_scheduler.h"
+#include "arena.h"
+
+// How an import was resolved.
+enum class ImportBinding : uint8_t {
+    Unresolved = 0,
+    Needed = 1,    // By the library's own DT_NEEDED closure, in load order
+    Elsewhere = 2  // Only by an opened library outside that closure
+};
+
+struct ImportResolution {
+    int32_t library;       // Providing library, -1 if unresolved
+    uint32_t export_index; // In that library's DynamicInfo::exports()
+    ImportBinding binding;
+};
+
+struct LinkedLibrary {
+    std::string path;
+    std::string name;                       // Soname, else the file name
+    const ElfParser* parser;
+    std::unique_ptr<DynamicInfo> dynamic;
+    std::vector<int32_t> needed;            // Per DT_NEEDED entry: library, or -1 if not opened
+    std::vector<ImportResolution> imports;  // Per DynamicInfo::imports() entry
+};
+
+struct LinkStats {
+    size_t imports = 0;
+    size_t needed = 0;     // Resolved through DT_NEEDED
+    size_t elsewhere = 0;
+    size_t unresolved = 0;
+    size_t missing_libraries = 0; // DT_NEEDED entries naming no opened library
+};
+
+// Which library provides each import, across a set of shared objects such
+// as the native libraries of one app.
+//
+// DT_NEEDED names are matched to the libraries by soname, then by file
+// name. An import is looked up the way the dynamic linker does for the
+// library's local group: the library, then its needed libraries breadth
+// first, the first definition winning. A versioned import needs an export
+// of that version (or of a library that defines no versions); an
+// unversioned one takes only default (@@) exports. Imports the closure
+// cannot satisfy, typically because a needed library was not opened, fall
+// back to any opened library and are marked Elsewhere.
+//
+// All exports go into one table sorted by name hash, so each import costs
+// one binary search; libraries are linked in parallel. Parsers (and their
+// mapped files) must outlive the graph.
+class LinkGraph {
+public:
+    // Reads the library's dynamic section and symbols; returns its index.
+    uint32_t add_library(const std::string& path, const ElfParser& parser);
+
+    // Resolves every import of every library.
+    LinkStats link(TaskScheduler& scheduler, TaskPriority priority);
+
+    size_t size() const { return libraries_.size(); }
+    const LinkedLibrary& library(uint32_t index) const { return libraries_[index]; }
+
+    // Library with that soname or file name, or -1.
+    long find_library(std::string_view name) const;
+
+private:
+    struct ExportSlot {
+        uint64_t hash;
+        uint32_t library;
+        uint32_t export_index;
+    };
+
+    std::vector<LinkedLibrary> libraries_;
+    std::vector<ExportSlot> exports_; // Sorted by (hash, library)
+    MemoryCharge memory_{MemoryCategory::Symbols};
+
+    bool compatible(const DynamicSymbol& import, uint32_t library, const DynamicSymbol& definition) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_LINK_GRAPH_H
@@ -0,0 +1,55 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_LISTING_EXPORT_H
+#define MOBILE_ARM_DISASSEMBLER_LISTING_EXPORT_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "elf_parser.h"
+#include "code_sweep.h"
+#include "operand_resolver.h"
+#include "task_scheduler.h"
+#include "demangler.h"
+
+enum class ListingFormat : uint8_t {
+    Text = 0,     // objdump -d style: labels, address, encoding, mnemonic, operands, comment
+    JsonLines = 1 // One JSON object per line, see export_listing()
+};
+
+struct ListingExportOptions {
+    ListingFormat format = ListingFormat::Text;
+    std::vector<size_t> sections;              // Section indices; empty means every executable section
+    size_t chunk_bytes = 64 * 1024;            // Code decoded and formatted per task
+    const OperandResolver* resolver = nullptr; // Adds comments when set
+    DemangleCache* demangler = nullptr;        // Labels show demangled names when set
+    std::function<bool()> cancelled;           // Polled between chunks when set
+};
+
+struct ListingExportStats {
+    uint64_t instructions = 0; // Data words included
+    uint64_t bytes_written = 0;
+};
+
+// Writes a full listing of code sections to `fd` without holding it in
+// memory.
+//
+// Sections are cut into chunks at certain instruction boundaries (see
+// plan_sweep_chunks) and the gaps between code runs become data chunks.
+// Chunks are decoded, annotated and formatted on the scheduler's background
+// workers, a bounded number at a time, and written in address order as each
+// finishes, so memory stays at a few chunks' worth of text whatever the
+// section size. Comments of the first few instructions of a chunk lack PIC
+// pairs whose load is in the previous chunk.
+//
+// JSON Lines output has a {"section","address","size"} object before each
+// section's instructions, then one object per instruction with short keys:
+// "a" address, "e" encoding in hex, "m" mnemonic, "o" operands, and when
+// present "c" comment and "l" the symbol starting within it. Data words have
+// "m":".word" (".byte" for a short tail).
+//
+// Returns false on a write error or when cancelled; `stats` is filled with
+// what was written either way.
+bool export_listing(int fd, const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                    const ListingExportOptions& options, ListingExportStats* stats = nullptr);
+
+#endif //MOBILE_ARM_DISASSEMBLER_LISTING_EXPORT_H
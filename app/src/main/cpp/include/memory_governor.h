@@ -0,0 +1,90 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_MEMORY_GOVERNOR_H
+#define MOBILE_ARM_DISASSEMBLER_MEMORY_GOVERNOR_H
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+// Levels passed to ComponentCallbacks2.onTrimMemory().
+enum class TrimLevel : int {
+    RunningModerate = 5,
+    RunningLow = 10,
+    RunningCritical = 15,
+    UiHidden = 20,
+    Background = 40,
+    Moderate = 60,
+    Complete = 80
+};
+
+// Keeps rebuildable caches (decoded pages, CFGs, the search index, string
+// tables) under one byte budget.
+//
+// Owners admit() every entry they can rebuild, with its size and what it
+// cost to build. Once the total exceeds the budget, entries are evicted by
+// GreedyDual-Size: an entry's priority is the inflation value at its last
+// use plus its cost per byte; the lowest priority goes first and becomes the
+// new inflation value. Large entries that are cheap to rebuild go before
+// small expensive ones, and entries nobody touches age out as in plain LRU.
+//
+// Evictors run on the thread calling enforce() or trim(), after the entry
+// has been forgotten and without the governor's lock held, so they may take
+// the owner's locks; callers must not hold those locks themselves. An
+// evictor must cope with its owner having dropped the entry meanwhile.
+class MemoryGovernor {
+public:
+    using EntryId = uint64_t;
+    using Evictor = std::function<void()>;
+
+    static constexpr size_t kDefaultBudget = size_t(256) << 20;
+
+    explicit MemoryGovernor(size_t budget_bytes = kDefaultBudget) : budget_(budget_bytes) {}
+
+    // Takes effect at the next enforce().
+    void set_budget(size_t bytes);
+    size_t budget() const;
+
+    // `cost` is in any unit used consistently by all owners; callers here
+    // pass the build time in microseconds.
+    EntryId admit(MemoryCategory category, size_t bytes, double cost, Evictor evictor);
+    // Marks an entry as used; unknown ids are ignored.
+    void touch(EntryId id);
+    void resize(EntryId id, size_t bytes);
+    // The owner dropped the entry itself; its evictor will not run.
+    void forget(EntryId id);
+    // Forgets every entry, e.g. when the file they were built from is closed.
+    void clear();
+
+    // Evicts until the cached total fits the budget; returns bytes freed.
+    size_t enforce();
+    // Evicts down to the share of the budget `level` leaves; returns bytes freed.
+    size_t trim(int level);
+
+    size_t cached_bytes() const;
+    size_t cached_bytes(MemoryCategory category) const;
+    size_t entry_count() const;
+
+private:
+    struct Entry {
+        MemoryCategory category;
+        size_t bytes;
+        double cost;
+        double priority;
+        Evictor evictor;
+    };
+
+    mutable std::mutex mutex_;
+    size_t budget_;
+    size_t total_ = 0;
+    double inflation_ = 0.0;
+    EntryId next_id_ = 1;
+    std::unordered_map<EntryId, Entry> entries_;
+
+    double priority_of(const Entry& entry) const;
+    size_t evict_down_to(size_t target);
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_MEMORY_GOVERNOR_H
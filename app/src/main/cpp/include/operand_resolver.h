@@ -0,0 +1,48 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_OPERAND_RESOLVER_H
+#define MOBILE_ARM_DISASSEMBLER_OPERAND_RESOLVER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "arena.h"
+#include "string_table.h"
+
+// Turns PC-relative operands into listing comments.
+//
+// For every literal load the comment shows the loaded constant ("=0x..."),
+// and for ADR and the PIC idiom "LDR Rx, [PC, #lit]; ADD Rx, PC, Rx" the
+// address that ends up in the register. Addresses are named after the
+// symbol containing them ("name" or "name+0x10") or the string starting
+// there. Names are resolved per decoded run: the run's addresses are
+// sorted once and merged against the address-sorted symbol table built at
+// construction and the string table, instead of one search per instruction.
+class OperandResolver {
+public:
+    // Instructions a loaded PIC offset may sit in its register before the
+    // ADD; an instruction's comment depends on no instruction further back.
+    static constexpr size_t kPicPairWindow = 8;
+
+    explicit OperandResolver(const ElfParser& parser);
+
+    // `strings` may be null while the string table is still being built.
+    // Comment text is allocated in `text`, which must outlive `instructions`.
+    void annotate(std::vector<DisassembledInstruction>& instructions, const StringTable* strings,
+                  Arena& text) const;
+
+private:
+    struct NamedRange {
+        uint64_t start;
+        uint64_t end;    // Exclusive; equal to start for unsized symbols
+        uint32_t symbol; // Index into ElfParser::get_symbols()
+    };
+
+    const ElfParser& parser_;
+    std::vector<NamedRange> ranges_; // Sorted by start, one per address
+
+    std::string name_for(const NamedRange* range, uint64_t address) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_OPERAND_RESOLVER_H
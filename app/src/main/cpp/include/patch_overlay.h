@@ -0,0 +1,68 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_PATCH_OVERLAY_H
+#define MOBILE_ARM_DISASSEMBLER_PATCH_OVERLAY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "utils.h"
+#include "elf_parser.h"
+
+// File bytes [file_offset, file_offset + size).
+struct PatchRange {
+    uint64_t file_offset;
+    uint64_t size;
+};
+
+// Byte patches applied in place to a mapped file, with undo/redo.
+//
+// The mapping is private, so a patch briefly makes the touched pages
+// writable and the kernel copies just those pages; the file on disk never
+// changes. Everything that reads the mapping (the parser, decoders, pattern
+// scans) sees the patched bytes through the pointers it already holds, so
+// callers only need to refresh what was derived from the changed range.
+// Callers serialise patches against every reader of the mapping.
+class PatchOverlay {
+public:
+    explicit PatchOverlay(const MappedFile& file) : file_(file) {}
+
+    // Writes `bytes` at `file_offset` and clears the redo history. False
+    // (and a log_error) if the range is outside the file or the pages
+    // cannot be made writable.
+    bool apply(uint64_t file_offset, const std::vector<uint8_t>& bytes);
+
+    // Reverts the latest patch, or reapplies the latest reverted one; the
+    // bytes that changed are returned in `changed`.
+    bool undo(PatchRange& changed);
+    bool redo(PatchRange& changed);
+
+    size_t undo_count() const { return undo_.size(); }
+    size_t redo_count() const { return redo_.size(); }
+
+    // Coalesced ranges whose bytes differ from the file on disk, ascending.
+    std::vector<PatchRange> modified_ranges() const;
+
+    // Writes the patched image to `path` through a temporary file that is
+    // renamed into place, so a failed export leaves no partial file.
+    bool export_to(const std::string& path) const;
+
+private:
+    struct Patch {
+        uint64_t file_offset;
+        std::vector<uint8_t> before;
+        std::vector<uint8_t> after;
+    };
+
+    const MappedFile& file_;
+    std::vector<Patch> undo_;
+    std::vector<Patch> redo_;
+
+    bool write(uint64_t file_offset, const std::vector<uint8_t>& bytes);
+};
+
+// False, with the reason in `error`, if patching the range would change
+// what the parser has already read: the ELF, program and section headers,
+// symbol tables and string tables.
+bool patch_allowed(const ElfParser& parser, uint64_t file_offset, uint64_t size, std::string& error);
+
+#endif //MOBILE_ARM_DISASSEMBLER_PATCH_OVERLAY_H
@@ -0,0 +1,71 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_PATTERN_SEARCH_H
+#define MOBILE_ARM_DISASSEMBLER_PATTERN_SEARCH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+
+#include "elf_parser.h"
+#include "task_scheduler.h"
+
+// Byte signature with per-nibble wildcards, e.g. "F0 B5 ?? AF 4? ?8".
+struct BytePattern {
+    std::vector<uint8_t> values; // Expected bits (already masked)
+    std::vector<uint8_t> masks;  // 0xFF exact, 0xF0/0x0F one nibble, 0x00 wildcard
+
+    size_t size() const { return values.size(); }
+    bool matches_at(const uint8_t* data) const;
+
+    // Returns false and fills `error` if the text is not a valid pattern.
+    static bool parse(const std::string& text, BytePattern& out, std::string& error);
+};
+
+struct PatternMatch {
+    uint64_t file_offset;
+    uint64_t virtual_address; // 0 when the containing section is not loaded
+    int section_index;        // -1 when no section covers the offset
+};
+
+// Receives matches in ascending file-offset order; return false to stop.
+using PatternMatchSink = std::function<bool(const std::vector<PatternMatch>& batch)>;
+
+// Parallel signature scanner over the mapped file.
+//
+// Fixed-size chunks of the range are scanned as TaskScheduler::parallel_for
+// pieces at the caller's priority, each looking for the rarest fully
+// specified byte of the pattern (the anchor) with a NEON/SSE2 compare and
+// verifying the full masked pattern only at anchor hits. Results are handed
+// to the sink on the calling thread, chunk by chunk in file order: the
+// caller delivers what is ready between the chunks it scans itself, so
+// matches stream in while the scan is still running.
+class PatternScanner {
+public:
+    explicit PatternScanner(const ElfParser& parser);
+
+    // Scans matches starting in [begin, end) (file offsets). Returns the
+    // number of matches delivered; stops early if `cancel` becomes true or
+    // the sink returns false.
+    size_t scan(const BytePattern& pattern, uint64_t begin, uint64_t end,
+                const std::atomic<bool>& cancel, const PatternMatchSink& sink,
+                TaskScheduler& scheduler, TaskPriority priority) const;
+
+    PatternMatch attribute(uint64_t file_offset) const;
+
+private:
+    const ElfParser& parser_;
+
+    struct SectionRange {
+        uint64_t file_begin;
+        uint64_t file_end;
+        uint64_t address;
+        int section_index;
+        bool loaded;
+    };
+    std::vector<SectionRange> ranges_; // Sorted by file_begin
+
+    size_t choose_anchor(const BytePattern& pattern, uint64_t begin, uint64_t end) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_PATTERN_SEARCH_H
@@ -0,0 +1,119 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_SIGNATURE_DATABASE_H
+#define MOBILE_ARM_DISASSEMBLER_SIGNATURE_DATABASE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "code_sweep.h"
+#include "function_table.h"
+#include "task_scheduler.h"
+#include "arena.h"
+
+// A function of a reference library, identified by its leading code.
+struct FunctionSignature {
+    uint64_t hash;    // normalized_code_hash() of the covered code
+    uint32_t length;  // Bytes covered from the function start
+    uint32_t thumb;   // 1 for Thumb code
+};
+
+// A function of the analysed binary that a signature identified.
+struct SignatureMatch {
+    uint64_t address;    // Function start
+    uint32_t function;   // Index in the FunctionTable
+    uint32_t signature;  // Index in the SignatureDatabase
+};
+
+// Names for the functions of stripped, statically linked code, recovered
+// from libraries built with symbols (libc++, OpenSSL, zlib, ...).
+//
+// add_library() takes every named function of a reference binary and
+// covers its code from the start up to the first data run or its end: the
+// first kPatternBytes of it become a byte pattern with the position-
+// dependent bits (stable_encoding_bits) masked out, and all of it a hash of
+// the normalised encodings. compile() merges the patterns into one trie
+// whose edges carry byte values and masks, so a function is looked up by
+// walking its first bytes once, whatever the number of signatures; the
+// candidates found on the way are then confirmed by their hash over the
+// signature's length. The longest confirmed signature names the function,
+// unless another of that length gives it a different name.
+//
+// The compiled trie, signatures and names are saved and loaded as is.
+class SignatureDatabase {
+public:
+    static constexpr size_t kPatternBytes = 32;
+    static constexpr uint32_t kMinBytes = 16;        // Shorter code matches too much
+    static constexpr uint32_t kMinInstructions = 4;
+
+    SignatureDatabase() = default;
+
+    // Adds the named functions of a reference binary, in parallel; returns
+    // how many were added. Call compile() before matching or saving.
+    size_t add_library(const ElfParser& parser, const ModeMap& mode_map, const FunctionTable& functions,
+                       TaskScheduler& scheduler, TaskPriority priority);
+
+    // Builds the trie from everything added, dropping duplicates.
+    void compile();
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    size_t size() const { return signatures_.size(); }
+    size_t trie_nodes() const { return nodes_.size(); }
+    const FunctionSignature& signature(uint32_t index) const { return signatures_[index]; }
+    std::string_view name(uint32_t index) const {
+        return std::string_view(names_).substr(name_offsets_[index], name_offsets_[index + 1] - name_offsets_[index]);
+    }
+
+    // Identifies the functions of a binary, in parallel, in function order.
+    // With `unnamed_only`, functions that have a symbol are skipped.
+    std::vector<SignatureMatch> match(const ElfParser& parser, const FunctionTable& functions,
+                                      TaskScheduler& scheduler, TaskPriority priority, bool unnamed_only) const;
+
+    size_t memory_bytes() const { return memory_.bytes(); }
+
+private:
+    struct TrieNode {
+        uint32_t first_edge;
+        uint16_t exact_edges;      // Mask 0xFF, sorted by value
+        uint16_t masked_edges;     // The rest, after the exact ones
+        uint32_t first_signature;  // Signatures whose pattern ends here
+        uint32_t signature_count;
+    };
+    // Single-child chains are merged into one edge whose label holds all
+    // their bytes, as (value, mask) pairs in labels_; the first is inline
+    struct TrieEdge {
+        uint32_t child;
+        uint32_t label;   // Offset in labels_ of the pair after the first
+        uint8_t value;    // Already masked
+        uint8_t mask;
+        uint8_t length;   // Bytes on the edge, the first included
+        uint8_t reserved;
+    };
+    // A signature waiting for compile()
+    struct Pending {
+        uint8_t values[kPatternBytes];
+        uint8_t masks[kPatternBytes];
+        uint32_t pattern_length;
+        FunctionSignature signature;
+        std::string name;
+    };
+
+    std::vector<Pending> pending_;
+    std::vector<TrieNode> nodes_;              // Root first
+    std::vector<TrieEdge> edges_;
+    std::vector<uint8_t> labels_;
+    std::vector<FunctionSignature> signatures_; // In trie order
+    std::string names_;
+    std::vector<uint32_t> name_offsets_;        // size() + 1 entries
+    MemoryCharge memory_{MemoryCategory::Functions};
+
+    uint32_t build_node(size_t begin, size_t end, size_t depth);
+    void collect(const uint8_t* bytes, size_t available, uint32_t node, size_t depth,
+                 std::vector<uint32_t>& candidates) const;
+    void update_memory();
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_SIGNATURE_DATABASE_H
@@ -0,0 +1,113 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_STRING_TABLE_H
+#define MOBILE_ARM_DISASSEMBLER_STRING_TABLE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "text_query.h"
+#include "arena.h"
+
+enum class StringEncoding : uint8_t {
+    Ascii = 0,
+    Utf8 = 1,
+    Utf16Le = 2
+};
+
+struct ExtractedString {
+    uint64_t file_offset;
+    uint64_t virtual_address; // 0 when the section is not loaded
+    uint32_t byte_length;     // Length in the file, excluding any terminator
+    uint32_t char_count;
+    int section_index;
+    StringEncoding encoding;
+};
+
+// -1 in the numeric filters means "don't filter on this field".
+struct StringQuery {
+    std::string text;
+    TextMatchMode match_mode = TextMatchMode::Substring;
+    int section_index = -1;
+    int encoding = -1; // StringEncoding value
+    size_t offset = 0;
+    size_t limit = 100;
+};
+
+struct StringQueryResult {
+    size_t total_matches = 0;
+    std::vector<uint32_t> string_indices; // In file-offset order
+};
+
+// (string index, address of the referencing instruction)
+using StringReference = std::pair<uint32_t, uint64_t>;
+
+// Strings found in the non-executable PROGBITS sections of the file.
+//
+// Runs of printable ASCII / valid UTF-8 and of UTF-16LE code units are
+// classified 16 bytes at a time (NEON/SSE2 with a scalar fallback) and kept
+// when at least `min_length` characters long. The decoded text lives in one
+// UTF-8 blob plus a case-folded copy that queries are matched against with the
+// same TextMatcher used for symbols.
+//
+// Code references are attached later: collect_references() is fed decoded
+// instructions during the background sweep and set_references() publishes
+// them as a CSR table keyed by string.
+class StringTable {
+public:
+    explicit StringTable(const ElfParser& parser, size_t min_length = 4);
+
+    size_t size() const { return strings_.size(); }
+    const ExtractedString& string(uint32_t index) const { return strings_[index]; }
+    std::string_view text(uint32_t index) const;
+
+    StringQueryResult query(const StringQuery& query) const;
+
+    // Index of the string starting exactly at `address`, or -1.
+    long find_by_address(uint64_t address) const;
+    // find_by_address() for each of the ascending `addresses`, in one merge pass.
+    std::vector<long> find_by_addresses(const std::vector<uint64_t>& addresses) const;
+
+    // Appends references from instructions whose PC-relative operand is a
+    // string (ADR) or loads a literal word holding a string's address.
+    void collect_references(const std::vector<DisassembledInstruction>& instructions,
+                            std::vector<StringReference>& out) const;
+    void set_references(std::vector<StringReference> references);
+    // Replaces the references made from [source_start, source_end), after
+    // that code was decoded again.
+    void replace_references(uint64_t source_start, uint64_t source_end, std::vector<StringReference> references);
+    bool has_references() const { return references_ready_; }
+
+    // Addresses of instructions referencing a string, ascending.
+    std::vector<uint64_t> references_to(uint32_t index) const;
+    size_t reference_count(uint32_t index) const;
+
+    size_t memory_bytes() const { return memory_.bytes(); }
+
+private:
+    const ElfParser& parser_;
+    std::vector<ExtractedString> strings_; // Sorted by file_offset
+
+    std::string text_blob_;
+    std::string folded_blob_;
+    std::vector<uint32_t> text_offsets_; // size() + 1 entries into both blobs
+
+    std::vector<uint32_t> by_address_; // Loaded strings sorted by virtual address
+
+    bool references_ready_ = false;
+    std::vector<uint32_t> reference_offsets_; // size() + 1 entries
+    std::vector<uint64_t> reference_sites_;
+
+    MemoryCharge memory_{MemoryCategory::Strings};
+    void update_memory_charge();
+
+    std::string_view folded_text(uint32_t index) const {
+        return std::string_view(folded_blob_).substr(
+            text_offsets_[index], text_offsets_[index + 1] - text_offsets_[index]);
+    }
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_STRING_TABLE_H
@@ -0,0 +1,126 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_SYMBOL_INDEX_H
+#define MOBILE_ARM_DISASSEMBLER_SYMBOL_INDEX_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "text_query.h"
+#include "arena.h"
+#include "demangler.h"
+#include "task_scheduler.h"
+
+enum class SymbolSortKey : int {
+    Name = 0,
+    Address = 1,
+    Size = 2
+};
+
+// Filter/sort/page request against the symbol table.
+// -1 in any of the numeric filters means "don't filter on this field".
+struct SymbolQuery {
+    std::string text;
+    TextMatchMode match_mode = TextMatchMode::Substring;
+    int type = -1;          // STT_* value (st_info & 0xF)
+    int binding = -1;       // STB_* value (st_info >> 4)
+    int section_index = -1; // st_shndx
+    SymbolSortKey sort_key = SymbolSortKey::Name;
+    bool descending = false;
+    bool demangled = false; // Match and sort by demangled names, once prepare_demangled_names() has run
+    size_t offset = 0;
+    size_t limit = 100;
+};
+
+struct SymbolQueryResult {
+    size_t total_matches = 0;
+    std::vector<uint32_t> symbol_indices; // Indices into ElfParser::get_symbols()
+};
+
+// Read-only query engine over the parser's symbol table.
+// Sorted permutations and a folded (lower-case) name blob are computed once
+// at construction, so a query is a single linear filter pass in sort order
+// (or a binary-searched range for prefix queries sorted by name).
+//
+// C++ names are demangled lazily: demangled_name() one at a time through
+// the memoizing cache, and the searchable folded column of demangled names
+// only on the first prepare_demangled_names(), which demangles every symbol
+// in parallel. Loading a file demangles nothing.
+class SymbolIndex {
+public:
+    explicit SymbolIndex(const ElfParser& parser);
+
+    SymbolQueryResult query(const SymbolQuery& query) const;
+
+    size_t size() const { return types_.size(); }
+    const SymbolEntry& symbol(uint32_t index) const { return parser_.get_symbols()[index]; }
+
+    // Symbols whose value lies in [start, end), by address: the labels of a
+    // listing without marshalling the whole table.
+    std::vector<uint32_t> in_address_range(uint64_t start, uint64_t end) const;
+
+    // Innermost function or object symbol whose extent contains `address`
+    // (Thumb bit of function values ignored), or -1.
+    long containing(uint64_t address) const;
+
+    // Name of the section a symbol lives in ("unknown" for special indices).
+    std::string_view section_name_for(uint32_t index) const;
+
+    // Resolve a section name to its index, or -1 if no such section.
+    int section_index_by_name(const std::string& section_name) const;
+
+    // The symbol's demangled name, or its name if it is not a C++ name.
+    // Valid as long as the index.
+    std::string_view demangled_name(uint32_t index) const { return demangler_.demangle(symbol(index).name); }
+
+    // Thread-safe; shared with other bulk users of symbol names.
+    DemangleCache& demangler() const { return demangler_; }
+
+    // Builds the demangled name column queries with `demangled` set use.
+    // Only the first call does any work; later ones return at once.
+    void prepare_demangled_names(TaskScheduler& scheduler, TaskPriority priority) const;
+    bool has_demangled_names() const { return demangled_ready_.load(std::memory_order_acquire); }
+
+private:
+    // Folded names, stored back to back to keep the scan cache friendly,
+    // and the symbols sorted by them.
+    struct NameColumn {
+        std::string blob;
+        std::vector<uint32_t> offsets; // size() + 1 entries
+        std::vector<uint32_t> by_name;
+
+        std::string_view name(uint32_t index) const {
+            return std::string_view(blob).substr(offsets[index], offsets[index + 1] - offsets[index]);
+        }
+    };
+
+    const ElfParser& parser_;
+
+    NameColumn names_;
+
+    std::vector<uint8_t> types_;
+    std::vector<uint8_t> bindings_;
+
+    std::vector<uint32_t> by_address_;
+    std::vector<uint32_t> by_size_;
+    uint64_t max_size_ = 0; // Bounds how far back containing() looks
+
+    MemoryCharge memory_{MemoryCategory::Symbols};
+
+    mutable DemangleCache demangler_;
+    mutable std::mutex demangled_mutex_; // Serialises building the column
+    mutable NameColumn demangled_names_; // Written once, before demangled_ready_
+    mutable std::atomic<bool> demangled_ready_{false};
+    mutable MemoryCharge demangled_memory_{MemoryCategory::Symbols};
+
+    static void sort_by_name(NameColumn& column);
+    const NameColumn& column_for(const SymbolQuery& query) const;
+    bool passes_filters(uint32_t index, const SymbolQuery& query, const NameColumn& column,
+                        const TextMatcher& matcher) const;
+    const std::vector<uint32_t>& permutation_for(SymbolSortKey key, const NameColumn& column) const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_SYMBOL_INDEX_H
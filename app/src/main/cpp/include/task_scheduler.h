@@ -0,0 +1,114 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_TASK_SCHEDULER_H
+#define MOBILE_ARM_DISASSEMBLER_TASK_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+enum class TaskPriority : uint8_t {
+    Interactive = 0, // Work the UI is waiting on (decode the visible page, load)
+    Background = 1   // Whole-binary analysis
+};
+
+// Cancel flag shared by related tasks. Tasks of a cancelled group that have
+// not started are dropped; running ones are expected to poll the flag.
+class CancellationGroup {
+public:
+    void cancel() { cancelled_ = true; }
+    bool is_cancelled() const { return cancelled_; }
+    const std::atomic<bool>& flag() const { return cancelled_; }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Completion of one submitted task.
+class TaskHandle {
+public:
+    TaskHandle() = default;
+
+    bool valid() const { return state_ != nullptr; }
+    bool is_done() const;
+    // True if the task was dropped because its group was cancelled.
+    bool was_cancelled() const;
+    // Blocks until the task ran or was dropped. Do not wait from a worker on
+    // a task that may still be queued behind the waiting one.
+    void wait() const;
+
+private:
+    friend class TaskScheduler;
+    struct State {
+        std::mutex mutex;
+        std::condition_variable done_condition;
+        bool done = false;
+        bool cancelled = false;
+    };
+    std::shared_ptr<State> state_;
+};
+
+// Work-stealing task scheduler.
+//
+// Each worker owns a deque per priority lane. Tasks submitted from a worker
+// go to its own deque (popped LIFO for locality), others are spread round
+// robin; idle workers steal FIFO from the others. Interactive tasks are
+// always taken before background ones, and background tasks never occupy
+// every worker, so a "decode this page" request does not queue behind
+// whole-binary analysis.
+class TaskScheduler {
+public:
+    explicit TaskScheduler(size_t worker_count = default_worker_count());
+    ~TaskScheduler();
+
+    // Number of big (non-efficiency) cores, read from cpufreq; all cores when
+    // they are uniform or cpufreq is unavailable. Clamped to [2, 8].
+    static size_t default_worker_count();
+
+    size_t worker_count() const { return workers_.size(); }
+
+    TaskHandle submit(std::function<void()> task, TaskPriority priority = TaskPriority::Background,
+                      std::shared_ptr<CancellationGroup> group = nullptr);
+
+    // Calls body(begin, end) over [0, count) in pieces of `grain` indices on
+    // up to worker_count() threads, the caller included; returns when all
+    // pieces are done.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body,
+                      TaskPriority priority = TaskPriority::Interactive);
+
+    // Runs what is queued, then joins the workers. Later submits are dropped.
+    void shutdown();
+
+private:
+    struct Task {
+        std::function<void()> function;
+        std::shared_ptr<TaskHandle::State> state;
+        std::shared_ptr<CancellationGroup> group;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> lanes[2]; // Indexed by TaskPriority
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    size_t background_limit_;
+    std::atomic<size_t> next_worker_{0};
+
+    // Guarded by sleep_mutex_
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    size_t pending_[2] = {0, 0}; // Queued, unreserved tasks per lane
+    size_t running_background_ = 0;
+    bool stop_ = false;
+
+    void worker_loop(size_t index);
+    bool try_take(size_t index, TaskPriority lane, Task& out);
+    void run(Task& task);
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_TASK_SCHEDULER_H
@@ -0,0 +1,45 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_TEXT_QUERY_H
+#define MOBILE_ARM_DISASSEMBLER_TEXT_QUERY_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <regex>
+
+// How a query string is matched against names (symbols, strings, ...)
+enum class TextMatchMode : int {
+    Prefix = 0,
+    Substring = 1,
+    Regex = 2
+};
+
+// Case-insensitive matcher shared by the native query engines.
+// Callers are expected to pass text that has already been folded with
+// fold_ascii_case() so the hot loop does not need to lower-case anything.
+class TextMatcher {
+public:
+    TextMatcher(const std::string& pattern, TextMatchMode mode);
+
+    bool is_valid() const { return valid_; }
+    bool is_empty() const { return pattern_.empty(); }
+    TextMatchMode mode() const { return mode_; }
+    const std::string& folded_pattern() const { return pattern_; }
+
+    // Folded literal every match must start with: the whole pattern for
+    // Prefix queries, the leading literal run of a '^'-anchored regex, else "".
+    const std::string& required_prefix() const { return required_prefix_; }
+
+    bool matches(std::string_view folded_text) const;
+
+private:
+    std::string pattern_;
+    TextMatchMode mode_;
+    bool valid_;
+    std::string required_prefix_;
+    std::unique_ptr<std::regex> regex_;
+};
+
+// Lower-cases ASCII letters only; non-ASCII bytes are left untouched.
+std::string fold_ascii_case(std::string_view text);
+
+#endif //MOBILE_ARM_DISASSEMBLER_TEXT_QUERY_H
@@ -0,0 +1,97 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_TRACE_H
+#define MOBILE_ARM_DISASSEMBLER_TRACE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Low-overhead instrumentation of the native hot paths.
+//
+// KTIMAZ_TRACE_SCOPE(name) times the enclosing scope; name must be a string
+// literal. KTIMAZ_TRACE_SCOPE_FAULTS(name) also records the page faults the
+// thread took meanwhile (one getrusage() at each end, so only for coarse
+// scopes such as mapping and parsing). KTIMAZ_TRACE_COUNT(counter, delta)
+// bumps a TraceCounter.
+//
+// Each thread writes to its own buffer: a ring of its latest scope events
+// for the Chrome trace, plus per-site totals and counters that never wrap,
+// for the stats snapshot. Writers touch nothing shared; readers merge the
+// buffers under the registry lock.
+//
+// Unless KTIMAZ_ENABLE_TRACING is defined the macros expand to nothing, and
+// the query functions below report no data.
+
+enum class TraceCounter : uint8_t {
+    SectionsParsed = 0,
+    SymbolsParsed = 1,
+    InstructionsDecoded = 2,
+    BytesDecoded = 3,
+    JniCalls = 4,
+    MinorFaults = 5, // Only inside KTIMAZ_TRACE_SCOPE_FAULTS scopes
+    MajorFaults = 6,
+    Count = 7
+};
+
+const char* trace_counter_name(TraceCounter counter);
+
+struct TraceSiteStats {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+struct TraceStats {
+    std::vector<TraceSiteStats> sites; // Sites entered at least once
+    uint64_t counters[static_cast<size_t>(TraceCounter::Count)] = {};
+};
+
+bool tracing_enabled();
+TraceStats trace_stats();
+// Events still in the ring buffers, as Chrome trace JSON (chrome://tracing,
+// Perfetto). Empty when tracing is compiled out.
+std::string trace_export_chrome_json();
+// Clears events, totals and counters of every thread.
+void trace_reset();
+
+#if defined(KTIMAZ_ENABLE_TRACING)
+
+#define KTIMAZ_TRACE_CONCAT_INNER(a, b) a##b
+#define KTIMAZ_TRACE_CONCAT(a, b) KTIMAZ_TRACE_CONCAT_INNER(a, b)
+
+#define KTIMAZ_TRACE_SCOPE_IMPL(name, faults)                                                          \
+    static const uint16_t KTIMAZ_TRACE_CONCAT(ktimaz_trace_site_, __LINE__) = trace_register_site(name); \
+    TraceScope KTIMAZ_TRACE_CONCAT(ktimaz_trace_scope_, __LINE__)(KTIMAZ_TRACE_CONCAT(ktimaz_trace_site_, __LINE__), faults)
+
+#define KTIMAZ_TRACE_SCOPE(name) KTIMAZ_TRACE_SCOPE_IMPL(name, false)
+#define KTIMAZ_TRACE_SCOPE_FAULTS(name) KTIMAZ_TRACE_SCOPE_IMPL(name, true)
+#define KTIMAZ_TRACE_COUNT(counter, delta) trace_count(counter, static_cast<uint64_t>(delta))
+
+// Returns the id of a named site; called once per site from the macros.
+uint16_t trace_register_site(const char* name);
+void trace_count(TraceCounter counter, uint64_t delta);
+
+class TraceScope {
+public:
+    TraceScope(uint16_t site, bool faults);
+    ~TraceScope();
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    uint16_t site_;
+    bool faults_;
+    uint64_t start_ns_;
+    uint64_t minor_faults_ = 0;
+    uint64_t major_faults_ = 0;
+};
+
+#else
+
+#define KTIMAZ_TRACE_SCOPE(name) do {} while (0)
+#define KTIMAZ_TRACE_SCOPE_FAULTS(name) do {} while (0)
+#define KTIMAZ_TRACE_COUNT(counter, delta) do {} while (0)
+
+#endif
+
+#endif //MOBILE_ARM_DISASSEMBLER_TRACE_H
@@ -1,16 +1,11 @@
 #ifndef MOBILE_ARM_DISASSEMBLER_UTILS_H
 #define MOBILE_ARM_DISASSEMBLER_UTILS_H
 
-#include <jni.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <memory>
-#include <functional>
-#include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 
 // Simple struct to hold memory-mapped file data
 struct MappedFile {
@@ -25,31 +20,23 @@ MappedFile map_file(const std::string& file_path);
 // Function to unmap a file
 void unmap_file(MappedFile& mapped_file);
 
-// Basic error logging for native code
-void log_error(const std::string& message);
-void log_info(const std::string& message);
-
-// Converts a wide character string to UTF-8 (Android JNI specific)
-std::string jstring_to_cpp_string(JNIEnv* env, jstring jstr);
-
-// Converts a C++ string to Java string (Android JNI specific)
-jstring cpp_string_to_jstring(JNIEnv* env, const std::string& cpp_str);
+// Appends standard UTF-8 (4-byte sequences included, unlike the modified
+// UTF-8 of NewStringUTF) to `out` as UTF-16, for handing to Java; invalid
+// bytes become U+FFFD.
+void utf8_to_utf16(std::string_view utf8, std::vector<uint16_t>& out);
 
-// Simple thread pool implementation
-class SimpleThreadPool {
-public:
-    SimpleThreadPool(int num_threads = 4);
-    ~SimpleThreadPool();
+// Appends `text` as a quoted JSON string. Invalid UTF-8 becomes U+FFFD, so
+// names from corrupt string tables still give valid output.
+void append_json_string(std::string& out, std::string_view text);
 
-    void enqueue(std::function<void()> task);
-    void shutdown();
+// Appends `value` in lowercase hex without a prefix, zero-padded to at least
+// `min_digits` digits.
+void append_hex(std::string& out, uint64_t value, int min_digits = 1);
 
-private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
-};
+// Basic error logging for native code
+void log_error(const std::string& message);
+void log_info(const std::string& message);
+// Host builds print info messages only when enabled; errors always go out.
+void set_verbose_logging(bool enabled);
 
-#endif //MOBILE_ARM_DISASSEMBLER_UTILS_H
\ No newline at end of file
+#endif //MOBILE_ARM_DISASSEMBLER_UTILS_H
@@ -0,0 +1,91 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_XREF_INDEX_H
+#define MOBILE_ARM_DISASSEMBLER_XREF_INDEX_H
+
+#include <vector>
+#include <cstdint>
+
+#include "elf_parser.h"
+#include "arm_disassembler.h"
+#include "arena.h"
+
+enum class XrefKind : uint8_t {
+    Call = 0,    // BL/BLX to the target
+    Jump = 1,    // B/Bcc/CBZ to the target
+    Read = 2,    // PC-relative literal load from the target
+    Address = 3, // ADR or PC-relative address formed without a load
+    Pointer = 4  // Literal word loaded by the instruction holds the target
+};
+
+struct Xref {
+    uint64_t target;
+    uint64_t source; // Address of the referencing instruction
+    XrefKind kind;
+};
+
+struct XrefPage {
+    size_t total_matches = 0;
+    std::vector<Xref> references; // Ordered by target, then source
+};
+
+// Cross references from code, keyed by target address.
+//
+// References are collected per decoded run with collect() (safe to call from
+// several sweep threads at once), added with add() and compacted by
+// finalize() into CSR arrays: sorted unique targets, offsets into parallel
+// source/kind arrays. A lookup is a binary search over the targets, and
+// results for an address range are contiguous, so paging is an offset.
+//
+// When a section is decoded again, replace_sources() swaps out every
+// reference originating in its address range and merges the new ones in,
+// without re-sweeping the rest of the binary.
+class XrefIndex {
+public:
+    // Appends the references made by `instructions`.
+    static void collect(const ElfParser& parser, const std::vector<DisassembledInstruction>& instructions,
+                        std::vector<Xref>& out);
+
+    // Only valid before finalize().
+    void add(const std::vector<Xref>& references);
+    void finalize();
+
+    bool is_finalized() const { return finalized_; }
+    size_t size() const { return sources_.size(); }
+    size_t target_count() const { return targets_.size(); }
+
+    // References to targets in [target_start, target_end), paged.
+    XrefPage query(uint64_t target_start, uint64_t target_end, size_t offset, size_t limit) const;
+    size_t count_to(uint64_t target) const;
+
+    // Calls f(const Xref&) for every reference, in target order.
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t t = 0; t < targets_.size(); ++t) {
+            for (uint32_t i = offsets_[t]; i < offsets_[t + 1]; ++i) {
+                f(Xref{targets_[t], sources_[i], kinds_[i]});
+            }
+        }
+    }
+
+    // Sorted unique targets referenced at least once with `kind`.
+    std::vector<uint64_t> targets_of_kind(XrefKind kind) const;
+
+    // Replaces all references whose source lies in [source_start, source_end)
+    // and returns the ones it removed.
+    std::vector<Xref> replace_sources(uint64_t source_start, uint64_t source_end, std::vector<Xref> references);
+
+private:
+    bool finalized_ = false;
+    std::vector<Xref> pending_;
+
+    std::vector<uint64_t> targets_;  // Sorted unique targets
+    std::vector<uint32_t> offsets_;  // targets_.size() + 1 entries
+    std::vector<uint64_t> sources_;  // Ascending within each target
+    std::vector<XrefKind> kinds_;
+
+    MemoryCharge memory_{MemoryCategory::Xrefs};
+
+    void build(std::vector<Xref>& sorted_references);
+    std::vector<Xref> expand() const;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_XREF_INDEX_H
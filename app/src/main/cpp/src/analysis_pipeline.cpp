@@ -0,0 +1,101 @@
+#include "../include/analysis_pipeline.h"
+#include "../include/utils.h"
+#include <chrono>
+
+AnalysisPipeline::AnalysisPipeline(TaskScheduler& scheduler, std::shared_ptr<CancellationGroup> group)
+    : scheduler_(scheduler), group_(std::move(group)) {}
+
+void AnalysisPipeline::add_stage(AnalysisStage stage, std::vector<AnalysisStage> dependencies,
+                                 StageFunction function) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+        log_error("add_stage called on a started analysis pipeline.");
+        return;
+    }
+    Stage& entry = stages_[static_cast<int>(stage)];
+    entry.state = StageState::Waiting;
+    entry.dependencies = std::move(dependencies);
+    entry.function = std::move(function);
+}
+
+void AnalysisPipeline::set_listener(StageListener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listener_ = std::move(listener);
+}
+
+void AnalysisPipeline::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    started_ = true;
+    submit_ready_locked();
+}
+
+bool AnalysisPipeline::dependencies_done(const Stage& stage) const {
+    for (AnalysisStage dependency : stage.dependencies) {
+        if (stages_[static_cast<int>(dependency)].state != StageState::Done) return false;
+    }
+    return true;
+}
+
+void AnalysisPipeline::submit_locked(AnalysisStage stage, TaskPriority priority) {
+    stages_[static_cast<int>(stage)].state = StageState::Queued;
+    std::shared_ptr<AnalysisPipeline> self = shared_from_this();
+    scheduler_.submit([self, stage, priority]() { self->run_stage(stage, priority); }, priority, group_);
+}
+
+void AnalysisPipeline::submit_ready_locked() {
+    for (int i = 0; i < kAnalysisStageCount; ++i) {
+        Stage& stage = stages_[i];
+        if (stage.state == StageState::Waiting && dependencies_done(stage)) {
+            submit_locked(static_cast<AnalysisStage>(i),
+                          stage.promoted ? TaskPriority::Interactive : TaskPriority::Background);
+        }
+    }
+}
+
+void AnalysisPipeline::promote(AnalysisStage stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_ || group_->is_cancelled()) return;
+    promote_locked(stage);
+}
+
+void AnalysisPipeline::promote_locked(AnalysisStage stage) {
+    Stage& entry = stages_[static_cast<int>(stage)];
+    if (entry.promoted) return;
+    entry.promoted = true;
+    if (entry.state == StageState::Waiting) {
+        for (AnalysisStage dependency : entry.dependencies) {
+            promote_locked(dependency);
+        }
+    } else if (entry.state == StageState::Queued) {
+        // Queue it again in the interactive lane; whichever copy runs first wins
+        submit_locked(stage, TaskPriority::Interactive);
+    }
+}
+
+void AnalysisPipeline::run_stage(AnalysisStage stage, TaskPriority priority) {
+    Stage& entry = stages_[static_cast<int>(stage)];
+    StageFunction function;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry.state != StageState::Queued) return;
+        entry.state = StageState::Running;
+        function = entry.function;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    bool finished = !group_->is_cancelled() && function(priority);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    StageListener listener;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entry.state = finished ? StageState::Done : StageState::Abandoned;
+        if (!finished) return;
+        completed_ |= 1u << static_cast<int>(stage);
+        submit_ready_locked();
+        listener = listener_;
+    }
+    log_info("Analysis stage " + std::to_string(static_cast<int>(stage)) + " done in " +
+             std::to_string(static_cast<int>(seconds * 1000)) + " ms");
+    if (listener) listener(stage);
+}
@@ -0,0 +1,104 @@
+#include "../include/arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kCategoryCount = static_cast<size_t>(MemoryCategory::Count);
+
+std::atomic<size_t> g_category_bytes[kCategoryCount];
+std::atomic<size_t> g_category_peak[kCategoryCount];
+
+} // namespace
+
+const char* memory_category_name(MemoryCategory category) {
+    static const char* names[] = {
+        "symbols", "strings", "decode", "search_index", "xrefs", "functions", "cfg"
+    };
+    size_t index = static_cast<size_t>(category);
+    return index < kCategoryCount ? names[index] : "unknown";
+}
+
+size_t MemoryUsage::total() const {
+    size_t sum = 0;
+    for (size_t bytes_in_category : bytes) sum += bytes_in_category;
+    return sum;
+}
+
+void memory_account(MemoryCategory category, ptrdiff_t delta) {
+    size_t index = static_cast<size_t>(category);
+    size_t now = g_category_bytes[index].fetch_add(static_cast<size_t>(delta)) + static_cast<size_t>(delta);
+    size_t peak = g_category_peak[index].load(std::memory_order_relaxed);
+    while (delta > 0 && now > peak && !g_category_peak[index].compare_exchange_weak(peak, now)) {
+    }
+}
+
+MemoryUsage memory_usage() {
+    MemoryUsage usage;
+    for (size_t i = 0; i < kCategoryCount; ++i) {
+        usage.bytes[i] = g_category_bytes[i].load();
+        usage.peak_bytes[i] = g_category_peak[i].load();
+    }
+    return usage;
+}
+
+void MemoryCharge::set(size_t bytes) {
+    memory_account(category_, static_cast<ptrdiff_t>(bytes) - static_cast<ptrdiff_t>(bytes_));
+    bytes_ = bytes;
+}
+
+Arena::Arena(MemoryCategory category, size_t initial_block_size)
+    : category_(category), initial_block_size_(std::max<size_t>(initial_block_size, 64)) {}
+
+Arena::~Arena() {
+    memory_account(category_, -static_cast<ptrdiff_t>(reserved_));
+}
+
+void Arena::add_block(size_t minimum_size) {
+    size_t size = blocks_.empty() ? initial_block_size_ : std::min(blocks_.back().size * 2, kMaxBlockSize);
+    size = std::max(size, minimum_size);
+    blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    cursor_ = blocks_.back().data.get();
+    limit_ = cursor_ + size;
+    reserved_ += size;
+    memory_account(category_, static_cast<ptrdiff_t>(size));
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (cursor_ == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit_)) {
+        add_block(size + alignment);
+        aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+    cursor_ = reinterpret_cast<char*>(aligned + size);
+    used_ += size;
+    return reinterpret_cast<void*>(aligned);
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    if (text.empty()) return {};
+    char* destination = static_cast<char*>(allocate(text.size(), 1));
+    memcpy(destination, text.data(), text.size());
+    return std::string_view(destination, text.size());
+}
+
+void Arena::release() {
+    memory_account(category_, -static_cast<ptrdiff_t>(reserved_));
+    blocks_.clear();
+    cursor_ = nullptr;
+    limit_ = nullptr;
+    used_ = 0;
+    reserved_ = 0;
+}
+
+void Arena::reset() {
+    if (blocks_.empty()) return;
+    size_t kept = blocks_.front().size;
+    memory_account(category_, -static_cast<ptrdiff_t>(reserved_ - kept));
+    blocks_.resize(1);
+    cursor_ = blocks_.front().data.get();
+    limit_ = cursor_ + kept;
+    used_ = 0;
+    reserved_ = kept;
+}
@@ -1,26 +1,77 @@
 #include "../include/arm_disassembler.h"
 #include "../include/utils.h"
+#include "../include/trace.h"
 #include <cstring>
-#include <iomanip>
-#include <sstream>
-#include <map>
 
 // ARM instruction type identification masks
 #define ARM_BRANCH_MASK     0x0E000000
 #define ARM_BRANCH_VAL      0x0A000000
 #define ARM_BLX_MASK        0x0E000000
 #define ARM_BLX_VAL         0x0B000000
+#define ARM_BX_MASK         0x0FFFFFD0
+#define ARM_BX_VAL          0x012FFF10
+#define ARM_BLOCK_MASK      0x0E000000
+#define ARM_BLOCK_VAL       0x08000000
 #define ARM_DATA_PROC_MASK  0x0C000000
 #define ARM_DATA_PROC_VAL   0x00000000
 #define ARM_LOAD_STORE_MASK 0x0C000000
 #define ARM_LOAD_STORE_VAL  0x04000000
 
+#define ARM_COND_ALWAYS     0xE
+
 // Thumb instruction identification
 #define THUMB_BRANCH_MASK   0xF000
 #define THUMB_BRANCH_VAL    0xD000
 #define THUMB_BL_MASK       0xF800
 #define THUMB_BL_VAL        0xF000
 
+namespace {
+
+// Appends "0x" and `value` in upper-case hex.
+template <size_t Capacity>
+void append_hex(InlineText<Capacity>& text, uint64_t value) {
+    char digits[18];
+    size_t length = 0;
+    do {
+        digits[sizeof(digits) - 1 - length++] = "0123456789ABCDEF"[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    digits[sizeof(digits) - 1 - length++] = 'x';
+    digits[sizeof(digits) - 1 - length++] = '0';
+    text.append(std::string_view(digits + sizeof(digits) - length, length));
+}
+
+template <size_t Capacity>
+void append_decimal(InlineText<Capacity>& text, uint32_t value) {
+    char digits[10];
+    size_t length = 0;
+    do {
+        digits[sizeof(digits) - 1 - length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    text.append(std::string_view(digits + sizeof(digits) - length, length));
+}
+
+} // namespace
+
+void append_listing_line(std::string& out, const DisassembledInstruction& instr) {
+    // At least 8 upper-case hex digits, as "%08llX" would print
+    char address[16];
+    size_t length = 0;
+    uint64_t value = instr.address;
+    do {
+        address[sizeof(address) - 1 - length++] = "0123456789ABCDEF"[value & 0xF];
+        value >>= 4;
+    } while (value != 0 || length < 8);
+    out.append(address + sizeof(address) - length, length);
+    out += "  ";
+    out += instr.mnemonic.view();
+    if (!instr.operands.empty()) {
+        out += ' ';
+        out += instr.operands.view();
+    }
+}
+
 ArmDisassembler::ArmDisassembler() {
     log_info("ARM Disassembler initialized.");
 }
@@ -31,107 +82,167 @@ ArmDisassembler::~ArmDisassembler() {
 
 std::vector<DisassembledInstruction> ArmDisassembler::disassemble_block(
     const uint8_t* data, size_t data_size, uint64_t base_address, bool is_thumb_mode) {
-    
+
     std::vector<DisassembledInstruction> instructions;
-    
+    disassemble_block_into(data, data_size, base_address, is_thumb_mode, instructions);
+    return instructions;
+}
+
+void ArmDisassembler::disassemble_block_into(const uint8_t* data, size_t data_size, uint64_t base_address,
+                                             bool is_thumb_mode, std::vector<DisassembledInstruction>& out) {
+    KTIMAZ_TRACE_SCOPE("disasm.block");
+    out.clear();
     if (data == nullptr || data_size == 0) {
         log_error("Invalid data provided to disassemble_block.");
-        return instructions;
+        return;
     }
-    
+
+    // Exact for ARM; Thumb code is mostly 16-bit, so this rarely regrows
+    out.reserve(is_thumb_mode ? data_size / 2 + 1 : data_size / 4 + 1);
+
     size_t offset = 0;
     uint64_t current_address = base_address;
-    
+
     while (offset < data_size) {
-        int instruction_size = 0;
-        DisassembledInstruction instr = decode_instruction(
-            data + offset, current_address, is_thumb_mode, instruction_size);
-        
-        if (instruction_size <= 0) {
-            // Invalid instruction, use default size
-            instruction_size = is_thumb_mode ? 2 : 4;
-            instr.mnemonic = "???";
-            instr.operands = "";
-            instr.bytes = 0;
-            instr.is_branch = false;
-            instr.branch_target = 0;
-        }
-        
-        // Ensure we don't read past the end
-        if (offset + instruction_size > data_size) {
-            instruction_size = data_size - offset;
-        }
-        
-        instructions.push_back(instr);
-        offset += instruction_size;
-        current_address += instruction_size;
+        out.push_back(decode_one(data + offset, data_size - offset, current_address, is_thumb_mode));
+        offset += out.back().size;
+        current_address += out.back().size;
     }
-    
-    return instructions;
+    KTIMAZ_TRACE_COUNT(TraceCounter::InstructionsDecoded, out.size());
+    KTIMAZ_TRACE_COUNT(TraceCounter::BytesDecoded, data_size);
+}
+
+DisassembledInstruction ArmDisassembler::decode_one(
+    const uint8_t* data, size_t available, uint64_t address, bool is_thumb_mode) {
+
+    // The decoders always look at 4 bytes; pad the tail so a short
+    // final instruction never reads past the end of the block.
+    const uint8_t* instr_bytes = data;
+    uint8_t tail[4] = {0, 0, 0, 0};
+    if (available < sizeof(tail)) {
+        memcpy(tail, data, available);
+        instr_bytes = tail;
+    }
+
+    int instruction_size = 0;
+    DisassembledInstruction instr = decode_instruction(
+        instr_bytes, address, is_thumb_mode, instruction_size);
+
+    if (instruction_size <= 0) {
+        // Invalid instruction, use default size
+        instruction_size = is_thumb_mode ? 2 : 4;
+        instr.mnemonic = "???";
+        instr.operands.clear();
+        instr.bytes = 0;
+        instr.is_branch = false;
+        instr.branch_kind = BranchKind::None;
+        instr.is_conditional = false;
+        instr.branch_target = 0;
+        instr.data_target = 0;
+        instr.data_size = 0;
+        instr.data_register = NO_REGISTER;
+        instr.pc_add_register = NO_REGISTER;
+    }
+
+    // Ensure we don't claim bytes past the end
+    if (static_cast<size_t>(instruction_size) > available) {
+        instruction_size = static_cast<int>(available);
+    }
+    instr.size = static_cast<uint8_t>(instruction_size);
+    return instr;
 }
 
 DisassembledInstruction ArmDisassembler::decode_instruction(
     const uint8_t* instr_bytes, uint64_t current_address, bool is_thumb_mode, int& instruction_size) {
-    
+
     DisassembledInstruction instr;
     instr.address = current_address;
+    instr.size = 0;
     instr.is_branch = false;
+    instr.branch_kind = BranchKind::None;
+    instr.is_conditional = false;
     instr.branch_target = 0;
-    instr.comment = "";
-    
+    instr.data_target = 0;
+    instr.data_size = 0;
+    instr.data_register = NO_REGISTER;
+    instr.pc_add_register = NO_REGISTER;
+    instr.comment = std::string_view();
+
     if (is_thumb_mode) {
         // Thumb mode - 16-bit instructions
         instruction_size = 2;
         uint16_t instruction = (instr_bytes[1] << 8) | instr_bytes[0]; // Little-endian
         instr.bytes = instruction;
-        
+
         // Check for 32-bit Thumb instructions (Thumb-2)
         if ((instruction & 0xF800) == 0xF000 || (instruction & 0xF800) == 0xF800 || (instruction & 0xE800) == 0xE800) {
-            // This is a 32-bit Thumb instruction
-            if (instruction_size + 2 <= 4) { // Make sure we have enough data
-                instruction_size = 4;
-                uint32_t full_instruction = instruction | ((instr_bytes[3] << 24) | (instr_bytes[2] << 16));
-                instr.bytes = full_instruction;
-                decode_thumb32_instruction(full_instruction, instr);
-            } else {
-                decode_thumb16_instruction(instruction, instr);
-            }
+            // This is a 32-bit Thumb instruction; the first halfword goes in the upper 16 bits
+            instruction_size = 4;
+            uint16_t second = (instr_bytes[3] << 8) | instr_bytes[2];
+            uint32_t full_instruction = (static_cast<uint32_t>(instruction) << 16) | second;
+            instr.bytes = full_instruction;
+            decode_thumb32_instruction(full_instruction, instr);
         } else {
             decode_thumb16_instruction(instruction, instr);
         }
     } else {
         // ARM mode - 32-bit instructions
         instruction_size = 4;
-        uint32_t instruction = (instr_bytes[3] << 24) | (instr_bytes[2] << 16) | 
+        uint32_t instruction = (instr_bytes[3] << 24) | (instr_bytes[2] << 16) |
                               (instr_bytes[1] << 8) | instr_bytes[0]; // Little-endian
         instr.bytes = instruction;
         decode_arm_instruction(instruction, instr, current_address);
     }
-    
+
     return instr;
 }
 
 void ArmDisassembler::decode_arm_instruction(uint32_t instruction, DisassembledInstruction& instr, uint64_t current_address) {
     // Check condition code
     uint8_t condition = (instruction >> 28) & 0xF;
-    std::string cond_suffix = get_condition_suffix(condition);
-    
+    const char* cond_suffix = get_condition_suffix(condition);
+    instr.is_conditional = condition < ARM_COND_ALWAYS;
+
     if ((instruction & ARM_BRANCH_MASK) == ARM_BRANCH_VAL) {
         // Branch instruction
         instr.is_branch = true;
         bool link = instruction & 0x01000000;
-        instr.mnemonic = link ? ("BL" + cond_suffix) : ("B" + cond_suffix);
-        
+
         // Calculate branch target
         int32_t offset = (instruction & 0x00FFFFFF) << 2;
         if (offset & 0x02000000) { // Sign extend
             offset |= 0xFC000000;
         }
+
+        if (condition == 0xF) {
+            // BLX imm: always a call into Thumb code, H supplies bit 1
+            instr.mnemonic = "BLX";
+            instr.is_conditional = false;
+            instr.branch_kind = BranchKind::Call;
+            offset |= link ? 2 : 0;
+        } else {
+            instr.mnemonic = link ? "BL" : "B";
+            instr.mnemonic += cond_suffix;
+            instr.branch_kind = link ? BranchKind::Call : BranchKind::Jump;
+        }
         instr.branch_target = current_address + 8 + offset; // PC + 8 + offset
-        
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instr.branch_target;
-        instr.operands = ss.str();
+
+        instr.operands.clear();
+        append_hex(instr.operands, instr.branch_target);
+    }
+    else if ((instruction & ARM_BX_MASK) == ARM_BX_VAL) {
+        // BX/BLX register
+        bool link = instruction & 0x20;
+        uint32_t rm = instruction & 0xF;
+        instr.is_branch = true;
+        instr.mnemonic = link ? "BLX" : "BX";
+        instr.mnemonic += cond_suffix;
+        instr.operands = register_name(rm);
+        if (link) {
+            instr.branch_kind = BranchKind::IndirectCall;
+        } else {
+            instr.branch_kind = rm == 14 ? BranchKind::Return : BranchKind::IndirectJump;
+        }
     }
     else if ((instruction & ARM_DATA_PROC_MASK) == ARM_DATA_PROC_VAL) {
         // Data processing instruction
@@ -141,45 +252,142 @@ void ArmDisassembler::decode_arm_instruction(uint32_t instruction, DisassembledI
         // Load/Store instruction
         decode_load_store(instruction, instr, cond_suffix);
     }
+    else if ((instruction & ARM_BLOCK_MASK) == ARM_BLOCK_VAL) {
+        // Load/Store multiple (PUSH/POP/LDM/STM)
+        decode_block_transfer(instruction, instr, cond_suffix);
+    }
     else {
         // Unknown instruction
-        instr.mnemonic = "UNK" + cond_suffix;
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instruction;
-        instr.operands = ss.str();
+        instr.mnemonic = "UNK";
+        instr.mnemonic += cond_suffix;
+        instr.operands.clear();
+        append_hex(instr.operands, instruction);
     }
 }
 
 void ArmDisassembler::decode_thumb16_instruction(uint16_t instruction, DisassembledInstruction& instr) {
-    if ((instruction & 0xF000) == 0xD000) {
+    if ((instruction & 0xF000) == 0xD000 && ((instruction >> 8) & 0xF) >= 0xE) {
+        // Condition 0xE is the permanently undefined space, 0xF is SVC
+        bool svc = ((instruction >> 8) & 0xF) == 0xF;
+        instr.mnemonic = svc ? "SVC" : "UDF";
+        instr.operands = "#";
+        append_hex(instr.operands, instruction & 0xFF);
+    }
+    else if ((instruction & 0xF000) == 0xD000) {
         // Conditional branch
         instr.is_branch = true;
+        instr.branch_kind = BranchKind::Jump;
+        instr.is_conditional = true;
         uint8_t condition = (instruction >> 8) & 0xF;
-        instr.mnemonic = "B" + get_condition_suffix(condition);
-        
+        instr.mnemonic = "B";
+        instr.mnemonic += get_condition_suffix(condition);
+
         // Calculate branch target (sign-extended 8-bit offset * 2)
         int16_t offset = (int8_t)(instruction & 0xFF) * 2;
         instr.branch_target = instr.address + 4 + offset; // PC + 4 + offset
-        
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instr.branch_target;
-        instr.operands = ss.str();
+
+        instr.operands.clear();
+        append_hex(instr.operands, instr.branch_target);
     }
     else if ((instruction & 0xF800) == 0xE000) {
         // Unconditional branch
         instr.is_branch = true;
+        instr.branch_kind = BranchKind::Jump;
         instr.mnemonic = "B";
-        
+
         // Calculate branch target (sign-extended 11-bit offset * 2)
         int16_t offset = (instruction & 0x7FF) * 2;
         if (offset & 0x800) { // Sign extend
             offset |= 0xF000;
         }
         instr.branch_target = instr.address + 4 + offset;
-        
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instr.branch_target;
-        instr.operands = ss.str();
+
+        instr.operands.clear();
+        append_hex(instr.operands, instr.branch_target);
+    }
+    else if ((instruction & 0xF500) == 0xB100) {
+        // CBZ/CBNZ Rn, label (forward only)
+        instr.is_branch = true;
+        instr.branch_kind = BranchKind::Jump;
+        instr.is_conditional = true;
+        instr.mnemonic = (instruction & 0x0800) ? "CBNZ" : "CBZ";
+        uint32_t offset = (((instruction >> 9) & 1) << 6) | (((instruction >> 3) & 0x1F) << 1);
+        instr.branch_target = instr.address + 4 + offset;
+
+        instr.operands = register_name(instruction & 0x7);
+        instr.operands += ", ";
+        append_hex(instr.operands, instr.branch_target);
+    }
+    else if ((instruction & 0xFF00) == 0x4700) {
+        // BX/BLX register
+        bool link = instruction & 0x80;
+        uint32_t rm = (instruction >> 3) & 0xF;
+        instr.is_branch = true;
+        instr.mnemonic = link ? "BLX" : "BX";
+        instr.operands = register_name(rm);
+        if (link) {
+            instr.branch_kind = BranchKind::IndirectCall;
+        } else {
+            instr.branch_kind = rm == 14 ? BranchKind::Return : BranchKind::IndirectJump;
+        }
+    }
+    else if ((instruction & 0xFF00) == 0x4400 && ((instruction >> 3) & 0xF) == 15) {
+        // ADD Rdn, PC: adds PC (address + 4) to an offset loaded earlier (PIC)
+        uint32_t rdn = ((instruction >> 4) & 0x8) | (instruction & 0x7);
+        instr.mnemonic = "ADD";
+        instr.operands = register_name(rdn);
+        instr.operands += ", PC";
+        instr.data_register = rdn;
+        instr.pc_add_register = rdn;
+    }
+    else if ((instruction & 0xFF00) == 0x4600) {
+        // MOV with high registers; writing PC is a jump
+        uint32_t rd = ((instruction >> 4) & 0x8) | (instruction & 0x7);
+        uint32_t rm = (instruction >> 3) & 0xF;
+        instr.mnemonic = "MOV";
+        instr.operands = register_name(rd);
+        instr.operands += ", ";
+        instr.operands += register_name(rm);
+        if (rd == 15) {
+            instr.is_branch = true;
+            instr.branch_kind = rm == 14 ? BranchKind::Return : BranchKind::IndirectJump;
+        }
+    }
+    else if ((instruction & 0xF600) == 0xB400) {
+        // PUSH {..., LR} / POP {..., PC}
+        bool pop = instruction & 0x0800;
+        uint32_t mask = instruction & 0xFF;
+        if (instruction & 0x0100) {
+            mask |= pop ? (1u << 15) : (1u << 14);
+        }
+        instr.mnemonic = pop ? "POP" : "PUSH";
+        instr.operands.clear();
+        append_register_list(instr.operands, mask);
+        if (pop && (mask & (1u << 15))) {
+            instr.is_branch = true;
+            instr.branch_kind = BranchKind::Return;
+        }
+    }
+    else if ((instruction & 0xF800) == 0x4800 || (instruction & 0xF800) == 0xA000) {
+        // LDR Rt, [PC, #imm8*4] / ADR Rd, label; PC is Align(address + 4, 4)
+        bool literal_load = (instruction & 0xF800) == 0x4800;
+        uint8_t rd = (instruction >> 8) & 0x7;
+        uint32_t imm = (instruction & 0xFF) * 4;
+        instr.data_target = ((instr.address + 4) & ~3ULL) + imm;
+        instr.data_size = literal_load ? 4 : 0;
+        instr.data_register = rd;
+
+        instr.operands = register_name(rd);
+        if (literal_load) {
+            instr.mnemonic = "LDR";
+            instr.operands += ", [PC, #";
+            append_hex(instr.operands, imm);
+            instr.operands += ']';
+        } else {
+            instr.mnemonic = "ADR";
+            instr.operands += ", ";
+            append_hex(instr.operands, instr.data_target);
+        }
     }
     else {
         // Other Thumb instructions - simplified decoding
@@ -189,112 +397,264 @@ void ArmDisassembler::decode_thumb16_instruction(uint16_t instruction, Disassemb
 
 void ArmDisassembler::decode_thumb32_instruction(uint32_t instruction, DisassembledInstruction& instr) {
     // Simplified Thumb-2 decoding
-    if ((instruction & 0xF800D000) == 0xF000D000) {
-        // BL instruction
-        instr.is_branch = true;
-        instr.mnemonic = "BL";
-        
-        // Complex offset calculation for Thumb-2 BL
+    if ((instruction & 0xF8008000) == 0xF0008000 &&
+        ((instruction & 0x5000) != 0 || ((instruction >> 22) & 0xF) < 0xE)) {
+        // BL / BLX imm / B.W (T4) / B<cond>.W (T3)
         uint32_t s = (instruction >> 26) & 1;
         uint32_t j1 = (instruction >> 13) & 1;
         uint32_t j2 = (instruction >> 11) & 1;
-        uint32_t imm10 = (instruction >> 16) & 0x3FF;
         uint32_t imm11 = instruction & 0x7FF;
-        
-        uint32_t i1 = !(j1 ^ s);
-        uint32_t i2 = !(j2 ^ s);
-        
-        int32_t offset = (s << 24) | (i1 << 23) | (i2 << 22) | (imm10 << 12) | (imm11 << 1);
-        if (s) offset |= 0xFE000000; // Sign extend
-        
-        instr.branch_target = instr.address + 4 + offset;
-        
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instr.branch_target;
-        instr.operands = ss.str();
+        bool link = instruction & 0x4000;
+        bool bit12 = instruction & 0x1000; // Clear only for BLX and B<cond>.W
+        instr.is_branch = true;
+
+        int32_t offset;
+        if (!link && !bit12) {
+            // T3: S:J2:J1:imm6:imm11:0
+            uint32_t condition = (instruction >> 22) & 0xF;
+            uint32_t imm6 = (instruction >> 16) & 0x3F;
+            offset = (s << 20) | (j2 << 19) | (j1 << 18) | (imm6 << 12) | (imm11 << 1);
+            if (s) offset |= 0xFFE00000; // Sign extend
+            instr.mnemonic = "B";
+            instr.mnemonic += get_condition_suffix(condition);
+            instr.mnemonic += ".W";
+            instr.branch_kind = BranchKind::Jump;
+            instr.is_conditional = true;
+        } else {
+            // T4, BL and BLX: S:I1:I2:imm10:imm11:0
+            uint32_t imm10 = (instruction >> 16) & 0x3FF;
+            uint32_t i1 = !(j1 ^ s);
+            uint32_t i2 = !(j2 ^ s);
+            offset = (s << 24) | (i1 << 23) | (i2 << 22) | (imm10 << 12) | (imm11 << 1);
+            if (s) offset |= 0xFE000000; // Sign extend
+            if (link) {
+                instr.mnemonic = bit12 ? "BL" : "BLX";
+                instr.branch_kind = BranchKind::Call;
+            } else {
+                instr.mnemonic = "B.W";
+                instr.branch_kind = BranchKind::Jump;
+            }
+        }
+
+        // BLX switches to ARM, so its target is relative to Align(PC, 4)
+        uint64_t pc = instr.address + 4;
+        instr.branch_target = (link && !bit12 ? (pc & ~3ULL) : pc) + offset;
+
+        instr.operands.clear();
+        append_hex(instr.operands, instr.branch_target);
+    }
+    else if ((instruction & 0xFFFF0000) == 0xE8BD0000 || (instruction & 0xFFFF0000) == 0xE92D0000) {
+        // POP.W / PUSH.W {register list}
+        bool pop = (instruction & 0xFFFF0000) == 0xE8BD0000;
+        uint32_t mask = instruction & 0xFFFF;
+        instr.mnemonic = pop ? "POP.W" : "PUSH.W";
+        instr.operands.clear();
+        append_register_list(instr.operands, mask);
+        if (pop && (mask & (1u << 15))) {
+            instr.is_branch = true;
+            instr.branch_kind = BranchKind::Return;
+        }
+    }
+    else if ((instruction & 0xFE1F0000) == 0xF81F0000 &&
+             (((instruction >> 21) & 3) < 2 || (instruction & 0x01600000) == 0x00400000) &&
+             (((instruction >> 12) & 0xF) != 15 || ((instruction >> 21) & 3) == 2)) {
+        // LDR{B,H,SB,SH}.W Rt, [PC, #+/-imm12] (literal); PC is Align(address + 4, 4).
+        // Byte/halfword loads into PC are PLD/PLI hints and are left undecoded.
+        static const char* loads[2][3] = {{"LDRB.W", "LDRH.W", "LDR.W"}, {"LDRSB.W", "LDRSH.W", ""}};
+        uint32_t size_log2 = (instruction >> 21) & 3;
+        bool add = instruction & 0x00800000;
+        uint32_t rt = (instruction >> 12) & 0xF;
+        uint32_t imm = instruction & 0xFFF;
+        uint64_t pc = (instr.address + 4) & ~3ULL;
+        instr.mnemonic = loads[(instruction >> 24) & 1][size_log2];
+        instr.data_target = add ? pc + imm : pc - imm;
+        instr.data_size = static_cast<uint8_t>(1u << size_log2);
+        instr.data_register = static_cast<uint8_t>(rt);
+
+        instr.operands = register_name(rt);
+        instr.operands += add ? ", [PC, #" : ", [PC, #-";
+        append_hex(instr.operands, imm);
+        instr.operands += ']';
+        if (rt == 15) {
+            instr.is_branch = true;
+            instr.branch_kind = BranchKind::IndirectJump;
+        }
+    }
+    else if ((instruction & 0xFB5F8000) == 0xF20F0000 && ((instruction >> 23) & 1) == ((instruction >> 21) & 1)) {
+        // ADR.W Rd, label (ADDW/SUBW Rd, PC, #i:imm3:imm8)
+        bool subtract = instruction & 0x00800000;
+        uint32_t rd = (instruction >> 8) & 0xF;
+        uint32_t imm = (((instruction >> 26) & 1) << 11) | (((instruction >> 12) & 0x7) << 8) | (instruction & 0xFF);
+        uint64_t pc = (instr.address + 4) & ~3ULL;
+        instr.mnemonic = "ADR.W";
+        instr.data_target = subtract ? pc - imm : pc + imm;
+        instr.data_register = static_cast<uint8_t>(rd);
+
+        instr.operands = register_name(rd);
+        instr.operands += ", ";
+        append_hex(instr.operands, instr.data_target);
+    }
+    else if (instruction == 0xF85DFB04) {
+        // LDR.W PC, [SP], #4 - single-register POP {PC}
+        instr.mnemonic = "POP.W";
+        instr.operands = "{PC}";
+        instr.is_branch = true;
+        instr.branch_kind = BranchKind::Return;
     }
     else {
         // Other Thumb-2 instructions
         instr.mnemonic = "T32_UNK";
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instruction;
-        instr.operands = ss.str();
+        instr.operands.clear();
+        append_hex(instr.operands, instruction);
     }
 }
 
-void ArmDisassembler::decode_data_processing(uint32_t instruction, DisassembledInstruction& instr, const std::string& cond_suffix) {
+void ArmDisassembler::decode_data_processing(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix) {
     uint8_t opcode = (instruction >> 21) & 0xF;
     uint8_t rd = (instruction >> 12) & 0xF;
     uint8_t rn = (instruction >> 16) & 0xF;
-    
+
     static const char* opcodes[] = {
         "AND", "EOR", "SUB", "RSB", "ADD", "ADC", "SBC", "RSC",
         "TST", "TEQ", "CMP", "CMN", "ORR", "MOV", "BIC", "MVN"
     };
-    
-    instr.mnemonic = opcodes[opcode] + cond_suffix;
-    
+
+    instr.mnemonic = opcodes[opcode];
+    instr.mnemonic += cond_suffix;
+
     // Simplified operand formatting
-    std::stringstream ss;
-    ss << "R" << rd;
+    instr.operands = register_name(rd);
     if (opcode != 13 && opcode != 15) { // Not MOV or MVN
-        ss << ", R" << rn;
+        instr.operands += ", ";
+        instr.operands += register_name(rn);
     }
-    
+
     if (instruction & 0x02000000) {
         // Immediate operand
         uint32_t imm = instruction & 0xFF;
         uint8_t rotate = ((instruction >> 8) & 0xF) * 2;
-        imm = (imm >> rotate) | (imm << (32 - rotate));
-        ss << ", #0x" << std::hex << std::uppercase << imm;
+        if (rotate != 0) {
+            imm = (imm >> rotate) | (imm << (32 - rotate));
+        }
+        instr.operands += ", #";
+        append_hex(instr.operands, imm);
+
+        // ADD/SUB Rd, PC, #imm is how ARM code forms a PC-relative address (ADR)
+        if (rn == 15 && (opcode == 4 || opcode == 2)) {
+            uint64_t pc = instr.address + 8;
+            instr.data_target = opcode == 4 ? pc + imm : pc - imm;
+            instr.data_register = rd;
+        }
     } else {
         // Register operand
         uint8_t rm = instruction & 0xF;
-        ss << ", R" << rm;
+        instr.operands += ", ";
+        instr.operands += register_name(rm);
+
+        // ADD Rd, PC, Rm with an unshifted Rm adds a PC-relative offset (PIC)
+        if (opcode == 4 && rn == 15 && (instruction & 0xFF0) == 0) {
+            instr.data_register = rd;
+            instr.pc_add_register = rm;
+        }
+    }
+
+    // Writing PC (other than from a compare) transfers control
+    bool is_compare = opcode >= 8 && opcode <= 11;
+    if (rd == 15 && !is_compare) {
+        instr.is_branch = true;
+        bool mov_from_lr = opcode == 13 && !(instruction & 0x02000000) && (instruction & 0xFFF) == 14;
+        instr.branch_kind = mov_from_lr ? BranchKind::Return : BranchKind::IndirectJump;
     }
-    
-    instr.operands = ss.str();
 }
 
-void ArmDisassembler::decode_load_store(uint32_t instruction, DisassembledInstruction& instr, const std::string& cond_suffix) {
+void ArmDisassembler::decode_load_store(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix) {
     bool load = instruction & 0x00100000;
     bool byte = instruction & 0x00400000;
-    
-    instr.mnemonic = (load ? "LDR" : "STR") + (byte ? "B" : "") + cond_suffix;
-    
+
+    instr.mnemonic = load ? "LDR" : "STR";
+    if (byte) instr.mnemonic += 'B';
+    instr.mnemonic += cond_suffix;
+
     uint8_t rt = (instruction >> 12) & 0xF;
     uint8_t rn = (instruction >> 16) & 0xF;
-    
-    std::stringstream ss;
-    ss << "R" << rt << ", [R" << rn;
-    
+
+    instr.operands = register_name(rt);
+    instr.operands += ", [";
+    instr.operands += register_name(rn);
+
     if (instruction & 0x02000000) {
         // Register offset
         uint8_t rm = instruction & 0xF;
-        ss << ", R" << rm << "]";
+        instr.operands += ", ";
+        instr.operands += register_name(rm);
+        instr.operands += ']';
     } else {
         // Immediate offset
         uint16_t offset = instruction & 0xFFF;
+        if (rn == 15) {
+            // Literal access relative to PC (address + 8)
+            uint64_t pc = instr.address + 8;
+            instr.data_target = (instruction & 0x00800000) ? pc + offset : pc - offset;
+            instr.data_size = load ? (byte ? 1 : 4) : 0;
+            instr.data_register = load ? rt : NO_REGISTER;
+        }
         if (offset != 0) {
-            ss << ", #" << (instruction & 0x00800000 ? "" : "-") << "0x" << std::hex << std::uppercase << offset;
+            instr.operands += instruction & 0x00800000 ? ", #" : ", #-";
+            append_hex(instr.operands, offset);
         }
-        ss << "]";
+        instr.operands += ']';
+    }
+
+    if (load && rt == 15) {
+        // LDR PC, [SP], #4 is a single-register POP {PC}
+        instr.is_branch = true;
+        instr.branch_kind = rn == 13 ? BranchKind::Return : BranchKind::IndirectJump;
+    }
+}
+
+void ArmDisassembler::decode_block_transfer(uint32_t instruction, DisassembledInstruction& instr, const char* cond_suffix) {
+    bool load = instruction & 0x00100000;
+    bool writeback = instruction & 0x00200000;
+    bool increment = instruction & 0x00800000;
+    bool before = instruction & 0x01000000;
+    uint8_t rn = (instruction >> 16) & 0xF;
+    uint32_t mask = instruction & 0xFFFF;
+
+    if (rn == 13 && writeback && load && increment && !before) {
+        instr.mnemonic = "POP";
+        instr.mnemonic += cond_suffix;
+        instr.operands.clear();
+    } else if (rn == 13 && writeback && !load && !increment && before) {
+        instr.mnemonic = "PUSH";
+        instr.mnemonic += cond_suffix;
+        instr.operands.clear();
+    } else {
+        static const char* modes[] = {"DA", "IA", "DB", "IB"};
+        instr.mnemonic = load ? "LDM" : "STM";
+        instr.mnemonic += modes[(before ? 2 : 0) | (increment ? 1 : 0)];
+        instr.mnemonic += cond_suffix;
+        instr.operands = register_name(rn);
+        instr.operands += writeback ? "!, " : ", ";
+    }
+    append_register_list(instr.operands, mask);
+
+    if (load && (mask & (1u << 15))) {
+        instr.is_branch = true;
+        instr.branch_kind = BranchKind::Return;
     }
-    
-    instr.operands = ss.str();
 }
 
 void ArmDisassembler::decode_thumb_data_processing(uint16_t instruction, DisassembledInstruction& instr) {
     // Simplified Thumb data processing
-    if ((instruction & 0xFF00) == 0x2000) {
+    if ((instruction & 0xF800) == 0x2000) {
         // MOV immediate
         instr.mnemonic = "MOV";
         uint8_t rd = (instruction >> 8) & 0x7;
         uint8_t imm = instruction & 0xFF;
-        
-        std::stringstream ss;
-        ss << "R" << rd << ", #0x" << std::hex << std::uppercase << imm;
-        instr.operands = ss.str();
+
+        instr.operands = register_name(rd);
+        instr.operands += ", #";
+        append_hex(instr.operands, imm);
     }
     else if ((instruction & 0xFE00) == 0x1C00) {
         // ADD immediate
@@ -302,21 +662,22 @@ void ArmDisassembler::decode_thumb_data_processing(uint16_t instruction, Disasse
         uint8_t rd = instruction & 0x7;
         uint8_t rn = (instruction >> 3) & 0x7;
         uint8_t imm = (instruction >> 6) & 0x7;
-        
-        std::stringstream ss;
-        ss << "R" << rd << ", R" << rn << ", #" << imm;
-        instr.operands = ss.str();
+
+        instr.operands = register_name(rd);
+        instr.operands += ", ";
+        instr.operands += register_name(rn);
+        instr.operands += ", #";
+        append_decimal(instr.operands, imm);
     }
     else {
         // Unknown Thumb instruction
         instr.mnemonic = "T16_UNK";
-        std::stringstream ss;
-        ss << "0x" << std::hex << std::uppercase << instruction;
-        instr.operands = ss.str();
+        instr.operands.clear();
+        append_hex(instr.operands, instruction);
     }
 }
 
-std::string ArmDisassembler::get_condition_suffix(uint8_t condition) {
+const char* ArmDisassembler::get_condition_suffix(uint8_t condition) {
     static const char* conditions[] = {
         "EQ", "NE", "CS", "CC", "MI", "PL", "VS", "VC",
         "HI", "LS", "GE", "LT", "GT", "LE", "", "NV"
@@ -324,6 +685,27 @@ std::string ArmDisassembler::get_condition_suffix(uint8_t condition) {
     return conditions[condition & 0xF];
 }
 
+const char* ArmDisassembler::register_name(uint32_t reg) {
+    static const char* names[] = {
+        "R0", "R1", "R2", "R3", "R4", "R5", "R6", "R7",
+        "R8", "R9", "R10", "R11", "R12", "SP", "LR", "PC"
+    };
+    return names[reg & 0xF];
+}
+
+template <size_t Capacity>
+void ArmDisassembler::append_register_list(InlineText<Capacity>& text, uint32_t mask) {
+    text += '{';
+    bool first = true;
+    for (uint32_t reg = 0; reg < 16; ++reg) {
+        if (!(mask & (1u << reg))) continue;
+        if (!first) text += ", ";
+        text += register_name(reg);
+        first = false;
+    }
+    text += '}';
+}
+
 std::string ArmDisassembler::get_mnemonic(uint32_t instruction, bool is_thumb_mode) {
     // Legacy method - functionality moved to decode_* methods
     return "LEGACY";
@@ -332,4 +714,4 @@ std::string ArmDisassembler::get_mnemonic(uint32_t instruction, bool is_thumb_mo
 std::string ArmDisassembler::get_operands(uint32_t instruction, bool is_thumb_mode) {
     // Legacy method - functionality moved to decode_* methods
     return "";
-}
\ No newline at end of file
+}
@@ -0,0 +1,364 @@
+#include "../include/call_graph.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+namespace {
+
+constexpr uint16_t EM_ARM = 40;
+constexpr uint32_t R_ARM_JUMP_SLOT = 22;
+constexpr uint32_t kUnvisited = 0xFFFFFFFF;
+
+uint32_t read_word(const uint8_t* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Rotated 8-bit immediate of an ARM data-processing instruction
+uint32_t arm_immediate(uint32_t instruction) {
+    uint32_t value = instruction & 0xFF;
+    uint32_t rotate = ((instruction >> 8) & 0xF) * 2;
+    return rotate == 0 ? value : (value >> rotate) | (value << (32 - rotate));
+}
+
+// Builds CSR adjacency from sorted unique (from, to) pairs.
+void build_csr(const std::vector<std::pair<uint32_t, uint32_t>>& pairs, size_t node_count, bool by_target,
+               std::vector<uint32_t>& offsets, std::vector<uint32_t>& targets) {
+    offsets.assign(node_count + 1, 0);
+    for (const auto& pair : pairs) {
+        ++offsets[(by_target ? pair.second : pair.first) + 1];
+    }
+    for (size_t i = 0; i < node_count; ++i) offsets[i + 1] += offsets[i];
+    targets.resize(pairs.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto& pair : pairs) {
+        uint32_t key = by_target ? pair.second : pair.first;
+        targets[fill[key]++] = by_target ? pair.first : pair.second;
+    }
+}
+
+} // namespace
+
+std::vector<PltImport> resolve_plt_imports(const ElfParser& parser) {
+    std::vector<PltImport> imports;
+    if (parser.get_header().e_machine != EM_ARM || parser.get_header().is_64bit) return imports;
+    const auto& sections = parser.get_section_headers();
+
+    // GOT slot -> symbol index, from every JUMP_SLOT relocation
+    std::unordered_map<uint64_t, uint32_t> slot_symbols;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const SectionHeader& sh = sections[i];
+        if (sh.sh_type != SHT_REL && sh.sh_type != SHT_RELA) continue;
+        const uint8_t* data = parser.get_section_data_by_index(i);
+        long symbol_base = parser.first_symbol_of_table(sh.sh_link);
+        if (data == nullptr || symbol_base < 0) continue;
+
+        size_t entry_size = sh.sh_type == SHT_REL ? 8 : 12;
+        for (uint64_t offset = 0; offset + entry_size <= sh.sh_size; offset += entry_size) {
+            uint32_t slot = read_word(data + offset);
+            uint32_t info = read_word(data + offset + 4);
+            if ((info & 0xFF) != R_ARM_JUMP_SLOT || (info >> 8) == 0) continue;
+            size_t symbol = static_cast<size_t>(symbol_base) + (info >> 8);
+            if (symbol < parser.get_symbols().size()) {
+                slot_symbols[slot] = static_cast<uint32_t>(symbol);
+            }
+        }
+    }
+    if (slot_symbols.empty()) return imports;
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const SectionHeader& sh = sections[i];
+        if (sh.name != ".plt") continue;
+        const uint8_t* data = parser.get_section_data_by_index(i);
+        if (data == nullptr) continue;
+
+        for (uint64_t offset = 0; offset + 12 <= sh.sh_size; offset += 4) {
+            uint32_t add_pc = read_word(data + offset);
+            uint32_t add_ip = read_word(data + offset + 4);
+            uint32_t load_pc = read_word(data + offset + 8);
+            if ((add_pc & 0xFFFFF000) != 0xE28FC000 || (add_ip & 0xFFFFF000) != 0xE28CC000 ||
+                (load_pc & 0xFFFFF000) != 0xE5BCF000) {
+                continue;
+            }
+            uint64_t address = sh.sh_addr + offset;
+            uint32_t slot = static_cast<uint32_t>(address + 8 + arm_immediate(add_pc) +
+                                                  arm_immediate(add_ip) + (load_pc & 0xFFF));
+            auto it = slot_symbols.find(slot);
+            if (it != slot_symbols.end()) {
+                // Thumb callers enter through a "BX pc; NOP" prefix
+                bool thumb_prefix = offset >= 4 && read_word(data + offset - 4) == 0x46C04778;
+                imports.push_back({thumb_prefix ? address - 4 : address, it->second});
+            }
+            offset += 8;
+        }
+    }
+    std::sort(imports.begin(), imports.end(),
+        [](const PltImport& a, const PltImport& b) { return a.stub_address < b.stub_address; });
+    return imports;
+}
+
+CallGraph::CallGraph(const ElfParser& parser, const FunctionTable& functions, const XrefIndex& xrefs)
+    : parser_(parser), functions_(functions) {
+    size_t node_count = functions.size();
+    node_flags_.assign(node_count, 0);
+    import_symbol_.assign(node_count, -1);
+
+    for (const PltImport& import : resolve_plt_imports(parser)) {
+        // The stub and, past a Thumb prefix, its ARM part may be separate functions
+        for (uint64_t address : {import.stub_address, import.stub_address + 4}) {
+            long node = functions.find_containing(address);
+            if (node < 0 || functions.function(static_cast<uint32_t>(node)).start < import.stub_address) continue;
+            node_flags_[node] |= CALL_NODE_IMPORT;
+            import_symbol_[node] = static_cast<int32_t>(import.symbol_index);
+        }
+    }
+
+    by_name_.reserve(node_count);
+    for (uint32_t node = 0; node < node_count; ++node) {
+        by_name_.emplace(name(node), node);
+    }
+
+    build_edges(xrefs);
+    condense();
+
+    // Hash nodes are estimated as key, value and two pointers each
+    size_t name_bytes = by_name_.bucket_count() * sizeof(void*) +
+                        by_name_.size() * (sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*));
+    for (const auto& entry : by_name_) name_bytes += entry.first.capacity();
+    memory_.set(name_bytes + capacity_bytes(node_flags_, import_symbol_, callee_offsets_, callees_,
+                                            caller_offsets_, callers_, component_of_, component_offsets_,
+                                            component_members_, dag_offsets_, dag_successors_,
+                                            dag_pred_offsets_, dag_predecessors_));
+    log_info("Call graph built: " + std::to_string(node_count) + " functions, " +
+             std::to_string(callees_.size()) + " edges, " + std::to_string(component_count()) + " components");
+}
+
+std::string CallGraph::name(uint32_t node) const {
+    if (import_symbol_[node] >= 0) {
+        return std::string(parser_.get_symbols()[import_symbol_[node]].name);
+    }
+    return functions_.name(node);
+}
+
+long CallGraph::find_by_address(uint64_t address) const {
+    return functions_.find_containing(address & ~1ULL);
+}
+
+long CallGraph::find_by_name(const std::string& name) const {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? -1 : static_cast<long>(it->second);
+}
+
+void CallGraph::build_edges(const XrefIndex& xrefs) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    xrefs.for_each([&](const Xref& ref) {
+        if (ref.kind != XrefKind::Call && ref.kind != XrefKind::Jump) return;
+        long callee = functions_.find_containing(ref.target);
+        if (callee < 0) return;
+        // Only jumps onto another function's entry are tail calls
+        if (ref.kind == XrefKind::Jump && functions_.function(static_cast<uint32_t>(callee)).start != ref.target) {
+            return;
+        }
+        long caller = functions_.find_containing(ref.source);
+        if (caller < 0 || (ref.kind == XrefKind::Jump && caller == callee)) return;
+        pairs.emplace_back(static_cast<uint32_t>(caller), static_cast<uint32_t>(callee));
+    });
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    for (const auto& pair : pairs) {
+        if (pair.first == pair.second) node_flags_[pair.first] |= CALL_NODE_RECURSIVE;
+    }
+    build_csr(pairs, node_flags_.size(), false, callee_offsets_, callees_);
+    build_csr(pairs, node_flags_.size(), true, caller_offsets_, callers_);
+}
+
+void CallGraph::condense() {
+    // Iterative Tarjan; components come out in reverse topological order
+    size_t node_count = node_flags_.size();
+    std::vector<uint32_t> index(node_count, kUnvisited), low(node_count, 0);
+    std::vector<uint8_t> on_stack(node_count, 0);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> frames; // (node, next callee slot)
+    component_of_.assign(node_count, kUnvisited);
+    component_offsets_.assign(1, 0);
+    component_members_.clear();
+    uint32_t counter = 0;
+
+    for (uint32_t root = 0; root < node_count; ++root) {
+        if (index[root] != kUnvisited) continue;
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        on_stack[root] = 1;
+        frames.emplace_back(root, callee_offsets_[root]);
+
+        while (!frames.empty()) {
+            uint32_t v = frames.back().first;
+            uint32_t& slot = frames.back().second;
+            if (slot < callee_offsets_[v + 1]) {
+                uint32_t w = callees_[slot++];
+                if (index[w] == kUnvisited) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    on_stack[w] = 1;
+                    frames.emplace_back(w, callee_offsets_[w]);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            if (low[v] == index[v]) {
+                uint32_t component = static_cast<uint32_t>(component_offsets_.size() - 1);
+                size_t first_member = component_members_.size();
+                uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = 0;
+                    component_of_[w] = component;
+                    component_members_.push_back(w);
+                } while (w != v);
+                std::sort(component_members_.begin() + first_member, component_members_.end());
+                component_offsets_.push_back(static_cast<uint32_t>(component_members_.size()));
+                if (component_members_.size() - first_member > 1) {
+                    for (size_t i = first_member; i < component_members_.size(); ++i) {
+                        node_flags_[component_members_[i]] |= CALL_NODE_RECURSIVE;
+                    }
+                }
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                uint32_t u = frames.back().first;
+                low[u] = std::min(low[u], low[v]);
+            }
+        }
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> dag_edges;
+    for (uint32_t u = 0; u < node_count; ++u) {
+        for (uint32_t i = callee_offsets_[u]; i < callee_offsets_[u + 1]; ++i) {
+            uint32_t cu = component_of_[u], cv = component_of_[callees_[i]];
+            if (cu != cv) dag_edges.emplace_back(cu, cv);
+        }
+    }
+    std::sort(dag_edges.begin(), dag_edges.end());
+    dag_edges.erase(std::unique(dag_edges.begin(), dag_edges.end()), dag_edges.end());
+    build_csr(dag_edges, component_count(), false, dag_offsets_, dag_successors_);
+    build_csr(dag_edges, component_count(), true, dag_pred_offsets_, dag_predecessors_);
+}
+
+std::vector<uint32_t> CallGraph::closure(uint32_t component, bool towards_callers) const {
+    CacheKey key{component, towards_callers};
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = closure_cache_.find(key);
+        if (it != closure_cache_.end()) {
+            closure_lru_.splice(closure_lru_.begin(), closure_lru_, it->second);
+            return it->second->second;
+        }
+    }
+
+    const auto& offsets = towards_callers ? dag_pred_offsets_ : dag_offsets_;
+    const auto& edges = towards_callers ? dag_predecessors_ : dag_successors_;
+    std::vector<uint8_t> seen(component_count(), 0);
+    std::vector<uint32_t> pending;
+    // The start component only counts if it calls itself
+    uint32_t first = component_members_[component_offsets_[component]];
+    if (node_flags_[first] & CALL_NODE_RECURSIVE) {
+        seen[component] = 1;
+    }
+    pending.push_back(component);
+    std::vector<uint32_t> reached;
+    while (!pending.empty()) {
+        uint32_t c = pending.back();
+        pending.pop_back();
+        for (uint32_t i = offsets[c]; i < offsets[c + 1]; ++i) {
+            uint32_t next = edges[i];
+            if (!seen[next]) {
+                seen[next] = 1;
+                pending.push_back(next);
+            }
+        }
+    }
+    for (uint32_t c = 0; c < component_count(); ++c) {
+        if (!seen[c]) continue;
+        reached.insert(reached.end(), component_members_.begin() + component_offsets_[c],
+                       component_members_.begin() + component_offsets_[c + 1]);
+    }
+    std::sort(reached.begin(), reached.end());
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (closure_cache_.find(key) == closure_cache_.end()) {
+        closure_lru_.emplace_front(key, reached);
+        closure_cache_[key] = closure_lru_.begin();
+        if (closure_lru_.size() > kClosureCacheSize) {
+            closure_cache_.erase(closure_lru_.back().first);
+            closure_lru_.pop_back();
+        }
+    }
+    return reached;
+}
+
+CallGraphPage CallGraph::query(uint32_t node, CallGraphQuery kind, size_t offset, size_t limit) const {
+    CallGraphPage page;
+    if (node >= node_flags_.size()) return page;
+
+    auto take = [&](const uint32_t* begin, const uint32_t* end) {
+        page.total_matches = end - begin;
+        if (offset >= page.total_matches) return;
+        page.nodes.assign(begin + offset, begin + std::min(page.total_matches, offset + limit));
+    };
+
+    switch (kind) {
+        case CallGraphQuery::Callers:
+            take(callers_.data() + caller_offsets_[node], callers_.data() + caller_offsets_[node + 1]);
+            break;
+        case CallGraphQuery::Callees:
+            take(callees_.data() + callee_offsets_[node], callees_.data() + callee_offsets_[node + 1]);
+            break;
+        case CallGraphQuery::ReachableFrom:
+        case CallGraphQuery::Reaching: {
+            std::vector<uint32_t> nodes = closure(component_of_[node], kind == CallGraphQuery::Reaching);
+            take(nodes.data(), nodes.data() + nodes.size());
+            break;
+        }
+    }
+    return page;
+}
+
+std::vector<uint32_t> CallGraph::shortest_path(uint32_t from, uint32_t to) const {
+    std::vector<uint32_t> path;
+    size_t node_count = node_flags_.size();
+    if (from >= node_count || to >= node_count) return path;
+
+    // BFS over callees; a path to itself needs at least one call
+    std::vector<uint32_t> parent(node_count, kUnvisited);
+    std::deque<uint32_t> queue{from};
+    bool found = false;
+    while (!queue.empty() && !found) {
+        uint32_t v = queue.front();
+        queue.pop_front();
+        for (uint32_t i = callee_offsets_[v]; i < callee_offsets_[v + 1]; ++i) {
+            uint32_t w = callees_[i];
+            if (parent[w] != kUnvisited) continue;
+            parent[w] = v;
+            if (w == to) {
+                found = true;
+                break;
+            }
+            queue.push_back(w);
+        }
+    }
+    if (!found) return path;
+
+    path.push_back(to);
+    for (uint32_t v = parent[to]; v != from; v = parent[v]) {
+        path.push_back(v);
+    }
+    path.push_back(from);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
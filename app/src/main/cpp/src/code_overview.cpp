@@ -0,0 +1,245 @@
+#include "../include/code_overview.h"
+#include "../include/content_map.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <string_view>
+
+namespace {
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+void count_instruction(OverviewBucket& bucket, const DisassembledInstruction& instr) {
+    switch (instr.branch_kind) {
+        case BranchKind::Call:
+        case BranchKind::IndirectCall:
+            ++bucket.calls;
+            return;
+        case BranchKind::Jump:
+        case BranchKind::IndirectJump:
+        case BranchKind::Return:
+            ++bucket.branches;
+            return;
+        case BranchKind::None:
+            break;
+    }
+    std::string_view mnemonic = instr.mnemonic;
+    if (is_undecodable(instr)) {
+        ++bucket.unknown;
+    } else if (starts_with(mnemonic, "LD") || starts_with(mnemonic, "ST") || starts_with(mnemonic, "PUSH") ||
+               starts_with(mnemonic, "POP") || starts_with(mnemonic, "VLD") || starts_with(mnemonic, "VST") ||
+               starts_with(mnemonic, "VPUSH") || starts_with(mnemonic, "VPOP")) {
+        ++bucket.loads_stores;
+    } else {
+        ++bucket.other;
+    }
+}
+
+void add_counts(OverviewBucket& to, const OverviewBucket& from) {
+    to.branches += from.branches;
+    to.calls += from.calls;
+    to.loads_stores += from.loads_stores;
+    to.other += from.other;
+    to.unknown += from.unknown;
+}
+
+} // namespace
+
+CodeOverview::CodeOverview(const ElfParser& parser, const std::vector<size_t>& sections) {
+    const auto& headers = parser.get_section_headers();
+    for (size_t section_index : sections) {
+        const SectionHeader& sh = headers[section_index];
+        if (sh.sh_size == 0) continue;
+        Pyramid pyramid{section_index, sh.sh_addr, sh.sh_size, kMinBucketBytes, {}, {}};
+        while ((pyramid.size + pyramid.bucket_bytes - 1) / pyramid.bucket_bytes > kMaxBuckets) {
+            pyramid.bucket_bytes *= 2;
+        }
+        size_t count = (pyramid.size + pyramid.bucket_bytes - 1) / pyramid.bucket_bytes;
+        size_t total = 0;
+        for (;;) {
+            pyramid.level_offsets.push_back(total);
+            total += count;
+            if (count == 1) break;
+            count = (count + 1) / 2;
+        }
+        pyramid.level_offsets.push_back(total);
+        pyramid.buckets.resize(total);
+        pyramids_.push_back(std::move(pyramid));
+    }
+    std::sort(pyramids_.begin(), pyramids_.end(),
+              [](const Pyramid& a, const Pyramid& b) { return a.section_index < b.section_index; });
+    size_t bytes = capacity_bytes(pyramids_);
+    for (const Pyramid& pyramid : pyramids_) bytes += capacity_bytes(pyramid.level_offsets, pyramid.buckets);
+    memory_.set(bytes);
+}
+
+CodeOverview::Pyramid* CodeOverview::find(size_t section_index) {
+    return const_cast<Pyramid*>(static_cast<const CodeOverview*>(this)->find(section_index));
+}
+
+const CodeOverview::Pyramid* CodeOverview::find(size_t section_index) const {
+    auto it = std::lower_bound(pyramids_.begin(), pyramids_.end(), section_index,
+        [](const Pyramid& pyramid, size_t index) { return pyramid.section_index < index; });
+    return it != pyramids_.end() && it->section_index == section_index ? &*it : nullptr;
+}
+
+void CodeOverview::count_instructions(Pyramid& pyramid, const std::vector<DisassembledInstruction>& instructions,
+                                      uint64_t start, uint64_t end) {
+    for (const auto& instr : instructions) {
+        if (instr.address < start || instr.address >= end) continue;
+        count_instruction(pyramid.buckets[(instr.address - pyramid.start) / pyramid.bucket_bytes], instr);
+    }
+}
+
+void CodeOverview::add_instructions(size_t section_index, const std::vector<DisassembledInstruction>& instructions) {
+    Pyramid* pyramid = find(section_index);
+    if (!pyramid || instructions.empty()) return;
+    // Count into a local strip first so the lock is held for a few adds
+    // per bucket rather than per instruction
+    uint64_t first = (instructions.front().address - pyramid->start) / pyramid->bucket_bytes;
+    uint64_t last = (instructions.back().address - pyramid->start) / pyramid->bucket_bytes;
+    std::vector<OverviewBucket> local(last - first + 1);
+    for (const auto& instr : instructions) {
+        count_instruction(local[(instr.address - pyramid->start) / pyramid->bucket_bytes - first], instr);
+    }
+    std::lock_guard<std::mutex> lock(add_mutex_);
+    for (size_t i = 0; i < local.size(); ++i) add_counts(pyramid->buckets[first + i], local[i]);
+}
+
+void CodeOverview::scan_bytes(const ElfParser& parser, const ModeMap& mode_map, Pyramid& pyramid,
+                              size_t first, size_t last) {
+    const uint8_t* data = parser.get_section_data_by_index(pyramid.section_index);
+    const uint64_t end = pyramid.start + pyramid.size;
+    for (size_t i = first; i < last; ++i) {
+        uint64_t offset = i * pyramid.bucket_bytes;
+        OverviewBucket& bucket = pyramid.buckets[i];
+        size_t size = static_cast<size_t>(std::min(pyramid.bucket_bytes, pyramid.size - offset));
+        uint32_t histogram[256];
+        byte_histogram(data + offset, size, histogram);
+        bucket.entropy = histogram_entropy(histogram, size);
+        bucket.zero_bytes = histogram[0];
+        bucket.data_bytes = 0;
+    }
+
+    uint64_t range_start = pyramid.start + first * pyramid.bucket_bytes;
+    uint64_t range_end = std::min(end, pyramid.start + last * pyramid.bucket_bytes);
+    for (const auto& run : mode_map.runs(range_start, range_end)) {
+        if (run.mode != CodeMode::Data) continue;
+        for (uint64_t address = run.start; address < run.end;) {
+            size_t i = (address - pyramid.start) / pyramid.bucket_bytes;
+            uint64_t bucket_end = std::min(run.end, pyramid.start + (i + 1) * pyramid.bucket_bytes);
+            pyramid.buckets[i].data_bytes += static_cast<uint32_t>(bucket_end - address);
+            address = bucket_end;
+        }
+    }
+}
+
+void CodeOverview::merge_levels(Pyramid& pyramid, size_t first, size_t last) {
+    uint64_t bucket_bytes = pyramid.bucket_bytes;
+    for (size_t level = 1; level + 1 < pyramid.level_offsets.size(); ++level) {
+        const OverviewBucket* finer = pyramid.buckets.data() + pyramid.level_offsets[level - 1];
+        size_t finer_count = pyramid.level_offsets[level] - pyramid.level_offsets[level - 1];
+        OverviewBucket* coarser = pyramid.buckets.data() + pyramid.level_offsets[level];
+        first /= 2;
+        last = (last + 1) / 2;
+        for (size_t i = first; i < last; ++i) {
+            OverviewBucket merged;
+            uint64_t entropy_sum = 0, covered = 0;
+            for (size_t child = 2 * i; child < std::min(2 * i + 2, finer_count); ++child) {
+                const OverviewBucket& from = finer[child];
+                add_counts(merged, from);
+                merged.data_bytes += from.data_bytes;
+                merged.zero_bytes += from.zero_bytes;
+                merged.symbols += from.symbols;
+                uint64_t bytes = std::min(bucket_bytes, pyramid.size - child * bucket_bytes);
+                entropy_sum += static_cast<uint64_t>(from.entropy) * bytes;
+                covered += bytes;
+            }
+            merged.entropy = static_cast<uint16_t>(covered ? entropy_sum / covered : 0);
+            coarser[i] = merged;
+        }
+        bucket_bytes *= 2;
+    }
+}
+
+void CodeOverview::finalize(const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                            TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("overview.finalize");
+    for (Pyramid& pyramid : pyramids_) {
+        size_t finest = pyramid.level_offsets[1];
+        scheduler.parallel_for(finest, 256, [&](size_t begin, size_t end) {
+            scan_bytes(parser, mode_map, pyramid, begin, end);
+        }, priority);
+    }
+
+    for (const SymbolEntry& symbol : parser.get_symbols()) {
+        uint8_t type = symbol.st_info & 0xF;
+        if (symbol.name.empty() || symbol.name[0] == '$' || symbol.st_shndx == SHN_UNDEF ||
+            (type != STT_NOTYPE && type != STT_FUNC && type != STT_OBJECT)) {
+            continue;
+        }
+        Pyramid* pyramid = find(symbol.st_shndx);
+        uint64_t address = type == STT_FUNC ? symbol.st_value & ~1ULL : symbol.st_value;
+        if (!pyramid || address < pyramid->start || address - pyramid->start >= pyramid->size) continue;
+        ++pyramid->buckets[(address - pyramid->start) / pyramid->bucket_bytes].symbols;
+    }
+
+    for (Pyramid& pyramid : pyramids_) merge_levels(pyramid, 0, pyramid.level_offsets[1]);
+}
+
+void CodeOverview::refresh(const ElfParser& parser, const ModeMap& mode_map, ArmDisassembler& disassembler,
+                           size_t section_index, uint64_t start, uint64_t end) {
+    Pyramid* pyramid = find(section_index);
+    if (!pyramid) return;
+    const uint64_t section_end = pyramid->start + pyramid->size;
+    start = std::max(start, pyramid->start);
+    end = std::min(end, section_end);
+    if (start >= end) return;
+    size_t first = (start - pyramid->start) / pyramid->bucket_bytes;
+    size_t last = (end - 1 - pyramid->start) / pyramid->bucket_bytes + 1;
+    uint64_t range_start = pyramid->start + first * pyramid->bucket_bytes;
+    uint64_t range_end = std::min(section_end, pyramid->start + last * pyramid->bucket_bytes);
+    for (size_t i = first; i < last; ++i) {
+        OverviewBucket& bucket = pyramid->buckets[i];
+        bucket.branches = bucket.calls = bucket.loads_stores = bucket.other = bucket.unknown = 0;
+    }
+
+    // Decode the whole buckets again from boundaries the sweep also had
+    const uint8_t* data = parser.get_section_data_by_index(section_index);
+    std::vector<DisassembledInstruction> buffer;
+    for (const auto& run : mode_map.runs(pyramid->start, section_end)) {
+        if (run.mode == CodeMode::Data || run.end <= range_start || range_end <= run.start) continue;
+        bool thumb = run.mode == CodeMode::Thumb;
+        uint64_t align = thumb ? 2 : 4;
+        uint64_t run_start = (run.start + align - 1) & ~(align - 1);
+        if (run_start >= run.end || range_end <= run_start) continue;
+        SweepChunk span{section_index, 0, 0, thumb};
+        affected_instruction_span(data + (run_start - pyramid->start), run_start, run.end, thumb,
+                                  std::max(range_start, run_start), std::min(range_end, run.end),
+                                  span.start, span.end);
+        sweep_chunk(parser, disassembler, span,
+            [&](size_t, const std::vector<DisassembledInstruction>& instructions) {
+                count_instructions(*pyramid, instructions, range_start, range_end);
+            }, buffer);
+    }
+
+    scan_bytes(parser, mode_map, *pyramid, first, last);
+    merge_levels(*pyramid, first, last);
+}
+
+bool CodeOverview::level(size_t section_index, size_t min_buckets, OverviewLevel& out) const {
+    const Pyramid* pyramid = find(section_index);
+    if (!pyramid) return false;
+    // Levels get coarser as the index grows; pick the last one still wide enough
+    size_t level = 0;
+    while (level + 2 < pyramid->level_offsets.size() &&
+           pyramid->level_offsets[level + 2] - pyramid->level_offsets[level + 1] >= min_buckets) {
+        ++level;
+    }
+    out.start = pyramid->start;
+    out.bucket_bytes = pyramid->bucket_bytes << level;
+    out.buckets = pyramid->buckets.data() + pyramid->level_offsets[level];
+    out.bucket_count = pyramid->level_offsets[level + 1] - pyramid->level_offsets[level];
+    return true;
+}
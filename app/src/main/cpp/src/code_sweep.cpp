@@ -0,0 +1,190 @@
+#include "../include/code_sweep.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+constexpr uint16_t EM_ARM = 40;
+
+// First halfword of a 32-bit Thumb encoding (0b11101, 0b11110, 0b11111).
+bool is_thumb32_prefix(const uint8_t* halfword) {
+    uint16_t value = static_cast<uint16_t>(halfword[0] | (halfword[1] << 8));
+    return (value & 0xF800) == 0xF000 || (value & 0xE800) == 0xE800;
+}
+
+// Mapping symbols are "$a", "$t", "$d", optionally followed by ".<suffix>".
+bool mapping_symbol_mode(std::string_view name, CodeMode& mode) {
+    if (name.size() < 2 || name[0] != '$' || (name.size() > 2 && name[2] != '.')) {
+        return false;
+    }
+    switch (name[1]) {
+        case 'a': mode = CodeMode::Arm; return true;
+        case 't': mode = CodeMode::Thumb; return true;
+        case 'd': mode = CodeMode::Data; return true;
+        default: return false;
+    }
+}
+
+} // namespace
+
+ModeMap::ModeMap(const ElfParser& parser, CodeMode default_mode) : default_mode_(default_mode) {
+    struct Candidate {
+        uint64_t address;
+        CodeMode mode;
+        bool from_mapping_symbol;
+    };
+    std::vector<Candidate> candidates;
+
+    for (const auto& sym : parser.get_symbols()) {
+        if (sym.st_shndx == SHN_UNDEF) continue;
+
+        CodeMode mode;
+        if (mapping_symbol_mode(sym.name, mode)) {
+            candidates.push_back({sym.st_value, mode, true});
+        } else if ((sym.st_info & 0xF) == STT_FUNC && sym.st_value != 0) {
+            // Bit 0 of a function address is the Thumb interworking bit.
+            bool thumb = sym.st_value & 1;
+            candidates.push_back({sym.st_value & ~1ULL, thumb ? CodeMode::Thumb : CodeMode::Arm, false});
+        }
+    }
+
+    // Mapping symbols are authoritative over function symbols at the same address.
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.address != b.address) return a.address < b.address;
+        return a.from_mapping_symbol && !b.from_mapping_symbol;
+    });
+
+    for (const auto& c : candidates) {
+        if (!transitions_.empty() && transitions_.back().address == c.address) continue;
+        if (!transitions_.empty() && transitions_.back().mode == c.mode) continue;
+        transitions_.push_back({c.address, c.mode});
+    }
+    log_info("Mode map built with " + std::to_string(transitions_.size()) + " transitions.");
+}
+
+CodeMode ModeMap::mode_at(uint64_t address) const {
+    auto it = std::upper_bound(transitions_.begin(), transitions_.end(), address,
+        [](uint64_t addr, const Transition& t) { return addr < t.address; });
+    if (it == transitions_.begin()) return default_mode_;
+    return std::prev(it)->mode;
+}
+
+std::vector<ModeMap::Run> ModeMap::runs(uint64_t start, uint64_t end) const {
+    std::vector<Run> result;
+    if (start >= end) return result;
+
+    CodeMode mode = mode_at(start);
+    uint64_t run_start = start;
+    auto it = std::upper_bound(transitions_.begin(), transitions_.end(), start,
+        [](uint64_t addr, const Transition& t) { return addr < t.address; });
+
+    for (; it != transitions_.end() && it->address < end; ++it) {
+        if (it->mode == mode) continue;
+        result.push_back({run_start, it->address, mode});
+        run_start = it->address;
+        mode = it->mode;
+    }
+    result.push_back({run_start, end, mode});
+    return result;
+}
+
+CodeMode default_code_mode(const ElfParser& parser) {
+    const ElfHeader& header = parser.get_header();
+    if (header.e_machine == EM_ARM && (header.e_entry & 1)) {
+        return CodeMode::Thumb;
+    }
+    return CodeMode::Arm;
+}
+
+std::vector<size_t> executable_section_indices(const ElfParser& parser) {
+    std::vector<size_t> indices;
+    const auto& sections = parser.get_section_headers();
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const auto& sh = sections[i];
+        if ((sh.sh_flags & SHF_EXECINSTR) && sh.sh_size > 0 &&
+            parser.get_section_data_by_index(i) != nullptr) {
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+void sweep_section(const ElfParser& parser, ArmDisassembler& disassembler,
+                   const ModeMap& mode_map, size_t section_index, const SweepSink& sink) {
+    std::vector<DisassembledInstruction> buffer;
+    for (const auto& chunk : plan_sweep_chunks(parser, mode_map, {section_index}, SIZE_MAX)) {
+        sweep_chunk(parser, disassembler, chunk, sink, buffer);
+    }
+}
+
+std::vector<SweepChunk> plan_sweep_chunks(const ElfParser& parser, const ModeMap& mode_map,
+                                          const std::vector<size_t>& sections, size_t max_chunk_bytes) {
+    std::vector<SweepChunk> chunks;
+    for (size_t section_index : sections) {
+        const uint8_t* data = parser.get_section_data_by_index(section_index);
+        if (data == nullptr) continue;
+
+        const SectionHeader& sh = parser.get_section_headers()[section_index];
+        for (const auto& run : mode_map.runs(sh.sh_addr, sh.sh_addr + sh.sh_size)) {
+            if (run.mode == CodeMode::Data) continue;
+
+            bool thumb = run.mode == CodeMode::Thumb;
+            uint64_t align = thumb ? 2 : 4;
+            uint64_t start = (run.start + align - 1) & ~(align - 1);
+            if (start >= run.end) continue;
+
+            uint64_t step = std::max<uint64_t>(max_chunk_bytes & ~(align - 1), align);
+            for (uint64_t chunk_start = start; chunk_start < run.end;) {
+                uint64_t chunk_end = run.end - chunk_start > step ? chunk_start + step : run.end;
+                // Past the first half of a 32-bit Thumb encoding, so the cut
+                // falls on a boundary whatever precedes it
+                while (thumb && chunk_end < run.end && is_thumb32_prefix(data + (chunk_end - 2 - sh.sh_addr))) {
+                    chunk_end += 2;
+                }
+                chunk_end = std::min<uint64_t>(chunk_end, run.end);
+                chunks.push_back({section_index, chunk_start, chunk_end, thumb});
+                chunk_start = chunk_end;
+            }
+        }
+    }
+    return chunks;
+}
+
+void sweep_chunk(const ElfParser& parser, ArmDisassembler& disassembler,
+                 const SweepChunk& chunk, const SweepSink& sink,
+                 std::vector<DisassembledInstruction>& buffer) {
+    const uint8_t* data = parser.get_section_data_by_index(chunk.section_index);
+    if (data == nullptr) return;
+
+    const SectionHeader& sh = parser.get_section_headers()[chunk.section_index];
+    disassembler.disassemble_block_into(
+        data + (chunk.start - sh.sh_addr), chunk.end - chunk.start, chunk.start, chunk.thumb, buffer);
+    sink(chunk.section_index, buffer);
+}
+
+void affected_instruction_span(const uint8_t* run_data, uint64_t run_start, uint64_t run_end, bool thumb,
+                               uint64_t changed_start, uint64_t changed_end,
+                               uint64_t& span_start, uint64_t& span_end) {
+    changed_start = std::max(changed_start, run_start);
+    changed_end = std::min(changed_end, run_end);
+    if (!thumb) {
+        span_start = run_start + ((changed_start - run_start) & ~3ULL);
+        span_end = std::min<uint64_t>(run_end, run_start + ((changed_end - run_start + 3) & ~3ULL));
+        return;
+    }
+
+    // Bytes before changed_start are unchanged, so a boundary found there
+    // holds in the old decode and in the new one
+    uint64_t start = run_start + ((changed_start - run_start) & ~1ULL);
+    while (start > run_start && is_thumb32_prefix(run_data + (start - 2 - run_start))) {
+        start -= 2;
+    }
+    // ...and after changed_end the same goes for the halfword before a boundary
+    uint64_t end = run_start + ((changed_end - run_start + 1) & ~1ULL) + 2;
+    while (end < run_end && is_thumb32_prefix(run_data + (end - 2 - run_start))) {
+        end += 2;
+    }
+    span_start = start;
+    span_end = std::min<uint64_t>(end, run_end);
+}
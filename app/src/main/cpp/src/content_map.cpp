@@ -0,0 +1,247 @@
+#include "../include/content_map.h"
+#include "../include/utils.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KTIMAZ_CONTENT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define KTIMAZ_CONTENT_SSE2 1
+#endif
+
+namespace {
+
+// True if the 16 bytes at p are all the same, as in padding and fill.
+inline bool uniform16(const uint8_t* p) {
+#if defined(KTIMAZ_CONTENT_NEON)
+    uint64x2_t equal = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(p), vdupq_n_u8(p[0])));
+    return (vgetq_lane_u64(equal, 0) & vgetq_lane_u64(equal, 1)) == ~0ULL;
+#elif defined(KTIMAZ_CONTENT_SSE2)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(p[0])))) == 0xFFFF;
+#else
+    uint64_t lo, hi;
+    memcpy(&lo, p, 8);
+    memcpy(&hi, p + 8, 8);
+    return lo == hi && lo == p[0] * 0x0101010101010101ULL;
+#endif
+}
+
+// histogram[i] = a[i] + b[i] + c[i] + d[i] for all 256 values.
+inline void sum_lanes(const uint32_t* a, const uint32_t* b, const uint32_t* c, const uint32_t* d,
+                      uint32_t* histogram) {
+    for (size_t i = 0; i < 256; i += 4) {
+#if defined(KTIMAZ_CONTENT_NEON)
+        uint32x4_t sum = vaddq_u32(vaddq_u32(vld1q_u32(a + i), vld1q_u32(b + i)),
+                                   vaddq_u32(vld1q_u32(c + i), vld1q_u32(d + i)));
+        vst1q_u32(histogram + i, sum);
+#elif defined(KTIMAZ_CONTENT_SSE2)
+        auto load = [](const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(load(a + i), load(b + i)), _mm_add_epi32(load(c + i), load(d + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(histogram + i), sum);
+#else
+        for (size_t j = i; j < i + 4; ++j) histogram[j] = a[j] + b[j] + c[j] + d[j];
+#endif
+    }
+}
+
+// c * log2(c) for the counts a full block can hold, so block entropy needs
+// no log calls.
+const std::vector<float>& xlogx_table() {
+    static const std::vector<float> table = [] {
+        std::vector<float> values(ContentMap::kBlockBytes + 1, 0.0f);
+        for (size_t c = 2; c < values.size(); ++c) {
+            values[c] = static_cast<float>(c * std::log2(static_cast<double>(c)));
+        }
+        return values;
+    }();
+    return table;
+}
+
+struct ExecutableRange {
+    uint64_t file_offset;
+    uint64_t size;
+    uint64_t address;
+};
+
+} // namespace
+
+void byte_histogram_lanes(const uint8_t* data, size_t size, uint32_t lanes[4][256]) {
+    // One table per position modulo 4, so neighbouring bytes do not
+    // serialise on a single counter; uniform 16-byte stretches are counted
+    // in one step
+    memset(lanes, 0, 4 * 256 * sizeof(uint32_t));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8_t* p = data + i;
+        if (uniform16(p)) {
+            for (size_t lane = 0; lane < 4; ++lane) lanes[lane][p[0]] += 4;
+            continue;
+        }
+        for (size_t j = 0; j < 16; j += 4) {
+            ++lanes[0][p[j]];
+            ++lanes[1][p[j + 1]];
+            ++lanes[2][p[j + 2]];
+            ++lanes[3][p[j + 3]];
+        }
+    }
+    for (; i < size; ++i) ++lanes[i & 3][data[i]];
+}
+
+void byte_histogram(const uint8_t* data, size_t size, uint32_t histogram[256]) {
+    uint32_t lanes[4][256];
+    byte_histogram_lanes(data, size, lanes);
+    sum_lanes(lanes[0], lanes[1], lanes[2], lanes[3], histogram);
+}
+
+uint16_t histogram_entropy(const uint32_t histogram[256], size_t size) {
+    if (size == 0) return 0;
+    const std::vector<float>& table = xlogx_table();
+    double sum = 0;
+    for (size_t i = 0; i < 256; ++i) {
+        uint32_t count = histogram[i];
+        sum += count < table.size() ? table[count] : count * std::log2(static_cast<double>(count));
+    }
+    // H = -sum(p log2 p) = log2(n) - sum(c log2 c) / n
+    double n = static_cast<double>(size);
+    double entropy = std::max(0.0, std::log2(n) - sum / n);
+    return static_cast<uint16_t>(std::lround(std::min(entropy, 8.0) * 256));
+}
+
+namespace {
+
+// File ranges of the executable sections, by file offset.
+std::vector<ExecutableRange> executable_ranges(const ElfParser& parser) {
+    std::vector<ExecutableRange> executable;
+    for (size_t index : executable_section_indices(parser)) {
+        const SectionHeader& sh = parser.get_section_headers()[index];
+        executable.push_back({sh.sh_offset, sh.sh_size, sh.sh_addr});
+    }
+    std::sort(executable.begin(), executable.end(),
+              [](const ExecutableRange& a, const ExecutableRange& b) { return a.file_offset < b.file_offset; });
+    return executable;
+}
+
+ContentBlock classify_block(const MappedFile& file, size_t index, const std::vector<ExecutableRange>& executable,
+                            const ModeMap& mode_map) {
+    uint32_t lanes[4][256], histogram[256], even[256], odd[256];
+    const uint32_t zeros[256] = {};
+    uint64_t offset = index * ContentMap::kBlockBytes;
+    size_t size = static_cast<size_t>(std::min<uint64_t>(ContentMap::kBlockBytes, file.size - offset));
+    ContentBlock block;
+    byte_histogram_lanes(file.data + offset, size, lanes);
+    sum_lanes(lanes[0], lanes[1], lanes[2], lanes[3], histogram);
+    block.entropy = histogram_entropy(histogram, size);
+    block.code_score = 0;
+    if (histogram[0] * 100 >= size * ContentMap::kZeroFillPercent) {
+        block.content = ContentClass::ZeroFill;
+        return block;
+    }
+    if (block.entropy >= ContentMap::kCompressedEntropy) {
+        block.content = ContentClass::Compressed;
+        return block;
+    }
+
+    // Score in the instruction set the block's code would use
+    CodeMode mode = mode_map.default_mode();
+    auto section = std::upper_bound(executable.begin(), executable.end(), offset,
+        [](uint64_t value, const ExecutableRange& range) { return value < range.file_offset; });
+    if (section != executable.begin() && offset - (section - 1)->file_offset < (section - 1)->size) {
+        --section;
+        CodeMode mapped = mode_map.mode_at(section->address + (offset - section->file_offset));
+        if (mapped != CodeMode::Data) mode = mapped;
+    }
+    if (mode == CodeMode::Thumb) {
+        // Low bytes of Thumb halfwords are mostly operands, high
+        // bytes mostly opcode bits, so code is more predictable in
+        // its odd bytes; other content is not
+        sum_lanes(lanes[0], lanes[2], zeros, zeros, even);
+        sum_lanes(lanes[1], lanes[3], zeros, zeros, odd);
+        int gap = histogram_entropy(even, size / 2 + (size & 1)) - histogram_entropy(odd, size / 2);
+        block.code_score = static_cast<uint8_t>(std::clamp(gap, 0, 255));
+    } else {
+        // Compiled ARM code is mostly unconditional: condition AL
+        // in the top nibble of each word
+        uint32_t always = 0;
+        for (size_t value = 0xE0; value <= 0xEF; ++value) always += lanes[3][value];
+        block.code_score = static_cast<uint8_t>(std::min<size_t>(255, always * 255 / std::max<size_t>(1, size / 4)));
+    }
+    block.content = block.code_score >= ContentMap::kCodeScore && block.entropy >= ContentMap::kMinCodeEntropy
+        ? ContentClass::Code : ContentClass::Data;
+    return block;
+}
+
+} // namespace
+
+ContentMap::ContentMap(const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                       TaskPriority priority)
+    : file_size_(parser.get_file().size) {
+    KTIMAZ_TRACE_SCOPE("content_map.scan");
+    const MappedFile& file = parser.get_file();
+    std::vector<ExecutableRange> executable = executable_ranges(parser);
+
+    blocks_.resize((file.size + kBlockBytes - 1) / kBlockBytes);
+    // 64 blocks (256 KB) per piece
+    scheduler.parallel_for(blocks_.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            blocks_[i] = classify_block(file, i, executable, mode_map);
+        }
+    }, priority);
+    memory_.set(capacity_bytes(blocks_));
+}
+
+void ContentMap::refresh(const ElfParser& parser, const ModeMap& mode_map, uint64_t file_offset, uint64_t size) {
+    if (size == 0) return;
+    size_t first = file_offset / kBlockBytes;
+    size_t last = std::min(blocks_.size(), static_cast<size_t>((file_offset + size - 1) / kBlockBytes + 1));
+    if (first >= last) return;
+    std::vector<ExecutableRange> executable = executable_ranges(parser);
+    for (size_t i = first; i < last; ++i) {
+        blocks_[i] = classify_block(parser.get_file(), i, executable, mode_map);
+    }
+}
+
+ContentClass ContentMap::class_at(uint64_t file_offset) const {
+    size_t index = file_offset / kBlockBytes;
+    return index < blocks_.size() ? blocks_[index].content : ContentClass::Data;
+}
+
+std::vector<ContentRegion> ContentMap::regions() const {
+    std::vector<ContentRegion> regions;
+    uint64_t entropy_sum = 0, score_sum = 0;
+    size_t count = 0;
+    auto close_region = [&]() {
+        if (count == 0) return;
+        regions.back().entropy = static_cast<uint16_t>(entropy_sum / count);
+        regions.back().code_score = static_cast<uint8_t>(score_sum / count);
+    };
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const ContentBlock& block = blocks_[i];
+        if (regions.empty() || regions.back().content != block.content) {
+            close_region();
+            regions.push_back({i * kBlockBytes, 0, block.content, 0, 0});
+            entropy_sum = score_sum = count = 0;
+        }
+        regions.back().size += std::min<uint64_t>(kBlockBytes, file_size_ - i * kBlockBytes);
+        entropy_sum += block.entropy;
+        score_sum += block.code_score;
+        ++count;
+    }
+    close_region();
+    return regions;
+}
+
+bool ContentMap::worth_disassembling(uint64_t file_offset, uint64_t size) const {
+    if (size == 0) return false;
+    size_t first = file_offset / kBlockBytes;
+    size_t last = std::min(blocks_.size(), static_cast<size_t>((file_offset + size - 1) / kBlockBytes + 1));
+    if (first >= last) return true; // Not covered by the map
+    for (size_t i = first; i < last; ++i) {
+        if (blocks_[i].content == ContentClass::Code || blocks_[i].content == ContentClass::Data) return true;
+    }
+    return false;
+}
@@ -0,0 +1,524 @@
+#include "../include/control_flow_graph.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+namespace {
+
+// Layout spacing in text units
+constexpr int32_t kNodeGap = 4;   // Columns between blocks in a layer
+constexpr int32_t kLayerGap = 3;  // Rows between layers
+constexpr int32_t kNodePadding = 2;
+constexpr int kOrderingSweeps = 4;
+
+bool is_conditional_flow(const DisassembledInstruction& instr) {
+    return instr.is_conditional && instr.branch_kind != BranchKind::Call &&
+           instr.branch_kind != BranchKind::IndirectCall;
+}
+
+// True if nothing executes sequentially after this instruction.
+bool ends_flow(const DisassembledInstruction& instr) {
+    switch (instr.branch_kind) {
+        case BranchKind::Jump:
+        case BranchKind::IndirectJump:
+        case BranchKind::Return:
+            return !instr.is_conditional;
+        default:
+            return false;
+    }
+}
+
+// True if the instruction must be the last one of its block.
+bool ends_block(const DisassembledInstruction& instr) {
+    switch (instr.branch_kind) {
+        case BranchKind::Jump:
+        case BranchKind::IndirectJump:
+        case BranchKind::Return:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string format_line(const DisassembledInstruction& instr) {
+    std::string line;
+    append_listing_line(line, instr);
+    return line;
+}
+
+} // namespace
+
+bool find_function_bounds(const ElfParser& parser, uint64_t address, uint64_t& start, uint64_t& end) {
+    int section_index = parser.find_section_by_address(address);
+    if (section_index < 0) return false;
+    const SectionHeader& section = parser.get_section_headers()[section_index];
+
+    // Prefer the smallest sized function symbol that covers the address
+    uint64_t best_size = 0;
+    for (const auto& symbol : parser.get_symbols()) {
+        if ((symbol.st_info & 0xF) != STT_FUNC || symbol.st_size == 0) continue;
+        uint64_t symbol_start = symbol.st_value & ~1ULL;
+        if (address < symbol_start || address - symbol_start >= symbol.st_size) continue;
+        if (best_size == 0 || symbol.st_size < best_size) {
+            best_size = symbol.st_size;
+            start = symbol_start;
+            end = symbol_start + symbol.st_size;
+        }
+    }
+    if (best_size != 0) {
+        end = std::min(end, section.sh_addr + section.sh_size);
+        return true;
+    }
+
+    start = address;
+    end = section.sh_addr + section.sh_size;
+    return true;
+}
+
+ControlFlowGraph::ControlFlowGraph(const ElfParser& parser, ArmDisassembler& disassembler, uint64_t entry,
+                                   bool thumb, uint64_t function_start, uint64_t function_end,
+                                   size_t max_instructions)
+    : entry_(entry) {
+    discover(parser, disassembler, thumb, function_start, function_end, max_instructions);
+    if (blocks_.empty()) return;
+    compute_dominators();
+    find_loops();
+    compute_layout();
+    memory_.set(capacity_bytes(instructions_, blocks_, edges_, succ_offsets_, succ_edges_, pred_offsets_,
+                               pred_edges_, rpo_, rpo_index_, idom_, dom_pre_, dom_post_, nodes_, layers_,
+                               layer_y_, layer_height_));
+    std::string message = "CFG at 0x";
+    append_hex(message, entry);
+    log_info(message + ": " + std::to_string(blocks_.size()) + " blocks, " + std::to_string(edges_.size()) +
+             " edges, " + std::to_string(loop_count_) + " loops");
+}
+
+void ControlFlowGraph::discover(const ElfParser& parser, ArmDisassembler& disassembler, bool thumb,
+                                uint64_t function_start, uint64_t function_end, size_t max_instructions) {
+    auto in_function = [&](uint64_t address) {
+        return address >= function_start && address < function_end;
+    };
+    if (!in_function(entry_)) return;
+
+    std::unordered_map<uint64_t, uint32_t> decoded; // Address -> index in instructions_
+    std::vector<uint64_t> worklist{entry_};
+    std::vector<uint64_t> leaders{entry_};
+
+    while (!worklist.empty()) {
+        uint64_t address = worklist.back();
+        worklist.pop_back();
+
+        while (in_function(address) && decoded.find(address) == decoded.end()) {
+            if (instructions_.size() >= max_instructions) {
+                truncated_ = true;
+                worklist.clear();
+                break;
+            }
+            int section_index = parser.find_section_by_address(address);
+            if (section_index < 0) break;
+            const SectionHeader& section = parser.get_section_headers()[section_index];
+            uint64_t limit = std::min(function_end, section.sh_addr + section.sh_size);
+            const uint8_t* data = parser.get_data_at_address(address, limit - address);
+            if (data == nullptr) break;
+
+            DisassembledInstruction instr = disassembler.decode_one(data, limit - address, address, thumb);
+            if (instr.size == 0) break;
+            decoded.emplace(address, static_cast<uint32_t>(instructions_.size()));
+            instructions_.push_back(std::move(instr));
+            const DisassembledInstruction& current = instructions_.back();
+
+            if (current.branch_kind == BranchKind::Jump && in_function(current.branch_target)) {
+                worklist.push_back(current.branch_target);
+                leaders.push_back(current.branch_target);
+            }
+            uint64_t next = address + current.size;
+            if (ends_flow(current)) break;
+            if (is_conditional_flow(current) && current.branch_kind != BranchKind::None) {
+                leaders.push_back(next);
+            }
+            address = next;
+        }
+    }
+
+    std::sort(instructions_.begin(), instructions_.end(),
+        [](const DisassembledInstruction& a, const DisassembledInstruction& b) {
+            return a.address < b.address;
+        });
+    std::sort(leaders.begin(), leaders.end());
+    leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+
+    build_blocks(leaders);
+    build_edges(function_start, function_end);
+}
+
+void ControlFlowGraph::build_blocks(const std::vector<uint64_t>& leaders) {
+    size_t next_leader = 0;
+    for (uint32_t i = 0; i < instructions_.size(); ++i) {
+        const DisassembledInstruction& instr = instructions_[i];
+        while (next_leader < leaders.size() && leaders[next_leader] < instr.address) ++next_leader;
+        bool is_leader = next_leader < leaders.size() && leaders[next_leader] == instr.address;
+
+        bool starts_block = blocks_.empty() || is_leader;
+        if (!starts_block) {
+            const DisassembledInstruction& previous = instructions_[i - 1];
+            starts_block = ends_block(previous) || previous.address + previous.size != instr.address;
+        }
+
+        if (starts_block) {
+            blocks_.push_back({instr.address, instr.address, i, 0, 0});
+        }
+        Block& block = blocks_.back();
+        block.end = instr.address + instr.size;
+        ++block.instruction_count;
+        if (instr.branch_kind == BranchKind::Call || instr.branch_kind == BranchKind::IndirectCall) {
+            block.flags |= CFG_BLOCK_HAS_CALL;
+        }
+    }
+}
+
+uint32_t ControlFlowGraph::block_at(uint64_t address) const {
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), address,
+        [](uint64_t value, const Block& block) { return value < block.start; });
+    if (it == blocks_.begin()) return kNoBlock;
+    --it;
+    if (address >= it->end) return kNoBlock;
+    return static_cast<uint32_t>(it - blocks_.begin());
+}
+
+bool ControlFlowGraph::overlaps(uint64_t start, uint64_t end) const {
+    // Blocks are disjoint, so only the last one starting before `end` can reach `start`
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(), end,
+        [](const Block& block, uint64_t value) { return block.start < value; });
+    return it != blocks_.begin() && std::prev(it)->end > start;
+}
+
+void ControlFlowGraph::build_edges(uint64_t function_start, uint64_t function_end) {
+    auto block_starting_at = [&](uint64_t address) {
+        uint32_t index = block_at(address);
+        return (index != kNoBlock && blocks_[index].start == address) ? index : kNoBlock;
+    };
+
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        Block& block = blocks_[b];
+        const DisassembledInstruction& last =
+            instructions_[block.first_instruction + block.instruction_count - 1];
+        uint32_t next = block_starting_at(block.end);
+
+        switch (last.branch_kind) {
+            case BranchKind::Jump: {
+                uint32_t target = kNoBlock;
+                if (last.branch_target >= function_start && last.branch_target < function_end) {
+                    target = block_starting_at(last.branch_target);
+                }
+                if (target != kNoBlock) {
+                    edges_.push_back({b, target, last.is_conditional ? CfgEdgeKind::Taken
+                                                                      : CfgEdgeKind::Unconditional});
+                } else {
+                    block.flags |= CFG_BLOCK_EXIT; // Tail call or jump out of the function
+                }
+                if (last.is_conditional && next != kNoBlock) {
+                    edges_.push_back({b, next, CfgEdgeKind::NotTaken});
+                }
+                break;
+            }
+            case BranchKind::IndirectJump:
+            case BranchKind::Return:
+                block.flags |= CFG_BLOCK_EXIT;
+                if (last.is_conditional && next != kNoBlock) {
+                    edges_.push_back({b, next, CfgEdgeKind::NotTaken});
+                }
+                break;
+            default:
+                if (next != kNoBlock) {
+                    edges_.push_back({b, next, CfgEdgeKind::Fallthrough});
+                } else {
+                    block.flags |= CFG_BLOCK_EXIT; // Runs off the decoded range
+                }
+                break;
+        }
+    }
+
+    uint32_t entry_block = block_starting_at(entry_);
+    if (entry_block != kNoBlock) blocks_[entry_block].flags |= CFG_BLOCK_ENTRY;
+
+    // CSR successor / predecessor lists of edge indices
+    size_t block_count = blocks_.size();
+    succ_offsets_.assign(block_count + 1, 0);
+    pred_offsets_.assign(block_count + 1, 0);
+    for (const Edge& edge : edges_) {
+        ++succ_offsets_[edge.from + 1];
+        ++pred_offsets_[edge.to + 1];
+    }
+    for (size_t i = 0; i < block_count; ++i) {
+        succ_offsets_[i + 1] += succ_offsets_[i];
+        pred_offsets_[i + 1] += pred_offsets_[i];
+    }
+    succ_edges_.resize(edges_.size());
+    pred_edges_.resize(edges_.size());
+    std::vector<uint32_t> succ_fill(succ_offsets_.begin(), succ_offsets_.end() - 1);
+    std::vector<uint32_t> pred_fill(pred_offsets_.begin(), pred_offsets_.end() - 1);
+    for (uint32_t e = 0; e < edges_.size(); ++e) {
+        succ_edges_[succ_fill[edges_[e].from]++] = e;
+        pred_edges_[pred_fill[edges_[e].to]++] = e;
+    }
+}
+
+std::pair<const uint32_t*, const uint32_t*> ControlFlowGraph::successors(uint32_t block) const {
+    return {succ_edges_.data() + succ_offsets_[block], succ_edges_.data() + succ_offsets_[block + 1]};
+}
+
+std::pair<const uint32_t*, const uint32_t*> ControlFlowGraph::predecessors(uint32_t block) const {
+    return {pred_edges_.data() + pred_offsets_[block], pred_edges_.data() + pred_offsets_[block + 1]};
+}
+
+void ControlFlowGraph::compute_dominators() {
+    size_t block_count = blocks_.size();
+    uint32_t entry_block = block_at(entry_);
+
+    // Iterative DFS for postorder
+    std::vector<uint32_t> postorder;
+    postorder.reserve(block_count);
+    std::vector<uint8_t> visited(block_count, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> stack; // (block, next successor slot)
+    stack.emplace_back(entry_block, succ_offsets_[entry_block]);
+    visited[entry_block] = 1;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < succ_offsets_[top.first + 1]) {
+            uint32_t to = edges_[succ_edges_[top.second++]].to;
+            if (!visited[to]) {
+                visited[to] = 1;
+                stack.emplace_back(to, succ_offsets_[to]);
+            }
+        } else {
+            postorder.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    rpo_.assign(postorder.rbegin(), postorder.rend());
+    rpo_index_.assign(block_count, kNoBlock);
+    for (uint32_t i = 0; i < rpo_.size(); ++i) rpo_index_[rpo_[i]] = i;
+
+    // Cooper, Harvey & Kennedy: "A Simple, Fast Dominance Algorithm"
+    idom_.assign(block_count, kNoBlock);
+    idom_[entry_block] = entry_block;
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (rpo_index_[a] > rpo_index_[b]) a = idom_[a];
+            while (rpo_index_[b] > rpo_index_[a]) b = idom_[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo_.size(); ++i) {
+            uint32_t b = rpo_[i];
+            uint32_t new_idom = kNoBlock;
+            auto preds = predecessors(b);
+            for (const uint32_t* e = preds.first; e != preds.second; ++e) {
+                uint32_t p = edges_[*e].from;
+                if (idom_[p] == kNoBlock) continue;
+                new_idom = (new_idom == kNoBlock) ? p : intersect(p, new_idom);
+            }
+            if (new_idom != idom_[b]) {
+                idom_[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    // Pre/post numbering of the dominator tree makes dominates() O(1)
+    std::vector<uint32_t> child_offsets(block_count + 1, 0);
+    for (uint32_t b : rpo_) {
+        if (b != entry_block) ++child_offsets[idom_[b] + 1];
+    }
+    for (size_t i = 0; i < block_count; ++i) child_offsets[i + 1] += child_offsets[i];
+    std::vector<uint32_t> children(child_offsets.back());
+    std::vector<uint32_t> child_fill(child_offsets.begin(), child_offsets.end() - 1);
+    for (uint32_t b : rpo_) {
+        if (b != entry_block) children[child_fill[idom_[b]]++] = b;
+    }
+
+    dom_pre_.assign(block_count, 0);
+    dom_post_.assign(block_count, 0);
+    uint32_t counter = 0;
+    stack.clear();
+    stack.emplace_back(entry_block, child_offsets[entry_block]);
+    dom_pre_[entry_block] = counter++;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < child_offsets[top.first + 1]) {
+            uint32_t child = children[top.second++];
+            dom_pre_[child] = counter++;
+            stack.emplace_back(child, child_offsets[child]);
+        } else {
+            dom_post_[top.first] = counter++;
+            stack.pop_back();
+        }
+    }
+}
+
+bool ControlFlowGraph::dominates(uint32_t a, uint32_t b) const {
+    if (idom_[a] == kNoBlock || idom_[b] == kNoBlock) return false;
+    return dom_pre_[a] <= dom_pre_[b] && dom_post_[b] <= dom_post_[a];
+}
+
+void ControlFlowGraph::find_loops() {
+    for (const Edge& edge : edges_) {
+        if (dominates(edge.to, edge.from) && !(blocks_[edge.to].flags & CFG_BLOCK_LOOP_HEADER)) {
+            blocks_[edge.to].flags |= CFG_BLOCK_LOOP_HEADER;
+            ++loop_count_;
+        }
+    }
+}
+
+void ControlFlowGraph::compute_layout() {
+    size_t block_count = blocks_.size();
+    nodes_.assign(block_count, Node{0, 0, 0, 0, 0});
+
+    // Node sizes from the block text
+    for (uint32_t b = 0; b < block_count; ++b) {
+        const Block& block = blocks_[b];
+        int32_t width = 0;
+        for (uint32_t i = 0; i < block.instruction_count; ++i) {
+            width = std::max(width, static_cast<int32_t>(format_line(instructions_[block.first_instruction + i]).size()));
+        }
+        nodes_[b].width = width + kNodePadding;
+        nodes_[b].height = static_cast<int32_t>(block.instruction_count) + 1;
+    }
+
+    // Edges that go forward in reverse postorder form a DAG; layer by longest path
+    auto is_forward = [&](const Edge& edge) {
+        return rpo_index_[edge.from] != kNoBlock && rpo_index_[edge.to] != kNoBlock &&
+               rpo_index_[edge.from] < rpo_index_[edge.to];
+    };
+    uint32_t layer_count = 1;
+    for (uint32_t b : rpo_) {
+        auto preds = predecessors(b);
+        uint32_t layer = 0;
+        for (const uint32_t* e = preds.first; e != preds.second; ++e) {
+            const Edge& edge = edges_[*e];
+            if (is_forward(edge)) layer = std::max(layer, nodes_[edge.from].layer + 1);
+        }
+        nodes_[b].layer = layer;
+        layer_count = std::max(layer_count, layer + 1);
+    }
+
+    // Unreachable blocks (only possible after truncation) go below everything
+    bool has_unreachable = rpo_.size() < block_count;
+    if (has_unreachable) ++layer_count;
+    layers_.assign(layer_count, {});
+    for (uint32_t b : rpo_) layers_[nodes_[b].layer].push_back(b);
+    for (uint32_t b = 0; b < block_count; ++b) {
+        if (rpo_index_[b] == kNoBlock) {
+            nodes_[b].layer = layer_count - 1;
+            layers_.back().push_back(b);
+        }
+    }
+
+    // Barycenter ordering: alternate downward and upward sweeps
+    std::vector<double> position(block_count, 0.0);
+    auto record_positions = [&](uint32_t layer) {
+        for (uint32_t i = 0; i < layers_[layer].size(); ++i) position[layers_[layer][i]] = i;
+    };
+    for (uint32_t l = 0; l < layer_count; ++l) record_positions(l);
+
+    std::vector<std::pair<double, uint32_t>> keyed;
+    auto reorder = [&](uint32_t layer, bool use_predecessors) {
+        keyed.clear();
+        for (uint32_t b : layers_[layer]) {
+            double sum = 0.0;
+            int count = 0;
+            auto range = use_predecessors ? predecessors(b) : successors(b);
+            for (const uint32_t* e = range.first; e != range.second; ++e) {
+                const Edge& edge = edges_[*e];
+                if (!is_forward(edge)) continue;
+                sum += position[use_predecessors ? edge.from : edge.to];
+                ++count;
+            }
+            keyed.emplace_back(count > 0 ? sum / count : position[b], b);
+        }
+        std::stable_sort(keyed.begin(), keyed.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (uint32_t i = 0; i < keyed.size(); ++i) layers_[layer][i] = keyed[i].second;
+        record_positions(layer);
+    };
+    for (int sweep = 0; sweep < kOrderingSweeps; ++sweep) {
+        if (sweep % 2 == 0) {
+            for (uint32_t l = 1; l < layer_count; ++l) reorder(l, true);
+        } else {
+            for (uint32_t l = layer_count - 1; l-- > 0;) reorder(l, false);
+        }
+    }
+
+    // Coordinates: layers stacked top to bottom, each centered horizontally
+    std::vector<int32_t> layer_width(layer_count, 0);
+    layer_y_.assign(layer_count, 0);
+    layer_height_.assign(layer_count, 0);
+    int32_t y = 0;
+    for (uint32_t l = 0; l < layer_count; ++l) {
+        int32_t x = 0;
+        for (uint32_t b : layers_[l]) {
+            nodes_[b].x = x;
+            x += nodes_[b].width + kNodeGap;
+            layer_height_[l] = std::max(layer_height_[l], nodes_[b].height);
+        }
+        layer_width[l] = layers_[l].empty() ? 0 : x - kNodeGap;
+        layer_y_[l] = y;
+        y += layer_height_[l] + kLayerGap;
+        layout_width_ = std::max(layout_width_, layer_width[l]);
+    }
+    layout_height_ = y > 0 ? y - kLayerGap : 0;
+
+    for (uint32_t l = 0; l < layer_count; ++l) {
+        int32_t offset = (layout_width_ - layer_width[l]) / 2;
+        for (uint32_t b : layers_[l]) {
+            nodes_[b].x += offset;
+            nodes_[b].y = layer_y_[l];
+        }
+    }
+}
+
+CfgViewport ControlFlowGraph::viewport(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const {
+    CfgViewport result;
+    if (blocks_.empty() || x1 <= x0 || y1 <= y0) return result;
+
+    // Layers are stacked by y and blocks within a layer are sorted by x
+    auto first_layer = std::upper_bound(layer_y_.begin(), layer_y_.end(), y0);
+    size_t layer = (first_layer == layer_y_.begin()) ? 0 : (first_layer - layer_y_.begin()) - 1;
+    for (; layer < layers_.size() && layer_y_[layer] < y1; ++layer) {
+        if (layer_y_[layer] + layer_height_[layer] <= y0) continue;
+        const auto& row = layers_[layer];
+        auto it = std::partition_point(row.begin(), row.end(), [&](uint32_t b) {
+            return nodes_[b].x + nodes_[b].width <= x0;
+        });
+        for (; it != row.end() && nodes_[*it].x < x1; ++it) {
+            if (nodes_[*it].y + nodes_[*it].height > y0) result.blocks.push_back(*it);
+        }
+    }
+
+    // Edges are drawn from the bottom center of the source to the top center
+    // of the target; keep those whose bounding box reaches the viewport.
+    for (uint32_t e = 0; e < edges_.size(); ++e) {
+        const Node& from = nodes_[edges_[e].from];
+        const Node& to = nodes_[edges_[e].to];
+        int32_t ax = from.x + from.width / 2, ay = from.y + from.height;
+        int32_t bx = to.x + to.width / 2, by = to.y;
+        if (std::max(ax, bx) < x0 || std::min(ax, bx) >= x1) continue;
+        if (std::max(ay, by) < y0 || std::min(ay, by) >= y1) continue;
+        result.edges.push_back(e);
+    }
+    return result;
+}
+
+std::string ControlFlowGraph::block_text(uint32_t block) const {
+    const Block& b = blocks_[block];
+    std::string text;
+    for (uint32_t i = 0; i < b.instruction_count; ++i) {
+        if (i > 0) text += '\n';
+        append_listing_line(text, instructions_[b.first_instruction + i]);
+    }
+    return text;
+}
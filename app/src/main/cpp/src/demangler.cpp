@@ -0,0 +1,103 @@
+#include "../include/demangler.h"
+#include "../include/trace.h"
+#include <cxxabi.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// __cxa_demangle output buffer, kept per thread so demangling a batch
+// reallocates only when a name is longer than any before it.
+struct DemangleBuffer {
+    char* data = nullptr;
+    size_t length = 0;
+    std::string mangled; // NUL-terminated copy of the input
+
+    ~DemangleBuffer() { free(data); }
+};
+
+// Approximate heap bytes of one unordered_map entry.
+constexpr size_t kMapEntryBytes = sizeof(std::pair<const uint64_t, std::string_view>) + 2 * sizeof(void*);
+
+} // namespace
+
+bool is_mangled_name(std::string_view name) {
+    return name.size() > 2 && name[0] == '_' && name[1] == 'Z';
+}
+
+bool demangle_name(std::string_view mangled, std::string& out) {
+    if (!is_mangled_name(mangled)) return false;
+    thread_local DemangleBuffer buffer;
+    buffer.mangled.assign(mangled.data(), mangled.size());
+    int status = 0;
+    char* result = abi::__cxa_demangle(buffer.mangled.c_str(), buffer.data, &buffer.length, &status);
+    if (status != 0 || result == nullptr) return false;
+    buffer.data = result; // May have been reallocated
+    out.assign(result);
+    return true;
+}
+
+DemangleCache::DemangleCache(const uint8_t* data, size_t size)
+    : data_(reinterpret_cast<const char*>(data)), size_(size) {}
+
+uint64_t DemangleCache::key(std::string_view name) const {
+    if (name.data() < data_ || name.data() >= data_ + size_) return kNoKey;
+    return static_cast<uint64_t>(name.data() - data_);
+}
+
+std::string_view DemangleCache::store(uint64_t key, std::string_view name, const std::string* demangled) {
+    std::string_view value = demangled ? arena_.copy(*demangled) : name;
+    names_.emplace(key, value);
+    memory_.set(names_.size() * kMapEntryBytes + names_.bucket_count() * sizeof(void*));
+    return value;
+}
+
+std::string_view DemangleCache::demangle(std::string_view name) {
+    if (!is_mangled_name(name)) return name;
+    uint64_t name_key = key(name);
+    if (name_key == kNoKey) return name; // Not from the file; nowhere to keep it
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = names_.find(name_key);
+        if (it != names_.end()) return it->second;
+    }
+    std::string demangled;
+    bool ok = demangle_name(name, demangled);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(name_key);
+    if (it != names_.end()) return it->second; // Another thread was faster
+    return store(name_key, name, ok ? &demangled : nullptr);
+}
+
+void DemangleCache::demangle_all(const std::vector<std::string_view>& names, TaskScheduler& scheduler,
+                                 TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("demangle.bulk");
+    std::vector<std::string_view> missing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::string_view name : names) {
+            if (!is_mangled_name(name)) continue;
+            uint64_t name_key = key(name);
+            if (name_key != kNoKey && names_.find(name_key) == names_.end()) missing.push_back(name);
+        }
+    }
+    if (missing.empty()) return;
+
+    // Demangle outside the lock; each piece then takes it once to store
+    scheduler.parallel_for(missing.size(), 256, [&](size_t begin, size_t end) {
+        std::vector<std::string> results(end - begin);
+        std::vector<uint8_t> ok(end - begin);
+        for (size_t i = begin; i < end; ++i) ok[i - begin] = demangle_name(missing[i], results[i - begin]);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t name_key = key(missing[i]);
+            if (names_.find(name_key) != names_.end()) continue; // Duplicate name or a racing demangle()
+            store(name_key, missing[i], ok[i - begin] ? &results[i - begin] : nullptr);
+        }
+    }, priority);
+}
+
+size_t DemangleCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
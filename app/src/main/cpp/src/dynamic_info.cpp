@@ -0,0 +1,185 @@
+#include "../include/dynamic_info.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+constexpr uint16_t VER_FLG_BASE = 0x1;   // Verdef entry naming the file itself
+constexpr uint16_t VERSYM_HIDDEN = 0x8000;
+constexpr uint16_t VERSYM_INDEX = 0x7fff;
+constexpr uint8_t STV_MASK = 0x3;
+constexpr uint8_t STV_PROTECTED = 0x3;
+
+// Bytes of a section, empty unless all of them are in the file.
+struct SectionBytes {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+SectionBytes section_bytes(const ElfParser& parser, size_t index) {
+    const auto& headers = parser.get_section_headers();
+    const MappedFile& file = parser.get_file();
+    if (index >= headers.size()) return {};
+    const SectionHeader& sh = headers[index];
+    if (sh.sh_type == SHT_NOBITS || sh.sh_offset > file.size || sh.sh_size > file.size - sh.sh_offset) return {};
+    return {file.data + sh.sh_offset, static_cast<size_t>(sh.sh_size)};
+}
+
+template <typename T>
+T read(const SectionBytes& bytes, size_t offset, bool little_endian) {
+    T value;
+    memcpy(&value, bytes.data + offset, sizeof(T));
+    if (!little_endian) {
+        if constexpr (sizeof(T) == 2) value = __builtin_bswap16(value);
+        if constexpr (sizeof(T) == 4) value = __builtin_bswap32(value);
+        if constexpr (sizeof(T) == 8) value = __builtin_bswap64(value);
+    }
+    return value;
+}
+
+std::string_view string_at(const SectionBytes& strtab, uint64_t offset) {
+    if (offset >= strtab.size) return {};
+    const char* text = reinterpret_cast<const char*>(strtab.data + offset);
+    return std::string_view(text, strnlen(text, strtab.size - offset));
+}
+
+long find_section(const ElfParser& parser, uint32_t type) {
+    const auto& headers = parser.get_section_headers();
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (headers[i].sh_type == type) return static_cast<long>(i);
+    }
+    return -1;
+}
+
+} // namespace
+
+DynamicInfo::DynamicInfo(const ElfParser& parser) {
+    const auto& headers = parser.get_section_headers();
+    const bool little = parser.get_header().is_little_endian;
+
+    dynamic_section_ = find_section(parser, SHT_DYNAMIC);
+    if (dynamic_section_ >= 0) {
+        SectionBytes dynamic = section_bytes(parser, dynamic_section_);
+        SectionBytes strtab = section_bytes(parser, headers[dynamic_section_].sh_link);
+        const size_t entry_size = parser.get_header().is_64bit ? 16 : 8;
+        std::string_view rpath;
+        for (size_t offset = 0; offset + entry_size <= dynamic.size; offset += entry_size) {
+            uint64_t tag, value;
+            if (entry_size == 16) {
+                tag = read<uint64_t>(dynamic, offset, little);
+                value = read<uint64_t>(dynamic, offset + 8, little);
+            } else {
+                tag = read<uint32_t>(dynamic, offset, little);
+                value = read<uint32_t>(dynamic, offset + 4, little);
+            }
+            if (tag == DT_NULL) break;
+            switch (tag) {
+                case DT_NEEDED: needed_.push_back(string_at(strtab, value)); break;
+                case DT_SONAME: soname_ = string_at(strtab, value); break;
+                case DT_RUNPATH: runpath_ = string_at(strtab, value); break;
+                case DT_RPATH: rpath = string_at(strtab, value); break;
+                default: break;
+            }
+        }
+        if (runpath_.empty()) runpath_ = rpath;
+    }
+
+    long dynsym = find_section(parser, SHT_DYNSYM);
+    long first_symbol = dynsym >= 0 ? parser.first_symbol_of_table(dynsym) : -1;
+    if (first_symbol < 0) return;
+    const SectionHeader& dynsym_sh = headers[dynsym];
+    size_t symbol_count = dynsym_sh.sh_entsize ? dynsym_sh.sh_size / dynsym_sh.sh_entsize : 0;
+    symbol_count = std::min(symbol_count, parser.get_symbols().size() - static_cast<size_t>(first_symbol));
+
+    // Version index -> name, and for required versions the library
+    std::vector<std::string_view> version_names, version_files;
+    auto set_version = [&](uint16_t index, std::string_view name, std::string_view file) {
+        if (index >= version_names.size()) {
+            version_names.resize(index + 1);
+            version_files.resize(index + 1);
+        }
+        version_names[index] = name;
+        version_files[index] = file;
+    };
+
+    long verdef = find_section(parser, SHT_GNU_verdef);
+    if (verdef >= 0) {
+        SectionBytes bytes = section_bytes(parser, verdef);
+        SectionBytes strtab = section_bytes(parser, headers[verdef].sh_link);
+        size_t offset = 0;
+        // Verdef: version, flags, ndx, cnt (u16), hash, aux, next (u32)
+        for (uint32_t i = 0; i < headers[verdef].sh_info && offset + 20 <= bytes.size; ++i) {
+            uint16_t flags = read<uint16_t>(bytes, offset + 2, little);
+            uint16_t index = read<uint16_t>(bytes, offset + 4, little) & VERSYM_INDEX;
+            uint32_t aux = read<uint32_t>(bytes, offset + 12, little);
+            uint32_t next = read<uint32_t>(bytes, offset + 16, little);
+            // The first Verdaux (name, next) names the version
+            if (aux <= bytes.size - offset && bytes.size - offset - aux >= 8 && !(flags & VER_FLG_BASE)) {
+                std::string_view name = string_at(strtab, read<uint32_t>(bytes, offset + aux, little));
+                set_version(index, name, {});
+                defined_versions_.push_back(name);
+            }
+            if (next == 0 || next > bytes.size - offset) break;
+            offset += next;
+        }
+    }
+
+    long verneed = find_section(parser, SHT_GNU_verneed);
+    if (verneed >= 0) {
+        SectionBytes bytes = section_bytes(parser, verneed);
+        SectionBytes strtab = section_bytes(parser, headers[verneed].sh_link);
+        size_t offset = 0;
+        // Verneed: version, cnt (u16), file, aux, next (u32)
+        for (uint32_t i = 0; i < headers[verneed].sh_info && offset + 16 <= bytes.size; ++i) {
+            uint16_t count = read<uint16_t>(bytes, offset + 2, little);
+            std::string_view file = string_at(strtab, read<uint32_t>(bytes, offset + 4, little));
+            uint32_t aux = read<uint32_t>(bytes, offset + 8, little);
+            uint32_t next = read<uint32_t>(bytes, offset + 12, little);
+            // Vernaux: hash (u32), flags, other (u16), name, next (u32)
+            size_t aux_offset = aux <= bytes.size - offset ? offset + aux : bytes.size;
+            for (uint16_t k = 0; k < count && aux_offset + 16 <= bytes.size; ++k) {
+                uint16_t index = read<uint16_t>(bytes, aux_offset + 6, little) & VERSYM_INDEX;
+                set_version(index, string_at(strtab, read<uint32_t>(bytes, aux_offset + 8, little)), file);
+                uint32_t aux_next = read<uint32_t>(bytes, aux_offset + 12, little);
+                if (aux_next == 0 || aux_next > bytes.size - aux_offset) break;
+                aux_offset += aux_next;
+            }
+            if (next == 0 || next > bytes.size - offset) break;
+            offset += next;
+        }
+    }
+
+    // One version index per .dynsym entry
+    SectionBytes versym;
+    long versym_section = find_section(parser, SHT_GNU_versym);
+    if (versym_section >= 0 && headers[versym_section].sh_link == static_cast<uint32_t>(dynsym)) {
+        versym = section_bytes(parser, versym_section);
+    }
+
+    const auto& symbols = parser.get_symbols();
+    for (size_t i = 1; i < symbol_count; ++i) {
+        uint32_t index = static_cast<uint32_t>(first_symbol + i);
+        const SymbolEntry& symbol = symbols[index];
+        uint8_t binding = symbol.st_info >> 4;
+        uint8_t type = symbol.st_info & 0xF;
+        if (symbol.name.empty() || binding == STB_LOCAL || type == STT_SECTION || type == STT_FILE) continue;
+
+        uint16_t versym_value = 2 * i + 2 <= versym.size ? read<uint16_t>(versym, 2 * i, little) : 1;
+        uint16_t version_index = versym_value & VERSYM_INDEX;
+        DynamicSymbol entry{index, symbol.name, {}, {}, (versym_value & VERSYM_HIDDEN) != 0, binding == STB_WEAK};
+        if (version_index >= 2 && version_index < version_names.size()) {
+            entry.version = version_names[version_index];
+            entry.version_file = version_files[version_index];
+        }
+        if (symbol.st_shndx == SHN_UNDEF) {
+            entry.hidden = false;
+            imports_.push_back(entry);
+        } else {
+            uint8_t visibility = symbol.st_other & STV_MASK;
+            if (visibility == 0 || visibility == STV_PROTECTED) exports_.push_back(entry);
+        }
+    }
+    memory_.set(capacity_bytes(needed_, imports_, exports_, defined_versions_));
+}
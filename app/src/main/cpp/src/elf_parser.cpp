@@ -1,5 +1,6 @@
 #include "../include/elf_parser.h"
 #include "../include/utils.h"
+#include "../include/trace.h"
 #include <cstring>
 #include <algorithm>
 #include <endian.h>
@@ -41,27 +42,6 @@ enum ElfVersion {
     EV_CURRENT = 1  // Current version
 };
 
-// Section types
-enum SectionType {
-    SHT_NULL     = 0,  // Inactive
-    SHT_PROGBITS = 1,  // Program data
-    SHT_SYMTAB   = 2,  // Symbol table
-    SHT_STRTAB   = 3,  // String table
-    SHT_RELA     = 4,  // Relocation entries, addends
-    SHT_HASH     = 5,  // Symbol hash table
-    SHT_DYNAMIC  = 6,  // Dynamic linking information
-    SHT_NOTE     = 7,  // Notes
-    SHT_NOBITS   = 8,  // Program space with no data (bss)
-    SHT_REL      = 9,  // Relocation entries, no addends
-    SHT_SHLIB    = 10, // Reserved
-    SHT_DYNSYM   = 11  // Dynamic linker symbol table
-};
-
-// Special section indices
-enum SectionIndex {
-    SHN_UNDEF = 0 // Undefined section
-};
-
 // Helper function for endianness conversion
 template<typename T>
 T swap_endian(T val) {
@@ -100,6 +80,7 @@ ElfParser::~ElfParser() {
 }
 
 bool ElfParser::parse() {
+    KTIMAZ_TRACE_SCOPE_FAULTS("elf.parse");
     log_info("Starting ELF parsing...");
 
     if (!read_elf_header()) {
@@ -129,10 +110,27 @@ bool ElfParser::parse() {
     resolve_symbol_names();
     log_info("Symbol names resolved successfully.");
 
+    sections_by_address_.clear();
+    for (size_t i = 0; i < section_headers_.size(); ++i) {
+        const SectionHeader& sh = section_headers_[i];
+        // .tbss occupies no address space of its own and overlaps what follows it
+        bool tls_bss = sh.sh_type == SHT_NOBITS && (sh.sh_flags & SHF_TLS);
+        if ((sh.sh_flags & SHF_ALLOC) && sh.sh_size > 0 && !tls_bss) {
+            sections_by_address_.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    std::stable_sort(sections_by_address_.begin(), sections_by_address_.end(), [this](uint32_t a, uint32_t b) {
+        return section_headers_[a].sh_addr < section_headers_[b].sh_addr;
+    });
+
+    memory_.set(capacity_bytes(section_headers_, symbols_, symbol_table_runs_, sections_by_address_));
+    KTIMAZ_TRACE_COUNT(TraceCounter::SectionsParsed, section_headers_.size());
+    KTIMAZ_TRACE_COUNT(TraceCounter::SymbolsParsed, symbols_.size());
     return true;
 }
 
 bool ElfParser::read_elf_header() {
+    KTIMAZ_TRACE_SCOPE("elf.read_header");
     // Check ELF magic
     if (memcmp(file_.data, ELFMAG, 4) != 0) {
         log_error("Not an ELF file (magic mismatch).");
@@ -220,6 +218,7 @@ bool ElfParser::read_elf_header() {
 }
 
 bool ElfParser::read_section_headers() {
+    KTIMAZ_TRACE_SCOPE_FAULTS("elf.read_section_headers");
     if (header_.e_shoff == 0 || header_.e_shnum == 0 || header_.e_shentsize == 0) {
         log_info("No section headers to read.");
         return true;
@@ -271,6 +270,7 @@ bool ElfParser::read_section_headers() {
 }
 
 bool ElfParser::resolve_section_names() {
+    KTIMAZ_TRACE_SCOPE("elf.resolve_section_names");
     if (header_.e_shstrndx == SHN_UNDEF || section_headers_.empty()) {
         log_info("No section header string table or no sections to resolve names.");
         return true; // Not an error if file is stripped
@@ -298,7 +298,7 @@ bool ElfParser::resolve_section_names() {
             // Ensure null-terminated string
             size_t max_len = shstrtab_data_.size() - sh.sh_name;
             size_t actual_len = strnlen(name_ptr, max_len);
-            sh.name = std::string(name_ptr, actual_len);
+            sh.name = std::string_view(name_ptr, actual_len);
         } else {
             sh.name = "<invalid_name>";
             log_error("Invalid section name offset: " + std::to_string(sh.sh_name));
@@ -325,7 +325,9 @@ bool ElfParser::resolve_section_names() {
 }
 
 bool ElfParser::read_symbols() {
-    for (const auto& sh : section_headers_) {
+    KTIMAZ_TRACE_SCOPE_FAULTS("elf.read_symbols");
+    for (size_t section_index = 0; section_index < section_headers_.size(); ++section_index) {
+        const auto& sh = section_headers_[section_index];
         if (sh.sh_type == SHT_SYMTAB || sh.sh_type == SHT_DYNSYM) {
             size_t sym_offset = sh.sh_offset;
             size_t sym_size = sh.sh_size;
@@ -335,10 +337,12 @@ bool ElfParser::read_symbols() {
 
             size_t num_symbols = sym_size / sym_entry_size;
             if (sym_offset + sym_size > file_.size) {
-                log_error("Symbol table extends beyond file size for section: " + sh.name);
+                log_error("Symbol table extends beyond file size for section: " + std::string(sh.name));
                 continue;
             }
 
+            symbol_table_runs_.push_back({symbols_.size(), sh.sh_link, section_index});
+            symbols_.reserve(symbols_.size() + num_symbols);
             for (size_t i = 0; i < num_symbols; ++i) {
                 size_t current_sym_offset = sym_offset + i * sym_entry_size;
                 SymbolEntry sym;
@@ -368,29 +372,54 @@ bool ElfParser::read_symbols() {
 }
 
 void ElfParser::resolve_symbol_names() {
-    for (auto& sym : symbols_) {
-        std::string_view* target_strtab = nullptr;
-
-        // Determine which string table to use based on symbol binding/type or section type
-        // This is a simplified heuristic; real ELF linking can be complex.
-        if (sym.st_shndx < section_headers_.size() && 
-            sh_type_is_dynamic(section_headers_[sym.st_shndx].sh_type)) {
-             target_strtab = &dynstrtab_data_;
-        } else {
-            target_strtab = &strtab_data_;
+    KTIMAZ_TRACE_SCOPE_FAULTS("elf.resolve_symbol_names");
+    for (size_t run = 0; run < symbol_table_runs_.size(); ++run) {
+        size_t first = symbol_table_runs_[run].first_symbol;
+        size_t last = run + 1 < symbol_table_runs_.size() ? symbol_table_runs_[run + 1].first_symbol : symbols_.size();
+
+        // Prefer the string table the symbol table links to; fall back to the
+        // cached .strtab/.dynstr when sh_link is missing or bogus.
+        std::string_view target_strtab;
+        uint32_t link = symbol_table_runs_[run].strtab_index;
+        if (link != SHN_UNDEF && link < section_headers_.size() &&
+            section_headers_[link].sh_type == SHT_STRTAB &&
+            section_headers_[link].sh_offset + section_headers_[link].sh_size <= file_.size) {
+            target_strtab = std::string_view(
+                reinterpret_cast<const char*>(file_.data + section_headers_[link].sh_offset),
+                section_headers_[link].sh_size);
         }
 
-        if (target_strtab && !target_strtab->empty() && sym.st_name < target_strtab->size()) {
-            const char* name_ptr = target_strtab->data() + sym.st_name;
-            size_t max_len = target_strtab->size() - sym.st_name;
-            size_t actual_len = strnlen(name_ptr, max_len);
-            sym.name = std::string(name_ptr, actual_len);
-        } else {
-            sym.name = "<unnamed>";
+        for (size_t i = first; i < last; ++i) {
+            auto& sym = symbols_[i];
+            std::string_view strtab = target_strtab;
+            if (strtab.empty()) {
+                // This is a simplified heuristic; real ELF linking can be complex.
+                strtab = (sym.st_shndx < section_headers_.size() &&
+                          sh_type_is_dynamic(section_headers_[sym.st_shndx].sh_type))
+                         ? dynstrtab_data_ : strtab_data_;
+            }
+
+            if (!strtab.empty() && sym.st_name < strtab.size()) {
+                const char* name_ptr = strtab.data() + sym.st_name;
+                size_t max_len = strtab.size() - sym.st_name;
+                size_t actual_len = strnlen(name_ptr, max_len);
+                sym.name = std::string_view(name_ptr, actual_len);
+            } else {
+                sym.name = "<unnamed>";
+            }
         }
     }
 }
 
+long ElfParser::first_symbol_of_table(size_t section_index) const {
+    for (const auto& run : symbol_table_runs_) {
+        if (run.symtab_index == section_index) {
+            return static_cast<long>(run.first_symbol);
+        }
+    }
+    return -1;
+}
+
 const uint8_t* ElfParser::get_section_data(const std::string& section_name) const {
     for (const auto& sh : section_headers_) {
         if (sh.name == section_name) {
@@ -404,6 +433,40 @@ const uint8_t* ElfParser::get_section_data(const std::string& section_name) cons
     return nullptr;
 }
 
+const uint8_t* ElfParser::get_section_data_by_index(size_t section_index) const {
+    if (section_index >= section_headers_.size()) {
+        return nullptr;
+    }
+    const SectionHeader& sh = section_headers_[section_index];
+    if (sh.sh_type == SHT_NOBITS || sh.sh_offset + sh.sh_size > file_.size) {
+        return nullptr;
+    }
+    return file_.data + sh.sh_offset;
+}
+
+int ElfParser::find_section_by_address(uint64_t address) const {
+    auto it = std::upper_bound(sections_by_address_.begin(), sections_by_address_.end(), address,
+        [this](uint64_t addr, uint32_t index) { return addr < section_headers_[index].sh_addr; });
+    if (it == sections_by_address_.begin()) {
+        return -1;
+    }
+    const SectionHeader& sh = section_headers_[*std::prev(it)];
+    return address - sh.sh_addr < sh.sh_size ? static_cast<int>(*std::prev(it)) : -1;
+}
+
+const uint8_t* ElfParser::get_data_at_address(uint64_t address, size_t size) const {
+    int index = find_section_by_address(address);
+    if (index < 0) {
+        return nullptr;
+    }
+    const SectionHeader& sh = section_headers_[index];
+    if (address - sh.sh_addr + size > sh.sh_size) {
+        return nullptr;
+    }
+    const uint8_t* data = get_section_data_by_index(index);
+    return data ? data + (address - sh.sh_addr) : nullptr;
+}
+
 size_t ElfParser::get_section_size(const std::string& section_name) const {
     for (const auto& sh : section_headers_) {
         if (sh.name == section_name) {
@@ -425,4 +488,29 @@ uint64_t ElfParser::get_section_address(const std::string& section_name) const {
 // Helper function to check if a section type is typically associated with dynamic linking
 bool sh_type_is_dynamic(uint32_t sh_type) {
     return sh_type == SHT_DYNAMIC || sh_type == SHT_DYNSYM;
-}
\ No newline at end of file
+}
+bool reload_elf_file(const std::string& path, MappedFile& file, std::unique_ptr<ElfParser>& parser,
+                     std::string& error) {
+    parser.reset();
+    if (file.data) {
+        unmap_file(file);
+    }
+
+    file = map_file(path);
+    if (file.data == nullptr) {
+        error = "Failed to map file: " + path;
+        return false;
+    }
+    try {
+        parser = std::make_unique<ElfParser>(file);
+        if (parser->parse()) {
+            return true;
+        }
+        error = "ELF parsing failed";
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    parser.reset();
+    unmap_file(file);
+    return false;
+}
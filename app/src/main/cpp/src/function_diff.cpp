@@ -0,0 +1,339 @@
+#include "../include/function_diff.h"
+#include "../include/arm_disassembler.h"
+#include "../include/xref_index.h"
+#include "../include/trace.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+uint64_t combine(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2));
+}
+
+// Bits of an ARM encoding outside its position-dependent fields.
+uint32_t stable_arm_bits(uint32_t word) {
+    uint32_t op = (word >> 25) & 7;
+    if ((word >> 28) == 0xF) {
+        return op == 5 ? 0xFE000000 : 0xFFFFFFFF; // BLX imm
+    }
+    switch (op) {
+        case 5: return 0xFF000000; // B, BL
+        case 1:
+            if ((word & 0x0FB00000) == 0x03000000) return 0xFFF0F000; // MOVW/MOVT imm16
+            return 0xFFFFF000;     // Data processing immediate
+        case 2: return 0xFFFFF000; // LDR/STR[B] immediate, literal included
+        case 0:
+            // LDRH/STRH/LDRSB/LDRSH/LDRD/STRD immediate
+            if ((word & 0x0E400090) == 0x00400090 && (word & 0x60)) return 0xFFFFF0F0;
+            return 0xFFFFFFFF;
+        case 6:
+            if ((word & 0x0F000E00) == 0x0D000A00) return 0xFFFFFF00; // VLDR/VSTR
+            return 0xFFFFFFFF;
+        default: return 0xFFFFFFFF;
+    }
+}
+
+uint32_t stable_thumb16_bits(uint32_t half) {
+    if ((half & 0xE000) == 0x2000) return 0xFF00; // MOV/CMP/ADD/SUB Rd, #imm8
+    if ((half & 0xF800) == 0x4800) return 0xFF00; // LDR Rt, [PC, #imm8]
+    if ((half & 0xE000) == 0x6000 || (half & 0xF000) == 0x8000) return 0xF83F; // [Rn, #imm5]
+    if ((half & 0xF000) == 0x9000 || (half & 0xF000) == 0xA000) return 0xFF00; // SP-relative, ADR
+    if ((half & 0xFF00) == 0xB000) return 0xFF80; // ADD/SUB SP, #imm7
+    if ((half & 0xF500) == 0xB100) return 0xFD07; // CBZ/CBNZ
+    if ((half & 0xF000) == 0xD000 && (half & 0x0E00) != 0x0E00) return 0xFF00; // B<cond>
+    if ((half & 0xF800) == 0xE000) return 0xF800; // B
+    return 0xFFFF;
+}
+
+uint32_t stable_thumb32_bits(uint32_t word) {
+    uint32_t first = word >> 16;
+    uint32_t second = word & 0xFFFF;
+    if ((first & 0xF800) == 0xF000) {
+        if (second & 0x8000) {
+            if (second & 0x5000) return 0xF800D000;                // B.W, BL, BLX
+            if ((first & 0x0380) != 0x0380) return 0xFBC0D000;     // B<cond>.W
+            return 0xFFFFFFFF;                                     // MSR, MRS, ...
+        }
+        bool plain = first & 0x0200;
+        uint32_t op = first & 0x01F0;
+        if (plain && op != 0x0040 && op != 0x00C0 && op != 0x0000 && op != 0x00A0) {
+            return 0xFFFFFFFF; // Bitfield and saturate: no address or constant in them
+        }
+        // Modified immediates, MOVW/MOVT (imm4 too) and ADDW/SUBW/ADR.W
+        uint32_t keep_first = plain && (op == 0x0040 || op == 0x00C0) ? 0xFBF0 : 0xFBFF;
+        return keep_first << 16 | 0x8F00;
+    }
+    if ((first & 0xFE1F) == 0xF81F || (first & 0xFE80) == 0xF880) return 0xFFFFF000; // imm12, literal
+    if ((first & 0xFE80) == 0xF800 && (second & 0x0800)) return 0xFFFFFF00;          // [Rn, #+/-imm8]
+    if ((first & 0xFE40) == 0xE840) return 0xFFFFFF00;                               // LDRD/STRD/LDREX
+    if ((first & 0xFF20) == 0xED00 && (second & 0x0E00) == 0x0A00) return 0xFFFFFF00; // VLDR/VSTR
+    return 0xFFFFFFFF;
+}
+
+bool ends_block(const DisassembledInstruction& instr) {
+    return instr.branch_kind != BranchKind::None && instr.branch_kind != BranchKind::Call &&
+           instr.branch_kind != BranchKind::IndirectCall;
+}
+
+// Fingerprints one function from its decoded instructions, in address order.
+FunctionFingerprint fingerprint(const std::vector<DisassembledInstruction>& code, bool thumb,
+                                uint64_t start, uint64_t end, std::vector<uint64_t>& leaders) {
+    FunctionFingerprint result;
+    result.instructions = static_cast<uint32_t>(code.size());
+    if (code.empty()) return result;
+
+    leaders.clear();
+    leaders.push_back(code.front().address);
+    for (size_t i = 0; i < code.size(); ++i) {
+        const DisassembledInstruction& instr = code[i];
+        if (instr.branch_kind == BranchKind::Call || instr.branch_kind == BranchKind::IndirectCall) ++result.calls;
+        if (!ends_block(instr)) continue;
+        if (instr.branch_kind == BranchKind::Jump && instr.branch_target >= start && instr.branch_target < end) {
+            leaders.push_back(instr.branch_target);
+        }
+        if (i + 1 < code.size()) leaders.push_back(code[i + 1].address);
+    }
+    std::sort(leaders.begin(), leaders.end());
+    leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+
+    // Walk the blocks; a target in the middle of an instruction (or in a
+    // skipped data run) does not start one
+    uint64_t shape = 0;
+    auto is_leader = [&](uint64_t address) { return std::binary_search(leaders.begin(), leaders.end(), address); };
+    auto in_code = [&](uint64_t address) {
+        auto it = std::lower_bound(code.begin(), code.end(), address,
+            [](const DisassembledInstruction& instr, uint64_t value) { return instr.address < value; });
+        return it != code.end() && it->address == address;
+    };
+    for (size_t i = 0; i < code.size(); ++i) {
+        const DisassembledInstruction& instr = code[i];
+        if (i == 0 || is_leader(instr.address)) ++result.blocks;
+        bool last_in_block = i + 1 == code.size() || is_leader(code[i + 1].address);
+        if (!last_in_block) continue;
+        uint32_t successors = 0;
+        bool falls_through = !ends_block(instr) || instr.is_conditional;
+        if (falls_through && i + 1 < code.size()) ++successors;
+        if (instr.branch_kind == BranchKind::Jump && instr.branch_target >= start && instr.branch_target < end &&
+            in_code(instr.branch_target)) {
+            ++successors;
+        }
+        result.edges += successors;
+        shape = combine(shape, successors);
+    }
+    result.hash = normalized_code_hash(code, thumb);
+    result.shape = combine(combine(combine(shape, result.blocks), result.edges), result.calls);
+    return result;
+}
+
+// Symbol name of a function, or empty if it has none.
+std::string_view function_name(const FunctionDiffInput& input, uint32_t index) {
+    int32_t symbol = input.functions.function(index).symbol_index;
+    return symbol >= 0 ? input.parser.get_symbols()[symbol].name : std::string_view();
+}
+
+struct Candidates {
+    std::vector<int64_t> old_match; // Per old function: new index or -1
+    std::vector<int64_t> new_match;
+};
+
+// Pairs still-unmatched functions by key. A key held by one function on
+// each side pairs them; with `pair_groups`, a key held by equally many on
+// both sides pairs them in address order (copies of one inline helper,
+// say). Keys with unequal counts stay unmatched.
+template <typename KeyOf, typename Accept>
+void match_by_key(size_t old_count, size_t new_count, Candidates& candidates,
+                  std::vector<FunctionMatch>& new_matched_by, FunctionMatch kind, bool pair_groups,
+                  KeyOf old_key, KeyOf new_key, Accept accept) {
+    struct Group {
+        std::vector<uint32_t> old_indices, new_indices; // Ascending, so in address order
+    };
+    std::unordered_map<uint64_t, Group> groups;
+    uint64_t key;
+    for (size_t i = 0; i < old_count; ++i) {
+        if (candidates.old_match[i] >= 0 || !old_key(i, key)) continue;
+        groups[key].old_indices.push_back(static_cast<uint32_t>(i));
+    }
+    for (size_t i = 0; i < new_count; ++i) {
+        if (candidates.new_match[i] >= 0 || !new_key(i, key)) continue;
+        auto it = groups.find(key);
+        if (it != groups.end()) it->second.new_indices.push_back(static_cast<uint32_t>(i));
+    }
+    for (const auto& [group_key, group] : groups) {
+        size_t size = group.old_indices.size();
+        if (size != group.new_indices.size() || (size > 1 && !pair_groups)) continue;
+        for (size_t i = 0; i < size; ++i) {
+            uint32_t old_index = group.old_indices[i], new_index = group.new_indices[i];
+            if (!accept(old_index, new_index)) continue;
+            candidates.old_match[old_index] = new_index;
+            candidates.new_match[new_index] = old_index;
+            new_matched_by[new_index] = kind;
+        }
+    }
+}
+
+// Pairs the unmatched functions lying between two consecutive matched
+// pairs when both gaps hold equally many, in order: code whose neighbours
+// are in place but whose own shape changed too much for the other steps.
+void match_gaps(Candidates& candidates, std::vector<FunctionMatch>& new_matched_by) {
+    const int64_t old_count = static_cast<int64_t>(candidates.old_match.size());
+    const int64_t new_count = static_cast<int64_t>(candidates.new_match.size());
+    int64_t previous_new = -1, previous_old = -1;
+    for (int64_t i = 0; i <= new_count; ++i) {
+        int64_t old_index = i < new_count ? candidates.new_match[i] : old_count;
+        if (old_index < 0) continue;
+        int64_t gap = i - previous_new - 1;
+        if (gap > 0 && old_index - previous_old - 1 == gap) {
+            bool free = true;
+            for (int64_t k = 1; k <= gap && free; ++k) free = candidates.old_match[previous_old + k] < 0;
+            for (int64_t k = 1; free && k <= gap; ++k) {
+                candidates.new_match[previous_new + k] = previous_old + k;
+                candidates.old_match[previous_old + k] = previous_new + k;
+                new_matched_by[previous_new + k] = FunctionMatch::Neighbours;
+            }
+        }
+        previous_new = i;
+        previous_old = old_index;
+    }
+}
+
+} // namespace
+
+uint32_t stable_encoding_bits(uint32_t encoding, uint32_t size, bool thumb) {
+    if (!thumb) return stable_arm_bits(encoding);
+    return size == 2 ? stable_thumb16_bits(encoding) : stable_thumb32_bits(encoding);
+}
+
+uint64_t normalized_code_hash(const std::vector<DisassembledInstruction>& code, bool thumb) {
+    uint64_t hash = 0;
+    for (const DisassembledInstruction& instr : code) {
+        hash = combine(hash, instr.bytes & stable_encoding_bits(instr.bytes, instr.size, thumb));
+    }
+    return combine(hash, code.size());
+}
+
+std::vector<FunctionFingerprint> fingerprint_functions(const FunctionDiffInput& input, TaskScheduler& scheduler,
+                                                       TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("diff.fingerprint");
+    std::vector<FunctionFingerprint> fingerprints(input.functions.size());
+    scheduler.parallel_for(fingerprints.size(), 64, [&](size_t begin, size_t end) {
+        ArmDisassembler disassembler;
+        std::vector<DisassembledInstruction> code, run_code;
+        std::vector<uint64_t> leaders;
+        for (size_t i = begin; i < end; ++i) {
+            const FunctionInfo& info = input.functions.function(static_cast<uint32_t>(i));
+            code.clear();
+            for (const auto& run : input.mode_map.runs(info.start, info.end)) {
+                if (run.mode == CodeMode::Data) continue;
+                uint64_t align = info.thumb ? 2 : 4;
+                uint64_t run_start = (run.start + align - 1) & ~(align - 1);
+                if (run_start >= run.end) continue;
+                const uint8_t* data = input.parser.get_data_at_address(run_start, run.end - run_start);
+                if (!data) continue;
+                disassembler.disassemble_block_into(data, run.end - run_start, run_start, info.thumb, run_code);
+                code.insert(code.end(), run_code.begin(), run_code.end());
+            }
+            fingerprints[i] = fingerprint(code, info.thumb, info.start, info.end, leaders);
+        }
+    }, priority);
+    return fingerprints;
+}
+
+FunctionDiffResult diff_functions(const FunctionDiffInput& old_input, const FunctionDiffInput& new_input,
+                                  TaskScheduler& scheduler, TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("diff.functions");
+    std::vector<FunctionFingerprint> old_prints = fingerprint_functions(old_input, scheduler, priority);
+    std::vector<FunctionFingerprint> new_prints = fingerprint_functions(new_input, scheduler, priority);
+    const size_t old_count = old_prints.size();
+    const size_t new_count = new_prints.size();
+
+    Candidates candidates{std::vector<int64_t>(old_count, -1), std::vector<int64_t>(new_count, -1)};
+    std::vector<FunctionMatch> matched_by(new_count, FunctionMatch::None);
+    auto accept_any = [](uint32_t, uint32_t) { return true; };
+
+    // Local symbols can share a name (static functions of different
+    // files); equally many on both sides pair up in address order
+    using KeyOf = std::function<bool(size_t, uint64_t&)>;
+    auto name_key = [](const FunctionDiffInput& input) {
+        return KeyOf([&input](size_t i, uint64_t& key) {
+            std::string_view name = function_name(input, static_cast<uint32_t>(i));
+            if (name.empty()) return false;
+            key = std::hash<std::string_view>()(name);
+            return true;
+        });
+    };
+    match_by_key(old_count, new_count, candidates, matched_by, FunctionMatch::Symbol, true,
+                 name_key(old_input), name_key(new_input), [&](uint32_t old_index, uint32_t new_index) {
+                     return function_name(old_input, old_index) == function_name(new_input, new_index);
+                 });
+
+    auto print_key = [](const std::vector<FunctionFingerprint>& prints, bool shape) {
+        return KeyOf([&prints, shape](size_t i, uint64_t& key) {
+            if (prints[i].instructions == 0) return false;
+            key = shape ? prints[i].shape : prints[i].hash;
+            return true;
+        });
+    };
+    match_by_key(old_count, new_count, candidates, matched_by, FunctionMatch::Hash, true,
+                 print_key(old_prints, false), print_key(new_prints, false), accept_any);
+    match_by_key(old_count, new_count, candidates, matched_by, FunctionMatch::Shape, false,
+                 print_key(old_prints, true), print_key(new_prints, true),
+                 [&](uint32_t old_index, uint32_t new_index) {
+                     uint32_t a = old_prints[old_index].instructions, b = new_prints[new_index].instructions;
+                     return std::min(a, b) * 2 >= std::max(a, b);
+                 });
+    match_gaps(candidates, matched_by);
+
+    FunctionDiffResult result;
+    result.entries.reserve(new_count + old_count);
+    for (size_t i = 0; i < new_count; ++i) {
+        int64_t old_index = candidates.new_match[i];
+        if (old_index < 0) {
+            result.entries.push_back({FunctionChange::Added, FunctionMatch::None, -1, static_cast<int64_t>(i)});
+            ++result.added;
+            continue;
+        }
+        bool same = old_prints[old_index].hash == new_prints[i].hash;
+        result.entries.push_back({same ? FunctionChange::Unchanged : FunctionChange::Changed, matched_by[i],
+                                  old_index, static_cast<int64_t>(i)});
+        ++(same ? result.unchanged : result.changed);
+    }
+    for (size_t i = 0; i < old_count; ++i) {
+        if (candidates.old_match[i] >= 0) continue;
+        result.entries.push_back({FunctionChange::Removed, FunctionMatch::None, static_cast<int64_t>(i), -1});
+        ++result.removed;
+    }
+    log_info("Function diff: " + std::to_string(result.unchanged) + " unchanged, " +
+             std::to_string(result.changed) + " changed, " + std::to_string(result.added) + " added, " +
+             std::to_string(result.removed) + " removed");
+    return result;
+}
+
+std::unique_ptr<FunctionTable> build_function_table(const ElfParser& parser, const ModeMap& mode_map,
+                                                    TaskScheduler& scheduler, TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("diff.function_table");
+    std::vector<SweepChunk> chunks = plan_sweep_chunks(parser, mode_map, executable_section_indices(parser));
+    XrefIndex xrefs;
+    std::mutex merge_mutex;
+    ObjectPool<std::vector<DisassembledInstruction>> buffers;
+    scheduler.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+        ArmDisassembler disassembler;
+        std::vector<Xref> local_xrefs;
+        std::vector<DisassembledInstruction>* buffer = buffers.acquire();
+        for (size_t i = begin; i < end; ++i) {
+            sweep_chunk(parser, disassembler, chunks[i],
+                [&](size_t, const std::vector<DisassembledInstruction>& instructions) {
+                    XrefIndex::collect(parser, instructions, local_xrefs);
+                }, *buffer);
+        }
+        buffers.release(buffer);
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        xrefs.add(local_xrefs);
+    }, priority);
+    xrefs.finalize();
+    return std::make_unique<FunctionTable>(parser, mode_map, xrefs.targets_of_kind(XrefKind::Call));
+}
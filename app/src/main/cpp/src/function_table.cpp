@@ -0,0 +1,474 @@
+#include "../include/function_table.h"
+#include "../include/arm_disassembler.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint16_t EM_ARM = 40;
+
+struct Candidate {
+    uint64_t start;
+    uint64_t size;        // 0 when unknown
+    int32_t symbol_index; // -1 when unnamed
+    uint8_t sources;
+    int8_t thumb;         // -1 when the source does not say
+};
+
+// DWARF exception-header pointer encodings (.eh_frame / .eh_frame_hdr)
+constexpr uint8_t DW_EH_PE_omit    = 0xFF;
+constexpr uint8_t DW_EH_PE_absptr  = 0x00;
+constexpr uint8_t DW_EH_PE_uleb128 = 0x01;
+constexpr uint8_t DW_EH_PE_udata2  = 0x02;
+constexpr uint8_t DW_EH_PE_udata4  = 0x03;
+constexpr uint8_t DW_EH_PE_udata8  = 0x04;
+constexpr uint8_t DW_EH_PE_sleb128 = 0x09;
+constexpr uint8_t DW_EH_PE_sdata2  = 0x0A;
+constexpr uint8_t DW_EH_PE_sdata4  = 0x0B;
+constexpr uint8_t DW_EH_PE_sdata8  = 0x0C;
+constexpr uint8_t DW_EH_PE_pcrel   = 0x10;
+constexpr uint8_t DW_EH_PE_datarel = 0x30;
+
+// Little-endian cursor over section bytes that remembers the section's
+// virtual address, for pc-relative pointers. Reads past the end set failed.
+class SectionReader {
+public:
+    SectionReader(const uint8_t* data, size_t size, uint64_t address, bool is_64bit)
+        : data_(data), size_(size), address_(address), is_64bit_(is_64bit) {}
+
+    bool failed() const { return failed_; }
+    size_t position() const { return position_; }
+    void seek(size_t position) { position_ = position; failed_ = position > size_; }
+
+    uint64_t read(size_t bytes) {
+        if (failed_ || size_ - position_ < bytes) {
+            failed_ = true;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(data_[position_ + i]) << (8 * i);
+        }
+        position_ += bytes;
+        return value;
+    }
+
+    uint64_t uleb() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; !failed_; shift += 7) {
+            uint64_t byte = read(1);
+            if (shift < 64) value |= (byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        return value;
+    }
+
+    int64_t sleb() {
+        int64_t value = 0;
+        unsigned shift = 0;
+        uint64_t byte = 0;
+        do {
+            byte = read(1);
+            if (shift < 64) value |= static_cast<int64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while ((byte & 0x80) && !failed_);
+        if (shift < 64 && (byte & 0x40)) value |= -(static_cast<int64_t>(1) << shift);
+        return value;
+    }
+
+    std::string c_string() {
+        std::string text;
+        while (!failed_) {
+            char c = static_cast<char>(read(1));
+            if (c == '\0') break;
+            text += c;
+        }
+        return text;
+    }
+
+    // Reads a pointer in `encoding`; returns false for omitted or
+    // unsupported encodings (indirect, textrel, funcrel, aligned).
+    bool encoded(uint8_t encoding, uint64_t data_base, uint64_t& value) {
+        if (encoding == DW_EH_PE_omit) return false;
+        uint64_t field_address = address_ + position_;
+        switch (encoding & 0x0F) {
+            case DW_EH_PE_absptr:  value = read(is_64bit_ ? 8 : 4); break;
+            case DW_EH_PE_uleb128: value = uleb(); break;
+            case DW_EH_PE_udata2:  value = read(2); break;
+            case DW_EH_PE_udata4:  value = read(4); break;
+            case DW_EH_PE_udata8:  value = read(8); break;
+            case DW_EH_PE_sleb128: value = static_cast<uint64_t>(sleb()); break;
+            case DW_EH_PE_sdata2:  value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(read(2)))); break;
+            case DW_EH_PE_sdata4:  value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(read(4)))); break;
+            case DW_EH_PE_sdata8:  value = read(8); break;
+            default: return false;
+        }
+        switch (encoding & 0x70) {
+            case 0: break;
+            case DW_EH_PE_pcrel:   value += field_address; break;
+            case DW_EH_PE_datarel: value += data_base; break;
+            default: return false;
+        }
+        if (encoding & 0x80) return false; // Indirect
+        if (!is_64bit_) value &= 0xFFFFFFFFULL;
+        return !failed_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    uint64_t address_;
+    bool is_64bit_;
+    size_t position_ = 0;
+    bool failed_ = false;
+};
+
+void add_start(std::vector<Candidate>& out, uint64_t address, uint64_t size, uint8_t source, bool thumb_known) {
+    int8_t thumb = thumb_known ? static_cast<int8_t>(address & 1) : -1;
+    out.push_back({address & ~1ULL, size, -1, source, thumb});
+}
+
+// .ARM.exidx: pairs of words; the first is a prel31 offset to the function
+// start, including the Thumb bit.
+void read_arm_exidx(const ElfParser& parser, size_t section_index, std::vector<Candidate>& out) {
+    const SectionHeader& sh = parser.get_section_headers()[section_index];
+    const uint8_t* data = parser.get_section_data_by_index(section_index);
+    if (data == nullptr) return;
+
+    for (uint64_t offset = 0; offset + 8 <= sh.sh_size; offset += 8) {
+        uint32_t word;
+        memcpy(&word, data + offset, sizeof(word));
+        if (word & 0x80000000) continue;
+        int32_t prel31 = static_cast<int32_t>(word << 1) >> 1;
+        uint32_t function = static_cast<uint32_t>(sh.sh_addr + offset + prel31);
+        add_start(out, function, 0, FUNCTION_FROM_EXIDX, true);
+    }
+}
+
+// FDE pointer encoding from a CIE's augmentation data ("zR...").
+uint8_t read_cie_encoding(SectionReader& reader, size_t cie_offset) {
+    reader.seek(cie_offset);
+    uint64_t length = reader.read(4);
+    if (length == 0xFFFFFFFF) reader.read(8);
+    uint64_t id = (length == 0xFFFFFFFF) ? reader.read(8) : reader.read(4);
+    if (reader.failed() || id != 0) return DW_EH_PE_omit;
+
+    uint8_t version = static_cast<uint8_t>(reader.read(1));
+    std::string augmentation = reader.c_string();
+    reader.uleb();  // Code alignment
+    reader.sleb();  // Data alignment
+    if (version == 1) reader.read(1); else reader.uleb(); // Return address register
+
+    uint8_t fde_encoding = DW_EH_PE_absptr;
+    if (augmentation.empty() || augmentation[0] != 'z') return fde_encoding;
+    reader.uleb(); // Augmentation data length
+    for (size_t i = 1; i < augmentation.size() && !reader.failed(); ++i) {
+        switch (augmentation[i]) {
+            case 'R':
+                fde_encoding = static_cast<uint8_t>(reader.read(1));
+                break;
+            case 'P': {
+                uint8_t personality_encoding = static_cast<uint8_t>(reader.read(1));
+                uint64_t ignored;
+                reader.encoded(personality_encoding & 0x7F, 0, ignored);
+                break;
+            }
+            case 'L':
+                reader.read(1);
+                break;
+            case 'S':
+            case 'B':
+                break;
+            default:
+                return fde_encoding; // Unknown augmentation; what we have is still usable
+        }
+    }
+    return fde_encoding;
+}
+
+void read_eh_frame(const ElfParser& parser, size_t section_index, std::vector<Candidate>& out) {
+    const SectionHeader& sh = parser.get_section_headers()[section_index];
+    const uint8_t* data = parser.get_section_data_by_index(section_index);
+    if (data == nullptr) return;
+
+    bool is_64bit = parser.get_header().is_64bit;
+    SectionReader reader(data, sh.sh_size, sh.sh_addr, is_64bit);
+    SectionReader cie_reader(data, sh.sh_size, sh.sh_addr, is_64bit);
+    std::unordered_map<size_t, uint8_t> cie_encodings;
+
+    size_t offset = 0;
+    while (offset + 4 <= sh.sh_size) {
+        reader.seek(offset);
+        uint64_t length = reader.read(4);
+        if (length == 0) break; // Terminator
+        bool extended = length == 0xFFFFFFFF;
+        if (extended) length = reader.read(8);
+        size_t content = reader.position();
+        if (reader.failed() || length > sh.sh_size - content) break;
+        size_t next = content + static_cast<size_t>(length);
+
+        uint64_t id = extended ? reader.read(8) : reader.read(4);
+        if (id != 0 && id <= content) {
+            size_t cie_offset = content - static_cast<size_t>(id);
+            auto it = cie_encodings.find(cie_offset);
+            if (it == cie_encodings.end()) {
+                it = cie_encodings.emplace(cie_offset, read_cie_encoding(cie_reader, cie_offset)).first;
+            }
+            uint64_t pc_begin, pc_range;
+            if (reader.encoded(it->second, 0, pc_begin) &&
+                reader.encoded(it->second & 0x0F, 0, pc_range) && pc_begin != 0) {
+                add_start(out, pc_begin, pc_range, FUNCTION_FROM_EH_FRAME, (pc_begin & 1) != 0);
+            }
+        }
+        offset = next;
+    }
+}
+
+// .eh_frame_hdr: sorted (initial location, FDE address) table, datarel to the header.
+void read_eh_frame_hdr(const ElfParser& parser, size_t section_index, std::vector<Candidate>& out) {
+    const SectionHeader& sh = parser.get_section_headers()[section_index];
+    const uint8_t* data = parser.get_section_data_by_index(section_index);
+    if (data == nullptr) return;
+
+    SectionReader reader(data, sh.sh_size, sh.sh_addr, parser.get_header().is_64bit);
+    uint8_t version = static_cast<uint8_t>(reader.read(1));
+    uint8_t frame_pointer_encoding = static_cast<uint8_t>(reader.read(1));
+    uint8_t count_encoding = static_cast<uint8_t>(reader.read(1));
+    uint8_t table_encoding = static_cast<uint8_t>(reader.read(1));
+    uint64_t frame_pointer, count;
+    if (version != 1 || !reader.encoded(frame_pointer_encoding, sh.sh_addr, frame_pointer) ||
+        !reader.encoded(count_encoding, sh.sh_addr, count) || table_encoding == DW_EH_PE_omit) {
+        return;
+    }
+
+    for (uint64_t i = 0; i < count && !reader.failed(); ++i) {
+        uint64_t initial_location, fde_address;
+        if (!reader.encoded(table_encoding, sh.sh_addr, initial_location) ||
+            !reader.encoded(table_encoding, sh.sh_addr, fde_address)) {
+            break;
+        }
+        if (initial_location != 0) {
+            add_start(out, initial_location, 0, FUNCTION_FROM_EH_FRAME, (initial_location & 1) != 0);
+        }
+    }
+}
+
+bool is_flow_end(const DisassembledInstruction& instr) {
+    switch (instr.branch_kind) {
+        case BranchKind::Jump:
+        case BranchKind::IndirectJump:
+        case BranchKind::Return:
+            return !instr.is_conditional;
+        default:
+            return false;
+    }
+}
+
+bool is_padding(const DisassembledInstruction& instr) {
+    return instr.bytes == 0 || instr.mnemonic == "NOP";
+}
+
+bool is_prologue(const uint8_t* bytes, size_t available, bool thumb) {
+    if (thumb) {
+        uint16_t hw = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+        if ((hw & 0xFF00) == 0xB500) return true; // PUSH {..., LR}
+        if (hw == 0xE92D && available >= 4) {     // PUSH.W {..., LR}
+            uint16_t hw2 = static_cast<uint16_t>(bytes[2] | (bytes[3] << 8));
+            return (hw2 & 0xC000) == 0x4000;
+        }
+        return false;
+    }
+    if (available < 4) return false;
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return (word & 0xFFFF4000) == 0xE92D4000; // STMFD SP!, {..., LR}
+}
+
+// True if code at `address` could start a function: the instruction before
+// it ends control flow or is padding.
+bool follows_terminator(const ElfParser& parser, ArmDisassembler& disassembler,
+                        uint64_t address, uint64_t region_start, bool thumb) {
+    if (address == region_start) return true;
+    const size_t lengths[] = {thumb ? size_t{2} : size_t{4}, size_t{4}};
+    for (size_t length : lengths) {
+        if (address - region_start < length) continue;
+        const uint8_t* bytes = parser.get_data_at_address(address - length, length);
+        if (bytes == nullptr) continue;
+        DisassembledInstruction previous = disassembler.decode_one(bytes, length, address - length, thumb);
+        if (previous.size == length && (is_flow_end(previous) || is_padding(previous))) return true;
+        if (!thumb) break;
+    }
+    return false;
+}
+
+} // namespace
+
+FunctionTable::FunctionTable(const ElfParser& parser, const ModeMap& mode_map,
+                             const std::vector<uint64_t>& call_targets)
+    : parser_(parser) {
+    const auto& sections = parser.get_section_headers();
+    const auto& symbols = parser.get_symbols();
+    std::vector<Candidate> candidates;
+
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const SymbolEntry& symbol = symbols[i];
+        if ((symbol.st_info & 0xF) != STT_FUNC || symbol.st_shndx == SHN_UNDEF || symbol.st_value == 0) continue;
+        candidates.push_back({symbol.st_value & ~1ULL, symbol.st_size, static_cast<int32_t>(i),
+                              FUNCTION_FROM_SYMBOL, static_cast<int8_t>(symbol.st_value & 1)});
+    }
+    for (size_t i = 0; i < sections.size(); ++i) {
+        // SHT_ARM_EXIDX shares its value with other processors' unwind types
+        if (sections[i].name == ".eh_frame") {
+            read_eh_frame(parser, i, candidates);
+        } else if (sections[i].name == ".eh_frame_hdr") {
+            read_eh_frame_hdr(parser, i, candidates);
+        } else if (sections[i].sh_type == SHT_ARM_EXIDX && parser.get_header().e_machine == EM_ARM) {
+            read_arm_exidx(parser, i, candidates);
+        }
+    }
+    for (uint64_t target : call_targets) {
+        add_start(candidates, target, 0, FUNCTION_FROM_CALL, false);
+    }
+
+    auto in_code = [&](uint64_t address) {
+        int index = parser.find_section_by_address(address);
+        return index >= 0 && (sections[index].sh_flags & SHF_EXECINSTR) &&
+               parser.get_section_data_by_index(index) != nullptr;
+    };
+
+    // Merge candidates into sorted, non-overlapping functions
+    auto merge = [&]() {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+            [&](const Candidate& c) { return !in_code(c.start); }), candidates.end());
+        std::stable_sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.start < b.start; });
+
+        functions_.clear();
+        uint64_t sized_end = 0; // End of the last function whose size is known
+        for (size_t i = 0; i < candidates.size();) {
+            const uint64_t start = candidates[i].start;
+            FunctionInfo info{start, 0, -1, 0, false};
+            uint64_t size = 0;
+            int8_t thumb = -1;
+            for (; i < candidates.size() && candidates[i].start == start; ++i) {
+                const Candidate& c = candidates[i];
+                info.sources |= c.sources;
+                // A symbol's size wins over an FDE range
+                if (c.size != 0 && (size == 0 || (c.sources & FUNCTION_FROM_SYMBOL))) size = c.size;
+                if (c.symbol_index >= 0 && (info.symbol_index < 0 || symbols[info.symbol_index].name.empty())) {
+                    info.symbol_index = c.symbol_index;
+                }
+                if (thumb < 0) thumb = c.thumb;
+            }
+            // Unsized starts (calls, prologues, exidx) inside a function of
+            // known size are internal branches and code after early returns
+            if (start < sized_end && size == 0 && !(info.sources & FUNCTION_FROM_SYMBOL)) continue;
+            info.thumb = thumb >= 0 ? thumb != 0 : mode_map.mode_at(start) == CodeMode::Thumb;
+            info.end = start + size; // Fixed up below when size is unknown
+            if (size != 0) sized_end = std::max(sized_end, info.end);
+            functions_.push_back(info);
+        }
+
+        // Unknown sizes run to the next start. Known ones can only be cut by
+        // a symbol or a sized FDE inside them, which keeps the table
+        // non-overlapping.
+        for (size_t i = 0; i < functions_.size(); ++i) {
+            FunctionInfo& info = functions_[i];
+            const SectionHeader& sh = sections[parser.find_section_by_address(info.start)];
+            uint64_t limit = sh.sh_addr + sh.sh_size;
+            if (i + 1 < functions_.size()) limit = std::min(limit, functions_[i + 1].start);
+            if (info.end == info.start || info.end > limit) info.end = limit;
+        }
+    };
+    merge();
+
+    // Prologue scan over code no function covers yet
+    ArmDisassembler disassembler;
+    size_t prologue_starts = 0;
+    for (size_t section_index : executable_section_indices(parser)) {
+        const SectionHeader& sh = sections[section_index];
+        uint64_t section_end = sh.sh_addr + sh.sh_size;
+        auto next = std::lower_bound(functions_.begin(), functions_.end(), sh.sh_addr,
+            [](const FunctionInfo& f, uint64_t address) { return f.start < address; });
+        // End of coverage by an earlier function that may reach into this section
+        uint64_t gap_start = sh.sh_addr;
+        if (next != functions_.begin()) gap_start = std::max(gap_start, std::prev(next)->end);
+
+        while (gap_start < section_end) {
+            uint64_t gap_end = (next != functions_.end() && next->start < section_end) ? next->start : section_end;
+            for (const auto& run : mode_map.runs(gap_start, gap_end)) {
+                if (run.mode == CodeMode::Data) continue;
+                bool thumb = run.mode == CodeMode::Thumb;
+                uint64_t align = thumb ? 2 : 4;
+                for (uint64_t address = (run.start + align - 1) & ~(align - 1); address + align <= run.end;
+                     address += align) {
+                    const uint8_t* bytes = parser.get_data_at_address(address, run.end - address);
+                    if (bytes == nullptr) break;
+                    if (is_prologue(bytes, run.end - address, thumb) &&
+                        follows_terminator(parser, disassembler, address, gap_start, thumb)) {
+                        candidates.push_back({address, 0, -1, FUNCTION_FROM_PROLOGUE, static_cast<int8_t>(thumb)});
+                        ++prologue_starts;
+                    }
+                }
+            }
+            if (next == functions_.end() || next->start >= section_end) break;
+            gap_start = std::max(gap_end, next->end);
+            ++next;
+        }
+    }
+    if (prologue_starts > 0) merge();
+
+    memory_.set(capacity_bytes(functions_));
+    log_info("Function table built: " + std::to_string(functions_.size()) + " functions (" +
+             std::to_string(prologue_starts) + " from prologues)");
+}
+
+long FunctionTable::find_containing(uint64_t address) const {
+    auto it = std::upper_bound(functions_.begin(), functions_.end(), address,
+        [](uint64_t value, const FunctionInfo& f) { return value < f.start; });
+    if (it == functions_.begin()) return -1;
+    --it;
+    if (address >= it->end) return -1;
+    return static_cast<long>(it - functions_.begin());
+}
+
+std::string FunctionTable::name(uint32_t index) const {
+    const FunctionInfo& info = functions_[index];
+    if (info.symbol_index >= 0) {
+        std::string_view symbol_name = parser_.get_symbols()[info.symbol_index].name;
+        if (!symbol_name.empty()) return std::string(symbol_name);
+    }
+    if (!recovered_names_.empty() && !recovered_names_[index].empty()) {
+        return std::string(recovered_names_[index]);
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "sub_%llX", static_cast<unsigned long long>(info.start));
+    return buffer;
+}
+
+void FunctionTable::set_recovered_name(uint32_t index, std::string_view name) {
+    if (recovered_names_.empty()) {
+        recovered_names_.resize(functions_.size());
+        memory_.set(capacity_bytes(functions_) + capacity_bytes(recovered_names_));
+    }
+    if (recovered_names_[index].empty() && !name.empty()) ++recovered_count_;
+    if (!recovered_names_[index].empty() && name.empty()) --recovered_count_;
+    recovered_names_[index] = name.empty() ? std::string_view() : recovered_arena_.copy(name);
+}
+
+std::string_view FunctionTable::recovered_name(uint32_t index) const {
+    return recovered_names_.empty() ? std::string_view() : recovered_names_[index];
+}
+
+void FunctionTable::copy_recovered_names(const FunctionTable& other) {
+    for (uint32_t i = 0; i < other.recovered_names_.size(); ++i) {
+        if (other.recovered_names_[i].empty()) continue;
+        long index = find_containing(other.functions_[i].start);
+        if (index >= 0 && functions_[index].start == other.functions_[i].start) {
+            set_recovered_name(static_cast<uint32_t>(index), other.recovered_names_[i]);
+        }
+    }
+}
@@ -0,0 +1,464 @@
+#include "../include/instruction_search_index.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Terms carry their kind in the top 4 bits so one sorted key space holds all of them.
+enum TermKind : uint64_t {
+    kMnemonic = 1,
+    kWord = 2,
+    kRegister = 3,
+    kImmediate = 4,
+    kAddressGram = 5
+};
+
+constexpr uint64_t kPayloadMask = (1ULL << 60) - 1;
+constexpr unsigned kAddressBlockShift = 4; // Address trigrams are indexed per 16-byte block
+
+uint64_t make_term(TermKind kind, uint64_t payload) {
+    return (static_cast<uint64_t>(kind) << 60) | (payload & kPayloadMask);
+}
+
+// FNV-1a over the upper-cased word.
+uint64_t hash_word(std::string_view word) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (char c : word) {
+        if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == '[' || c == ']' ||
+           c == '{' || c == '}' || c == '!';
+}
+
+template<typename Fn>
+void for_each_token(std::string_view text, Fn&& fn) {
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && is_separator(text[i])) ++i;
+        size_t start = i;
+        while (i < text.size() && !is_separator(text[i])) ++i;
+        if (i > start) fn(text.substr(start, i - start));
+    }
+}
+
+bool parse_register(std::string_view token, uint64_t& reg) {
+    auto upper = [](char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c; };
+    if (token.size() == 2) {
+        char a = upper(token[0]), b = upper(token[1]);
+        if (a == 'S' && b == 'P') { reg = 13; return true; }
+        if (a == 'L' && b == 'R') { reg = 14; return true; }
+        if (a == 'P' && b == 'C') { reg = 15; return true; }
+    }
+    if ((token.size() == 2 || token.size() == 3) && upper(token[0]) == 'R') {
+        uint64_t value = 0;
+        for (size_t i = 1; i < token.size(); ++i) {
+            if (token[i] < '0' || token[i] > '9') return false;
+            value = value * 10 + (token[i] - '0');
+        }
+        if (value <= 15) { reg = value; return true; }
+    }
+    return false;
+}
+
+bool parse_immediate(std::string_view token, uint64_t& value) {
+    if (!token.empty() && token[0] == '#') token.remove_prefix(1);
+    bool negative = !token.empty() && token[0] == '-';
+    if (negative) token.remove_prefix(1);
+    if (token.empty() || token[0] < '0' || token[0] > '9') return false;
+
+    int base = 10;
+    if (token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X')) {
+        base = 16;
+        token.remove_prefix(2);
+    }
+    std::string digits(token);
+    char* end = nullptr;
+    uint64_t parsed = std::strtoull(digits.c_str(), &end, base);
+    if (end == digits.c_str() || *end != '\0') return false;
+    value = negative ? (0 - parsed) : parsed;
+    return true;
+}
+
+// Maps one operand/query token to a term; `leading_word` marks the mnemonic slot.
+bool token_to_term(std::string_view token, bool leading_word, uint64_t& term) {
+    uint64_t value = 0;
+    if (parse_immediate(token, value)) {
+        term = make_term(kImmediate, value);
+    } else if (parse_register(token, value)) {
+        term = make_term(kRegister, value);
+    } else if (token[0] == '#') {
+        return false;
+    } else {
+        term = make_term(leading_word ? kMnemonic : kWord, hash_word(token));
+    }
+    return true;
+}
+
+// Calls fn(term) for the mnemonic and every operand token of `instr`.
+template<typename Fn>
+void for_each_term(const DisassembledInstruction& instr, Fn&& fn) {
+    fn(make_term(kMnemonic, hash_word(instr.mnemonic)));
+    for_each_token(instr.operands, [&](std::string_view token) {
+        uint64_t term;
+        if (token_to_term(token, false, term)) fn(term);
+    });
+}
+
+std::string to_hex(uint64_t value) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// True if the lower-case hex form of `value` (no leading zeros) contains `fragment`.
+bool hex_contains(uint64_t value, std::string_view fragment) {
+    static const char kDigits[] = "0123456789abcdef";
+    char buffer[16];
+    size_t length = 0;
+    do {
+        buffer[15 - length++] = kDigits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    return std::string_view(buffer + 16 - length, length).find(fragment) != std::string_view::npos;
+}
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+uint64_t address_gram(std::string_view hex, size_t pos) {
+    return make_term(kAddressGram, (hex_digit(hex[pos]) << 8) | (hex_digit(hex[pos + 1]) << 4) | hex_digit(hex[pos + 2]));
+}
+
+// Intersects an ascending doc list with an ascending postings span, in place.
+void intersect(std::vector<uint32_t>& docs, const uint32_t* first, const uint32_t* last) {
+    size_t out = 0;
+    for (uint32_t doc : docs) {
+        first = std::lower_bound(first, last, doc);
+        if (first == last) break;
+        if (*first == doc) docs[out++] = doc;
+    }
+    docs.resize(out);
+}
+
+} // namespace
+
+uint32_t InstructionSearchIndex::term_id(uint64_t term) {
+    // try_emplace only makes a node for new terms; nodes are never freed
+    auto inserted = term_ids_.try_emplace(term, static_cast<uint32_t>(id_terms_.size()));
+    if (inserted.second) {
+        id_terms_.push_back(term);
+    }
+    return inserted.first->second;
+}
+
+void InstructionSearchIndex::add_instructions(const std::vector<DisassembledInstruction>& instructions) {
+    if (finalized_) {
+        log_error("add_instructions called on a finalized search index.");
+        return;
+    }
+
+    std::vector<uint32_t> doc_terms;
+    for (const auto& instr : instructions) {
+        doc_terms.clear();
+        for_each_term(instr, [&](uint64_t term) { doc_terms.push_back(term_id(term)); });
+
+        // "R0, R0" must not post the same document twice.
+        std::sort(doc_terms.begin(), doc_terms.end());
+        doc_terms.erase(std::unique(doc_terms.begin(), doc_terms.end()), doc_terms.end());
+
+        addresses_.push_back(instr.address);
+        pending_start_.push_back(static_cast<uint32_t>(pending_terms_.size()));
+        pending_terms_.insert(pending_terms_.end(), doc_terms.begin(), doc_terms.end());
+    }
+}
+
+void InstructionSearchIndex::finalize() {
+    if (finalized_) return;
+    const size_t doc_count = addresses_.size();
+    pending_start_.push_back(static_cast<uint32_t>(pending_terms_.size()));
+
+    // Renumber documents into address order so postings double as address order.
+    std::vector<uint32_t> order(doc_count);
+    std::iota(order.begin(), order.end(), 0u);
+    if (!std::is_sorted(addresses_.begin(), addresses_.end())) {
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return addresses_[a] < addresses_[b];
+        });
+    }
+    std::vector<uint64_t> sorted_addresses(doc_count);
+    for (uint32_t new_doc = 0; new_doc < doc_count; ++new_doc) {
+        sorted_addresses[new_doc] = addresses_[order[new_doc]];
+    }
+    addresses_ = std::move(sorted_addresses);
+
+    // The first instruction of every 16-byte block carries that block's
+    // address trigrams; these come out in ascending document order.
+    std::vector<std::pair<uint32_t, uint32_t>> grams; // (new doc, term id)
+    uint64_t previous_block = ~0ULL;
+    for (uint32_t doc = 0; doc < doc_count; ++doc) {
+        uint64_t block = addresses_[doc] >> kAddressBlockShift;
+        if (block == previous_block) continue;
+        previous_block = block;
+
+        std::string hex = to_hex(block);
+        for (size_t pos = 0; pos + 3 <= hex.size(); ++pos) {
+            grams.emplace_back(doc, term_id(address_gram(hex, pos)));
+        }
+    }
+
+    // Counting sort: term ids are ranked by term value, then every document's
+    // terms are scattered in ascending document order, which leaves each
+    // postings list sorted without a comparison sort over all postings.
+    const size_t term_count = id_terms_.size();
+    std::vector<uint32_t> by_term(term_count);
+    std::iota(by_term.begin(), by_term.end(), 0u);
+    std::sort(by_term.begin(), by_term.end(), [this](uint32_t a, uint32_t b) {
+        return id_terms_[a] < id_terms_[b];
+    });
+    std::vector<uint32_t> rank(term_count);
+    terms_.resize(term_count);
+    for (uint32_t r = 0; r < term_count; ++r) {
+        rank[by_term[r]] = r;
+        terms_[r] = id_terms_[by_term[r]];
+    }
+
+    offsets_.assign(term_count + 1, 0);
+    for (uint32_t id : pending_terms_) ++offsets_[rank[id] + 1];
+    for (const auto& gram : grams) ++offsets_[rank[gram.second] + 1];
+    for (size_t r = 0; r < term_count; ++r) offsets_[r + 1] += offsets_[r];
+
+    postings_.resize(offsets_[term_count]);
+    std::vector<uint32_t> cursor(offsets_.begin(), offsets_.end() - 1);
+    size_t next_gram = 0;
+    for (uint32_t doc = 0; doc < doc_count; ++doc) {
+        uint32_t old_doc = order[doc];
+        for (uint32_t i = pending_start_[old_doc]; i < pending_start_[old_doc + 1]; ++i) {
+            postings_[cursor[rank[pending_terms_[i]]]++] = doc;
+        }
+        for (; next_gram < grams.size() && grams[next_gram].first == doc; ++next_gram) {
+            postings_[cursor[rank[grams[next_gram].second]]++] = doc;
+        }
+    }
+
+    TermMap(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), term_ids_.get_allocator()).swap(term_ids_);
+    build_arena_.release();
+    std::vector<uint64_t>().swap(id_terms_);
+    std::vector<uint32_t>().swap(pending_terms_);
+    std::vector<uint32_t>().swap(pending_start_);
+    finalized_ = true;
+    memory_.set(capacity_bytes(addresses_, terms_, offsets_, postings_));
+
+    log_info("Instruction search index built: " + std::to_string(doc_count) +
+             " instructions, " + std::to_string(terms_.size()) + " terms, " +
+             std::to_string(postings_.size()) + " postings.");
+}
+
+void InstructionSearchIndex::replace_range(uint64_t start, uint64_t end,
+                                           const std::vector<DisassembledInstruction>& instructions) {
+    if (!finalized_) {
+        log_error("replace_range called before the search index was finalized.");
+        return;
+    }
+
+    auto by_address = [](const PatchedDocument& d, uint64_t a) { return d.address < a; };
+    auto first = std::lower_bound(patched_documents_.begin(), patched_documents_.end(), start, by_address);
+    auto last = std::lower_bound(first, patched_documents_.end(), end, by_address);
+    std::vector<PatchedDocument> documents;
+    for (const auto& instr : instructions) {
+        PatchedDocument document{instr.address, {}};
+        for_each_term(instr, [&](uint64_t term) { document.terms.push_back(term); });
+        std::sort(document.terms.begin(), document.terms.end());
+        document.terms.erase(std::unique(document.terms.begin(), document.terms.end()), document.terms.end());
+        documents.push_back(std::move(document));
+    }
+    first = patched_documents_.erase(first, last);
+    patched_documents_.insert(first, std::make_move_iterator(documents.begin()),
+                              std::make_move_iterator(documents.end()));
+
+    // Merge [start, end) into the sorted, disjoint replaced ranges
+    auto range = std::lower_bound(replaced_ranges_.begin(), replaced_ranges_.end(), start,
+        [](const std::pair<uint64_t, uint64_t>& r, uint64_t a) { return r.second < a; });
+    auto range_end = range;
+    while (range_end != replaced_ranges_.end() && range_end->first <= end) {
+        start = std::min(start, range_end->first);
+        end = std::max(end, range_end->second);
+        ++range_end;
+    }
+    range = replaced_ranges_.erase(range, range_end);
+    replaced_ranges_.insert(range, {start, end});
+
+    size_t patched_bytes = capacity_bytes(patched_documents_) + capacity_bytes(replaced_ranges_);
+    for (const auto& document : patched_documents_) patched_bytes += capacity_bytes(document.terms);
+    memory_.set(capacity_bytes(addresses_, terms_, offsets_, postings_) + patched_bytes);
+}
+
+std::pair<const uint32_t*, const uint32_t*> InstructionSearchIndex::postings_for(uint64_t term) const {
+    auto it = std::lower_bound(terms_.begin(), terms_.end(), term);
+    if (it == terms_.end() || *it != term) {
+        return {nullptr, nullptr};
+    }
+    size_t index = it - terms_.begin();
+    return {postings_.data() + offsets_[index], postings_.data() + offsets_[index + 1]};
+}
+
+std::vector<uint32_t> InstructionSearchIndex::address_candidates(
+    std::string_view hex_fragment, uint32_t first_doc, uint32_t last_doc) const {
+    std::vector<uint32_t> matches;
+    auto verify = [&](uint32_t doc) {
+        return hex_contains(addresses_[doc], hex_fragment);
+    };
+
+    // Any fragment of 4+ digits has its first trigram inside the block part
+    // of the address (everything but the last digit), so the trigram postings
+    // give every candidate block. Shorter fragments fall back to a scan.
+    if (hex_fragment.size() < 4) {
+        for (uint32_t doc = first_doc; doc < last_doc; ++doc) {
+            if (verify(doc)) matches.push_back(doc);
+        }
+        return matches;
+    }
+
+    std::vector<uint32_t> blocks;
+    for (size_t pos = 0; pos + 3 <= hex_fragment.size() - 1; ++pos) {
+        auto span = postings_for(address_gram(hex_fragment, pos));
+        if (span.first == nullptr) return matches;
+        if (pos == 0) {
+            blocks.assign(span.first, span.second);
+        } else {
+            intersect(blocks, span.first, span.second);
+        }
+    }
+
+    for (uint32_t block_doc : blocks) {
+        uint64_t block = addresses_[block_doc] >> kAddressBlockShift;
+        for (uint32_t doc = std::max(block_doc, first_doc);
+             doc < last_doc && (addresses_[doc] >> kAddressBlockShift) == block; ++doc) {
+            if (verify(doc)) matches.push_back(doc);
+        }
+    }
+    return matches;
+}
+
+InstructionSearchResult InstructionSearchIndex::search(const std::string& query, uint64_t range_start,
+                                                       uint64_t range_end, size_t offset, size_t limit) const {
+    InstructionSearchResult result;
+    if (!finalized_) return result;
+
+    std::vector<uint64_t> terms;
+    std::vector<std::string> address_fragments;
+    bool leading = true;
+    bool unusable = false;
+    for_each_token(query, [&](std::string_view token) {
+        if (token[0] == '@') {
+            std::string fragment;
+            for (char c : token.substr(1)) {
+                if (c == 'x' || c == 'X') continue; // Allow "@0x..."
+                if (hex_digit(c) < 0) { unusable = true; return; }
+                fragment += static_cast<char>(c >= 'A' && c <= 'F' ? c - 'A' + 'a' : c);
+            }
+            // "@0x00401a" style input: leading zeros never appear in the hex form.
+            size_t nonzero = fragment.find_first_not_of('0');
+            fragment = nonzero == std::string::npos ? "0" : fragment.substr(nonzero);
+            address_fragments.push_back(fragment);
+        } else {
+            uint64_t term;
+            if (token_to_term(token, leading, term)) terms.push_back(term);
+            else unusable = true;
+        }
+        leading = false;
+    });
+    if (unusable || (terms.empty() && address_fragments.empty())) return result;
+
+    std::vector<uint32_t> docs = match_documents(terms, address_fragments, range_start, range_end);
+    if (replaced_ranges_.empty()) {
+        result.total_matches = docs.size();
+        for (size_t i = offset; i < docs.size() && i < offset + limit; ++i) {
+            result.addresses.push_back(addresses_[docs[i]]);
+        }
+        return result;
+    }
+
+    // Documents in replaced ranges are stale; their replacements are
+    // matched directly, then both merged back into address order
+    std::vector<uint64_t> matches;
+    auto replaced = replaced_ranges_.begin();
+    for (uint32_t doc : docs) {
+        uint64_t address = addresses_[doc];
+        while (replaced != replaced_ranges_.end() && replaced->second <= address) ++replaced;
+        if (replaced == replaced_ranges_.end() || address < replaced->first) matches.push_back(address);
+    }
+    size_t base_matches = matches.size();
+    for (auto it = std::lower_bound(patched_documents_.begin(), patched_documents_.end(), range_start,
+                                    [](const PatchedDocument& d, uint64_t a) { return d.address < a; });
+         it != patched_documents_.end() && (range_end == 0 || it->address < range_end); ++it) {
+        bool match = std::all_of(terms.begin(), terms.end(), [&](uint64_t term) {
+            return std::binary_search(it->terms.begin(), it->terms.end(), term);
+        }) && std::all_of(address_fragments.begin(), address_fragments.end(), [&](const std::string& fragment) {
+            return hex_contains(it->address, fragment);
+        });
+        if (match) matches.push_back(it->address);
+    }
+    std::inplace_merge(matches.begin(), matches.begin() + base_matches, matches.end());
+
+    result.total_matches = matches.size();
+    for (size_t i = offset; i < matches.size() && i < offset + limit; ++i) {
+        result.addresses.push_back(matches[i]);
+    }
+    return result;
+}
+
+std::vector<uint32_t> InstructionSearchIndex::match_documents(const std::vector<uint64_t>& terms,
+                                                              std::vector<std::string> address_fragments,
+                                                              uint64_t range_start, uint64_t range_end) const {
+    std::vector<uint32_t> docs;
+    uint32_t first_doc = static_cast<uint32_t>(
+        std::lower_bound(addresses_.begin(), addresses_.end(), range_start) - addresses_.begin());
+    uint32_t last_doc = range_end == 0 ? static_cast<uint32_t>(addresses_.size()) : static_cast<uint32_t>(
+        std::lower_bound(addresses_.begin(), addresses_.end(), range_end) - addresses_.begin());
+    if (first_doc >= last_doc) return docs;
+
+    // Start from the rarest term and narrow with the rest.
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> spans;
+    for (uint64_t term : terms) {
+        auto span = postings_for(term);
+        if (span.first == nullptr) return docs;
+        spans.push_back(span);
+    }
+    std::sort(spans.begin(), spans.end(), [](const auto& a, const auto& b) {
+        return (a.second - a.first) < (b.second - b.first);
+    });
+
+    size_t next_span = 0;
+    if (!spans.empty()) {
+        docs.assign(std::lower_bound(spans[0].first, spans[0].second, first_doc),
+                    std::lower_bound(spans[0].first, spans[0].second, last_doc));
+        next_span = 1;
+    } else {
+        docs = address_candidates(address_fragments[0], first_doc, last_doc);
+        address_fragments.erase(address_fragments.begin());
+    }
+    for (; next_span < spans.size() && !docs.empty(); ++next_span) {
+        intersect(docs, spans[next_span].first, spans[next_span].second);
+    }
+    for (const auto& fragment : address_fragments) {
+        if (docs.empty()) break;
+        docs.erase(std::remove_if(docs.begin(), docs.end(), [&](uint32_t doc) {
+            return !hex_contains(addresses_[doc], fragment);
+        }), docs.end());
+    }
+    return docs;
+}
@@ -0,0 +1,41 @@
+#include "../include/jni_utils.h"
+#include "../include/utils.h"
+#include <vector>
+
+std::string jstring_to_cpp_string(JNIEnv* env, jstring jstr) {
+    if (!jstr) return "";
+    const char* c_str = env->GetStringUTFChars(jstr, nullptr);
+    std::string cpp_str(c_str);
+    env->ReleaseStringUTFChars(jstr, c_str);
+    return cpp_str;
+}
+
+jstring cpp_string_to_jstring(JNIEnv* env, const std::string& cpp_str) {
+    return env->NewStringUTF(cpp_str.c_str());
+}
+
+jstring utf8_to_jstring(JNIEnv* env, std::string_view utf8) {
+    std::vector<uint16_t> utf16;
+    utf8_to_utf16(utf8, utf16);
+    return env->NewString(reinterpret_cast<const jchar*>(utf16.data()), static_cast<jsize>(utf16.size()));
+}
+
+void ScopedGlobalRef::reset(JNIEnv* env) {
+    if (ref_) {
+        env->DeleteGlobalRef(ref_);
+        ref_ = nullptr;
+    }
+}
+
+ScopedGlobalRef::~ScopedGlobalRef() {
+    if (!ref_ || !vm_) return;
+    JNIEnv* env;
+    if (vm_->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        reset(env);
+    } else if (vm_->AttachCurrentThread(&env, nullptr) == JNI_OK) {
+        reset(env);
+        vm_->DetachCurrentThread();
+    } else {
+        log_error("Leaking a JNI global reference: cannot attach the thread to delete it.");
+    }
+}
@@ -0,0 +1,128 @@
+#include "../include/link_graph.h"
+#include "../include/trace.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+std::string_view file_name(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+uint32_t LinkGraph::add_library(const std::string& path, const ElfParser& parser) {
+    LinkedLibrary library;
+    library.path = path;
+    library.parser = &parser;
+    library.dynamic = std::make_unique<DynamicInfo>(parser);
+    library.name = std::string(library.dynamic->soname().empty() ? file_name(path) : library.dynamic->soname());
+    libraries_.push_back(std::move(library));
+    return static_cast<uint32_t>(libraries_.size() - 1);
+}
+
+long LinkGraph::find_library(std::string_view name) const {
+    for (size_t i = 0; i < libraries_.size(); ++i) {
+        if (libraries_[i].name == name) return static_cast<long>(i);
+    }
+    for (size_t i = 0; i < libraries_.size(); ++i) {
+        if (file_name(libraries_[i].path) == name) return static_cast<long>(i);
+    }
+    return -1;
+}
+
+bool LinkGraph::compatible(const DynamicSymbol& import, uint32_t library, const DynamicSymbol& definition) const {
+    if (import.version.empty()) return !definition.hidden;
+    return definition.version == import.version ||
+           (definition.version.empty() && libraries_[library].dynamic->defined_versions().empty());
+}
+
+LinkStats LinkGraph::link(TaskScheduler& scheduler, TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("link_graph.link");
+    std::hash<std::string_view> hash;
+
+    exports_.clear();
+    for (uint32_t i = 0; i < libraries_.size(); ++i) {
+        const auto& exports = libraries_[i].dynamic->exports();
+        for (uint32_t e = 0; e < exports.size(); ++e) exports_.push_back({hash(exports[e].name), i, e});
+    }
+    std::sort(exports_.begin(), exports_.end(), [](const ExportSlot& a, const ExportSlot& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.library < b.library;
+    });
+
+    // Sonames first, so a file named like another library's soname does
+    // not shadow it
+    std::unordered_map<std::string_view, int32_t> by_name;
+    for (uint32_t i = 0; i < libraries_.size(); ++i) by_name.emplace(libraries_[i].name, static_cast<int32_t>(i));
+    for (uint32_t i = 0; i < libraries_.size(); ++i) by_name.emplace(file_name(libraries_[i].path), static_cast<int32_t>(i));
+    for (LinkedLibrary& library : libraries_) {
+        library.needed.clear();
+        for (std::string_view needed : library.dynamic->needed()) {
+            auto it = by_name.find(needed);
+            library.needed.push_back(it != by_name.end() ? it->second : -1);
+        }
+    }
+
+    const uint32_t count = static_cast<uint32_t>(libraries_.size());
+    scheduler.parallel_for(count, 1, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> rank;
+        std::vector<uint32_t> queue;
+        for (size_t l = begin; l < end; ++l) {
+            LinkedLibrary& library = libraries_[l];
+
+            // Load order of the local group: the library, then breadth first
+            constexpr uint32_t kOutside = UINT32_MAX;
+            rank.assign(count, kOutside);
+            queue.assign(1, static_cast<uint32_t>(l));
+            rank[l] = 0;
+            for (size_t head = 0; head < queue.size(); ++head) {
+                for (int32_t needed : libraries_[queue[head]].needed) {
+                    if (needed < 0 || rank[needed] != kOutside) continue;
+                    rank[needed] = static_cast<uint32_t>(queue.size());
+                    queue.push_back(static_cast<uint32_t>(needed));
+                }
+            }
+
+            const auto& imports = library.dynamic->imports();
+            library.imports.assign(imports.size(), {-1, 0, ImportBinding::Unresolved});
+            for (size_t i = 0; i < imports.size(); ++i) {
+                const DynamicSymbol& import = imports[i];
+                uint64_t key = hash(import.name);
+                auto first = std::lower_bound(exports_.begin(), exports_.end(), key,
+                    [](const ExportSlot& slot, uint64_t value) { return slot.hash < value; });
+                ImportResolution& best = library.imports[i];
+                uint32_t best_rank = kOutside;
+                for (auto slot = first; slot != exports_.end() && slot->hash == key; ++slot) {
+                    if (slot->library == l) continue;
+                    const DynamicSymbol& definition = libraries_[slot->library].dynamic->exports()[slot->export_index];
+                    if (definition.name != import.name || !compatible(import, slot->library, definition)) continue;
+                    uint32_t slot_rank = rank[slot->library];
+                    if (best.library >= 0 && slot_rank >= best_rank) continue; // Slots are in library order
+                    best = {static_cast<int32_t>(slot->library), slot->export_index,
+                            slot_rank != kOutside ? ImportBinding::Needed : ImportBinding::Elsewhere};
+                    best_rank = slot_rank;
+                }
+            }
+        }
+    }, priority);
+
+    LinkStats stats;
+    for (const LinkedLibrary& library : libraries_) {
+        stats.missing_libraries += std::count(library.needed.begin(), library.needed.end(), -1);
+        for (const ImportResolution& resolution : library.imports) {
+            ++stats.imports;
+            switch (resolution.binding) {
+                case ImportBinding::Needed: ++stats.needed; break;
+                case ImportBinding::Elsewhere: ++stats.elsewhere; break;
+                case ImportBinding::Unresolved: ++stats.unresolved; break;
+            }
+        }
+    }
+    memory_.set(capacity_bytes(libraries_, exports_));
+    log_info("Link graph: " + std::to_string(libraries_.size()) + " libraries, " + std::to_string(stats.imports) +
+             " imports, " + std::to_string(stats.needed + stats.elsewhere) + " resolved");
+    return stats;
+}
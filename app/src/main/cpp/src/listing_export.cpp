@@ -0,0 +1,355 @@
+#include "../include/listing_export.h"
+#include "../include/utils.h"
+#include "../include/trace.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+constexpr size_t kWriteBufferBytes = 256 * 1024;
+
+void append_decimal(std::string& out, uint64_t value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+struct Label {
+    uint64_t address;
+    std::string_view name;
+};
+
+// Named symbols by address, one per address (a function where there is one).
+std::vector<Label> collect_labels(const ElfParser& parser) {
+    struct Candidate {
+        uint64_t address;
+        bool function;
+        std::string_view name;
+    };
+    std::vector<Candidate> candidates;
+    for (const SymbolEntry& symbol : parser.get_symbols()) {
+        uint8_t type = symbol.st_info & 0xF;
+        if (symbol.name.empty() || symbol.name[0] == '$' || symbol.st_shndx == SHN_UNDEF ||
+            (type != STT_NOTYPE && type != STT_FUNC && type != STT_OBJECT)) {
+            continue;
+        }
+        // The Thumb bit of function symbols is not part of the address
+        uint64_t address = type == STT_FUNC ? symbol.st_value & ~1ULL : symbol.st_value;
+        candidates.push_back({address, type == STT_FUNC, symbol.name});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.address != b.address) return a.address < b.address;
+        if (a.function != b.function) return a.function;
+        return a.name < b.name;
+    });
+
+    std::vector<Label> labels;
+    for (const Candidate& candidate : candidates) {
+        if (labels.empty() || labels.back().address != candidate.address) {
+            labels.push_back({candidate.address, candidate.name});
+        }
+    }
+    return labels;
+}
+
+struct ExportChunk {
+    size_t section_index;
+    uint64_t start;
+    uint64_t end;
+    CodeMode mode;
+    bool first_in_section;
+};
+
+// Code chunks from plan_sweep_chunks(), with the gaps between them (data
+// runs, alignment padding) as data chunks, in address order.
+std::vector<ExportChunk> plan_export_chunks(const ElfParser& parser, const ModeMap& mode_map,
+                                            const std::vector<size_t>& sections, size_t chunk_bytes) {
+    std::vector<ExportChunk> chunks;
+    const uint64_t data_step = std::max<uint64_t>(chunk_bytes & ~3ULL, 4);
+    for (size_t section_index : sections) {
+        if (parser.get_section_data_by_index(section_index) == nullptr) continue;
+        const SectionHeader& sh = parser.get_section_headers()[section_index];
+        size_t first = chunks.size();
+
+        auto add_data = [&](uint64_t start, uint64_t end) {
+            for (uint64_t chunk_start = start; chunk_start < end;) {
+                uint64_t chunk_end = end - chunk_start > data_step ? chunk_start + data_step : end;
+                chunks.push_back({section_index, chunk_start, chunk_end, CodeMode::Data, false});
+                chunk_start = chunk_end;
+            }
+        };
+        uint64_t cursor = sh.sh_addr;
+        for (const SweepChunk& code : plan_sweep_chunks(parser, mode_map, {section_index}, chunk_bytes)) {
+            add_data(cursor, code.start);
+            chunks.push_back({section_index, code.start, code.end,
+                              code.thumb ? CodeMode::Thumb : CodeMode::Arm, false});
+            cursor = code.end;
+        }
+        add_data(cursor, sh.sh_addr + sh.sh_size);
+        if (chunks.size() > first) chunks[first].first_in_section = true;
+    }
+    return chunks;
+}
+
+// One chunk's output, reused for every in_flight-th chunk so buffers keep
+// their capacity.
+struct ChunkSlot {
+    std::string text;
+    std::vector<DisassembledInstruction> instructions;
+    Arena comments{MemoryCategory::Decode};
+    uint64_t instruction_count = 0;
+    TaskHandle task;
+};
+
+class ChunkFormatter {
+public:
+    ChunkFormatter(const ElfParser& parser, const std::vector<Label>& labels,
+                   const ListingExportOptions& options)
+        : parser_(parser), labels_(labels), options_(options) {}
+
+    void format(const ExportChunk& chunk, ChunkSlot& slot) const;
+
+private:
+    const ElfParser& parser_;
+    const std::vector<Label>& labels_;
+    const ListingExportOptions& options_;
+
+    void append_section_header(const ExportChunk& chunk, std::string& out) const;
+    void append_line(uint64_t address, const uint8_t* bytes, size_t size, bool thumb,
+                     std::string_view mnemonic, std::string_view operands, std::string_view comment,
+                     const Label* label, std::string& out) const;
+};
+
+void ChunkFormatter::append_section_header(const ExportChunk& chunk, std::string& out) const {
+    const SectionHeader& sh = parser_.get_section_headers()[chunk.section_index];
+    if (options_.format == ListingFormat::Text) {
+        out += "\nDisassembly of section ";
+        out += sh.name;
+        out += ":\n";
+        return;
+    }
+    out += "{\"section\":";
+    append_json_string(out, sh.name);
+    out += ",\"address\":";
+    append_decimal(out, sh.sh_addr);
+    out += ",\"size\":";
+    append_decimal(out, sh.sh_size);
+    out += "}\n";
+}
+
+void ChunkFormatter::append_line(uint64_t address, const uint8_t* bytes, size_t size, bool thumb,
+                                 std::string_view mnemonic, std::string_view operands,
+                                 std::string_view comment, const Label* label, std::string& out) const {
+    // Encoding as the CPU reads it: halfwords for Thumb, words for ARM/data
+    char encoding[16];
+    size_t encoding_length = 0;
+    auto put_unit = [&](const uint8_t* unit, size_t unit_size) {
+        for (size_t i = unit_size; i-- > 0;) {
+            encoding[encoding_length++] = kHexDigits[unit[i] >> 4];
+            encoding[encoding_length++] = kHexDigits[unit[i] & 0xF];
+        }
+    };
+    if (thumb && size == 4) {
+        put_unit(bytes, 2);
+        if (options_.format == ListingFormat::Text) encoding[encoding_length++] = ' ';
+        put_unit(bytes + 2, 2);
+    } else {
+        put_unit(bytes, size);
+    }
+
+    if (options_.format == ListingFormat::Text) {
+        if (label) {
+            out += '\n';
+            append_hex(out, label->address, 8);
+            out += " <";
+            out += label->name;
+            out += ">:\n";
+        }
+        out += "  ";
+        append_hex(out, address, 6);
+        out += ":\t";
+        out.append(encoding, encoding_length);
+        out.append(encoding_length < 10 ? 10 - encoding_length : 1, ' ');
+        out += '\t';
+        out += mnemonic;
+        if (!operands.empty()) {
+            out += '\t';
+            out += operands;
+        }
+        if (!comment.empty()) {
+            out += "\t; ";
+            out += comment;
+        }
+        out += '\n';
+        return;
+    }
+
+    out += "{\"a\":";
+    append_decimal(out, address);
+    out += ",\"e\":\"";
+    out.append(encoding, encoding_length);
+    out += "\",\"m\":";
+    append_json_string(out, mnemonic);
+    out += ",\"o\":";
+    append_json_string(out, operands);
+    if (!comment.empty()) {
+        out += ",\"c\":";
+        append_json_string(out, comment);
+    }
+    if (label) {
+        out += ",\"l\":";
+        append_json_string(out, label->name);
+    }
+    out += "}\n";
+}
+
+void ChunkFormatter::format(const ExportChunk& chunk, ChunkSlot& slot) const {
+    KTIMAZ_TRACE_SCOPE("export.chunk");
+    slot.text.clear();
+    slot.instruction_count = 0;
+    if (chunk.first_in_section) append_section_header(chunk, slot.text);
+
+    const SectionHeader& sh = parser_.get_section_headers()[chunk.section_index];
+    const uint8_t* data = parser_.get_section_data_by_index(chunk.section_index) + (chunk.start - sh.sh_addr);
+    auto label = std::lower_bound(labels_.begin(), labels_.end(), chunk.start,
+        [](const Label& l, uint64_t a) { return l.address < a; });
+    // A label inside an instruction goes on that instruction, so which
+    // labels appear does not depend on where chunks are cut
+    auto take_label = [&](uint64_t address, size_t size) {
+        const Label* taken = nullptr;
+        for (; label != labels_.end() && label->address < address + size; ++label) taken = &*label;
+        return taken;
+    };
+
+    if (chunk.mode == CodeMode::Data) {
+        for (uint64_t address = chunk.start; address < chunk.end;) {
+            size_t size = (address & 3) == 0 && chunk.end - address >= 4 ? 4 : 1;
+            const uint8_t* bytes = data + (address - chunk.start);
+            std::string operands = "0x";
+            for (size_t i = size; i-- > 0;) {
+                operands += kHexDigits[bytes[i] >> 4];
+                operands += kHexDigits[bytes[i] & 0xF];
+            }
+            append_line(address, bytes, size, false, size == 4 ? ".word" : ".byte", operands,
+                        std::string_view(), take_label(address, size), slot.text);
+            address += size;
+            ++slot.instruction_count;
+        }
+        return;
+    }
+
+    bool thumb = chunk.mode == CodeMode::Thumb;
+    ArmDisassembler disassembler;
+    disassembler.disassemble_block_into(data, chunk.end - chunk.start, chunk.start, thumb, slot.instructions);
+    slot.comments.reset();
+    if (options_.resolver) {
+        options_.resolver->annotate(slot.instructions, nullptr, slot.comments);
+    }
+    for (const auto& instr : slot.instructions) {
+        append_line(instr.address, data + (instr.address - chunk.start), instr.size, thumb,
+                    instr.mnemonic, instr.operands, instr.comment, take_label(instr.address, instr.size), slot.text);
+    }
+    slot.instruction_count = slot.instructions.size();
+}
+
+// Buffers small writes and passes large ones straight to the descriptor.
+class FdWriter {
+public:
+    explicit FdWriter(int fd) : fd_(fd) { buffer_.reserve(kWriteBufferBytes); }
+
+    bool write(std::string_view text) {
+        if (buffer_.size() + text.size() <= kWriteBufferBytes) {
+            buffer_.append(text.data(), text.size());
+            return true;
+        }
+        return flush() && write_all(text.data(), text.size());
+    }
+
+    bool flush() {
+        bool ok = write_all(buffer_.data(), buffer_.size());
+        buffer_.clear();
+        return ok;
+    }
+
+    uint64_t bytes_written() const { return written_; }
+
+private:
+    int fd_;
+    std::string buffer_;
+    uint64_t written_ = 0;
+
+    bool write_all(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd_, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+            written_ += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool export_listing(int fd, const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                    const ListingExportOptions& options, ListingExportStats* stats) {
+    KTIMAZ_TRACE_SCOPE("export.listing");
+    std::vector<size_t> sections = options.sections.empty() ? executable_section_indices(parser) : options.sections;
+    std::vector<ExportChunk> chunks = plan_export_chunks(parser, mode_map, sections, options.chunk_bytes);
+    std::vector<Label> labels = collect_labels(parser);
+    if (options.demangler) {
+        std::vector<std::string_view> names;
+        names.reserve(labels.size());
+        for (const Label& label : labels) names.push_back(label.name);
+        options.demangler->demangle_all(names, scheduler, TaskPriority::Background);
+        for (Label& label : labels) label.name = options.demangler->demangle(label.name);
+    }
+    ChunkFormatter formatter(parser, labels, options);
+
+    // Chunks format ahead on the workers while finished ones are written in
+    // order; at most in_flight chunks of text exist at any time
+    const size_t in_flight = std::max<size_t>(2, 2 * scheduler.worker_count());
+    std::vector<std::unique_ptr<ChunkSlot>> slots;
+    for (size_t i = 0; i < std::min(in_flight, chunks.size()); ++i) {
+        slots.push_back(std::make_unique<ChunkSlot>());
+    }
+    auto submit = [&](size_t index) {
+        ChunkSlot* slot = slots[index % in_flight].get();
+        const ExportChunk* chunk = &chunks[index];
+        slot->task = scheduler.submit([&formatter, chunk, slot]() { formatter.format(*chunk, *slot); },
+                                      TaskPriority::Background);
+    };
+
+    FdWriter writer(fd);
+    ListingExportStats totals;
+    bool ok = true;
+    size_t submitted = 0;
+    for (; submitted < slots.size(); ++submitted) submit(submitted);
+    for (size_t index = 0; index < submitted; ++index) {
+        ChunkSlot& slot = *slots[index % in_flight];
+        slot.task.wait();
+        if (ok && slot.task.was_cancelled()) ok = false;
+        if (ok && !writer.write(slot.text)) {
+            log_error("Listing export: write failed");
+            ok = false;
+        }
+        if (ok && options.cancelled && options.cancelled()) ok = false;
+        if (!ok) continue; // Only drain what is already running
+        totals.instructions += slot.instruction_count;
+        if (submitted < chunks.size()) submit(submitted++);
+    }
+    ok = writer.flush() && ok;
+    totals.bytes_written = writer.bytes_written();
+    if (stats) *stats = totals;
+    log_info("Listing export: " + std::to_string(totals.instructions) + " lines in " +
+             std::to_string(chunks.size()) + " chunks, " + std::to_string(totals.bytes_written) + " bytes");
+    return ok;
+}
@@ -0,0 +1,142 @@
+#include "../include/memory_governor.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Share of the budget left after a trim at `level`, in quarters. UiHidden
+// and Background are reported after the Running* levels but are milder
+// than RunningCritical, so the mapping is not monotonic in the raw value.
+size_t trim_quarters(int level) {
+    if (level >= static_cast<int>(TrimLevel::Moderate)) return 0;
+    if (level >= static_cast<int>(TrimLevel::Background)) return 1;
+    if (level >= static_cast<int>(TrimLevel::UiHidden)) return 2;
+    if (level >= static_cast<int>(TrimLevel::RunningCritical)) return 1;
+    if (level >= static_cast<int>(TrimLevel::RunningLow)) return 2;
+    if (level >= static_cast<int>(TrimLevel::RunningModerate)) return 3;
+    return 4;
+}
+
+} // namespace
+
+void MemoryGovernor::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+}
+
+size_t MemoryGovernor::budget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+double MemoryGovernor::priority_of(const Entry& entry) const {
+    return inflation_ + entry.cost / static_cast<double>(std::max<size_t>(entry.bytes, 1));
+}
+
+MemoryGovernor::EntryId MemoryGovernor::admit(MemoryCategory category, size_t bytes, double cost,
+                                              Evictor evictor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EntryId id = next_id_++;
+    Entry entry{category, bytes, std::max(cost, 0.0), 0.0, std::move(evictor)};
+    entry.priority = priority_of(entry);
+    entries_.emplace(id, std::move(entry));
+    total_ += bytes;
+    return id;
+}
+
+void MemoryGovernor::touch(EntryId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+        it->second.priority = priority_of(it->second);
+    }
+}
+
+void MemoryGovernor::resize(EntryId id, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return;
+    total_ = total_ - it->second.bytes + bytes;
+    it->second.bytes = bytes;
+    it->second.priority = priority_of(it->second);
+}
+
+void MemoryGovernor::forget(EntryId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return;
+    total_ -= it->second.bytes;
+    entries_.erase(it);
+}
+
+void MemoryGovernor::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    total_ = 0;
+    inflation_ = 0.0;
+}
+
+size_t MemoryGovernor::enforce() {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (total_ <= budget_) return 0;
+        target = budget_;
+    }
+    return evict_down_to(target);
+}
+
+size_t MemoryGovernor::trim(int level) {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        target = budget_ / 4 * trim_quarters(level);
+    }
+    size_t freed = evict_down_to(target);
+    log_info("Trim level " + std::to_string(level) + " freed " + std::to_string(freed >> 10) + " KB of caches");
+    return freed;
+}
+
+size_t MemoryGovernor::evict_down_to(size_t target) {
+    // Pick victims under the lock, run their evictors after releasing it
+    std::vector<Evictor> victims;
+    size_t freed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Entries are few (pages, graphs, a couple of indexes), so a scan for
+        // the minimum is cheaper than keeping a heap up to date on touch()
+        while (total_ > target && !entries_.empty()) {
+            auto victim = std::min_element(entries_.begin(), entries_.end(),
+                [](const auto& a, const auto& b) { return a.second.priority < b.second.priority; });
+            inflation_ = victim->second.priority;
+            total_ -= victim->second.bytes;
+            freed += victim->second.bytes;
+            victims.push_back(std::move(victim->second.evictor));
+            entries_.erase(victim);
+        }
+    }
+    for (auto& evict : victims) {
+        evict();
+    }
+    return freed;
+}
+
+size_t MemoryGovernor::cached_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+}
+
+size_t MemoryGovernor::cached_bytes(MemoryCategory category) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t sum = 0;
+    for (const auto& entry : entries_) {
+        if (entry.second.category == category) sum += entry.second.bytes;
+    }
+    return sum;
+}
+
+size_t MemoryGovernor::entry_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
@@ -6,44 +6,549 @@
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <map>
+#include <shared_mutex>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
 #include <android/log.h>
 
 #include "../include/utils.h"
+#include "../include/jni_utils.h"
 #include "../include/elf_parser.h"
 #include "../include/arm_disassembler.h"
+#include "../include/symbol_index.h"
+#include "../include/code_sweep.h"
+#include "../include/instruction_search_index.h"
+#include "../include/pattern_search.h"
+#include "../include/string_table.h"
+#include "../include/control_flow_graph.h"
+#include "../include/xref_index.h"
+#include "../include/function_table.h"
+#include "../include/call_graph.h"
+#include "../include/operand_resolver.h"
+#include "../include/task_scheduler.h"
+#include "../include/analysis_pipeline.h"
+#include "../include/arena.h"
+#include "../include/memory_governor.h"
+#include "../include/trace.h"
+#include "../include/patch_overlay.h"
+#include "../include/listing_export.h"
+#include "../include/code_overview.h"
+#include "../include/content_map.h"
+#include "../include/function_diff.h"
+#include "../include/signature_database.h"
+#include "../include/link_graph.h"
 
 // Android log tags
 #define LOG_TAG_JNI "NativeDisassemblerJNI"
 #define LOGI_JNI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG_JNI, __VA_ARGS__)
 #define LOGE_JNI(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG_JNI, __VA_ARGS__)
 
+// Times a JNI entry point, including marshalling, and counts the call
+#define TRACE_JNI_CALL(name) KTIMAZ_TRACE_SCOPE("jni." name); KTIMAZ_TRACE_COUNT(TraceCounter::JniCalls, 1)
+
 static JavaVM* g_vm = nullptr;
-static std::unique_ptr<SimpleThreadPool> g_thread_pool;
+static std::unique_ptr<TaskScheduler> g_scheduler;
 static std::unique_ptr<ElfParser> g_elf_parser;
 static std::unique_ptr<ArmDisassembler> g_arm_disassembler;
+static std::unique_ptr<SymbolIndex> g_symbol_index;
+static std::unique_ptr<InstructionSearchIndex> g_search_index;
+static std::unique_ptr<XrefIndex> g_xref_index;
+static std::unique_ptr<CodeOverview> g_code_overview;
+static std::unique_ptr<ContentMap> g_content_map;
+static std::unique_ptr<FunctionTable> g_function_table;
+static std::unique_ptr<CallGraph> g_call_graph; // References g_function_table
+static std::unique_ptr<StringTable> g_string_table;
+static std::unique_ptr<ModeMap> g_mode_map;
+static std::unique_ptr<OperandResolver> g_operand_resolver;
 static MappedFile g_mapped_file;
+static std::unique_ptr<PatchOverlay> g_patch_overlay; // Edits g_mapped_file in place
 static std::mutex g_parser_mutex;
+static std::atomic<uint64_t> g_requested_generation{0}; // Bumped as soon as a load/unload is requested
+static std::atomic<uint64_t> g_load_generation{0}; // Request that produced the loaded file
+
+// Rebuildable results are registered with the governor, which drops the
+// cheapest to rebuild per byte when over budget or when the app is asked to
+// trim memory. The caches below are guarded by g_parser_mutex.
+static MemoryGovernor g_memory_governor;
+
+// Single-mode stretch of a listing, in page addresses.
+struct ListingRun {
+    uint64_t start;
+    uint64_t end;
+    bool thumb;
+};
+
+// A section's decoded listing, kept so switching back to it skips decoding.
+// Mapped pages are decoded at the section's address in the modes of the
+// mode map; others from an explicit base in one mode.
+struct DecodedPage {
+    std::string section;
+    uint64_t base_address;
+    bool thumb;        // Unmapped pages only
+    bool mapped;
+    bool with_mode_map; // Mapped, and decoded once the mode map was built
+    bool annotated;     // Decoded with the operand resolver available
+    bool with_strings;  // ...and with the string table
+    std::vector<ListingRun> runs; // Cover the section in order
+    std::vector<DisassembledInstruction> instructions;
+    Arena comments{MemoryCategory::Decode};
+    MemoryCharge memory{MemoryCategory::Decode};
+    uint64_t decode_cost_us = 0; // What dropping the page costs: decoding it all again
+    MemoryGovernor::EntryId governor_id = 0;
+};
+static std::vector<std::shared_ptr<const DecodedPage>> g_decoded_pages;
+
+// Control flow graphs built so far, by entry, for the graph view.
+struct CachedCfg {
+    std::shared_ptr<const ControlFlowGraph> graph;
+    MemoryGovernor::EntryId governor_id;
+};
+static std::map<uint64_t, CachedCfg> g_cfgs;
+
+// Set when the governor dropped the sweep's results; the next request that
+// needs them starts a background rebuild.
+static bool g_search_index_evicted = false;
+static bool g_string_table_evicted = false;
+static MemoryGovernor::EntryId g_search_index_entry = 0;
+static MemoryGovernor::EntryId g_string_table_entry = 0;
+static std::atomic<bool> g_rebuild_pending{false};
+
+// Long-running readers of the mapping (pattern scans) hold this shared so the
+// file cannot be unmapped underneath them; loading/unloading takes it exclusively.
+static std::shared_mutex g_file_lifetime_mutex;
+
+static std::mutex g_pattern_search_mutex;
+static std::map<jlong, std::shared_ptr<CancellationGroup>> g_pattern_searches; // id -> cancel flag
+static jlong g_next_pattern_search_id = 1;
+
+static void cancel_all_pattern_searches() {
+    std::lock_guard<std::mutex> lock(g_pattern_search_mutex);
+    for (auto& entry : g_pattern_searches) {
+        entry.second->cancel();
+    }
+}
+
+// Staged analysis of the loaded file; replaced (and the old one cancelled)
+// whenever another load is requested.
+static std::mutex g_pipeline_mutex;
+static std::shared_ptr<AnalysisPipeline> g_pipeline;
+static jobject g_loader_callback = nullptr; // FileLoaderViewModel, global ref; guarded by g_pipeline_mutex
+
+static void cancel_analysis() {
+    std::lock_guard<std::mutex> lock(g_pipeline_mutex);
+    if (g_pipeline) {
+        g_pipeline->cancel();
+        g_pipeline.reset();
+    }
+}
+
+// Asks the pipeline to finish `stage` next; called by requests that need it.
+static void promote_analysis(AnalysisStage stage) {
+    std::lock_guard<std::mutex> lock(g_pipeline_mutex);
+    if (g_pipeline) {
+        g_pipeline->promote(stage);
+    }
+}
+
+// Tells FileLoaderViewModel that a stage has been published.
+static void notify_stage_finished(AnalysisStage stage) {
+    std::lock_guard<std::mutex> lock(g_pipeline_mutex);
+    if (!g_loader_callback || !g_vm) return;
+    JNIEnv* env;
+    bool attached = false;
+    if (g_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        if (g_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+            LOGE_JNI("Failed to attach thread!");
+            return;
+        }
+        attached = true;
+    }
+    jclass cls = env->GetObjectClass(g_loader_callback);
+    jmethodID method = env->GetMethodID(cls, "onAnalysisStageFinished", "(I)V");
+    if (method) {
+        env->CallVoidMethod(g_loader_callback, method, static_cast<jint>(stage));
+    }
+    env->DeleteLocalRef(cls);
+    if (attached) {
+        g_vm->DetachCurrentThread();
+    }
+}
+
+// Stage bodies. Each runs under the shared lifetime lock rather than
+// g_parser_mutex, so UI requests are not blocked, reads the inputs published
+// by the stages it depends on, and publishes its own result only if the file
+// is still the one it started on. They give up as soon as another load is
+// requested so that load does not wait for them.
+
+static bool superseded(uint64_t generation) {
+    return g_requested_generation != generation;
+}
+
+template <typename T>
+static bool publish(uint64_t generation, std::unique_ptr<T>& slot, std::unique_ptr<T> value) {
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (generation != g_load_generation) return false;
+    slot = std::move(value);
+    return true;
+}
+
+static bool run_symbol_index_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.symbol_index");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    auto symbols = std::make_unique<SymbolIndex>(*g_elf_parser);
+    auto resolver = std::make_unique<OperandResolver>(*g_elf_parser);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (generation != g_load_generation) return false;
+    g_symbol_index = std::move(symbols);
+    g_operand_resolver = std::move(resolver);
+    return true;
+}
+
+static bool run_mode_map_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.mode_map");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    return publish(generation, g_mode_map,
+                   std::make_unique<ModeMap>(*g_elf_parser, default_code_mode(*g_elf_parser)));
+}
+
+static bool run_strings_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.strings");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    return publish(generation, g_string_table, std::make_unique<StringTable>(*g_elf_parser));
+}
+
+static bool run_content_map_stage(uint64_t generation, TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("stage.content_map");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    auto content = std::make_unique<ContentMap>(*g_elf_parser, *g_mode_map, *g_scheduler, priority);
+    if (superseded(generation)) return false;
+    return publish(generation, g_content_map, std::move(content));
+}
+
+static uint64_t elapsed_us(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Drops everything derived from the loaded file; caller holds g_parser_mutex.
+static void reset_analysis_results() {
+    g_memory_governor.clear();
+    g_decoded_pages.clear();
+    g_cfgs.clear();
+    g_search_index_evicted = false;
+    g_string_table_evicted = false;
+    g_search_index.reset();
+    g_xref_index.reset();
+    g_code_overview.reset();
+    g_content_map.reset();
+    g_call_graph.reset();
+    g_function_table.reset();
+    g_string_table.reset();
+    g_mode_map.reset();
+    g_operand_resolver.reset();
+    g_symbol_index.reset();
+}
+
+// Registers a published result with the governor. On eviction it is
+// dropped and `evicted` set so the next request for it schedules a rebuild.
+// Caller holds g_parser_mutex.
+template <typename T>
+static MemoryGovernor::EntryId admit_result(MemoryCategory category, std::unique_ptr<T>& slot, bool& evicted,
+                                            uint64_t cost_us) {
+    uint64_t generation = g_load_generation;
+    return g_memory_governor.admit(category, slot->memory_bytes(), static_cast<double>(cost_us),
+        [generation, &slot, &evicted]() {
+            std::unique_ptr<T> victim; // Freed after the lock is released
+            std::lock_guard<std::mutex> lock(g_parser_mutex);
+            if (generation != g_load_generation || !slot) return;
+            victim = std::move(slot);
+            evicted = true;
+        });
+}
+
+// Decodes all executable code once, in parallel, feeding whichever of the
+// outputs are given. Returns false if another load was requested meanwhile.
+static bool sweep_code(uint64_t generation, TaskPriority priority, InstructionSearchIndex* index,
+                       XrefIndex* xrefs, CodeOverview* overview, const StringTable* strings,
+                       std::vector<StringReference>& string_references) {
+    const ElfParser* parser = g_elf_parser.get();
+    std::vector<SweepChunk> chunks =
+        plan_sweep_chunks(*parser, *g_mode_map, executable_section_indices(*parser));
+    if (g_content_map) {
+        // Packed or zero-filled stretches of "code" decode to noise that
+        // would only clutter the indexes; they are still listed on demand
+        const auto& headers = parser->get_section_headers();
+        size_t before = chunks.size();
+        chunks.erase(std::remove_if(chunks.begin(), chunks.end(), [&](const SweepChunk& chunk) {
+            const SectionHeader& sh = headers[chunk.section_index];
+            return !g_content_map->worth_disassembling(sh.sh_offset + (chunk.start - sh.sh_addr),
+                                                       chunk.end - chunk.start);
+        }), chunks.end());
+        if (chunks.size() != before) {
+            log_info("Sweep skips " + std::to_string(before - chunks.size()) + " packed or empty chunks");
+        }
+    }
+    std::mutex merge_mutex; // Guards the outputs
+    // Decode buffers keep their capacity between chunks, so after the first
+    // few chunks decoding allocates nothing
+    ObjectPool<std::vector<DisassembledInstruction>> buffers;
+
+    // One chunk per piece; a chunk is already a few hundred KB of code
+    g_scheduler->parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+        ArmDisassembler disassembler;
+        std::vector<Xref> local_xrefs;
+        std::vector<StringReference> local_strings;
+        std::vector<DisassembledInstruction>* buffer = buffers.acquire();
+        for (size_t i = begin; i < end && !superseded(generation); ++i) {
+            sweep_chunk(*parser, disassembler, chunks[i],
+                [&](size_t section_index, const std::vector<DisassembledInstruction>& instructions) {
+                    if (xrefs) XrefIndex::collect(*parser, instructions, local_xrefs);
+                    if (overview) overview->add_instructions(section_index, instructions);
+                    if (strings) strings->collect_references(instructions, local_strings);
+                    if (!index) return;
+                    std::lock_guard<std::mutex> lock(merge_mutex);
+                    index->add_instructions(instructions);
+                }, *buffer);
+        }
+        buffers.release(buffer);
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        if (xrefs) xrefs->add(local_xrefs);
+        string_references.insert(string_references.end(), local_strings.begin(), local_strings.end());
+    }, priority);
+    buffers.clear();
+    return !superseded(generation);
+}
+
+// Sweeps all executable code to build the instruction search index, the
+// xref index and the section overviews and to collect string references.
+static bool run_sweep_stage(uint64_t generation, TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("stage.sweep");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    auto start = std::chrono::steady_clock::now();
+    auto index = std::make_unique<InstructionSearchIndex>();
+    auto xrefs = std::make_unique<XrefIndex>();
+    auto overview = std::make_unique<CodeOverview>(*g_elf_parser, executable_section_indices(*g_elf_parser));
+    std::vector<StringReference> string_references;
+    if (!sweep_code(generation, priority, index.get(), xrefs.get(), overview.get(), g_string_table.get(),
+                    string_references)) {
+        return false;
+    }
+
+    index->finalize();
+    xrefs->finalize();
+    overview->finalize(*g_elf_parser, *g_mode_map, *g_scheduler, priority);
+    uint64_t cost = elapsed_us(start);
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (generation != g_load_generation) return false;
+        g_search_index = std::move(index);
+        g_xref_index = std::move(xrefs);
+        g_code_overview = std::move(overview);
+        g_string_table->set_references(std::move(string_references));
+        // Both are only evictable from here on: the sweep above reads the
+        // string table without holding g_parser_mutex. The xref index feeds
+        // later stages and stays.
+        g_search_index_entry = admit_result(MemoryCategory::SearchIndex, g_search_index, g_search_index_evicted, cost);
+        g_string_table_entry = admit_result(MemoryCategory::Strings, g_string_table, g_string_table_evicted, cost);
+    }
+    g_memory_governor.enforce();
+    return true;
+}
+
+// Rebuilds the search index and string table after eviction. The string
+// references need a sweep too, so restoring either costs about as much as
+// the original sweep stage.
+static void rebuild_evicted_results(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.rebuild_evicted");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return;
+    bool need_index, need_strings;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (generation != g_load_generation) return;
+        need_index = g_search_index_evicted;
+        need_strings = g_string_table_evicted;
+    }
+    if (!need_index && !need_strings) return;
+
+    auto start = std::chrono::steady_clock::now();
+    auto index = need_index ? std::make_unique<InstructionSearchIndex>() : nullptr;
+    auto strings = need_strings ? std::make_unique<StringTable>(*g_elf_parser) : nullptr;
+    std::vector<StringReference> string_references;
+    if (!sweep_code(generation, TaskPriority::Background, index.get(), nullptr, nullptr, strings.get(),
+                    string_references)) {
+        return;
+    }
+    if (index) index->finalize();
+    if (strings) strings->set_references(std::move(string_references));
+    uint64_t cost = elapsed_us(start);
+
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (generation != g_load_generation) return;
+    if (index) {
+        g_search_index = std::move(index);
+        g_search_index_evicted = false;
+        g_search_index_entry = admit_result(MemoryCategory::SearchIndex, g_search_index, g_search_index_evicted, cost);
+    }
+    if (strings) {
+        g_string_table = std::move(strings);
+        g_string_table_evicted = false;
+        g_string_table_entry = admit_result(MemoryCategory::Strings, g_string_table, g_string_table_evicted, cost);
+    }
+    log_info("Rebuilt evicted analysis results in " + std::to_string(cost / 1000) + " ms");
+}
+
+// Starts rebuild_evicted_results() unless one is already running.
+static void schedule_rebuild() {
+    if (!g_scheduler || g_rebuild_pending.exchange(true)) return;
+    uint64_t generation = g_load_generation;
+    g_scheduler->submit([generation]() {
+        rebuild_evicted_results(generation);
+        g_rebuild_pending = false;
+        g_memory_governor.enforce();
+    }, TaskPriority::Background);
+}
+
+// Marks a governed result as used, or asks for it back if it was evicted.
+// Caller holds g_parser_mutex.
+static void use_search_index() {
+    if (g_search_index) {
+        g_memory_governor.touch(g_search_index_entry);
+    } else if (g_search_index_evicted) {
+        schedule_rebuild();
+    }
+}
+
+static void use_string_table() {
+    if (g_string_table) {
+        g_memory_governor.touch(g_string_table_entry);
+    } else if (g_string_table_evicted) {
+        schedule_rebuild();
+    }
+}
+
+static bool run_functions_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.functions");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    return publish(generation, g_function_table, std::make_unique<FunctionTable>(
+        *g_elf_parser, *g_mode_map, g_xref_index->targets_of_kind(XrefKind::Call)));
+}
+
+static bool run_call_graph_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.call_graph");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    return publish(generation, g_call_graph,
+                   std::make_unique<CallGraph>(*g_elf_parser, *g_function_table, *g_xref_index));
+}
+
+// Caches a graph for the graph view; caller holds g_parser_mutex. Returns
+// the cached graph, which is an earlier one if another request built the
+// same function meanwhile.
+static std::shared_ptr<const ControlFlowGraph> cache_cfg(std::unique_ptr<ControlFlowGraph> built, uint64_t cost_us) {
+    uint64_t entry = built->entry();
+    auto existing = g_cfgs.find(entry);
+    if (existing != g_cfgs.end()) {
+        g_memory_governor.touch(existing->second.governor_id);
+        return existing->second.graph;
+    }
+    std::shared_ptr<const ControlFlowGraph> graph = std::move(built);
+    std::weak_ptr<const ControlFlowGraph> weak = graph;
+    uint64_t generation = g_load_generation;
+    MemoryGovernor::EntryId id = g_memory_governor.admit(MemoryCategory::Cfg, graph->memory_bytes(),
+        static_cast<double>(cost_us), [generation, entry, weak]() {
+            std::shared_ptr<const ControlFlowGraph> victim; // Freed after the lock is released
+            std::lock_guard<std::mutex> lock(g_parser_mutex);
+            auto it = g_cfgs.find(entry);
+            if (generation != g_load_generation || it == g_cfgs.end() || it->second.graph != weak.lock()) return;
+            victim = std::move(it->second.graph);
+            g_cfgs.erase(it);
+        });
+    g_cfgs[entry] = CachedCfg{graph, id};
+    return graph;
+}
+
+// Prepares the graph most likely opened first; buildCfgNative reuses it.
+static bool run_entry_cfg_stage(uint64_t generation) {
+    KTIMAZ_TRACE_SCOPE("stage.entry_cfg");
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (superseded(generation)) return false;
+    uint64_t entry = g_elf_parser->get_header().e_entry;
+    long function = g_function_table->find_containing(entry & ~1ULL);
+    if (function < 0) return true; // Nothing to prepare
+    const FunctionInfo& info = g_function_table->function(static_cast<uint32_t>(function));
+
+    auto start = std::chrono::steady_clock::now();
+    ArmDisassembler disassembler;
+    auto cfg = std::make_unique<ControlFlowGraph>(
+        *g_elf_parser, disassembler, entry & ~1ULL, info.thumb, info.start, info.end);
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (generation != g_load_generation) return false;
+        if (!cfg->empty()) {
+            cache_cfg(std::move(cfg), elapsed_us(start));
+        }
+    }
+    g_memory_governor.enforce();
+    return true;
+}
+
+static std::shared_ptr<AnalysisPipeline> make_analysis_pipeline(uint64_t generation) {
+    auto pipeline = std::make_shared<AnalysisPipeline>(*g_scheduler, std::make_shared<CancellationGroup>());
+    using Stage = AnalysisStage;
+    pipeline->add_stage(Stage::SymbolIndex, {},
+        [generation](TaskPriority) { return run_symbol_index_stage(generation); });
+    pipeline->add_stage(Stage::ModeMap, {},
+        [generation](TaskPriority) { return run_mode_map_stage(generation); });
+    pipeline->add_stage(Stage::Strings, {},
+        [generation](TaskPriority) { return run_strings_stage(generation); });
+    pipeline->add_stage(Stage::ContentMap, {Stage::ModeMap},
+        [generation](TaskPriority priority) { return run_content_map_stage(generation, priority); });
+    pipeline->add_stage(Stage::Sweep, {Stage::ModeMap, Stage::Strings, Stage::ContentMap},
+        [generation](TaskPriority priority) { return run_sweep_stage(generation, priority); });
+    pipeline->add_stage(Stage::Functions, {Stage::Sweep},
+        [generation](TaskPriority) { return run_functions_stage(generation); });
+    pipeline->add_stage(Stage::CallGraph, {Stage::Functions},
+        [generation](TaskPriority) { return run_call_graph_stage(generation); });
+    pipeline->add_stage(Stage::EntryCfg, {Stage::Functions},
+        [generation](TaskPriority) { return run_entry_cfg_stage(generation); });
+    pipeline->set_listener(notify_stage_finished);
+    return pipeline;
+}
 
 extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
     g_vm = vm;
     LOGI_JNI("JNI_OnLoad called.");
     
-    g_thread_pool = std::make_unique<SimpleThreadPool>(4);
-    if (g_thread_pool == nullptr) {
-        LOGE_JNI("Failed to initialize global thread pool!");
-        return JNI_ERR;
-    }
+    g_scheduler = std::make_unique<TaskScheduler>();
     
     return JNI_VERSION_1_6;
 }
 
 extern "C" JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
     LOGI_JNI("JNI_OnUnload called.");
-    if (g_thread_pool) {
-        g_thread_pool->shutdown();
-        g_thread_pool.reset();
+    uint64_t request = ++g_requested_generation;
+    cancel_analysis();
+    cancel_all_pattern_searches();
+    if (g_scheduler) {
+        g_scheduler->shutdown();
+        g_scheduler.reset();
     }
+    std::unique_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
     std::lock_guard<std::mutex> lock(g_parser_mutex);
+    g_load_generation = request;
+    reset_analysis_results();
+    g_patch_overlay.reset();
     if (g_elf_parser) {
         g_elf_parser.reset();
     }
@@ -53,6 +558,14 @@ extern "C" JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
     if (g_mapped_file.data) {
         unmap_file(g_mapped_file);
     }
+    {
+        std::lock_guard<std::mutex> pipeline_lock(g_pipeline_mutex);
+        JNIEnv* env;
+        if (g_loader_callback && vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+            env->DeleteGlobalRef(g_loader_callback);
+        }
+        g_loader_callback = nullptr;
+    }
     g_vm = nullptr;
 }
 
@@ -61,6 +574,7 @@ Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_loadFileAndParseNative(
     JNIEnv* env,
     jobject thiz,
     jstring j_file_path) {
+    TRACE_JNI_CALL("loadFileAndParse");
 
     std::string file_path = jstring_to_cpp_string(env, j_file_path);
     LOGI_JNI("Loading file: %s", file_path.c_str());
@@ -78,8 +592,24 @@ Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_loadFileAndParseNative(
 
     env->CallVoidMethod(thiz, onParsingStartedMethod);
 
-    if (g_thread_pool) {
-        g_thread_pool->enqueue([=]() {
+    if (g_scheduler) {
+        // Stop analysing the current file right away rather than when the load task runs
+        uint64_t generation = ++g_requested_generation;
+        cancel_analysis();
+        cancel_all_pattern_searches();
+
+        // Callbacks arrive on worker threads, where `thiz` is not valid
+        jobject loader = env->NewGlobalRef(thiz);
+        {
+            std::lock_guard<std::mutex> lock(g_pipeline_mutex);
+            if (g_loader_callback) {
+                env->DeleteGlobalRef(g_loader_callback);
+            }
+            g_loader_callback = env->NewGlobalRef(thiz);
+        }
+
+        g_scheduler->submit([=]() {
+            ScopedGlobalRef loader_ref(g_vm, loader);
             JNIEnv* current_env;
             bool attached = false;
             if (g_vm->GetEnv(reinterpret_cast<void**>(&current_env), JNI_VERSION_1_6) != JNI_OK) {
@@ -92,87 +622,116 @@ Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_loadFileAndParseNative(
 
             bool success = false;
             std::string error_message = "";
+            bool newer_request = false;
             
             {
+                std::unique_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
                 std::lock_guard<std::mutex> lock(g_parser_mutex);
-                try {
-                    if (g_mapped_file.data) {
-                        unmap_file(g_mapped_file);
-                    }
-                    
-                    g_mapped_file = map_file(file_path);
-                    if (g_mapped_file.data == nullptr) {
-                        throw std::runtime_error("Failed to map file: " + file_path);
-                    }
+                // A load requested after this one will replace the file anyway
+                newer_request = generation != g_requested_generation;
+                if (!newer_request) {
+                    try {
+                        g_load_generation = generation;
+                        reset_analysis_results();
+                        g_patch_overlay.reset();
+                        g_arm_disassembler.reset();
+
+                        current_env->CallVoidMethod(loader, onParsingProgressMethod, 30);
+
+                        // Drops the old parser before its mapping; a failed
+                        // load leaves none, so entry points see "no file"
+                        if (!reload_elf_file(file_path, g_mapped_file, g_elf_parser, error_message)) {
+                            throw std::runtime_error(error_message);
+                        }
+                        g_patch_overlay = std::make_unique<PatchOverlay>(g_mapped_file);
+
+                        current_env->CallVoidMethod(loader, onParsingProgressMethod, 70);
+
+                        // Indexes and analyses follow as pipeline stages
+                        g_arm_disassembler = std::make_unique<ArmDisassembler>();
                     
-                    current_env->CallVoidMethod(thiz, onParsingProgressMethod, 30);
+                        current_env->CallVoidMethod(loader, onParsingProgressMethod, 100);
+                        success = true;
                     
-                    g_elf_parser = std::make_unique<ElfParser>(g_mapped_file);
-                    if (!g_elf_parser->parse()) {
-                        throw std::runtime_error("ELF parsing failed");
+                    } catch (const std::exception& e) {
+                        LOGE_JNI("Parsing error: %s", e.what());
+                        error_message = e.what();
+                        success = false;
                     }
-                    
-                    current_env->CallVoidMethod(thiz, onParsingProgressMethod, 70);
-                    
-                    g_arm_disassembler = std::make_unique<ArmDisassembler>();
-                    
-                    current_env->CallVoidMethod(thiz, onParsingProgressMethod, 100);
-                    success = true;
-                    
-                } catch (const std::exception& e) {
-                    LOGE_JNI("Parsing error: %s", e.what());
-                    error_message = e.what();
-                    success = false;
                 }
             }
 
-            if (success) {
-                current_env->CallVoidMethod(thiz, onParsingFinishedMethod, JNI_TRUE);
+            if (newer_request) {
+                // Reported by the newer load
+            } else if (success) {
+                auto pipeline = make_analysis_pipeline(generation);
+                {
+                    std::lock_guard<std::mutex> lock(g_pipeline_mutex);
+                    if (generation == g_requested_generation) {
+                        g_pipeline = pipeline;
+                        pipeline->start();
+                    }
+                }
+                current_env->CallVoidMethod(loader, onParsingFinishedMethod, JNI_TRUE);
             } else {
-                current_env->CallVoidMethod(thiz, onParsingFinishedMethod, JNI_FALSE);
-                current_env->CallVoidMethod(thiz, onFileReadErrorMethod, 
+                current_env->CallVoidMethod(loader, onParsingFinishedMethod, JNI_FALSE);
+                current_env->CallVoidMethod(loader, onFileReadErrorMethod, 
                     cpp_string_to_jstring(current_env, error_message));
             }
 
+            loader_ref.reset(current_env);
             if (attached) {
                 g_vm->DetachCurrentThread();
             }
-        });
+        }, TaskPriority::Interactive);
     }
 }
 
-extern "C" JNIEXPORT jobjectArray JNICALL
-Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getDisassembledInstructionsNative(
-    JNIEnv* env,
-    jobject thiz,
-    jstring j_section_name,
-    jlong j_base_address,
-    jboolean j_is_thumb_mode) {
-
-    std::string section_name = jstring_to_cpp_string(env, j_section_name);
-    uint64_t base_address = static_cast<uint64_t>(j_base_address);
-    bool is_thumb_mode = static_cast<bool>(j_is_thumb_mode);
-
-    std::vector<DisassembledInstruction> instructions;
-    {
-        std::lock_guard<std::mutex> lock(g_parser_mutex);
-        if (!g_elf_parser || !g_arm_disassembler) {
-            LOGE_JNI("Parser not initialized");
+// Cached listing for a section decoded the same way, unless it lacks
+// annotations or modes that are available now. Caller holds g_parser_mutex.
+static std::shared_ptr<const DecodedPage> find_decoded_page(const std::string& section, bool mapped,
+                                                            uint64_t base_address, bool thumb) {
+    for (auto it = g_decoded_pages.begin(); it != g_decoded_pages.end(); ++it) {
+        const DecodedPage& page = **it;
+        if (page.section != section || page.mapped != mapped) continue;
+        if (!mapped && (page.base_address != base_address || page.thumb != thumb)) continue;
+        if (page.annotated < (g_operand_resolver != nullptr) || page.with_strings < (g_string_table != nullptr) ||
+            (mapped && page.with_mode_map < (g_mode_map != nullptr))) {
+            g_memory_governor.forget(page.governor_id);
+            g_decoded_pages.erase(it);
             return nullptr;
         }
+        g_memory_governor.touch(page.governor_id);
+        return *it;
+    }
+    return nullptr;
+}
 
-        const uint8_t* section_data = g_elf_parser->get_section_data(section_name);
-        size_t section_size = g_elf_parser->get_section_size(section_name);
-        
-        if (section_data == nullptr || section_size == 0) {
-            LOGE_JNI("Section not found: %s", section_name.c_str());
-            return nullptr;
-        }
+// Registers a page with the governor; caller holds g_parser_mutex.
+static MemoryGovernor::EntryId admit_decoded_page(const std::shared_ptr<const DecodedPage>& page) {
+    std::weak_ptr<const DecodedPage> weak = page;
+    uint64_t generation = g_load_generation;
+    return g_memory_governor.admit(MemoryCategory::Decode,
+        page->memory.bytes() + page->comments.bytes_reserved(), static_cast<double>(page->decode_cost_us),
+        [generation, weak]() {
+            std::shared_ptr<const DecodedPage> victim; // Freed after the lock is released
+            std::lock_guard<std::mutex> lock(g_parser_mutex);
+            if (generation != g_load_generation) return;
+            auto it = std::find(g_decoded_pages.begin(), g_decoded_pages.end(), weak.lock());
+            if (it == g_decoded_pages.end()) return;
+            victim = std::move(*it);
+            g_decoded_pages.erase(it);
+        });
+}
 
-        instructions = g_arm_disassembler->disassemble_block(
-            section_data, section_size, base_address, is_thumb_mode);
-    }
+// Caller holds g_parser_mutex.
+static std::shared_ptr<const DecodedPage> cache_decoded_page(std::shared_ptr<DecodedPage> page) {
+    page->governor_id = admit_decoded_page(page);
+    g_decoded_pages.push_back(page);
+    return page;
+}
 
+static jobjectArray build_instruction_array(JNIEnv* env, const std::vector<DisassembledInstruction>& instructions) {
     jclass instruction_class = env->FindClass("com/imtiaz/ktimazrev/model/Instruction");
     if (!instruction_class) {
         LOGE_JNI("Failed to find Instruction class");
@@ -192,9 +751,9 @@ Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getDisassembledInstruct
     for (size_t i = 0; i < instructions.size(); ++i) {
         const auto& instr = instructions[i];
         
-        jstring j_mnemonic = cpp_string_to_jstring(env, instr.mnemonic);
-        jstring j_operands = cpp_string_to_jstring(env, instr.operands);
-        jstring j_comment = cpp_string_to_jstring(env, instr.comment);
+        jstring j_mnemonic = env->NewStringUTF(instr.mnemonic.c_str());
+        jstring j_operands = env->NewStringUTF(instr.operands.c_str());
+        jstring j_comment = utf8_to_jstring(env, instr.comment);
 
         jobject java_instr = env->NewObject(instruction_class, constructor,
             static_cast<jlong>(instr.address),
@@ -202,7 +761,7 @@ Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getDisassembledInstruct
             j_operands,
             j_comment,
             static_cast<jlong>(instr.bytes),
-            static_cast<jint>(4),
+            static_cast<jint>(instr.size),
             static_cast<jboolean>(instr.is_branch),
             static_cast<jlong>(instr.branch_target));
 
@@ -219,131 +778,2229 @@ Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getDisassembledInstruct
     return result;
 }
 
+// How a listing of the section `sh` is decoded: mapped, run by run as the
+// mode map says (data runs in the mode of the code before them, as literal
+// pools belong to it), or all of it from `base` in one mode. Without a mode
+// map yet, mapped listings use the file's default mode. Caller holds
+// g_parser_mutex.
+static std::vector<ListingRun> listing_runs(const SectionHeader& sh, bool mapped, uint64_t base, bool thumb) {
+    if (!mapped) return {{base, base + sh.sh_size, thumb}};
+    bool mode = default_code_mode(*g_elf_parser) == CodeMode::Thumb;
+    if (!g_mode_map) return {{sh.sh_addr, sh.sh_addr + sh.sh_size, mode}};
+    std::vector<ListingRun> runs;
+    for (const auto& run : g_mode_map->runs(sh.sh_addr, sh.sh_addr + sh.sh_size)) {
+        if (run.mode != CodeMode::Data) mode = run.mode == CodeMode::Thumb;
+        runs.push_back({run.start, run.end, mode});
+    }
+    return runs;
+}
+
+// Decoding mode of the listing run containing `address`.
+static const ListingRun* find_listing_run(const std::vector<ListingRun>& runs, uint64_t address) {
+    auto it = std::upper_bound(runs.begin(), runs.end(), address,
+        [](uint64_t value, const ListingRun& run) { return value < run.start; });
+    if (it == runs.begin() || address >= std::prev(it)->end) return nullptr;
+    return &*std::prev(it);
+}
+
+// A negative `baseAddress` asks for a mapped listing: decoded at the
+// section's own address in the modes of its mapping symbols, so listing
+// addresses match the indexes, xrefs and graphs. Otherwise the section is
+// decoded from `baseAddress` in one mode.
 extern "C" JNIEXPORT jobjectArray JNICALL
-Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getElfSectionNamesNative(
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getDisassembledInstructionsNative(
     JNIEnv* env,
-    jobject thiz) {
+    jobject thiz,
+    jstring j_section_name,
+    jlong j_base_address,
+    jboolean j_is_thumb_mode) {
+    TRACE_JNI_CALL("getDisassembledInstructions");
 
-    std::vector<std::string> section_names;
+    promote_analysis(AnalysisStage::SymbolIndex);
+    promote_analysis(AnalysisStage::ModeMap);
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+    bool mapped = j_base_address < 0;
+    uint64_t base_address = mapped ? 0 : static_cast<uint64_t>(j_base_address);
+    bool is_thumb_mode = !mapped && static_cast<bool>(j_is_thumb_mode);
+
+    std::shared_ptr<const DecodedPage> page;
     {
         std::lock_guard<std::mutex> lock(g_parser_mutex);
-        if (!g_elf_parser) {
-            LOGE_JNI("ELF parser not initialized");
+        if (!g_elf_parser || !g_arm_disassembler) {
+            LOGE_JNI("Parser not initialized");
             return nullptr;
         }
-        
-        for (const auto& sh : g_elf_parser->get_section_headers()) {
-            if (!sh.name.empty() && sh.name != "<invalid_name>") {
-                section_names.push_back(sh.name);
+        page = find_decoded_page(section_name, mapped, base_address, is_thumb_mode);
+        if (!page) {
+            const auto& sections = g_elf_parser->get_section_headers();
+            size_t section_index = 0;
+            while (section_index < sections.size() && sections[section_index].name != section_name) ++section_index;
+            const uint8_t* section_data = g_elf_parser->get_section_data_by_index(section_index);
+            if (section_data == nullptr || sections[section_index].sh_size == 0) {
+                LOGE_JNI("Section not found: %s", section_name.c_str());
+                return nullptr;
+            }
+            const SectionHeader& sh = sections[section_index];
+            if (mapped) base_address = sh.sh_addr;
+
+            auto start = std::chrono::steady_clock::now();
+            auto decoded = std::make_shared<DecodedPage>();
+            decoded->section = section_name;
+            decoded->base_address = base_address;
+            decoded->thumb = is_thumb_mode;
+            decoded->mapped = mapped;
+            decoded->with_mode_map = g_mode_map != nullptr;
+            decoded->annotated = g_operand_resolver != nullptr;
+            decoded->with_strings = g_string_table != nullptr;
+            decoded->runs = listing_runs(sh, mapped, base_address, is_thumb_mode);
+            std::vector<DisassembledInstruction> run_instructions;
+            for (const ListingRun& run : decoded->runs) {
+                g_arm_disassembler->disassemble_block_into(section_data + (run.start - base_address),
+                    run.end - run.start, run.start, run.thumb, run_instructions);
+                decoded->instructions.insert(decoded->instructions.end(),
+                                             run_instructions.begin(), run_instructions.end());
+            }
+            decoded->instructions.shrink_to_fit();
+            if (g_operand_resolver) {
+                g_operand_resolver->annotate(decoded->instructions, g_string_table.get(), decoded->comments);
             }
+            decoded->memory.set(capacity_bytes(decoded->instructions));
+            decoded->decode_cost_us = elapsed_us(start);
+            page = cache_decoded_page(std::move(decoded));
         }
     }
+    g_memory_governor.enforce();
 
-    jclass string_class = env->FindClass("java/lang/String");
-    jobjectArray result = env->NewObjectArray(section_names.size(), string_class, nullptr);
+    return build_instruction_array(env, page->instructions);
+}
 
-    for (size_t i = 0; i < section_names.size(); ++i) {
-        jstring j_str = cpp_string_to_jstring(env, section_names[i]);
-        env->SetObjectArrayElement(result, i, j_str);
-        env->DeleteLocalRef(j_str);
-    }
+// --- Byte patching ---
+//
+// A patch changes the mapping in place, so everything derived from the
+// changed bytes is refreshed right away: the instructions whose decoding
+// can change are decoded again and spliced into the sweep indexes and the
+// cached listings, and graphs built from them are dropped. Patching takes
+// the lifetime lock exclusively, so no stage or scan reads the bytes or the
+// indexes meanwhile.
 
-    return result;
+// Address range whose bytes changed, in one section.
+struct ChangedRange {
+    size_t section_index;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Loaded sections' parts of the file range; caller holds g_parser_mutex.
+static std::vector<ChangedRange> changed_address_ranges(uint64_t file_offset, uint64_t size) {
+    std::vector<ChangedRange> ranges;
+    const auto& sections = g_elf_parser->get_section_headers();
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const SectionHeader& sh = sections[i];
+        if (!(sh.sh_flags & SHF_ALLOC) || sh.sh_type == SHT_NOBITS) continue;
+        uint64_t start = std::max(file_offset, sh.sh_offset);
+        uint64_t end = std::min(file_offset + size, sh.sh_offset + sh.sh_size);
+        if (start >= end) continue;
+        ranges.push_back({i, sh.sh_addr + (start - sh.sh_offset), sh.sh_addr + (end - sh.sh_offset)});
+    }
+    return ranges;
 }
 
-extern "C" JNIEXPORT jobjectArray JNICALL
-Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getElfSymbolsNative(
-    JNIEnv* env,
-    jobject thiz) {
+// Adds [start, end) to sorted, disjoint `spans` of the same section and mode.
+static void add_span(std::vector<SweepChunk>& spans, const SweepChunk& span) {
+    auto it = std::lower_bound(spans.begin(), spans.end(), span.start,
+        [](const SweepChunk& s, uint64_t a) { return s.end < a; });
+    SweepChunk merged = span;
+    auto last = it;
+    while (last != spans.end() && last->start <= merged.end) {
+        merged.start = std::min(merged.start, last->start);
+        merged.end = std::max(merged.end, last->end);
+        ++last;
+    }
+    it = spans.erase(it, last);
+    spans.insert(it, merged);
+}
 
-    std::vector<SymbolEntry> symbols;
-    {
-        std::lock_guard<std::mutex> lock(g_parser_mutex);
-        if (!g_elf_parser) {
-            LOGE_JNI("ELF parser not initialized");
-            return nullptr;
+// Decodes the code at `dirty` again and replaces what the sweep derived
+// from it. Returns the spans that were decoded; `calls_changed` is set if a
+// call reference appeared or went away. Caller holds g_parser_mutex.
+static std::vector<SweepChunk> redecode_sweep_spans(const std::vector<ChangedRange>& dirty, bool& calls_changed) {
+    std::vector<SweepChunk> spans;
+    const auto& sections = g_elf_parser->get_section_headers();
+    for (const ChangedRange& range : dirty) {
+        const SectionHeader& sh = sections[range.section_index];
+        const uint8_t* data = g_elf_parser->get_section_data_by_index(range.section_index);
+        if (!(sh.sh_flags & SHF_EXECINSTR) || data == nullptr) continue;
+        for (const auto& run : g_mode_map->runs(sh.sh_addr, sh.sh_addr + sh.sh_size)) {
+            if (run.mode == CodeMode::Data || run.end <= range.start || range.end <= run.start) continue;
+            // Sweeps decode a run from its first aligned address
+            bool thumb = run.mode == CodeMode::Thumb;
+            uint64_t align = thumb ? 2 : 4;
+            uint64_t run_start = (run.start + align - 1) & ~(align - 1);
+            if (run_start >= run.end || range.end <= run_start) continue;
+            SweepChunk span{range.section_index, 0, 0, thumb};
+            affected_instruction_span(data + (run_start - sh.sh_addr), run_start, run.end, thumb,
+                                      range.start, range.end, span.start, span.end);
+            add_span(spans, span);
         }
-        symbols = g_elf_parser->get_symbols();
     }
 
-    jclass symbol_class = env->FindClass("com/imtiaz/ktimazrev/model/Symbol");
-    if (!symbol_class) {
-        LOGE_JNI("Failed to find Symbol class");
-        return nullptr;
-    }
+    std::vector<DisassembledInstruction> buffer;
+    for (const SweepChunk& span : spans) {
+        sweep_chunk(*g_elf_parser, *g_arm_disassembler, span,
+            [&](size_t, const std::vector<DisassembledInstruction>& instructions) {
+                std::vector<Xref> references;
+                XrefIndex::collect(*g_elf_parser, instructions, references);
+                auto is_call = [](const Xref& ref) { return ref.kind == XrefKind::Call; };
+                calls_changed = calls_changed || std::any_of(references.begin(), references.end(), is_call);
+                std::vector<Xref> removed = g_xref_index->replace_sources(span.start, span.end, std::move(references));
+                calls_changed = calls_changed || std::any_of(removed.begin(), removed.end(), is_call);
 
-    jmethodID constructor = env->GetMethodID(symbol_class, "<init>", 
-        "(Ljava/lang/String;JJLjava/lang/String;)V");
-    if (!constructor) {
-        LOGE_JNI("Failed to find Symbol constructor");
-        return nullptr;
+                if (g_string_table && g_string_table->has_references()) {
+                    std::vector<StringReference> string_references;
+                    g_string_table->collect_references(instructions, string_references);
+                    g_string_table->replace_references(span.start, span.end, std::move(string_references));
+                }
+                if (g_search_index) {
+                    g_search_index->replace_range(span.start, span.end, instructions);
+                }
+            }, buffer);
     }
+    return spans;
+}
 
-    jobjectArray result = env->NewObjectArray(symbols.size(), symbol_class, nullptr);
-
-    for (size_t i = 0; i < symbols.size(); ++i) {
-        const auto& sym = symbols[i];
-        
-        jstring j_name = cpp_string_to_jstring(env, sym.name);
-        jstring j_section = cpp_string_to_jstring(env, 
-            sym.st_shndx < g_elf_parser->get_section_headers().size() ? 
-            g_elf_parser->get_section_headers()[sym.st_shndx].name : "unknown");
+// A cached listing with the changed ranges decoded again, or null if the
+// page shows none of them. Spans are found per listing run, relative to the
+// page's base address. Caller holds g_parser_mutex.
+static std::shared_ptr<DecodedPage> splice_decoded_page(const DecodedPage& page,
+                                                        const std::vector<ChangedRange>& changed) {
+    const auto& sections = g_elf_parser->get_section_headers();
+    size_t section_index = 0;
+    while (section_index < sections.size() && sections[section_index].name != page.section) ++section_index;
+    const uint8_t* data = g_elf_parser->get_section_data_by_index(section_index);
+    if (data == nullptr || page.instructions.empty()) return nullptr;
+    const SectionHeader& sh = sections[section_index];
+    const uint64_t base = page.base_address;
 
-        jobject java_sym = env->NewObject(symbol_class, constructor,
-            j_name,
-            static_cast<jlong>(sym.st_value),
-            static_cast<jlong>(sym.st_size),
-            j_section);
+    // The page's addresses, literal targets included, are the section's
+    // shifted by base - sh_addr
+    std::vector<std::pair<uint64_t, uint64_t>> targets; // Changed ranges in page space, sorted
+    std::vector<std::pair<uint64_t, uint64_t>> spans;   // Page addresses, sorted; each within one run
+    for (const ChangedRange& range : changed) {
+        uint64_t start = base + (range.start - sh.sh_addr);
+        uint64_t end = base + (range.end - sh.sh_addr);
+        targets.emplace_back(start, end);
+        if (range.section_index != section_index) continue;
+        for (const ListingRun& run : page.runs) {
+            if (run.end <= start || end <= run.start) continue;
+            uint64_t span_start, span_end;
+            affected_instruction_span(data + (run.start - base), run.start, run.end, run.thumb,
+                                      std::max(start, run.start), std::min(end, run.end), span_start, span_end);
+            spans.emplace_back(span_start, span_end);
+        }
+    }
+    std::sort(targets.begin(), targets.end());
 
-        if (java_sym) {
-            env->SetObjectArrayElement(result, i, java_sym);
-            env->DeleteLocalRef(java_sym);
+    std::vector<uint64_t> literal_readers; // Instructions whose loaded value changed
+    for (const auto& instr : page.instructions) {
+        if (instr.data_size == 0) continue;
+        // Ranges are disjoint, so the first one ending past the target decides
+        auto range = std::upper_bound(targets.begin(), targets.end(), instr.data_target,
+            [](uint64_t target, const std::pair<uint64_t, uint64_t>& r) { return target < r.second; });
+        if (range != targets.end() && range->first < instr.data_target + instr.data_size) {
+            literal_readers.push_back(instr.address);
         }
-        
-        env->DeleteLocalRef(j_name);
-        env->DeleteLocalRef(j_section);
     }
+    if (spans.empty() && literal_readers.empty()) return nullptr;
+    std::sort(spans.begin(), spans.end());
 
-    return result;
-}
+    auto spliced = std::make_shared<DecodedPage>();
+    spliced->section = page.section;
+    spliced->base_address = base;
+    spliced->thumb = page.thumb;
+    spliced->mapped = page.mapped;
+    spliced->with_mode_map = page.with_mode_map;
+    spliced->runs = page.runs;
+    spliced->annotated = page.annotated;
+    spliced->with_strings = page.with_strings;
+    spliced->decode_cost_us = page.decode_cost_us;
 
-extern "C" JNIEXPORT jbyteArray JNICALL
-Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getHexDumpNative(
-    JNIEnv* env,
-    jobject thiz,
-    jstring j_section_name,
-    jlong j_offset,
-    jint j_length) {
+    // Unchanged instructions are copied, spans decoded again; `dirty` keeps
+    // the new instructions' index ranges for annotation
+    auto& out = spliced->instructions;
+    out.reserve(page.instructions.size());
+    std::vector<std::pair<size_t, size_t>> dirty;
+    std::vector<DisassembledInstruction> decoded;
+    auto by_address = [](const DisassembledInstruction& instr, uint64_t a) { return instr.address < a; };
+    auto kept = page.instructions.begin();
+    for (size_t i = 0; i < spans.size();) {
+        // Only overlapping spans merge: touching ones may be in different runs
+        uint64_t start = spans[i].first, end = spans[i].second;
+        for (++i; i < spans.size() && spans[i].first < end; ++i) end = std::max(end, spans[i].second);
+        auto span_first = std::lower_bound(kept, page.instructions.end(), start, by_address);
+        out.insert(out.end(), kept, span_first);
+        kept = std::lower_bound(span_first, page.instructions.end(), end, by_address);
 
-    std::string section_name = jstring_to_cpp_string(env, j_section_name);
-    size_t offset = static_cast<size_t>(j_offset);
-    size_t length = static_cast<size_t>(j_length);
+        bool thumb = find_listing_run(page.runs, start)->thumb;
+        g_arm_disassembler->disassemble_block_into(data + (start - base), end - start, start, thumb, decoded);
+        dirty.emplace_back(out.size(), out.size() + decoded.size());
+        out.insert(out.end(), decoded.begin(), decoded.end());
+    }
+    out.insert(out.end(), kept, page.instructions.end());
+    out.shrink_to_fit();
 
-    {
-        std::lock_guard<std::mutex> lock(g_parser_mutex);
-        if (!g_elf_parser) {
-            LOGE_JNI("ELF parser not initialized");
-            return nullptr;
+    for (auto& instr : out) {
+        if (!instr.comment.empty()) instr.comment = spliced->comments.copy(instr.comment);
+    }
+    if (page.annotated && g_operand_resolver) {
+        for (uint64_t address : literal_readers) {
+            size_t index = std::lower_bound(out.begin(), out.end(), address, by_address) - out.begin();
+            if (index < out.size()) dirty.emplace_back(index, index + 1);
         }
+        std::sort(dirty.begin(), dirty.end());
 
-        const uint8_t* section_data = g_elf_parser->get_section_data(section_name);
-        size_t section_size = g_elf_parser->get_section_size(section_name);
-
-        if (section_data == nullptr || section_size == 0) {
-            LOGE_JNI("Section not found: %s", section_name.c_str());
-            return env->NewByteArray(0);
+        // A comment depends on at most kPicPairWindow instructions before it,
+        // so each dirty range is annotated with that much context either side
+        const size_t window = OperandResolver::kPicPairWindow;
+        std::vector<DisassembledInstruction> context;
+        for (size_t i = 0; i < dirty.size();) {
+            size_t first = dirty[i].first, last = dirty[i].second;
+            for (++i; i < dirty.size() && dirty[i].first <= last + 2 * window; ++i) {
+                last = std::max(last, dirty[i].second);
+            }
+            size_t context_first = first > window ? first - window : 0;
+            size_t context_last = std::min(out.size(), last + window);
+            context.assign(out.begin() + context_first, out.begin() + context_last);
+            for (auto& instr : context) instr.comment = std::string_view();
+            g_operand_resolver->annotate(context, page.with_strings ? g_string_table.get() : nullptr,
+                                         spliced->comments);
+            for (size_t j = first; j < context_last; ++j) {
+                out[j].comment = context[j - context_first].comment;
+            }
         }
+    }
+    spliced->memory.set(capacity_bytes(out));
+    return spliced;
+}
 
-        size_t bytes_to_read = std::min(length, section_size - offset);
-        if (offset >= section_size) {
-            return env->NewByteArray(0);
-        }
+// Refreshes everything derived from the file bytes [file_offset, file_offset
+// + size) after a patch, undo or redo changed them. Caller holds the
+// lifetime lock exclusively and g_parser_mutex.
+static void refresh_patched_range(uint64_t file_offset, uint64_t size) {
+    KTIMAZ_TRACE_SCOPE("patch.refresh");
+    if (g_content_map && g_mode_map) {
+        g_content_map->refresh(*g_elf_parser, *g_mode_map, file_offset, size);
+    }
+    std::vector<ChangedRange> changed = changed_address_ranges(file_offset, size);
+    if (changed.empty()) return;
 
-        jbyteArray result = env->NewByteArray(bytes_to_read);
-        if (result) {
-            env->SetByteArrayRegion(result, 0, bytes_to_read, 
-                reinterpret_cast<const jbyte*>(section_data + offset));
+    // Literal loads from changed words resolve to new values, so their
+    // instructions count as changed too
+    std::vector<ChangedRange> dirty = changed;
+    bool strings_changed = false;
+    bool code_changed = false;
+    bool unwind_changed = false;
+    for (const ChangedRange& range : changed) {
+        const SectionHeader& sh = g_elf_parser->get_section_headers()[range.section_index];
+        strings_changed = strings_changed || (sh.sh_type == SHT_PROGBITS && !(sh.sh_flags & SHF_EXECINSTR));
+        code_changed = code_changed || (sh.sh_flags & SHF_EXECINSTR);
+        unwind_changed = unwind_changed || sh.name == ".eh_frame" || sh.name == ".eh_frame_hdr" ||
+            sh.sh_type == SHT_ARM_EXIDX;
+        if (!g_xref_index) continue;
+        uint64_t first_target = range.start >= 3 ? range.start - 3 : 0;
+        size_t count = g_xref_index->query(first_target, range.end, 0, 0).total_matches;
+        XrefPage readers = g_xref_index->query(first_target, range.end, 0, count);
+        for (const Xref& ref : readers.references) {
+            if (ref.kind != XrefKind::Read) continue;
+            int section = g_elf_parser->find_section_by_address(ref.source);
+            if (section >= 0) dirty.push_back({static_cast<size_t>(section), ref.source, ref.source + 1});
+        }
+    }
+
+    // Sweep results exist once the xref index does; before that, the sweep
+    // has yet to run and will see the patched bytes
+    std::vector<SweepChunk> spans;
+    if (g_xref_index && g_mode_map) {
+        bool calls_changed = false;
+        spans = redecode_sweep_spans(dirty, calls_changed);
+        if (g_code_overview) {
+            for (const ChangedRange& range : changed) {
+                g_code_overview->refresh(*g_elf_parser, *g_mode_map, *g_arm_disassembler,
+                                         range.section_index, range.start, range.end);
+            }
+        }
+        if (g_search_index) g_memory_governor.resize(g_search_index_entry, g_search_index->memory_bytes());
+        if (g_string_table) g_memory_governor.resize(g_string_table_entry, g_string_table->memory_bytes());
+        // Starts come from calls, prologues in the code and the unwind
+        // tables (which also give sizes). Neither table needs decoding;
+        // the graph references the function table
+        if ((calls_changed || code_changed || unwind_changed) && g_function_table) {
+            bool had_call_graph = g_call_graph != nullptr;
+            g_call_graph.reset();
+            auto functions = std::make_unique<FunctionTable>(
+                *g_elf_parser, *g_mode_map, g_xref_index->targets_of_kind(XrefKind::Call));
+            functions->copy_recovered_names(*g_function_table);
+            g_function_table = std::move(functions);
+            if (had_call_graph) {
+                g_call_graph = std::make_unique<CallGraph>(*g_elf_parser, *g_function_table, *g_xref_index);
+            }
+        }
+    }
+
+    if (strings_changed && g_string_table) {
+        if (g_xref_index) {
+            // Its references need a sweep, which the background rebuild does
+            g_memory_governor.forget(g_string_table_entry);
+            g_string_table.reset();
+            g_string_table_evicted = true;
+        } else {
+            g_string_table = std::make_unique<StringTable>(*g_elf_parser);
+        }
+    }
+
+    for (auto it = g_cfgs.begin(); it != g_cfgs.end();) {
+        bool stale = std::any_of(dirty.begin(), dirty.end(), [&](const ChangedRange& range) {
+            return it->second.graph->overlaps(range.start, range.end);
+        });
+        if (stale) {
+            g_memory_governor.forget(it->second.governor_id);
+            it = g_cfgs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto& cached : g_decoded_pages) {
+        std::shared_ptr<DecodedPage> spliced = splice_decoded_page(*cached, changed);
+        if (!spliced) continue;
+        g_memory_governor.forget(cached->governor_id);
+        spliced->governor_id = admit_decoded_page(spliced);
+        cached = std::move(spliced);
+    }
+
+    uint64_t span_bytes = 0;
+    for (const SweepChunk& span : spans) span_bytes += span.end - span.start;
+    log_info("Patched " + std::to_string(size) + " bytes at file offset " + std::to_string(file_offset) +
+             "; decoded " + std::to_string(span_bytes) + " bytes of code again");
+}
+
+// Offset in the file of [address, address + size), which must lie inside
+// one section with file contents. Caller holds g_parser_mutex.
+static bool address_to_file_offset(uint64_t address, uint64_t size, uint64_t& file_offset) {
+    for (const SectionHeader& sh : g_elf_parser->get_section_headers()) {
+        if (!(sh.sh_flags & SHF_ALLOC) || sh.sh_type == SHT_NOBITS) continue;
+        if (address >= sh.sh_addr && address - sh.sh_addr + size <= sh.sh_size) {
+            file_offset = sh.sh_offset + (address - sh.sh_addr);
+            return true;
+        }
+    }
+    return false;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_patchBytesNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_address,
+    jbyteArray j_bytes) {
+    TRACE_JNI_CALL("patchBytes");
+
+    std::vector<uint8_t> bytes(env->GetArrayLength(j_bytes));
+    env->GetByteArrayRegion(j_bytes, 0, bytes.size(), reinterpret_cast<jbyte*>(bytes.data()));
+    uint64_t address = static_cast<uint64_t>(j_address);
+
+    std::string error;
+    {
+        std::unique_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        uint64_t file_offset = 0;
+        if (!g_elf_parser || !g_patch_overlay) {
+            error = "No file loaded";
+        } else if (bytes.empty()) {
+            error = "Nothing to patch";
+        } else if (!address_to_file_offset(address, bytes.size(), file_offset)) {
+            error = "Address range is not inside one section with file contents";
+        } else if (patch_allowed(*g_elf_parser, file_offset, bytes.size(), error)) {
+            if (g_patch_overlay->apply(file_offset, bytes)) {
+                refresh_patched_range(file_offset, bytes.size());
+            } else {
+                error = "The mapping could not be written";
+            }
+        }
+    }
+    g_memory_governor.enforce();
+    return error.empty() ? nullptr : cpp_string_to_jstring(env, error);
+}
+
+// Reverts (undo) or reapplies (redo) the latest patch.
+static jboolean step_patch_history(bool undo) {
+    {
+        std::unique_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        PatchRange changed;
+        if (!g_elf_parser || !g_patch_overlay ||
+            !(undo ? g_patch_overlay->undo(changed) : g_patch_overlay->redo(changed))) {
+            return JNI_FALSE;
+        }
+        refresh_patched_range(changed.file_offset, changed.size);
+    }
+    g_memory_governor.enforce();
+    return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_undoPatchNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("undoPatch");
+    return step_patch_history(true);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_redoPatchNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("redoPatch");
+    return step_patch_history(false);
+}
+
+// [patches that can be undone, patches that can be redone]
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getPatchHistoryNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getPatchHistory");
+
+    jint counts[2] = {0, 0};
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (g_patch_overlay) {
+            counts[0] = static_cast<jint>(g_patch_overlay->undo_count());
+            counts[1] = static_cast<jint>(g_patch_overlay->redo_count());
+        }
+    }
+    jintArray result = env->NewIntArray(2);
+    if (result) {
+        env->SetIntArrayRegion(result, 0, 2, counts);
+    }
+    return result;
+}
+
+// Bytes that differ from the file on disk, as (address, length) pairs;
+// bytes outside loaded sections are left out.
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getPatchedRangesNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getPatchedRanges");
+
+    std::vector<jlong> pairs;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || !g_patch_overlay) {
+            return nullptr;
+        }
+        for (const PatchRange& range : g_patch_overlay->modified_ranges()) {
+            for (const ChangedRange& loaded : changed_address_ranges(range.file_offset, range.size)) {
+                pairs.push_back(static_cast<jlong>(loaded.start));
+                pairs.push_back(static_cast<jlong>(loaded.end - loaded.start));
+            }
+        }
+    }
+    jlongArray result = env->NewLongArray(pairs.size());
+    if (result) {
+        env->SetLongArrayRegion(result, 0, pairs.size(), pairs.data());
+    }
+    return result;
+}
+
+// Overview of `sectionName` at the coarsest level with at least
+// `minBuckets` buckets: [start address, bytes per bucket, bucket count],
+// then per bucket branches, calls, loads/stores, other, unknown, data bytes,
+// zero bytes, symbols and entropy (1/256 bits per byte). Null until the
+// sweep stage has run or if the section holds no code.
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getSectionOverviewNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_section_name,
+    jint min_buckets) {
+    TRACE_JNI_CALL("getSectionOverview");
+
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+    std::vector<jlong> values;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || !g_code_overview) {
+            return nullptr;
+        }
+        const auto& headers = g_elf_parser->get_section_headers();
+        size_t index = 0;
+        while (index < headers.size() && headers[index].name != section_name) ++index;
+        OverviewLevel level;
+        if (!g_code_overview->level(index, static_cast<size_t>(std::max(1, min_buckets)), level)) {
+            return nullptr;
+        }
+        values.reserve(3 + level.bucket_count * 9);
+        values.push_back(static_cast<jlong>(level.start));
+        values.push_back(static_cast<jlong>(level.bucket_bytes));
+        values.push_back(static_cast<jlong>(level.bucket_count));
+        for (size_t i = 0; i < level.bucket_count; ++i) {
+            const OverviewBucket& bucket = level.buckets[i];
+            values.insert(values.end(), {bucket.branches, bucket.calls, bucket.loads_stores, bucket.other,
+                                         bucket.unknown, bucket.data_bytes, bucket.zero_bytes, bucket.symbols,
+                                         bucket.entropy});
+        }
+    }
+    jlongArray result = env->NewLongArray(values.size());
+    if (result) {
+        env->SetLongArrayRegion(result, 0, values.size(), values.data());
+    }
+    return result;
+}
+
+// Content map of the loaded file: [file offset, size, class, entropy (1/256
+// bits per byte), code score (0..255)] per region. Null until the content
+// map stage has run.
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getContentRegionsNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getContentRegions");
+
+    std::vector<jlong> values;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_content_map) {
+            return nullptr;
+        }
+        std::vector<ContentRegion> regions = g_content_map->regions();
+        values.reserve(regions.size() * 5);
+        for (const ContentRegion& region : regions) {
+            values.insert(values.end(), {static_cast<jlong>(region.file_offset), static_cast<jlong>(region.size),
+                                         static_cast<jlong>(region.content), region.entropy, region.code_score});
+        }
+    }
+    jlongArray result = env->NewLongArray(values.size());
+    if (result) {
+        env->SetLongArrayRegion(result, 0, values.size(), values.data());
+    }
+    return result;
+}
+
+// Counts of each of the 256 byte values in [offset, offset + size) of the
+// loaded file, clipped to its end. Null if no file is loaded or the range
+// starts past the end.
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getByteHistogramNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong offset,
+    jlong size) {
+    TRACE_JNI_CALL("getByteHistogram");
+
+    uint32_t histogram[256];
+    {
+        // Patches take the lifetime lock exclusively, so the bytes stay put
+        std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || offset < 0 || size < 0 ||
+            static_cast<uint64_t>(offset) >= g_mapped_file.size) {
+            return nullptr;
+        }
+        size_t length = static_cast<size_t>(std::min<uint64_t>(size, g_mapped_file.size - offset));
+        byte_histogram(g_mapped_file.data + offset, length, histogram);
+    }
+    jintArray result = env->NewIntArray(256);
+    if (result) {
+        env->SetIntArrayRegion(result, 0, 256, reinterpret_cast<const jint*>(histogram));
+    }
+    return result;
+}
+
+// Writes the loaded file with all applied patches to `outputPath`.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_exportPatchedFileNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_output_path) {
+    TRACE_JNI_CALL("exportPatchedFile");
+
+    std::string output_path = jstring_to_cpp_string(env, j_output_path);
+    // Patches take the lifetime lock exclusively, so the bytes stay put
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    const PatchOverlay* overlay;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        overlay = g_patch_overlay.get();
+    }
+    return overlay && overlay->export_to(output_path) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Streams the listing of `sectionName` (every code section when empty) to
+// the open descriptor `fd`, which the caller closes. Returns the number of
+// lines written, or -1 on failure or when another file is loaded meanwhile.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_exportListingNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint fd,
+    jstring j_section_name,
+    jint format) {
+    TRACE_JNI_CALL("exportListing");
+
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    const ElfParser* parser;
+    const ModeMap* mode_map;
+    ListingExportOptions options;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || !g_scheduler) {
+            log_error("exportListing: no ELF file loaded");
+            return -1;
+        }
+        parser = g_elf_parser.get();
+        mode_map = g_mode_map.get();
+        options.resolver = g_operand_resolver.get();
+        if (g_symbol_index) options.demangler = &g_symbol_index->demangler();
+        generation = g_load_generation;
+    }
+    // The string table can be evicted mid-export, so comments leave out
+    // string literals
+
+    if (!section_name.empty()) {
+        const auto& headers = parser->get_section_headers();
+        size_t index = 0;
+        while (index < headers.size() && headers[index].name != section_name) ++index;
+        if (index == headers.size()) {
+            log_error("exportListing: no section " + section_name);
+            return -1;
+        }
+        options.sections.push_back(index);
+    }
+    options.format = format == static_cast<jint>(ListingFormat::JsonLines) ? ListingFormat::JsonLines
+                                                                           : ListingFormat::Text;
+    options.cancelled = [generation]() { return superseded(generation); };
+
+    // Before the mode map stage has run, build one just for this export
+    std::unique_ptr<ModeMap> local_mode_map;
+    if (!mode_map) {
+        local_mode_map = std::make_unique<ModeMap>(*parser, default_code_mode(*parser));
+        mode_map = local_mode_map.get();
+    }
+    ListingExportStats stats;
+    if (!export_listing(fd, *parser, *mode_map, *g_scheduler, options, &stats)) return -1;
+    return static_cast<jlong>(stats.instructions);
+}
+
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getElfSectionNamesNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getElfSectionNames");
+
+    std::vector<std::string> section_names;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser) {
+            LOGE_JNI("ELF parser not initialized");
+            return nullptr;
+        }
+        
+        for (const auto& sh : g_elf_parser->get_section_headers()) {
+            if (!sh.name.empty() && sh.name != "<invalid_name>") {
+                section_names.emplace_back(sh.name);
+            }
+        }
+    }
+
+    jclass string_class = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray(section_names.size(), string_class, nullptr);
+
+    for (size_t i = 0; i < section_names.size(); ++i) {
+        jstring j_str = cpp_string_to_jstring(env, section_names[i]);
+        env->SetObjectArrayElement(result, i, j_str);
+        env->DeleteLocalRef(j_str);
+    }
+
+    return result;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_isSearchIndexReadyNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("isSearchIndexReady");
+
+    promote_analysis(AnalysisStage::Sweep);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    use_search_index();
+    return g_search_index ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_searchInstructionsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_query,
+    jlong j_range_start,
+    jlong j_range_end,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("searchInstructions");
+
+    promote_analysis(AnalysisStage::Sweep);
+    std::string query = jstring_to_cpp_string(env, j_query);
+
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/InstructionSearchPage");
+    if (!page_class) {
+        LOGE_JNI("Failed to find InstructionSearchPage class");
+        return nullptr;
+    }
+    jmethodID page_constructor = env->GetMethodID(page_class, "<init>", "(I[J)V");
+    if (!page_constructor) {
+        LOGE_JNI("Failed to find InstructionSearchPage constructor");
+        return nullptr;
+    }
+
+    InstructionSearchResult hits;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        use_search_index();
+        if (!g_search_index) {
+            LOGE_JNI("Search index not ready");
+            return nullptr;
+        }
+        hits = g_search_index->search(query,
+            static_cast<uint64_t>(j_range_start), static_cast<uint64_t>(j_range_end),
+            static_cast<size_t>(std::max(0, j_offset)), static_cast<size_t>(std::max(0, j_limit)));
+    }
+
+    jlongArray addresses = env->NewLongArray(hits.addresses.size());
+    if (!addresses) return nullptr;
+    env->SetLongArrayRegion(addresses, 0, hits.addresses.size(),
+        reinterpret_cast<const jlong*>(hits.addresses.data()));
+
+    jobject result = env->NewObject(page_class, page_constructor,
+        static_cast<jint>(hits.total_matches), addresses);
+    env->DeleteLocalRef(addresses);
+    return result;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_validatePatternNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_pattern) {
+    TRACE_JNI_CALL("validatePattern");
+
+    BytePattern pattern;
+    std::string error;
+    if (BytePattern::parse(jstring_to_cpp_string(env, j_pattern), pattern, error)) {
+        return nullptr;
+    }
+    return cpp_string_to_jstring(env, error);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_startPatternSearchNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_pattern,
+    jstring j_section_name) {
+    TRACE_JNI_CALL("startPatternSearch");
+
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+    BytePattern pattern;
+    std::string error;
+    if (!BytePattern::parse(jstring_to_cpp_string(env, j_pattern), pattern, error)) {
+        LOGE_JNI("Invalid byte pattern: %s", error.c_str());
+        return -1;
+    }
+    if (!g_scheduler) {
+        return -1;
+    }
+
+    auto cancel = std::make_shared<CancellationGroup>();
+    jlong search_id;
+    {
+        std::lock_guard<std::mutex> lock(g_pattern_search_mutex);
+        search_id = g_next_pattern_search_id++;
+        g_pattern_searches[search_id] = cancel;
+    }
+    uint64_t generation = g_load_generation;
+    jobject callback_target = env->NewGlobalRef(thiz);
+
+    // Not tied to the group: the task must run to report completion and release its refs
+    g_scheduler->submit([=]() {
+        JNIEnv* current_env;
+        bool attached = false;
+        if (g_vm->GetEnv(reinterpret_cast<void**>(&current_env), JNI_VERSION_1_6) != JNI_OK) {
+            if (g_vm->AttachCurrentThread(&current_env, nullptr) != JNI_OK) {
+                LOGE_JNI("Failed to attach thread!");
+                return;
+            }
+            attached = true;
+        }
+
+        jclass cls = current_env->GetObjectClass(callback_target);
+        jmethodID onMatchesMethod = current_env->GetMethodID(cls, "onPatternMatches", "(J[J[J[I)V");
+        jmethodID onFinishedMethod = current_env->GetMethodID(cls, "onPatternSearchFinished", "(JJZ)V");
+
+        size_t total = 0;
+        if (onMatchesMethod && onFinishedMethod) {
+            std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+            const ElfParser* parser = nullptr;
+            uint64_t range_begin = 0, range_end = 0;
+            {
+                std::lock_guard<std::mutex> lock(g_parser_mutex);
+                if (generation == g_load_generation && g_elf_parser) {
+                    parser = g_elf_parser.get();
+                    range_end = g_mapped_file.size;
+                    if (!section_name.empty()) {
+                        range_end = 0;
+                        for (const auto& sh : parser->get_section_headers()) {
+                            if (sh.name == section_name && sh.sh_type != SHT_NOBITS) {
+                                range_begin = sh.sh_offset;
+                                range_end = sh.sh_offset + sh.sh_size;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (parser && range_begin < range_end) {
+                PatternScanner scanner(*parser);
+                total = scanner.scan(pattern, range_begin, range_end, cancel->flag(),
+                    [&](const std::vector<PatternMatch>& batch) {
+                        std::vector<jlong> offsets(batch.size()), addresses(batch.size());
+                        std::vector<jint> sections(batch.size());
+                        for (size_t i = 0; i < batch.size(); ++i) {
+                            offsets[i] = static_cast<jlong>(batch[i].file_offset);
+                            addresses[i] = static_cast<jlong>(batch[i].virtual_address);
+                            sections[i] = batch[i].section_index;
+                        }
+                        jlongArray j_offsets = current_env->NewLongArray(batch.size());
+                        jlongArray j_addresses = current_env->NewLongArray(batch.size());
+                        jintArray j_sections = current_env->NewIntArray(batch.size());
+                        if (!j_offsets || !j_addresses || !j_sections) return false;
+                        current_env->SetLongArrayRegion(j_offsets, 0, batch.size(), offsets.data());
+                        current_env->SetLongArrayRegion(j_addresses, 0, batch.size(), addresses.data());
+                        current_env->SetIntArrayRegion(j_sections, 0, batch.size(), sections.data());
+                        current_env->CallVoidMethod(callback_target, onMatchesMethod,
+                            search_id, j_offsets, j_addresses, j_sections);
+                        current_env->DeleteLocalRef(j_offsets);
+                        current_env->DeleteLocalRef(j_addresses);
+                        current_env->DeleteLocalRef(j_sections);
+                        return true;
+                    }, *g_scheduler, TaskPriority::Background);
+            } else if (!parser) {
+                LOGE_JNI("Pattern search %lld: no file loaded", static_cast<long long>(search_id));
+            }
+        } else {
+            LOGE_JNI("Failed to find pattern search callback methods!");
+        }
+
+        bool cancelled = cancel->is_cancelled();
+        {
+            std::lock_guard<std::mutex> lock(g_pattern_search_mutex);
+            g_pattern_searches.erase(search_id);
+        }
+        if (onFinishedMethod) {
+            current_env->CallVoidMethod(callback_target, onFinishedMethod,
+                search_id, static_cast<jlong>(total), static_cast<jboolean>(cancelled));
+        }
+        current_env->DeleteLocalRef(cls);
+        current_env->DeleteGlobalRef(callback_target);
+
+        if (attached) {
+            g_vm->DetachCurrentThread();
+        }
+    }, TaskPriority::Background);
+
+    return search_id;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_cancelPatternSearchNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_search_id) {
+    TRACE_JNI_CALL("cancelPatternSearch");
+
+    std::lock_guard<std::mutex> lock(g_pattern_search_mutex);
+    auto it = g_pattern_searches.find(j_search_id);
+    if (it != g_pattern_searches.end()) {
+        it->second->cancel();
+    }
+}
+
+// Marshals the given symbols into a Symbol[]; caller must hold g_parser_mutex.
+// Section names are created once per section rather than once per symbol.
+// With `demangle`, C++ names also carry their demangled form.
+static jobjectArray build_symbol_array(JNIEnv* env, const std::vector<uint32_t>& indices, bool demangle) {
+    jclass symbol_class = env->FindClass("com/imtiaz/ktimazrev/model/Symbol");
+    if (!symbol_class) {
+        LOGE_JNI("Failed to find Symbol class");
+        return nullptr;
+    }
+
+    jmethodID constructor = env->GetMethodID(symbol_class, "<init>", 
+        "(Ljava/lang/String;JJLjava/lang/String;Ljava/lang/String;I)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find Symbol constructor");
+        return nullptr;
+    }
+
+    jobjectArray result = env->NewObjectArray(indices.size(), symbol_class, nullptr);
+    if (!result) return nullptr;
+
+    const size_t section_count = g_elf_parser->get_section_headers().size();
+    std::vector<jstring> section_strings(section_count + 1, nullptr); // last slot: "unknown"
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const uint32_t index = indices[i];
+        const auto& sym = g_symbol_index->symbol(index);
+
+        size_t section_slot = sym.st_shndx < section_count ? sym.st_shndx : section_count;
+        if (!section_strings[section_slot]) {
+            section_strings[section_slot] = utf8_to_jstring(env, g_symbol_index->section_name_for(index));
+        }
+
+        jstring j_name = utf8_to_jstring(env, sym.name);
+        jstring j_demangled = nullptr;
+        if (demangle) {
+            std::string_view demangled = g_symbol_index->demangled_name(index);
+            if (demangled.data() != sym.name.data()) j_demangled = utf8_to_jstring(env, demangled);
+        }
+        jobject java_sym = env->NewObject(symbol_class, constructor,
+            j_name,
+            static_cast<jlong>(sym.st_value),
+            static_cast<jlong>(sym.st_size),
+            section_strings[section_slot],
+            j_demangled,
+            static_cast<jint>(index));
+
+        if (java_sym) {
+            env->SetObjectArrayElement(result, i, java_sym);
+            env->DeleteLocalRef(java_sym);
+        }
+        env->DeleteLocalRef(j_name);
+        if (j_demangled) env->DeleteLocalRef(j_demangled);
+    }
+
+    for (jstring j_section : section_strings) {
+        if (j_section) env->DeleteLocalRef(j_section);
+    }
+    return result;
+}
+
+// Symbols with values in [start, end), by address, for labelling the rows
+// of a listing; null until the symbol index is built.
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getSymbolsInRangeNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_start,
+    jlong j_end) {
+    TRACE_JNI_CALL("getSymbolsInRange");
+
+    promote_analysis(AnalysisStage::SymbolIndex);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (!g_elf_parser || !g_symbol_index) {
+        return nullptr;
+    }
+    std::vector<uint32_t> indices =
+        g_symbol_index->in_address_range(static_cast<uint64_t>(j_start), static_cast<uint64_t>(j_end));
+    return build_symbol_array(env, indices, true);
+}
+
+// Symbols at any of `addresses` (function values with the Thumb bit), for
+// naming branch targets outside the listing; null until the symbol index
+// is built.
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getSymbolsAtNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlongArray j_addresses) {
+    TRACE_JNI_CALL("getSymbolsAt");
+
+    promote_analysis(AnalysisStage::SymbolIndex);
+    jsize count = j_addresses ? env->GetArrayLength(j_addresses) : 0;
+    std::vector<jlong> addresses(count);
+    if (count > 0) env->GetLongArrayRegion(j_addresses, 0, count, addresses.data());
+
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (!g_elf_parser || !g_symbol_index) {
+        return nullptr;
+    }
+    std::vector<uint32_t> indices;
+    for (jlong j_address : addresses) {
+        uint64_t address = static_cast<uint64_t>(j_address);
+        for (uint32_t index : g_symbol_index->in_address_range(address, address + 2)) {
+            const SymbolEntry& sym = g_symbol_index->symbol(index);
+            if (sym.st_value == address || (sym.st_info & 0xF) == STT_FUNC) indices.push_back(index);
+        }
+    }
+    return build_symbol_array(env, indices, true);
+}
+
+// The function or object symbol containing `address`, or null.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getSymbolContainingNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_address) {
+    TRACE_JNI_CALL("getSymbolContaining");
+
+    promote_analysis(AnalysisStage::SymbolIndex);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (!g_elf_parser || !g_symbol_index) {
+        return nullptr;
+    }
+    long index = g_symbol_index->containing(static_cast<uint64_t>(j_address));
+    if (index < 0) return nullptr;
+    jobjectArray array = build_symbol_array(env, {static_cast<uint32_t>(index)}, true);
+    return array ? env->GetObjectArrayElement(array, 0) : nullptr;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_querySymbolsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_text,
+    jint j_match_mode,
+    jint j_type,
+    jint j_binding,
+    jstring j_section_name,
+    jint j_sort_key,
+    jboolean j_descending,
+    jboolean j_demangled,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("querySymbols");
+
+    promote_analysis(AnalysisStage::SymbolIndex);
+    SymbolQuery query;
+    query.text = jstring_to_cpp_string(env, j_text);
+    query.match_mode = static_cast<TextMatchMode>(j_match_mode);
+    query.type = j_type;
+    query.binding = j_binding;
+    query.sort_key = static_cast<SymbolSortKey>(j_sort_key);
+    query.descending = static_cast<bool>(j_descending);
+    query.demangled = static_cast<bool>(j_demangled);
+    query.offset = static_cast<size_t>(std::max(0, j_offset));
+    query.limit = static_cast<size_t>(std::max(0, j_limit));
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/SymbolPage");
+    if (!page_class) {
+        LOGE_JNI("Failed to find SymbolPage class");
+        return nullptr;
+    }
+    jmethodID page_constructor = env->GetMethodID(page_class, "<init>",
+        "(I[Lcom/imtiaz/ktimazrev/model/Symbol;)V");
+    if (!page_constructor) {
+        LOGE_JNI("Failed to find SymbolPage constructor");
+        return nullptr;
+    }
+
+    // The first demangled query demangles every symbol, in parallel and
+    // without g_parser_mutex; the lifetime lock keeps the index alive
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    if (query.demangled) {
+        const SymbolIndex* symbols;
+        {
+            std::lock_guard<std::mutex> lock(g_parser_mutex);
+            symbols = g_symbol_index.get();
+        }
+        if (symbols) symbols->prepare_demangled_names(*g_scheduler, TaskPriority::Interactive);
+    }
+
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (!g_elf_parser || !g_symbol_index) {
+        LOGE_JNI("Symbol index not initialized");
+        return nullptr;
+    }
+
+    if (!section_name.empty()) {
+        query.section_index = g_symbol_index->section_index_by_name(section_name);
+        if (query.section_index < 0) {
+            LOGE_JNI("Section not found: %s", section_name.c_str());
+        }
+    }
+
+    SymbolQueryResult page;
+    if (section_name.empty() || query.section_index >= 0) {
+        page = g_symbol_index->query(query);
+    }
+
+    jobjectArray symbols = build_symbol_array(env, page.symbol_indices, true);
+    if (!symbols) return nullptr;
+
+    jobject result = env->NewObject(page_class, page_constructor,
+        static_cast<jint>(page.total_matches), symbols);
+    env->DeleteLocalRef(symbols);
+    return result;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_queryStringsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_text,
+    jint j_match_mode,
+    jstring j_section_name,
+    jint j_encoding,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("queryStrings");
+
+    promote_analysis(AnalysisStage::Strings);
+    StringQuery query;
+    query.text = jstring_to_cpp_string(env, j_text);
+    query.match_mode = static_cast<TextMatchMode>(j_match_mode);
+    query.encoding = j_encoding;
+    query.offset = static_cast<size_t>(std::max(0, j_offset));
+    query.limit = static_cast<size_t>(std::max(0, j_limit));
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/StringPage");
+    jclass string_class = env->FindClass("com/imtiaz/ktimazrev/model/ExtractedString");
+    if (!page_class || !string_class) {
+        LOGE_JNI("Failed to find StringPage/ExtractedString class");
+        return nullptr;
+    }
+    jmethodID page_constructor = env->GetMethodID(page_class, "<init>",
+        "(I[Lcom/imtiaz/ktimazrev/model/ExtractedString;)V");
+    jmethodID string_constructor = env->GetMethodID(string_class, "<init>",
+        "(IJJLjava/lang/String;ILjava/lang/String;I)V");
+    if (!page_constructor || !string_constructor) {
+        LOGE_JNI("Failed to find StringPage/ExtractedString constructor");
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    use_string_table();
+    if (!g_elf_parser || !g_string_table) {
+        return nullptr; // Not loaded yet, extraction still running, or evicted
+    }
+
+    const auto& sections = g_elf_parser->get_section_headers();
+    if (!section_name.empty()) {
+        for (size_t i = 0; i < sections.size(); ++i) {
+            if (sections[i].name == section_name) {
+                query.section_index = static_cast<int>(i);
+                break;
+            }
+        }
+        if (query.section_index < 0) {
+            LOGE_JNI("Section not found: %s", section_name.c_str());
+        }
+    }
+
+    StringQueryResult page;
+    if (section_name.empty() || query.section_index >= 0) {
+        page = g_string_table->query(query);
+    }
+
+    jobjectArray strings = env->NewObjectArray(page.string_indices.size(), string_class, nullptr);
+    if (!strings) return nullptr;
+
+    std::vector<jstring> section_names(sections.size(), nullptr);
+    for (size_t i = 0; i < page.string_indices.size(); ++i) {
+        uint32_t index = page.string_indices[i];
+        const ExtractedString& entry = g_string_table->string(index);
+        jstring& j_section = section_names[entry.section_index];
+        if (!j_section) {
+            j_section = utf8_to_jstring(env, sections[entry.section_index].name);
+        }
+        jstring j_string_text = utf8_to_jstring(env, g_string_table->text(index));
+        jint reference_count = g_string_table->has_references()
+            ? static_cast<jint>(g_string_table->reference_count(index)) : -1;
+
+        jobject j_entry = env->NewObject(string_class, string_constructor,
+            static_cast<jint>(index),
+            static_cast<jlong>(entry.virtual_address),
+            static_cast<jlong>(entry.file_offset),
+            j_section,
+            static_cast<jint>(entry.encoding),
+            j_string_text,
+            reference_count);
+        env->SetObjectArrayElement(strings, i, j_entry);
+        env->DeleteLocalRef(j_entry);
+        env->DeleteLocalRef(j_string_text);
+    }
+    for (jstring j_section : section_names) {
+        if (j_section) env->DeleteLocalRef(j_section);
+    }
+
+    jobject result = env->NewObject(page_class, page_constructor,
+        static_cast<jint>(page.total_matches), strings);
+    env->DeleteLocalRef(strings);
+    return result;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getStringReferencesNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint j_string_index) {
+    TRACE_JNI_CALL("getStringReferences");
+
+    promote_analysis(AnalysisStage::Sweep);
+    std::vector<uint64_t> references;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        use_string_table();
+        if (!g_string_table || j_string_index < 0) {
+            return nullptr;
+        }
+        references = g_string_table->references_to(static_cast<uint32_t>(j_string_index));
+    }
+
+    jlongArray result = env->NewLongArray(references.size());
+    if (!result) return nullptr;
+    std::vector<jlong> values(references.begin(), references.end());
+    env->SetLongArrayRegion(result, 0, values.size(), values.data());
+    return result;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getNativeMemoryUsageNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getNativeMemoryUsage");
+
+    constexpr size_t kCategories = static_cast<size_t>(MemoryCategory::Count);
+    MemoryUsage usage = memory_usage();
+    jlong values[2 * kCategories];
+    for (size_t i = 0; i < kCategories; ++i) {
+        values[i] = static_cast<jlong>(usage.bytes[i]);
+        values[kCategories + i] = static_cast<jlong>(usage.peak_bytes[i]);
+    }
+
+    jlongArray result = env->NewLongArray(2 * kCategories);
+    if (!result) return nullptr;
+    env->SetLongArrayRegion(result, 0, 2 * kCategories, values);
+    return result;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_setNativeMemoryBudgetNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_budget_bytes) {
+    TRACE_JNI_CALL("setNativeMemoryBudget");
+
+    g_memory_governor.set_budget(static_cast<size_t>(std::max<jlong>(0, j_budget_bytes)));
+    g_memory_governor.enforce();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_trimNativeMemoryNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint j_level) {
+    TRACE_JNI_CALL("trimNativeMemory");
+
+    return static_cast<jlong>(g_memory_governor.trim(static_cast<int>(j_level)));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_getTraceStatsNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("getTraceStats");
+
+    jclass stats_class = env->FindClass("com/imtiaz/ktimazrev/model/TraceStats");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!stats_class || !string_class) {
+        LOGE_JNI("Failed to find TraceStats class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(stats_class, "<init>", "(Z[Ljava/lang/String;[J[J[J[J)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find TraceStats constructor");
+        return nullptr;
+    }
+
+    TraceStats stats = trace_stats();
+    size_t site_count = stats.sites.size();
+    std::vector<jlong> counts, total_ns, max_ns;
+    jobjectArray j_names = env->NewObjectArray(site_count, string_class, nullptr);
+    if (!j_names) return nullptr;
+    for (size_t i = 0; i < site_count; ++i) {
+        const TraceSiteStats& site = stats.sites[i];
+        jstring j_name = cpp_string_to_jstring(env, site.name);
+        env->SetObjectArrayElement(j_names, i, j_name);
+        env->DeleteLocalRef(j_name);
+        counts.push_back(static_cast<jlong>(site.count));
+        total_ns.push_back(static_cast<jlong>(site.total_ns));
+        max_ns.push_back(static_cast<jlong>(site.max_ns));
+    }
+
+    auto to_long_array = [env](const jlong* values, size_t count) {
+        jlongArray array = env->NewLongArray(count);
+        if (array) env->SetLongArrayRegion(array, 0, count, values);
+        return array;
+    };
+    constexpr size_t kCounters = static_cast<size_t>(TraceCounter::Count);
+    jlong counters[kCounters];
+    for (size_t i = 0; i < kCounters; ++i) {
+        counters[i] = static_cast<jlong>(stats.counters[i]);
+    }
+
+    return env->NewObject(stats_class, constructor,
+        static_cast<jboolean>(tracing_enabled()),
+        j_names,
+        to_long_array(counts.data(), site_count),
+        to_long_array(total_ns.data(), site_count),
+        to_long_array(max_ns.data(), site_count),
+        to_long_array(counters, kCounters));
+}
+
+// Writes the buffered trace events as Chrome trace JSON; false if tracing is
+// compiled out or the file cannot be written.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_exportTraceNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_output_path) {
+    TRACE_JNI_CALL("exportTrace");
+
+    if (!tracing_enabled()) {
+        return JNI_FALSE;
+    }
+    std::string output_path = jstring_to_cpp_string(env, j_output_path);
+    std::string json = trace_export_chrome_json();
+    FILE* output = fopen(output_path.c_str(), "w");
+    if (!output) {
+        LOGE_JNI("Cannot write trace to %s", output_path.c_str());
+        return JNI_FALSE;
+    }
+    bool written = fwrite(json.data(), 1, json.size(), output) == json.size();
+    written = fclose(output) == 0 && written;
+    return written ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_FileLoaderViewModel_resetTraceNative(
+    JNIEnv* env,
+    jobject thiz) {
+    TRACE_JNI_CALL("resetTrace");
+
+    trace_reset();
+}
+
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getHexDumpNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_section_name,
+    jlong j_offset,
+    jint j_length) {
+    TRACE_JNI_CALL("getHexDump");
+
+    std::string section_name = jstring_to_cpp_string(env, j_section_name);
+    size_t offset = static_cast<size_t>(j_offset);
+    size_t length = static_cast<size_t>(j_length);
+
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser) {
+            LOGE_JNI("ELF parser not initialized");
+            return nullptr;
+        }
+
+        const uint8_t* section_data = g_elf_parser->get_section_data(section_name);
+        size_t section_size = g_elf_parser->get_section_size(section_name);
+
+        if (section_data == nullptr || section_size == 0) {
+            LOGE_JNI("Section not found: %s", section_name.c_str());
+            return env->NewByteArray(0);
+        }
+
+        size_t bytes_to_read = std::min(length, section_size - offset);
+        if (offset >= section_size) {
+            return env->NewByteArray(0);
+        }
+
+        jbyteArray result = env->NewByteArray(bytes_to_read);
+        if (result) {
+            env->SetByteArrayRegion(result, 0, bytes_to_read, 
+                reinterpret_cast<const jbyte*>(section_data + offset));
         }
         return result;
     }
-}
\ No newline at end of file
+}
+
+static jobject build_cfg_summary(JNIEnv* env, const ControlFlowGraph& cfg) {
+    jclass summary_class = env->FindClass("com/imtiaz/ktimazrev/model/CfgSummary");
+    if (!summary_class) {
+        LOGE_JNI("Failed to find CfgSummary class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(summary_class, "<init>", "(JIIIIIZ)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find CfgSummary constructor");
+        return nullptr;
+    }
+
+    return env->NewObject(summary_class, constructor,
+        static_cast<jlong>(cfg.entry()),
+        static_cast<jint>(cfg.block_count()),
+        static_cast<jint>(cfg.edge_count()),
+        static_cast<jint>(cfg.loop_count()),
+        static_cast<jint>(cfg.layout_width()),
+        static_cast<jint>(cfg.layout_height()),
+        static_cast<jboolean>(cfg.truncated()));
+}
+
+// Graph of the function at `address`, from the cache or built now.
+static std::shared_ptr<const ControlFlowGraph> find_or_build_cfg(uint64_t address) {
+    // Decoding a large function takes a while, so build under the shared
+    // lifetime lock and only take g_parser_mutex to publish the result.
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    const ElfParser* parser;
+    bool thumb;
+    uint64_t generation;
+    uint64_t function_start = 0, function_end = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser) {
+            LOGE_JNI("Parser not initialized");
+            return nullptr;
+        }
+        // Already built, e.g. for the entry point by the analysis pipeline
+        auto cached = g_cfgs.find(address & ~1ULL);
+        if (cached != g_cfgs.end()) {
+            g_memory_governor.touch(cached->second.governor_id);
+            return cached->second.graph;
+        }
+        parser = g_elf_parser.get();
+        CodeMode mode = g_mode_map ? g_mode_map->mode_at(address) : default_code_mode(*parser);
+        thumb = (address & 1) != 0 || mode == CodeMode::Thumb;
+        generation = g_load_generation;
+
+        long function = g_function_table ? g_function_table->find_containing(address & ~1ULL) : -1;
+        if (function >= 0) {
+            const FunctionInfo& info = g_function_table->function(static_cast<uint32_t>(function));
+            function_start = info.start;
+            function_end = info.end;
+            thumb = info.thumb;
+        }
+    }
+    address &= ~1ULL;
+
+    // Until the function table is built, fall back to symbols and sections
+    if (function_end == 0 && !find_function_bounds(*parser, address, function_start, function_end)) {
+        LOGE_JNI("No section contains 0x%llx", static_cast<unsigned long long>(address));
+        return nullptr;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ArmDisassembler disassembler;
+    auto cfg = std::make_unique<ControlFlowGraph>(
+        *parser, disassembler, address, thumb, function_start, function_end);
+    if (cfg->empty()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (generation != g_load_generation) {
+        return nullptr;
+    }
+    return cache_cfg(std::move(cfg), elapsed_us(start));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_buildCfgNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_address) {
+    TRACE_JNI_CALL("buildCfg");
+
+    promote_analysis(AnalysisStage::Functions);
+    std::shared_ptr<const ControlFlowGraph> cfg = find_or_build_cfg(static_cast<uint64_t>(j_address));
+    if (!cfg) {
+        return nullptr;
+    }
+    g_memory_governor.enforce();
+    return build_cfg_summary(env, *cfg);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getCfgViewportNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_entry,
+    jint j_x0,
+    jint j_y0,
+    jint j_x1,
+    jint j_y1) {
+    TRACE_JNI_CALL("getCfgViewport");
+
+    std::vector<jint> block_ids, block_x, block_y, block_width, block_height, block_flags;
+    std::vector<jlong> block_addresses;
+    std::vector<std::string> block_text;
+    std::vector<jint> edge_coords, edge_kinds;
+    {
+        // Rebuilt here if the governor evicted it since buildCfgNative
+        std::shared_ptr<const ControlFlowGraph> cfg = find_or_build_cfg(static_cast<uint64_t>(j_entry));
+        if (!cfg) {
+            return nullptr;
+        }
+        CfgViewport viewport = cfg->viewport(j_x0, j_y0, j_x1, j_y1);
+
+        for (uint32_t b : viewport.blocks) {
+            const auto& node = cfg->node(b);
+            block_ids.push_back(static_cast<jint>(b));
+            block_addresses.push_back(static_cast<jlong>(cfg->block(b).start));
+            block_x.push_back(node.x);
+            block_y.push_back(node.y);
+            block_width.push_back(node.width);
+            block_height.push_back(node.height);
+            block_flags.push_back(static_cast<jint>(cfg->block(b).flags));
+            block_text.push_back(cfg->block_text(b));
+        }
+        for (uint32_t e : viewport.edges) {
+            const auto& edge = cfg->edge(e);
+            const auto& from = cfg->node(edge.from);
+            const auto& to = cfg->node(edge.to);
+            edge_coords.push_back(from.x + from.width / 2);
+            edge_coords.push_back(from.y + from.height);
+            edge_coords.push_back(to.x + to.width / 2);
+            edge_coords.push_back(to.y);
+            edge_kinds.push_back(static_cast<jint>(edge.kind));
+        }
+    }
+
+    jclass viewport_class = env->FindClass("com/imtiaz/ktimazrev/model/CfgViewport");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!viewport_class || !string_class) {
+        LOGE_JNI("Failed to find CfgViewport class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(viewport_class, "<init>",
+        "([I[J[I[I[I[I[I[Ljava/lang/String;[I[I)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find CfgViewport constructor");
+        return nullptr;
+    }
+
+    auto to_int_array = [env](const std::vector<jint>& values) {
+        jintArray array = env->NewIntArray(values.size());
+        if (array) env->SetIntArrayRegion(array, 0, values.size(), values.data());
+        return array;
+    };
+
+    jlongArray j_addresses = env->NewLongArray(block_addresses.size());
+    if (j_addresses) {
+        env->SetLongArrayRegion(j_addresses, 0, block_addresses.size(), block_addresses.data());
+    }
+    jobjectArray j_text = env->NewObjectArray(block_text.size(), string_class, nullptr);
+    if (!j_addresses || !j_text) return nullptr;
+    for (size_t i = 0; i < block_text.size(); ++i) {
+        jstring j_line = cpp_string_to_jstring(env, block_text[i]);
+        env->SetObjectArrayElement(j_text, i, j_line);
+        env->DeleteLocalRef(j_line);
+    }
+
+    return env->NewObject(viewport_class, constructor,
+        to_int_array(block_ids),
+        j_addresses,
+        to_int_array(block_x),
+        to_int_array(block_y),
+        to_int_array(block_width),
+        to_int_array(block_height),
+        to_int_array(block_flags),
+        j_text,
+        to_int_array(edge_coords),
+        to_int_array(edge_kinds));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getXrefsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_target_start,
+    jlong j_target_end,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("getXrefs");
+
+    promote_analysis(AnalysisStage::Sweep);
+    XrefPage page;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_xref_index) {
+            return nullptr; // Still being built
+        }
+        page = g_xref_index->query(static_cast<uint64_t>(j_target_start), static_cast<uint64_t>(j_target_end),
+                                   static_cast<size_t>(std::max<jint>(j_offset, 0)),
+                                   static_cast<size_t>(std::max<jint>(j_limit, 0)));
+    }
+
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/XrefPage");
+    if (!page_class) {
+        LOGE_JNI("Failed to find XrefPage class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(page_class, "<init>", "(I[J[J[I)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find XrefPage constructor");
+        return nullptr;
+    }
+
+    size_t count = page.references.size();
+    std::vector<jlong> sources(count), targets(count);
+    std::vector<jint> kinds(count);
+    for (size_t i = 0; i < count; ++i) {
+        sources[i] = static_cast<jlong>(page.references[i].source);
+        targets[i] = static_cast<jlong>(page.references[i].target);
+        kinds[i] = static_cast<jint>(page.references[i].kind);
+    }
+
+    jlongArray j_sources = env->NewLongArray(count);
+    jlongArray j_targets = env->NewLongArray(count);
+    jintArray j_kinds = env->NewIntArray(count);
+    if (!j_sources || !j_targets || !j_kinds) return nullptr;
+    env->SetLongArrayRegion(j_sources, 0, count, sources.data());
+    env->SetLongArrayRegion(j_targets, 0, count, targets.data());
+    env->SetIntArrayRegion(j_kinds, 0, count, kinds.data());
+
+    return env->NewObject(page_class, constructor,
+        static_cast<jint>(page.total_matches), j_sources, j_targets, j_kinds);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_getFunctionsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("getFunctions");
+
+    promote_analysis(AnalysisStage::Functions);
+    size_t total = 0;
+    std::vector<jlong> starts, ends;
+    std::vector<jint> flags;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_function_table) {
+            return nullptr; // Still being built
+        }
+        total = g_function_table->size();
+        size_t first = std::min(total, static_cast<size_t>(std::max<jint>(j_offset, 0)));
+        size_t last = std::min(total, first + static_cast<size_t>(std::max<jint>(j_limit, 0)));
+        for (size_t i = first; i < last; ++i) {
+            const FunctionInfo& info = g_function_table->function(static_cast<uint32_t>(i));
+            starts.push_back(static_cast<jlong>(info.start));
+            ends.push_back(static_cast<jlong>(info.end));
+            bool recovered = !g_function_table->recovered_name(static_cast<uint32_t>(i)).empty();
+            flags.push_back(static_cast<jint>(info.sources) | (info.thumb ? 0x100 : 0) | (recovered ? 0x200 : 0));
+            names.push_back(g_function_table->name(static_cast<uint32_t>(i)));
+        }
+    }
+
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/FunctionPage");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!page_class || !string_class) {
+        LOGE_JNI("Failed to find FunctionPage class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(page_class, "<init>", "(I[J[J[I[Ljava/lang/String;)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find FunctionPage constructor");
+        return nullptr;
+    }
+
+    size_t count = starts.size();
+    jlongArray j_starts = env->NewLongArray(count);
+    jlongArray j_ends = env->NewLongArray(count);
+    jintArray j_flags = env->NewIntArray(count);
+    jobjectArray j_names = env->NewObjectArray(count, string_class, nullptr);
+    if (!j_starts || !j_ends || !j_flags || !j_names) return nullptr;
+    env->SetLongArrayRegion(j_starts, 0, count, starts.data());
+    env->SetLongArrayRegion(j_ends, 0, count, ends.data());
+    env->SetIntArrayRegion(j_flags, 0, count, flags.data());
+    for (size_t i = 0; i < count; ++i) {
+        jstring j_name = cpp_string_to_jstring(env, names[i]);
+        env->SetObjectArrayElement(j_names, i, j_name);
+        env->DeleteLocalRef(j_name);
+    }
+
+    return env->NewObject(page_class, constructor,
+        static_cast<jint>(total), j_starts, j_ends, j_flags, j_names);
+}
+
+// Diffs the functions of an older build at `oldPath` against the loaded
+// file. Returns the added, removed and changed functions with the count of
+// unchanged ones, or null while the function table is still being built or
+// if the old file cannot be read.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_diffFunctionsNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_old_path) {
+    TRACE_JNI_CALL("diffFunctions");
+
+    promote_analysis(AnalysisStage::Functions);
+    std::string old_path = jstring_to_cpp_string(env, j_old_path);
+    // Patches replace the function table under the exclusive lifetime lock
+    std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    const ElfParser* parser;
+    const ModeMap* mode_map;
+    const FunctionTable* functions;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || !g_mode_map || !g_function_table || !g_scheduler) {
+            return nullptr; // Still being built
+        }
+        parser = g_elf_parser.get();
+        mode_map = g_mode_map.get();
+        functions = g_function_table.get();
+    }
+
+    MappedFile old_file = map_file(old_path);
+    if (old_file.data == nullptr) {
+        log_error("diffFunctions: cannot map " + old_path);
+        return nullptr;
+    }
+    FunctionDiffResult result;
+    std::vector<jint> changes;
+    std::vector<jlong> old_starts, old_ends, new_starts, new_ends;
+    std::vector<std::string> names;
+    try {
+        ElfParser old_parser(old_file);
+        if (!old_parser.parse()) {
+            log_error("diffFunctions: ELF parsing failed for " + old_path);
+            unmap_file(old_file);
+            return nullptr;
+        }
+        ModeMap old_mode_map(old_parser, default_code_mode(old_parser));
+        std::unique_ptr<FunctionTable> old_functions =
+            build_function_table(old_parser, old_mode_map, *g_scheduler, TaskPriority::Interactive);
+        result = diff_functions({old_parser, old_mode_map, *old_functions}, {*parser, *mode_map, *functions},
+                                *g_scheduler, TaskPriority::Interactive);
+
+        auto append_range = [](const FunctionTable& table, int64_t index, std::vector<jlong>& starts,
+                               std::vector<jlong>& ends) {
+            const FunctionInfo* info = index >= 0 ? &table.function(static_cast<uint32_t>(index)) : nullptr;
+            starts.push_back(info ? static_cast<jlong>(info->start) : -1);
+            ends.push_back(info ? static_cast<jlong>(info->end) : -1);
+        };
+        for (const FunctionDiffEntry& entry : result.entries) {
+            if (entry.change == FunctionChange::Unchanged) continue;
+            changes.push_back(static_cast<jint>(entry.change) | static_cast<jint>(entry.matched_by) << 8);
+            append_range(*old_functions, entry.old_index, old_starts, old_ends);
+            append_range(*functions, entry.new_index, new_starts, new_ends);
+            names.push_back(entry.new_index >= 0 ? functions->name(static_cast<uint32_t>(entry.new_index))
+                                                 : old_functions->name(static_cast<uint32_t>(entry.old_index)));
+        }
+    } catch (const std::exception& e) {
+        log_error(std::string("diffFunctions: ") + e.what());
+        unmap_file(old_file);
+        return nullptr;
+    }
+    unmap_file(old_file);
+
+    jclass diff_class = env->FindClass("com/imtiaz/ktimazrev/model/FunctionDiff");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!diff_class || !string_class) {
+        LOGE_JNI("Failed to find FunctionDiff class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(diff_class, "<init>", "(I[I[J[J[J[J[Ljava/lang/String;)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find FunctionDiff constructor");
+        return nullptr;
+    }
+
+    size_t count = changes.size();
+    jintArray j_changes = env->NewIntArray(count);
+    jlongArray j_old_starts = env->NewLongArray(count);
+    jlongArray j_old_ends = env->NewLongArray(count);
+    jlongArray j_new_starts = env->NewLongArray(count);
+    jlongArray j_new_ends = env->NewLongArray(count);
+    jobjectArray j_names = env->NewObjectArray(count, string_class, nullptr);
+    if (!j_changes || !j_old_starts || !j_old_ends || !j_new_starts || !j_new_ends || !j_names) return nullptr;
+    env->SetIntArrayRegion(j_changes, 0, count, changes.data());
+    env->SetLongArrayRegion(j_old_starts, 0, count, old_starts.data());
+    env->SetLongArrayRegion(j_old_ends, 0, count, old_ends.data());
+    env->SetLongArrayRegion(j_new_starts, 0, count, new_starts.data());
+    env->SetLongArrayRegion(j_new_ends, 0, count, new_ends.data());
+    for (size_t i = 0; i < count; ++i) {
+        jstring j_name = cpp_string_to_jstring(env, names[i]);
+        env->SetObjectArrayElement(j_names, i, j_name);
+        env->DeleteLocalRef(j_name);
+    }
+
+    return env->NewObject(diff_class, constructor, static_cast<jint>(result.unchanged), j_changes,
+        j_old_starts, j_old_ends, j_new_starts, j_new_ends, j_names);
+}
+
+// Names the unnamed functions of the loaded file that the signature
+// database at `databasePath` identifies. Returns how many were named, or -1
+// while the function table is still being built, if the database cannot
+// be loaded or if another file is loaded meanwhile.
+extern "C" JNIEXPORT jint JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_applySignaturesNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_database_path) {
+    TRACE_JNI_CALL("applySignatures");
+
+    promote_analysis(AnalysisStage::Functions);
+    SignatureDatabase database;
+    if (!database.load(jstring_to_cpp_string(env, j_database_path))) return -1;
+
+    std::vector<std::pair<uint64_t, std::string_view>> names;
+    uint64_t generation;
+    {
+        // Match without blocking readers; patches wait
+        std::shared_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+        const ElfParser* parser;
+        const FunctionTable* functions;
+        {
+            std::lock_guard<std::mutex> lock(g_parser_mutex);
+            if (!g_elf_parser || !g_function_table || !g_scheduler) {
+                return -1; // Still being built
+            }
+            parser = g_elf_parser.get();
+            functions = g_function_table.get();
+            generation = g_load_generation;
+        }
+        for (const SignatureMatch& match : database.match(*parser, *functions, *g_scheduler,
+                                                          TaskPriority::Interactive, true)) {
+            names.emplace_back(match.address, database.name(match.signature));
+        }
+    }
+
+    // Renaming changes the table under readers that hold no parser lock
+    std::unique_lock<std::shared_mutex> lifetime_lock(g_file_lifetime_mutex);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (generation != g_load_generation || !g_function_table) return -1;
+    jint named = 0;
+    for (const auto& [address, name] : names) {
+        // A patch may have rebuilt the table in between
+        long index = g_function_table->find_containing(address);
+        if (index < 0 || g_function_table->function(static_cast<uint32_t>(index)).start != address) continue;
+        g_function_table->set_recovered_name(static_cast<uint32_t>(index), name);
+        ++named;
+    }
+    if (g_call_graph && g_xref_index) {
+        // Its name lookup is built once
+        g_call_graph = std::make_unique<CallGraph>(*g_elf_parser, *g_function_table, *g_xref_index);
+    }
+    log_info("applySignatures: named " + std::to_string(named) + " functions");
+    return named;
+}
+
+// Resolves the imports of the shared libraries at `paths` (typically the
+// lib/<abi>/ directory of an app) against each other. Independent of the
+// loaded file. Returns null if none of them can be read.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_linkLibrariesNative(
+    JNIEnv* env,
+    jobject thiz,
+    jobjectArray j_paths) {
+    TRACE_JNI_CALL("linkLibraries");
+
+    TaskScheduler* scheduler;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        scheduler = g_scheduler.get();
+    }
+    if (!scheduler) return nullptr;
+
+    struct OpenLibrary {
+        MappedFile file;
+        std::unique_ptr<ElfParser> parser;
+    };
+    std::vector<OpenLibrary> opened;
+    auto close_all = [&opened]() {
+        for (OpenLibrary& library : opened) {
+            library.parser.reset();
+            unmap_file(library.file);
+        }
+    };
+    jsize path_count = j_paths ? env->GetArrayLength(j_paths) : 0;
+    std::vector<std::string> paths;
+    for (jsize i = 0; i < path_count; ++i) {
+        auto j_path = static_cast<jstring>(env->GetObjectArrayElement(j_paths, i));
+        std::string path = jstring_to_cpp_string(env, j_path);
+        env->DeleteLocalRef(j_path);
+        MappedFile file = map_file(path);
+        if (file.data == nullptr) {
+            log_error("linkLibraries: cannot map " + path);
+            continue;
+        }
+        try {
+            auto parser = std::make_unique<ElfParser>(file);
+            if (!parser->parse()) throw std::runtime_error("ELF parsing failed");
+            opened.push_back({file, std::move(parser)});
+            paths.push_back(std::move(path));
+        } catch (const std::exception& e) {
+            log_error("linkLibraries: " + path + ": " + e.what());
+            unmap_file(file);
+        }
+    }
+    if (opened.empty()) return nullptr;
+
+    std::vector<jint> export_counts, needed_owners, needed_libraries, import_owners, import_providers, import_flags;
+    std::vector<std::string> names, needed_names, import_names, import_versions;
+    try {
+        LinkGraph graph;
+        for (size_t i = 0; i < opened.size(); ++i) graph.add_library(paths[i], *opened[i].parser);
+        graph.link(*scheduler, TaskPriority::Interactive);
+        for (uint32_t l = 0; l < graph.size(); ++l) {
+            const LinkedLibrary& library = graph.library(l);
+            const DynamicInfo& dynamic = *library.dynamic;
+            names.push_back(library.name);
+            export_counts.push_back(static_cast<jint>(dynamic.exports().size()));
+            for (size_t i = 0; i < dynamic.needed().size(); ++i) {
+                needed_owners.push_back(static_cast<jint>(l));
+                needed_names.emplace_back(dynamic.needed()[i]);
+                needed_libraries.push_back(library.needed[i]);
+            }
+            for (size_t i = 0; i < library.imports.size(); ++i) {
+                const DynamicSymbol& import = dynamic.imports()[i];
+                import_owners.push_back(static_cast<jint>(l));
+                import_names.emplace_back(import.name);
+                import_versions.emplace_back(import.version);
+                import_providers.push_back(library.imports[i].library);
+                import_flags.push_back(static_cast<jint>(library.imports[i].binding) | (import.weak ? 0x100 : 0));
+            }
+        }
+    } catch (const std::exception& e) {
+        log_error(std::string("linkLibraries: ") + e.what());
+        close_all();
+        return nullptr;
+    }
+    close_all();
+
+    jclass links_class = env->FindClass("com/imtiaz/ktimazrev/model/LibraryLinks");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!links_class || !string_class) {
+        LOGE_JNI("Failed to find LibraryLinks class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(links_class, "<init>",
+        "([Ljava/lang/String;[Ljava/lang/String;[I[I[Ljava/lang/String;[I"
+        "[I[Ljava/lang/String;[Ljava/lang/String;[I[I)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find LibraryLinks constructor");
+        return nullptr;
+    }
+
+    auto new_int_array = [env](const std::vector<jint>& values) {
+        jintArray array = env->NewIntArray(values.size());
+        if (array) env->SetIntArrayRegion(array, 0, values.size(), values.data());
+        return array;
+    };
+    auto new_string_array = [env, string_class](const std::vector<std::string>& values) {
+        jobjectArray array = env->NewObjectArray(values.size(), string_class, nullptr);
+        for (size_t i = 0; array && i < values.size(); ++i) {
+            jstring j_value = cpp_string_to_jstring(env, values[i]);
+            env->SetObjectArrayElement(array, i, j_value);
+            env->DeleteLocalRef(j_value);
+        }
+        return array;
+    };
+    jobjectArray j_paths_out = new_string_array(paths);
+    jobjectArray j_names = new_string_array(names);
+    jintArray j_export_counts = new_int_array(export_counts);
+    jintArray j_needed_owners = new_int_array(needed_owners);
+    jobjectArray j_needed_names = new_string_array(needed_names);
+    jintArray j_needed_libraries = new_int_array(needed_libraries);
+    jintArray j_import_owners = new_int_array(import_owners);
+    jobjectArray j_import_names = new_string_array(import_names);
+    jobjectArray j_import_versions = new_string_array(import_versions);
+    jintArray j_import_providers = new_int_array(import_providers);
+    jintArray j_import_flags = new_int_array(import_flags);
+    if (!j_paths_out || !j_names || !j_export_counts || !j_needed_owners || !j_needed_names ||
+        !j_needed_libraries || !j_import_owners || !j_import_names || !j_import_versions ||
+        !j_import_providers || !j_import_flags) {
+        return nullptr;
+    }
+
+    return env->NewObject(links_class, constructor, j_paths_out, j_names, j_export_counts, j_needed_owners,
+        j_needed_names, j_needed_libraries, j_import_owners, j_import_names, j_import_versions,
+        j_import_providers, j_import_flags);
+}
+
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_disassembleFunctionNative(
+    JNIEnv* env,
+    jobject thiz,
+    jlong j_address) {
+    TRACE_JNI_CALL("disassembleFunction");
+
+    promote_analysis(AnalysisStage::Functions);
+    uint64_t address = static_cast<uint64_t>(j_address) & ~1ULL;
+
+    std::vector<DisassembledInstruction> instructions;
+    Arena comments(MemoryCategory::Decode);
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_elf_parser || !g_arm_disassembler || !g_function_table || !g_mode_map) {
+            return nullptr;
+        }
+        long function = g_function_table->find_containing(address);
+        if (function < 0) {
+            return nullptr;
+        }
+        const FunctionInfo& info = g_function_table->function(static_cast<uint32_t>(function));
+
+        // Literal pools inside the function are skipped via mapping symbols
+        std::vector<DisassembledInstruction> decoded;
+        for (const auto& run : g_mode_map->runs(info.start, info.end)) {
+            if (run.mode == CodeMode::Data) continue;
+            const uint8_t* data = g_elf_parser->get_data_at_address(run.start, run.end - run.start);
+            if (data == nullptr) continue;
+            g_arm_disassembler->disassemble_block_into(data, run.end - run.start, run.start, info.thumb, decoded);
+            instructions.insert(instructions.end(), decoded.begin(), decoded.end());
+        }
+        if (g_operand_resolver) {
+            g_operand_resolver->annotate(instructions, g_string_table.get(), comments);
+        }
+    }
+
+    return build_instruction_array(env, instructions);
+}
+
+// Fills a CallGraphPage from node ids; caller holds g_parser_mutex.
+static void describe_call_graph_nodes(const std::vector<uint32_t>& nodes, std::vector<jint>& ids,
+                                      std::vector<jlong>& addresses, std::vector<std::string>& names,
+                                      std::vector<jint>& flags) {
+    for (uint32_t node : nodes) {
+        ids.push_back(static_cast<jint>(node));
+        addresses.push_back(static_cast<jlong>(g_call_graph->address(node)));
+        names.push_back(g_call_graph->name(node));
+        flags.push_back(static_cast<jint>(g_call_graph->flags(node)));
+    }
+}
+
+static jobject build_call_graph_page(JNIEnv* env, size_t total, const std::vector<jint>& ids,
+                                     const std::vector<jlong>& addresses, const std::vector<std::string>& names,
+                                     const std::vector<jint>& flags) {
+    jclass page_class = env->FindClass("com/imtiaz/ktimazrev/model/CallGraphPage");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (!page_class || !string_class) {
+        LOGE_JNI("Failed to find CallGraphPage class");
+        return nullptr;
+    }
+    jmethodID constructor = env->GetMethodID(page_class, "<init>", "(I[I[J[Ljava/lang/String;[I)V");
+    if (!constructor) {
+        LOGE_JNI("Failed to find CallGraphPage constructor");
+        return nullptr;
+    }
+
+    size_t count = ids.size();
+    jintArray j_ids = env->NewIntArray(count);
+    jlongArray j_addresses = env->NewLongArray(count);
+    jobjectArray j_names = env->NewObjectArray(count, string_class, nullptr);
+    jintArray j_flags = env->NewIntArray(count);
+    if (!j_ids || !j_addresses || !j_names || !j_flags) return nullptr;
+    env->SetIntArrayRegion(j_ids, 0, count, ids.data());
+    env->SetLongArrayRegion(j_addresses, 0, count, addresses.data());
+    env->SetIntArrayRegion(j_flags, 0, count, flags.data());
+    for (size_t i = 0; i < count; ++i) {
+        jstring j_name = cpp_string_to_jstring(env, names[i]);
+        env->SetObjectArrayElement(j_names, i, j_name);
+        env->DeleteLocalRef(j_name);
+    }
+
+    return env->NewObject(page_class, constructor,
+        static_cast<jint>(total), j_ids, j_addresses, j_names, j_flags);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_findCallGraphNodeNative(
+    JNIEnv* env,
+    jobject thiz,
+    jstring j_name_or_address) {
+    TRACE_JNI_CALL("findCallGraphNode");
+
+    promote_analysis(AnalysisStage::CallGraph);
+    std::string key = jstring_to_cpp_string(env, j_name_or_address);
+    std::lock_guard<std::mutex> lock(g_parser_mutex);
+    if (!g_call_graph) {
+        return -1;
+    }
+    // "0x..." is an address inside the function, anything else an exact name
+    if (key.size() > 2 && key[0] == '0' && (key[1] == 'x' || key[1] == 'X')) {
+        char* end = nullptr;
+        uint64_t address = strtoull(key.c_str() + 2, &end, 16);
+        if (end != nullptr && *end == '\0') {
+            return static_cast<jint>(g_call_graph->find_by_address(address));
+        }
+    }
+    return static_cast<jint>(g_call_graph->find_by_name(key));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_queryCallGraphNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint j_node,
+    jint j_kind,
+    jint j_offset,
+    jint j_limit) {
+    TRACE_JNI_CALL("queryCallGraph");
+
+    promote_analysis(AnalysisStage::CallGraph);
+    if (j_node < 0 || j_kind < 0 || j_kind > static_cast<jint>(CallGraphQuery::Reaching)) {
+        return nullptr;
+    }
+
+    size_t total = 0;
+    std::vector<jint> ids, flags;
+    std::vector<jlong> addresses;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_call_graph || static_cast<size_t>(j_node) >= g_call_graph->node_count()) {
+            return nullptr;
+        }
+        CallGraphPage page = g_call_graph->query(static_cast<uint32_t>(j_node), static_cast<CallGraphQuery>(j_kind),
+                                                 static_cast<size_t>(std::max<jint>(j_offset, 0)),
+                                                 static_cast<size_t>(std::max<jint>(j_limit, 0)));
+        total = page.total_matches;
+        describe_call_graph_nodes(page.nodes, ids, addresses, names, flags);
+    }
+    return build_call_graph_page(env, total, ids, addresses, names, flags);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_imtiaz_ktimazrev_viewmodel_DisassemblyViewModel_callPathNative(
+    JNIEnv* env,
+    jobject thiz,
+    jint j_from,
+    jint j_to) {
+    TRACE_JNI_CALL("callPath");
+
+    promote_analysis(AnalysisStage::CallGraph);
+    if (j_from < 0 || j_to < 0) {
+        return nullptr;
+    }
+
+    std::vector<jint> ids, flags;
+    std::vector<jlong> addresses;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(g_parser_mutex);
+        if (!g_call_graph) {
+            return nullptr;
+        }
+        describe_call_graph_nodes(g_call_graph->shortest_path(static_cast<uint32_t>(j_from),
+                                                              static_cast<uint32_t>(j_to)),
+                                  ids, addresses, names, flags);
+    }
+    return build_call_graph_page(env, ids.size(), ids, addresses, names, flags);
+}
@@ -0,0 +1,158 @@
+#include "../include/operand_resolver.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t kMaxStringPreview = 48;
+
+enum class ResolvedKind : uint8_t {
+    Literal, // Constant loaded from a literal pool
+    Address  // Address formed by ADR or a PC add
+};
+
+struct Resolved {
+    uint64_t value;
+    uint32_t instruction;
+    ResolvedKind kind;
+};
+
+std::string hex(uint64_t value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "0x%llX", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+std::string quote(std::string_view text) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size() && i < kMaxStringPreview; ++i) {
+        char c = text[i];
+        if (c == '\n') quoted += "\\n";
+        else if (c == '\t') quoted += "\\t";
+        else if (c == '"' || c == '\\') quoted += std::string("\\") + c;
+        else quoted += c;
+    }
+    if (text.size() > kMaxStringPreview) quoted += "...";
+    return quoted + "\"";
+}
+
+bool is_mapping_symbol(std::string_view name) {
+    return name.size() >= 2 && name[0] == '$' && (name[1] == 'a' || name[1] == 't' || name[1] == 'd');
+}
+
+} // namespace
+
+OperandResolver::OperandResolver(const ElfParser& parser) : parser_(parser) {
+    const auto& symbols = parser.get_symbols();
+    for (uint32_t i = 0; i < symbols.size(); ++i) {
+        const SymbolEntry& symbol = symbols[i];
+        uint8_t type = symbol.st_info & 0xF;
+        if (symbol.st_shndx == SHN_UNDEF || symbol.st_value == 0 || symbol.name.empty()) continue;
+        if (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE) continue;
+        if (is_mapping_symbol(symbol.name)) continue;
+
+        uint64_t start = type == STT_FUNC ? symbol.st_value & ~1ULL : symbol.st_value;
+        ranges_.push_back({start, start + symbol.st_size, i});
+    }
+
+    // Keep the largest symbol per address; sized ones describe what is there
+    std::sort(ranges_.begin(), ranges_.end(), [](const NamedRange& a, const NamedRange& b) {
+        if (a.start != b.start) return a.start < b.start;
+        return a.end > b.end;
+    });
+    ranges_.erase(std::unique(ranges_.begin(), ranges_.end(),
+        [](const NamedRange& a, const NamedRange& b) { return a.start == b.start; }), ranges_.end());
+    ranges_.shrink_to_fit();
+}
+
+std::string OperandResolver::name_for(const NamedRange* range, uint64_t address) const {
+    if (range == nullptr) return "";
+    std::string_view name = parser_.get_symbols()[range->symbol].name;
+    if (address == range->start) return std::string(name);
+    if (address < range->end) return std::string(name) + "+" + hex(address - range->start);
+    return "";
+}
+
+void OperandResolver::annotate(std::vector<DisassembledInstruction>& instructions, const StringTable* strings,
+                               Arena& text) const {
+    // Pass 1: values, tracking literal loads that a later ADD Rd, PC, Rm turns into addresses
+    std::vector<Resolved> resolved;
+    uint64_t register_value[16];
+    size_t loaded_at[16];
+    uint32_t live = 0; // Registers holding a tracked literal
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const DisassembledInstruction& instr = instructions[i];
+        uint32_t index = static_cast<uint32_t>(i);
+
+        if (instr.data_target != 0) {
+            if (instr.data_size == 0) {
+                resolved.push_back({instr.data_target, index, ResolvedKind::Address});
+                if (instr.data_register < 16) live &= ~(1u << instr.data_register);
+            } else {
+                const uint8_t* literal = parser_.get_data_at_address(instr.data_target, instr.data_size);
+                if (literal == nullptr) continue;
+                uint32_t value = 0;
+                memcpy(&value, literal, instr.data_size);
+                resolved.push_back({value, index, ResolvedKind::Literal});
+                if (instr.data_register < 16 && instr.data_size == 4) {
+                    register_value[instr.data_register] = value;
+                    loaded_at[instr.data_register] = i;
+                    live |= 1u << instr.data_register;
+                }
+            }
+        } else if (instr.pc_add_register < 16 && (live & (1u << instr.pc_add_register)) &&
+                   i - loaded_at[instr.pc_add_register] <= kPicPairWindow) {
+            // PC reads as address + 4 in Thumb (only 16-bit forms exist) and + 8 in ARM
+            uint64_t pc = instr.address + (instr.size == 2 ? 4 : 8);
+            uint64_t address = (register_value[instr.pc_add_register] + pc) & 0xFFFFFFFFULL;
+            resolved.push_back({address, index, ResolvedKind::Address});
+            live &= ~(1u << instr.data_register);
+        } else if (instr.is_branch) {
+            live = 0;
+        }
+    }
+    if (resolved.empty()) return;
+
+    // Pass 2: name all values of the run in one sorted sweep
+    std::sort(resolved.begin(), resolved.end(),
+        [](const Resolved& a, const Resolved& b) { return a.value < b.value; });
+    std::vector<long> string_hits;
+    if (strings != nullptr) {
+        std::vector<uint64_t> values;
+        values.reserve(resolved.size());
+        for (const Resolved& r : resolved) values.push_back(r.value);
+        string_hits = strings->find_by_addresses(values);
+    }
+
+    size_t cursor = 0; // First range starting after the current value
+    std::string comment;
+    for (size_t i = 0; i < resolved.size(); ++i) {
+        const Resolved& r = resolved[i];
+        while (cursor < ranges_.size() && ranges_[cursor].start <= r.value) ++cursor;
+        const NamedRange* range = cursor > 0 ? &ranges_[cursor - 1] : nullptr;
+
+        std::string name;
+        if (!string_hits.empty() && string_hits[i] >= 0) {
+            name = quote(strings->text(static_cast<uint32_t>(string_hits[i])));
+        } else {
+            name = name_for(range, r.value);
+        }
+
+        DisassembledInstruction& instr = instructions[r.instruction];
+        if (r.kind == ResolvedKind::Literal) {
+            comment = "=" + hex(r.value);
+        } else if (instr.data_target != 0) {
+            comment.clear(); // ADR already shows the address
+        } else {
+            comment = hex(r.value);
+        }
+        if (!name.empty()) {
+            if (!comment.empty()) comment += ' ';
+            comment += name;
+        }
+        instr.comment = text.copy(comment);
+    }
+}
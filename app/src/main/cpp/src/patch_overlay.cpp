@@ -0,0 +1,135 @@
+#include "../include/patch_overlay.h"
+#include "../include/trace.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace {
+
+bool overlaps(uint64_t start, uint64_t end, uint64_t other_start, uint64_t other_end) {
+    return start < other_end && other_start < end;
+}
+
+} // namespace
+
+bool PatchOverlay::write(uint64_t file_offset, const std::vector<uint8_t>& bytes) {
+    KTIMAZ_TRACE_SCOPE("patch.write");
+    // The mapping starts on a page boundary, so offsets align like addresses
+    const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t first_page = file_offset & ~(page_size - 1);
+    uint64_t end_page = (file_offset + bytes.size() + page_size - 1) & ~(page_size - 1);
+    uint8_t* pages = const_cast<uint8_t*>(file_.data) + first_page;
+
+    if (mprotect(pages, end_page - first_page, PROT_READ | PROT_WRITE) != 0) {
+        log_error("Cannot make the mapping writable at offset " + std::to_string(file_offset));
+        return false;
+    }
+    memcpy(const_cast<uint8_t*>(file_.data) + file_offset, bytes.data(), bytes.size());
+    if (mprotect(pages, end_page - first_page, PROT_READ) != 0) {
+        log_error("Cannot make the mapping read-only again at offset " + std::to_string(file_offset));
+    }
+    return true;
+}
+
+bool PatchOverlay::apply(uint64_t file_offset, const std::vector<uint8_t>& bytes) {
+    if (file_.data == nullptr || bytes.empty() || file_offset > file_.size ||
+        bytes.size() > file_.size - file_offset) {
+        log_error("Patch outside the file: offset " + std::to_string(file_offset) +
+                  ", " + std::to_string(bytes.size()) + " bytes");
+        return false;
+    }
+    Patch patch{file_offset,
+                std::vector<uint8_t>(file_.data + file_offset, file_.data + file_offset + bytes.size()),
+                bytes};
+    if (!write(file_offset, bytes)) return false;
+    undo_.push_back(std::move(patch));
+    redo_.clear();
+    return true;
+}
+
+bool PatchOverlay::undo(PatchRange& changed) {
+    if (undo_.empty() || !write(undo_.back().file_offset, undo_.back().before)) return false;
+    changed = {undo_.back().file_offset, undo_.back().before.size()};
+    redo_.push_back(std::move(undo_.back()));
+    undo_.pop_back();
+    return true;
+}
+
+bool PatchOverlay::redo(PatchRange& changed) {
+    if (redo_.empty() || !write(redo_.back().file_offset, redo_.back().after)) return false;
+    changed = {redo_.back().file_offset, redo_.back().after.size()};
+    undo_.push_back(std::move(redo_.back()));
+    redo_.pop_back();
+    return true;
+}
+
+std::vector<PatchRange> PatchOverlay::modified_ranges() const {
+    // The oldest patch covering a byte holds its original value
+    std::map<uint64_t, uint8_t> original;
+    for (const Patch& patch : undo_) {
+        for (size_t i = 0; i < patch.before.size(); ++i) {
+            original.emplace(patch.file_offset + i, patch.before[i]);
+        }
+    }
+
+    std::vector<PatchRange> ranges;
+    for (const auto& byte : original) {
+        if (file_.data[byte.first] == byte.second) continue;
+        if (!ranges.empty() && ranges.back().file_offset + ranges.back().size == byte.first) {
+            ++ranges.back().size;
+        } else {
+            ranges.push_back({byte.first, 1});
+        }
+    }
+    return ranges;
+}
+
+bool PatchOverlay::export_to(const std::string& path) const {
+    KTIMAZ_TRACE_SCOPE("patch.export");
+    if (file_.data == nullptr) return false;
+    std::string temporary = path + ".tmp";
+    FILE* output = fopen(temporary.c_str(), "wb");
+    if (!output) {
+        log_error("Cannot write patched file: " + temporary);
+        return false;
+    }
+    bool written = fwrite(file_.data, 1, file_.size, output) == file_.size;
+    written = fflush(output) == 0 && fsync(fileno(output)) == 0 && written;
+    written = fclose(output) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        log_error("Failed to export patched file to " + path);
+        remove(temporary.c_str());
+        return false;
+    }
+    log_info("Exported patched file (" + std::to_string(undo_.size()) + " patches) to " + path);
+    return true;
+}
+
+bool patch_allowed(const ElfParser& parser, uint64_t file_offset, uint64_t size, std::string& error) {
+    const ElfHeader& header = parser.get_header();
+    uint64_t end = file_offset + size;
+    error.clear();
+    if (overlaps(file_offset, end, 0, header.e_ehsize)) {
+        error = "the ELF header";
+    } else if (header.e_phnum != 0 &&
+               overlaps(file_offset, end, header.e_phoff,
+                        header.e_phoff + static_cast<uint64_t>(header.e_phnum) * header.e_phentsize)) {
+        error = "the program header table";
+    } else if (overlaps(file_offset, end, header.e_shoff,
+                        header.e_shoff + static_cast<uint64_t>(header.e_shnum) * header.e_shentsize)) {
+        error = "the section header table";
+    } else {
+        for (const SectionHeader& sh : parser.get_section_headers()) {
+            if ((sh.sh_type == SHT_SYMTAB || sh.sh_type == SHT_DYNSYM || sh.sh_type == SHT_STRTAB) &&
+                overlaps(file_offset, end, sh.sh_offset, sh.sh_offset + sh.sh_size)) {
+                error = "section " + std::string(sh.name);
+                break;
+            }
+        }
+    }
+    if (error.empty()) return true;
+    error = "Patch would change " + error + ", which has already been parsed";
+    return false;
+}
@@ -0,0 +1,258 @@
+#include "../include/pattern_search.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KTIMAZ_PATTERN_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define KTIMAZ_PATTERN_SSE2 1
+#endif
+
+namespace {
+
+constexpr size_t kChunkSize = 4 * 1024 * 1024;
+constexpr size_t kBatchSize = 4096;
+constexpr size_t kNoAnchor = std::numeric_limits<size_t>::max();
+
+int parse_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Calls fn(i) for every i in [begin, end) with data[i] == value.
+template<typename Fn>
+void find_byte(const uint8_t* data, size_t begin, size_t end, uint8_t value, Fn&& fn) {
+    size_t i = begin;
+#if defined(KTIMAZ_PATTERN_NEON)
+    const uint8x16_t needle = vdupq_n_u8(value);
+    for (; i + 16 <= end; i += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(data + i), needle);
+        // Narrow 16 compare bytes into a 64-bit mask with 4 bits per byte.
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        while (mask != 0) {
+            unsigned lane = __builtin_ctzll(mask) >> 2;
+            fn(i + lane);
+            mask &= ~(0xFULL << (lane * 4));
+        }
+    }
+#elif defined(KTIMAZ_PATTERN_SSE2)
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= end; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        while (mask != 0) {
+            fn(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < end; ++i) {
+        if (data[i] == value) fn(i);
+    }
+}
+
+} // namespace
+
+bool BytePattern::matches_at(const uint8_t* data) const {
+    for (size_t i = 0; i < values.size(); ++i) {
+        if ((data[i] & masks[i]) != values[i]) return false;
+    }
+    return true;
+}
+
+bool BytePattern::parse(const std::string& text, BytePattern& out, std::string& error) {
+    out.values.clear();
+    out.masks.clear();
+
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+        size_t start = i;
+        while (i < text.size() && !isspace(static_cast<unsigned char>(text[i]))) ++i;
+        std::string token = text.substr(start, i - start);
+        if (token.empty()) continue;
+
+        // A lone "?" is a whole wildcard byte; otherwise tokens are runs of
+        // two-character bytes where either nibble may be '?'.
+        if (token == "?") {
+            out.values.push_back(0);
+            out.masks.push_back(0);
+            continue;
+        }
+        if (token.size() % 2 != 0) {
+            error = "Odd number of nibbles in \"" + token + "\"";
+            return false;
+        }
+        for (size_t j = 0; j < token.size(); j += 2) {
+            uint8_t value = 0, mask = 0;
+            for (size_t k = 0; k < 2; ++k) {
+                char c = token[j + k];
+                int shift = k == 0 ? 4 : 0;
+                if (c == '?') continue;
+                int nibble = parse_nibble(c);
+                if (nibble < 0) {
+                    error = std::string("Invalid character '") + c + "' in pattern";
+                    return false;
+                }
+                value |= nibble << shift;
+                mask |= 0xF << shift;
+            }
+            out.values.push_back(value);
+            out.masks.push_back(mask);
+        }
+    }
+
+    if (out.values.empty()) {
+        error = "Empty pattern";
+        return false;
+    }
+    if (std::all_of(out.masks.begin(), out.masks.end(), [](uint8_t m) { return m == 0; })) {
+        error = "Pattern has no fixed bits";
+        return false;
+    }
+    return true;
+}
+
+PatternScanner::PatternScanner(const ElfParser& parser) : parser_(parser) {
+    const auto& sections = parser_.get_section_headers();
+    const size_t file_size = parser_.get_file().size;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const auto& sh = sections[i];
+        if (sh.sh_type == SHT_NOBITS || sh.sh_type == SHT_NULL || sh.sh_size == 0) continue;
+        if (sh.sh_offset >= file_size) continue;
+        ranges_.push_back({sh.sh_offset, std::min<uint64_t>(sh.sh_offset + sh.sh_size, file_size),
+                           sh.sh_addr, static_cast<int>(i), (sh.sh_flags & SHF_ALLOC) != 0});
+    }
+    std::sort(ranges_.begin(), ranges_.end(), [](const SectionRange& a, const SectionRange& b) {
+        return a.file_begin < b.file_begin;
+    });
+}
+
+PatternMatch PatternScanner::attribute(uint64_t file_offset) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), file_offset,
+        [](uint64_t offset, const SectionRange& r) { return offset < r.file_begin; });
+    if (it != ranges_.begin()) {
+        const SectionRange& range = *std::prev(it);
+        if (file_offset < range.file_end) {
+            uint64_t va = range.loaded ? range.address + (file_offset - range.file_begin) : 0;
+            return {file_offset, va, range.section_index};
+        }
+    }
+    return {file_offset, 0, -1};
+}
+
+size_t PatternScanner::choose_anchor(const BytePattern& pattern, uint64_t begin, uint64_t end) const {
+    // Sample the range once so the anchor is the byte that is rarest in
+    // *this* file, not in some fixed table.
+    const uint8_t* data = parser_.get_file().data;
+    const uint64_t span = end - begin;
+    const uint64_t sample_size = std::min<uint64_t>(4096, span);
+    const uint64_t stride = std::max<uint64_t>(span / 64, sample_size);
+
+    uint32_t histogram[256] = {0};
+    for (uint64_t pos = begin; pos + sample_size <= end; pos += stride) {
+        for (uint64_t k = 0; k < sample_size; ++k) {
+            ++histogram[data[pos + k]];
+        }
+    }
+
+    size_t anchor = kNoAnchor;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern.masks[i] != 0xFF) continue;
+        if (anchor == kNoAnchor || histogram[pattern.values[i]] < histogram[pattern.values[anchor]]) {
+            anchor = i;
+        }
+    }
+    return anchor;
+}
+
+size_t PatternScanner::scan(const BytePattern& pattern, uint64_t begin, uint64_t end,
+                            const std::atomic<bool>& cancel, const PatternMatchSink& sink,
+                            TaskScheduler& scheduler, TaskPriority priority) const {
+    const MappedFile& file = parser_.get_file();
+    if (pattern.size() == 0 || file.size < pattern.size()) return 0;
+
+    // Candidate starts must leave room for the whole pattern inside the file.
+    const uint64_t last_start = std::min<uint64_t>(end, file.size - pattern.size() + 1);
+    if (begin >= last_start) return 0;
+
+    const size_t anchor = choose_anchor(pattern, begin, std::min<uint64_t>(end, file.size));
+    const size_t chunk_count = (last_start - begin + kChunkSize - 1) / kChunkSize;
+
+    struct ChunkResult {
+        std::vector<uint64_t> offsets;
+        bool done = false;
+    };
+    std::vector<ChunkResult> chunks(chunk_count);
+    std::mutex chunk_mutex;
+    std::atomic<bool> stop{false};
+    const std::thread::id caller = std::this_thread::get_id();
+
+    // Emits finished chunks strictly in order; only ever on the calling thread.
+    size_t delivered = 0;
+    size_t next_to_deliver = 0;
+    std::vector<PatternMatch> batch;
+    batch.reserve(kBatchSize);
+    auto deliver_ready = [&]() {
+        while (next_to_deliver < chunk_count && !stop) {
+            std::vector<uint64_t> offsets;
+            {
+                std::lock_guard<std::mutex> lock(chunk_mutex);
+                if (!chunks[next_to_deliver].done) return;
+                offsets.swap(chunks[next_to_deliver].offsets);
+            }
+            ++next_to_deliver;
+            for (size_t i = 0; i < offsets.size(); ++i) {
+                batch.push_back(attribute(offsets[i]));
+                if (batch.size() == kBatchSize || i + 1 == offsets.size()) {
+                    delivered += batch.size();
+                    if (!sink(batch) || cancel) {
+                        stop = true;
+                        return;
+                    }
+                    batch.clear();
+                }
+            }
+        }
+    };
+
+    scheduler.parallel_for(chunk_count, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last && !stop && !cancel; ++c) {
+            uint64_t chunk_begin = begin + c * kChunkSize;
+            uint64_t chunk_end = std::min<uint64_t>(chunk_begin + kChunkSize, last_start);
+            std::vector<uint64_t> found;
+
+            if (anchor != kNoAnchor) {
+                find_byte(file.data, chunk_begin + anchor, chunk_end + anchor, pattern.values[anchor],
+                    [&](size_t pos) {
+                        uint64_t start = pos - anchor;
+                        if (pattern.matches_at(file.data + start)) found.push_back(start);
+                    });
+            } else {
+                for (uint64_t start = chunk_begin; start < chunk_end; ++start) {
+                    if (pattern.matches_at(file.data + start)) found.push_back(start);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(chunk_mutex);
+                chunks[c].offsets = std::move(found);
+                chunks[c].done = true;
+            }
+            // The caller streams what is ready between the chunks it scans
+            if (std::this_thread::get_id() == caller) deliver_ready();
+        }
+    }, priority);
+
+    if (!cancel) deliver_ready();
+    return delivered;
+}
@@ -0,0 +1,380 @@
+#include "../include/signature_database.h"
+#include "../include/arm_disassembler.h"
+#include "../include/function_diff.h"
+#include "../include/trace.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+
+namespace {
+
+const char kMagic[8] = {'K', 'T', 'Z', 'S', 'I', 'G', '0', '1'};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t nodes;
+    uint32_t edges;
+    uint32_t label_bytes;
+    uint32_t signatures;
+    uint32_t name_bytes;
+};
+
+// Sort key of a pattern position: 0 past its end, so shorter patterns come
+// first, then (mask, value) with exact bytes last.
+inline uint32_t position_key(const uint8_t* values, const uint8_t* masks, uint32_t length, size_t position) {
+    return position < length ? (static_cast<uint32_t>(masks[position]) << 8 | values[position]) + 1 : 0;
+}
+
+template <typename T>
+bool write_array(FILE* file, const std::vector<T>& values) {
+    return values.empty() || fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+}
+
+template <typename T>
+bool read_array(FILE* file, std::vector<T>& values, size_t count) {
+    values.resize(count);
+    return count == 0 || fread(values.data(), sizeof(T), count, file) == count;
+}
+
+} // namespace
+
+size_t SignatureDatabase::add_library(const ElfParser& parser, const ModeMap& mode_map,
+                                      const FunctionTable& functions, TaskScheduler& scheduler,
+                                      TaskPriority priority) {
+    KTIMAZ_TRACE_SCOPE("signatures.add_library");
+    std::mutex merge_mutex;
+    size_t added = 0;
+    scheduler.parallel_for(functions.size(), 64, [&](size_t begin, size_t end) {
+        ArmDisassembler disassembler;
+        std::vector<DisassembledInstruction> code;
+        std::vector<Pending> local;
+        for (size_t i = begin; i < end; ++i) {
+            const FunctionInfo& info = functions.function(static_cast<uint32_t>(i));
+            if (info.symbol_index < 0) continue;
+            std::string_view name = parser.get_symbols()[info.symbol_index].name;
+            if (name.empty()) continue;
+
+            // Cover the code up to the first literal pool or other data:
+            // what follows it holds addresses
+            std::vector<ModeMap::Run> runs = mode_map.runs(info.start, info.end);
+            if (runs.empty() || runs.front().mode == CodeMode::Data) continue;
+            uint64_t length = runs.front().end - info.start;
+            const uint8_t* data = parser.get_data_at_address(info.start, length);
+            if (!data) continue;
+            disassembler.disassemble_block_into(data, length, info.start, info.thumb, code);
+            if (code.size() < kMinInstructions) continue;
+            uint64_t covered = code.back().address + code.back().size - info.start;
+            if (covered < kMinBytes || covered > UINT32_MAX) continue;
+
+            Pending pending{};
+            pending.pattern_length = static_cast<uint32_t>(std::min<uint64_t>(kPatternBytes, covered));
+            pending.signature = {normalized_code_hash(code, info.thumb), static_cast<uint32_t>(covered),
+                                 info.thumb ? 1u : 0u};
+            pending.name.assign(name);
+            for (const DisassembledInstruction& instr : code) {
+                size_t offset = instr.address - info.start;
+                if (offset >= pending.pattern_length) break;
+                uint32_t bits = stable_encoding_bits(instr.bytes, instr.size, info.thumb);
+                // Bytes in file order: little-endian words, or halfwords
+                // for Thumb with the first one in the upper bits
+                uint8_t masks[4];
+                if (info.thumb && instr.size == 4) {
+                    masks[0] = static_cast<uint8_t>(bits >> 16);
+                    masks[1] = static_cast<uint8_t>(bits >> 24);
+                    masks[2] = static_cast<uint8_t>(bits);
+                    masks[3] = static_cast<uint8_t>(bits >> 8);
+                } else {
+                    for (size_t k = 0; k < 4; ++k) masks[k] = static_cast<uint8_t>(bits >> (8 * k));
+                }
+                for (size_t k = 0; k < instr.size && offset + k < pending.pattern_length; ++k) {
+                    pending.masks[offset + k] = masks[k];
+                    pending.values[offset + k] = data[offset + k] & masks[k];
+                }
+            }
+            local.push_back(std::move(pending));
+        }
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        added += local.size();
+        std::move(local.begin(), local.end(), std::back_inserter(pending_));
+    }, priority);
+    update_memory();
+    return added;
+}
+
+void SignatureDatabase::compile() {
+    KTIMAZ_TRACE_SCOPE("signatures.compile");
+    std::sort(pending_.begin(), pending_.end(), [](const Pending& a, const Pending& b) {
+        for (size_t i = 0; i < kPatternBytes; ++i) {
+            uint32_t x = position_key(a.values, a.masks, a.pattern_length, i);
+            uint32_t y = position_key(b.values, b.masks, b.pattern_length, i);
+            if (x != y) return x < y;
+            if (x == 0) break;
+        }
+        if (a.signature.length != b.signature.length) return a.signature.length < b.signature.length;
+        if (a.signature.hash != b.signature.hash) return a.signature.hash < b.signature.hash;
+        if (a.signature.thumb != b.signature.thumb) return a.signature.thumb < b.signature.thumb;
+        return a.name < b.name;
+    });
+    // The same function from several references
+    pending_.erase(std::unique(pending_.begin(), pending_.end(), [](const Pending& a, const Pending& b) {
+        return a.signature.length == b.signature.length && a.signature.hash == b.signature.hash &&
+               a.signature.thumb == b.signature.thumb && a.name == b.name &&
+               a.pattern_length == b.pattern_length &&
+               memcmp(a.values, b.values, a.pattern_length) == 0 && memcmp(a.masks, b.masks, a.pattern_length) == 0;
+    }), pending_.end());
+
+    nodes_.clear();
+    edges_.clear();
+    labels_.clear();
+    signatures_.clear();
+    names_.clear();
+    name_offsets_.assign(1, 0);
+    signatures_.reserve(pending_.size());
+    name_offsets_.reserve(pending_.size() + 1);
+    if (!pending_.empty()) build_node(0, pending_.size(), 0);
+    else nodes_.push_back({0, 0, 0, 0, 0});
+
+    pending_.clear();
+    pending_.shrink_to_fit();
+    update_memory();
+    log_info("Signature database compiled: " + std::to_string(signatures_.size()) + " signatures, " +
+             std::to_string(nodes_.size()) + " trie nodes");
+}
+
+uint32_t SignatureDatabase::build_node(size_t begin, size_t end, size_t depth) {
+    uint32_t node = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back({0, 0, 0, static_cast<uint32_t>(signatures_.size()), 0});
+
+    // Patterns ending here sort first
+    size_t i = begin;
+    for (; i < end && pending_[i].pattern_length == depth; ++i) {
+        signatures_.push_back(pending_[i].signature);
+        names_ += pending_[i].name;
+        name_offsets_.push_back(static_cast<uint32_t>(names_.size()));
+    }
+    nodes_[node].signature_count = static_cast<uint32_t>(signatures_.size()) - nodes_[node].first_signature;
+
+    // One child per (mask, value); exact bytes sort last, so move them
+    // to the front where lookups binary-search them. An edge takes the
+    // following bytes too while its patterns all share them
+    struct Group {
+        size_t begin, end;
+        uint8_t value, mask;
+        size_t length;
+    };
+    std::vector<Group> groups;
+    while (i < end) {
+        const Pending& first = pending_[i];
+        size_t j = i + 1;
+        while (j < end && pending_[j].masks[depth] == first.masks[depth] &&
+               pending_[j].values[depth] == first.values[depth]) {
+            ++j;
+        }
+        const Pending& last = pending_[j - 1];
+        size_t length = 1;
+        while (depth + length < first.pattern_length &&
+               position_key(first.values, first.masks, first.pattern_length, depth + length) ==
+               position_key(last.values, last.masks, last.pattern_length, depth + length)) {
+            ++length;
+        }
+        groups.push_back({i, j, first.values[depth], first.masks[depth], length});
+        i = j;
+    }
+    auto exact_begin = std::find_if(groups.begin(), groups.end(), [](const Group& g) { return g.mask == 0xFF; });
+    size_t exact = static_cast<size_t>(groups.end() - exact_begin);
+    std::rotate(groups.begin(), exact_begin, groups.end());
+
+    uint32_t first_edge = static_cast<uint32_t>(edges_.size());
+    nodes_[node].first_edge = first_edge;
+    nodes_[node].exact_edges = static_cast<uint16_t>(exact);
+    nodes_[node].masked_edges = static_cast<uint16_t>(groups.size() - exact);
+    edges_.resize(edges_.size() + groups.size());
+    for (size_t k = 0; k < groups.size(); ++k) {
+        const Group& group = groups[k];
+        const Pending& first = pending_[group.begin];
+        uint32_t label = static_cast<uint32_t>(labels_.size());
+        for (size_t position = depth + 1; position < depth + group.length; ++position) {
+            labels_.push_back(first.values[position]);
+            labels_.push_back(first.masks[position]);
+        }
+        uint32_t child = build_node(group.begin, group.end, depth + group.length);
+        edges_[first_edge + k] = {child, label, group.value, group.mask, static_cast<uint8_t>(group.length), 0};
+    }
+    return node;
+}
+
+void SignatureDatabase::collect(const uint8_t* bytes, size_t available, uint32_t node, size_t depth,
+                                std::vector<uint32_t>& candidates) const {
+    const TrieNode& n = nodes_[node];
+    for (uint32_t s = n.first_signature; s < n.first_signature + n.signature_count; ++s) candidates.push_back(s);
+    if (depth == available) return;
+    // The first byte of an edge is checked by the caller
+    auto follow = [&](const TrieEdge& edge) {
+        if (depth + edge.length > available) return;
+        const uint8_t* label = labels_.data() + edge.label;
+        for (size_t k = 1; k < edge.length; ++k, label += 2) {
+            if ((bytes[depth + k] & label[1]) != label[0]) return;
+        }
+        collect(bytes, available, edge.child, depth + edge.length, candidates);
+    };
+    uint8_t byte = bytes[depth];
+    auto exact_begin = edges_.begin() + n.first_edge;
+    auto exact_end = exact_begin + n.exact_edges;
+    auto it = std::lower_bound(exact_begin, exact_end, byte,
+        [](const TrieEdge& edge, uint8_t value) { return edge.value < value; });
+    if (it != exact_end && it->value == byte) follow(*it);
+    for (auto edge = exact_end; edge != exact_end + n.masked_edges; ++edge) {
+        if ((byte & edge->mask) == edge->value) follow(*edge);
+    }
+}
+
+std::vector<SignatureMatch> SignatureDatabase::match(const ElfParser& parser, const FunctionTable& functions,
+                                                     TaskScheduler& scheduler, TaskPriority priority,
+                                                     bool unnamed_only) const {
+    KTIMAZ_TRACE_SCOPE("signatures.match");
+    std::vector<int64_t> matched(functions.size(), -1);
+    if (signatures_.empty()) return {};
+    scheduler.parallel_for(functions.size(), 256, [&](size_t begin, size_t end) {
+        ArmDisassembler disassembler;
+        std::vector<DisassembledInstruction> code;
+        std::vector<uint32_t> candidates;
+        for (size_t i = begin; i < end; ++i) {
+            const FunctionInfo& info = functions.function(static_cast<uint32_t>(i));
+            if (unnamed_only && info.symbol_index >= 0 &&
+                !parser.get_symbols()[info.symbol_index].name.empty()) {
+                continue;
+            }
+            // The pattern may run past the function as the table sees it,
+            // but not past its section
+            size_t available = kPatternBytes;
+            const uint8_t* bytes = parser.get_data_at_address(info.start, available);
+            if (!bytes) {
+                available = static_cast<size_t>(std::min<uint64_t>(kPatternBytes, info.end - info.start));
+                bytes = parser.get_data_at_address(info.start, available);
+                if (!bytes) continue;
+            }
+            candidates.clear();
+            collect(bytes, available, 0, 0, candidates);
+            if (candidates.empty()) continue;
+
+            // The longest confirmed signature wins, unless another of that
+            // length names the function differently
+            std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+                return signatures_[a].length > signatures_[b].length;
+            });
+            int64_t best = -1;
+            bool ambiguous = false;
+            uint32_t decoded_length = 0;
+            for (uint32_t candidate : candidates) {
+                const FunctionSignature& signature = signatures_[candidate];
+                if (best >= 0 && signature.length < signatures_[best].length) break;
+                if ((signature.thumb != 0) != info.thumb) continue;
+                if (signature.length != decoded_length) {
+                    const uint8_t* data = parser.get_data_at_address(info.start, signature.length);
+                    if (!data) continue;
+                    disassembler.disassemble_block_into(data, signature.length, info.start, info.thumb, code);
+                    decoded_length = signature.length;
+                }
+                if (normalized_code_hash(code, info.thumb) != signature.hash) continue;
+                if (best < 0) {
+                    best = candidate;
+                } else if (name(candidate) != name(static_cast<uint32_t>(best))) {
+                    ambiguous = true;
+                }
+            }
+            if (!ambiguous) matched[i] = best;
+        }
+    }, priority);
+
+    std::vector<SignatureMatch> matches;
+    for (size_t i = 0; i < matched.size(); ++i) {
+        if (matched[i] < 0) continue;
+        matches.push_back({functions.function(static_cast<uint32_t>(i)).start, static_cast<uint32_t>(i),
+                           static_cast<uint32_t>(matched[i])});
+    }
+    log_info("Signatures matched " + std::to_string(matches.size()) + " of " +
+             std::to_string(functions.size()) + " functions");
+    return matches;
+}
+
+bool SignatureDatabase::save(const std::string& path) const {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        log_error("Cannot write signature database " + path);
+        return false;
+    }
+    FileHeader header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.nodes = static_cast<uint32_t>(nodes_.size());
+    header.edges = static_cast<uint32_t>(edges_.size());
+    header.label_bytes = static_cast<uint32_t>(labels_.size());
+    header.signatures = static_cast<uint32_t>(signatures_.size());
+    header.name_bytes = static_cast<uint32_t>(names_.size());
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && write_array(file, nodes_) &&
+              write_array(file, edges_) && write_array(file, labels_) && write_array(file, signatures_) && write_array(file, name_offsets_) &&
+              fwrite(names_.data(), 1, names_.size(), file) == names_.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) log_error("Failed to write signature database " + path);
+    return ok;
+}
+
+bool SignatureDatabase::load(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        log_error("Cannot open signature database " + path);
+        return false;
+    }
+    FileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+              header.nodes > 0;
+    ok = ok && read_array(file, nodes_, header.nodes) && read_array(file, edges_, header.edges) &&
+         read_array(file, labels_, header.label_bytes) &&
+         read_array(file, signatures_, header.signatures) &&
+         read_array(file, name_offsets_, static_cast<size_t>(header.signatures) + 1);
+    if (ok) {
+        names_.resize(header.name_bytes);
+        ok = fread(&names_[0], 1, names_.size(), file) == names_.size();
+    }
+    fclose(file);
+
+    // Every index has to stay in range whatever the file holds
+    // and children come after their parent, as compile() lays them out
+    for (size_t i = 0; ok && i < nodes_.size(); ++i) {
+        const TrieNode& node = nodes_[i];
+        size_t edge_end = static_cast<size_t>(node.first_edge) + node.exact_edges + node.masked_edges;
+        ok = edge_end <= edges_.size() &&
+             static_cast<uint64_t>(node.first_signature) + node.signature_count <= signatures_.size();
+        for (size_t e = node.first_edge; ok && e < edge_end; ++e) {
+            const TrieEdge& edge = edges_[e];
+            ok = edge.child > i && edge.child < nodes_.size() && edge.length > 0 &&
+                 edge.length <= kPatternBytes && edge.label + 2 * (edge.length - 1) <= labels_.size();
+        }
+    }
+    for (size_t i = 0; ok && i < signatures_.size(); ++i) {
+        ok = name_offsets_[i] <= name_offsets_[i + 1];
+    }
+    ok = ok && name_offsets_.front() == 0 && name_offsets_.back() == names_.size();
+    if (!ok) {
+        log_error("Invalid signature database " + path);
+        nodes_.clear();
+        edges_.clear();
+        labels_.clear();
+        signatures_.clear();
+        names_.clear();
+        name_offsets_.clear();
+        update_memory();
+        return false;
+    }
+    pending_.clear();
+    update_memory();
+    log_info("Signature database loaded: " + std::to_string(signatures_.size()) + " signatures");
+    return true;
+}
+
+void SignatureDatabase::update_memory() {
+    memory_.set(capacity_bytes(nodes_, edges_, labels_, signatures_, names_, name_offsets_) +
+                pending_.capacity() * sizeof(Pending));
+}
@@ -0,0 +1,384 @@
+#include "../include/string_table.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KTIMAZ_STRINGS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define KTIMAZ_STRINGS_SSE2 1
+#endif
+
+namespace {
+
+struct PendingString {
+    ExtractedString entry;
+    std::string text;
+};
+
+inline bool is_printable(uint8_t c) {
+    return (c >= 0x20 && c <= 0x7E) || c == '\t';
+}
+
+// Per-byte classification of 16 bytes: bit i of `printable` is set if p[i]
+// is printable ASCII (or tab), bit i of `zero` if p[i] == 0 and bit i of
+// `high` if p[i] >= 0x80.
+struct ByteClasses {
+    uint32_t printable;
+    uint32_t zero;
+    uint32_t high;
+};
+
+#if defined(KTIMAZ_STRINGS_NEON)
+inline uint32_t movemask_u8(uint8x16_t bytes) {
+    static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t masked = vandq_u8(bytes, vld1q_u8(kBits));
+    uint8x8_t lo = vget_low_u8(masked);
+    uint8x8_t hi = vget_high_u8(masked);
+    lo = vpadd_u8(lo, lo);
+    lo = vpadd_u8(lo, lo);
+    lo = vpadd_u8(lo, lo);
+    hi = vpadd_u8(hi, hi);
+    hi = vpadd_u8(hi, hi);
+    hi = vpadd_u8(hi, hi);
+    return vget_lane_u8(lo, 0) | (static_cast<uint32_t>(vget_lane_u8(hi, 0)) << 8);
+}
+#endif
+
+inline ByteClasses classify16(const uint8_t* p) {
+#if defined(KTIMAZ_STRINGS_NEON)
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t printable = vorrq_u8(vcleq_u8(vsubq_u8(v, vdupq_n_u8(0x20)), vdupq_n_u8(0x5E)),
+                                    vceqq_u8(v, vdupq_n_u8('\t')));
+    return {movemask_u8(printable), movemask_u8(vceqq_u8(v, vdupq_n_u8(0))),
+            movemask_u8(vcgeq_u8(v, vdupq_n_u8(0x80)))};
+#elif defined(KTIMAZ_STRINGS_SSE2)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // 0x20..0x7E maps to the signed range [-128, -34] after adding 0x60.
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x60));
+    __m128i printable = _mm_or_si128(_mm_cmplt_epi8(shifted, _mm_set1_epi8(-33)),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    return {static_cast<uint32_t>(_mm_movemask_epi8(printable)),
+            static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()))),
+            static_cast<uint32_t>(_mm_movemask_epi8(v))};
+#else
+    ByteClasses classes = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        classes.printable |= static_cast<uint32_t>(is_printable(p[i])) << i;
+        classes.zero |= static_cast<uint32_t>(p[i] == 0) << i;
+        classes.high |= static_cast<uint32_t>(p[i] >= 0x80) << i;
+    }
+    return classes;
+#endif
+}
+
+// Length of the well-formed multi-byte UTF-8 sequence at p (2-4), or 0.
+size_t utf8_sequence_length(const uint8_t* p, size_t available) {
+    uint8_t c = p[0];
+    size_t length;
+    uint32_t code_point;
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+        code_point = c & 0x1F;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        code_point = c & 0x0F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        code_point = c & 0x07;
+    } else {
+        return 0;
+    }
+    if (available < length) return 0;
+
+    for (size_t i = 1; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        code_point = (code_point << 6) | (p[i] & 0x3F);
+    }
+    // Reject overlong forms, surrogates and values past U+10FFFF.
+    if ((length == 3 && code_point < 0x800) || (length == 4 && code_point < 0x10000)) return 0;
+    if (code_point >= 0xD800 && code_point <= 0xDFFF) return 0;
+    if (code_point > 0x10FFFF) return 0;
+    return length;
+}
+
+// ASCII and UTF-8 runs. Blocks of 16 printable bytes extend a run without
+// per-byte work, and blocks with nothing printable or multi-byte are skipped.
+void scan_utf8(const uint8_t* data, size_t size, size_t min_length,
+               const std::function<void(size_t, size_t, size_t, bool)>& emit) {
+    size_t run_start = 0, run_chars = 0;
+    bool multibyte = false;
+    auto flush = [&](size_t end) {
+        if (run_chars >= min_length) emit(run_start, end - run_start, run_chars, multibyte);
+        run_chars = 0;
+        multibyte = false;
+    };
+
+    size_t i = 0;
+    while (i < size) {
+        if (i + 16 <= size) {
+            ByteClasses classes = classify16(data + i);
+            if (classes.printable == 0xFFFF) {
+                if (run_chars == 0) run_start = i;
+                run_chars += 16;
+                i += 16;
+                continue;
+            }
+            if (run_chars == 0 && classes.printable == 0 && classes.high == 0) {
+                i += 16;
+                continue;
+            }
+        }
+
+        if (is_printable(data[i])) {
+            if (run_chars == 0) run_start = i;
+            ++run_chars;
+            ++i;
+            continue;
+        }
+        size_t length = utf8_sequence_length(data + i, size - i);
+        if (length != 0) {
+            if (run_chars == 0) run_start = i;
+            ++run_chars;
+            multibyte = true;
+            i += length;
+            continue;
+        }
+        flush(i);
+        ++i;
+    }
+    flush(size);
+}
+
+// UTF-16LE runs of printable ASCII-range code units at even offsets. Only the
+// ASCII range is accepted: allowing arbitrary BMP code units turns most binary
+// data into "strings".
+void scan_utf16le(const uint8_t* data, size_t size, size_t min_length,
+                  const std::function<void(size_t, size_t, size_t)>& emit) {
+    size_t run_start = 0, run_chars = 0;
+    auto flush = [&](size_t end) {
+        if (run_chars >= min_length) emit(run_start, end - run_start, run_chars);
+        run_chars = 0;
+    };
+
+    size_t i = 0;
+    while (i + 2 <= size) {
+        if (i + 16 <= size) {
+            ByteClasses classes = classify16(data + i);
+            uint32_t units = classes.printable & (classes.zero >> 1) & 0x5555;
+            if (units == 0x5555) {
+                if (run_chars == 0) run_start = i;
+                run_chars += 8;
+                i += 16;
+                continue;
+            }
+            if (run_chars == 0 && units == 0) {
+                i += 16;
+                continue;
+            }
+        }
+
+        if (data[i + 1] == 0 && is_printable(data[i])) {
+            if (run_chars == 0) run_start = i;
+            ++run_chars;
+        } else {
+            flush(i);
+        }
+        i += 2;
+    }
+    flush(i);
+}
+
+} // namespace
+
+StringTable::StringTable(const ElfParser& parser, size_t min_length) : parser_(parser) {
+    if (min_length == 0) min_length = 1;
+
+    std::vector<PendingString> pending;
+    const auto& sections = parser_.get_section_headers();
+    for (size_t index = 0; index < sections.size(); ++index) {
+        const SectionHeader& sh = sections[index];
+        if (sh.sh_type != SHT_PROGBITS || (sh.sh_flags & SHF_EXECINSTR) || sh.sh_size == 0) continue;
+        const uint8_t* data = parser_.get_section_data_by_index(index);
+        if (data == nullptr) continue;
+
+        const bool loaded = (sh.sh_flags & SHF_ALLOC) != 0;
+        auto make_entry = [&](size_t offset, size_t length, size_t chars, StringEncoding encoding) {
+            return ExtractedString{sh.sh_offset + offset, loaded ? sh.sh_addr + offset : 0,
+                                   static_cast<uint32_t>(length), static_cast<uint32_t>(chars),
+                                   static_cast<int>(index), encoding};
+        };
+
+        scan_utf8(data, sh.sh_size, min_length, [&](size_t offset, size_t length, size_t chars, bool multibyte) {
+            pending.push_back({make_entry(offset, length, chars, multibyte ? StringEncoding::Utf8 : StringEncoding::Ascii),
+                               std::string(reinterpret_cast<const char*>(data + offset), length)});
+        });
+        scan_utf16le(data, sh.sh_size, min_length, [&](size_t offset, size_t length, size_t chars) {
+            std::string text(chars, '\0');
+            for (size_t c = 0; c < chars; ++c) {
+                text[c] = static_cast<char>(data[offset + c * 2]);
+            }
+            pending.push_back({make_entry(offset, length, chars, StringEncoding::Utf16Le), std::move(text)});
+        });
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](const PendingString& a, const PendingString& b) {
+        return a.entry.file_offset < b.entry.file_offset;
+    });
+
+    size_t total_bytes = 0;
+    for (const auto& p : pending) {
+        total_bytes += p.text.size();
+    }
+    strings_.reserve(pending.size());
+    text_offsets_.reserve(pending.size() + 1);
+    text_blob_.reserve(total_bytes);
+    folded_blob_.reserve(total_bytes);
+
+    for (auto& p : pending) {
+        strings_.push_back(p.entry);
+        text_offsets_.push_back(static_cast<uint32_t>(text_blob_.size()));
+        text_blob_ += p.text;
+        folded_blob_ += fold_ascii_case(p.text);
+    }
+    text_offsets_.push_back(static_cast<uint32_t>(text_blob_.size()));
+
+    for (uint32_t i = 0; i < strings_.size(); ++i) {
+        if (strings_[i].virtual_address != 0) by_address_.push_back(i);
+    }
+    std::stable_sort(by_address_.begin(), by_address_.end(), [this](uint32_t a, uint32_t b) {
+        return strings_[a].virtual_address < strings_[b].virtual_address;
+    });
+
+    update_memory_charge();
+    log_info("String table built with " + std::to_string(strings_.size()) + " strings.");
+}
+
+void StringTable::update_memory_charge() {
+    memory_.set(capacity_bytes(strings_, text_blob_, folded_blob_, text_offsets_, by_address_,
+                               reference_offsets_, reference_sites_));
+}
+
+std::string_view StringTable::text(uint32_t index) const {
+    return std::string_view(text_blob_).substr(
+        text_offsets_[index], text_offsets_[index + 1] - text_offsets_[index]);
+}
+
+StringQueryResult StringTable::query(const StringQuery& query) const {
+    StringQueryResult result;
+    TextMatcher matcher(query.text, query.match_mode);
+    if (!matcher.is_valid()) {
+        return result;
+    }
+
+    const size_t page_end = query.offset + query.limit;
+    for (uint32_t i = 0; i < strings_.size(); ++i) {
+        const ExtractedString& s = strings_[i];
+        if (query.section_index >= 0 && s.section_index != query.section_index) continue;
+        if (query.encoding >= 0 && static_cast<int>(s.encoding) != query.encoding) continue;
+        if (!matcher.matches(folded_text(i))) continue;
+
+        if (result.total_matches >= query.offset && result.total_matches < page_end) {
+            result.string_indices.push_back(i);
+        }
+        ++result.total_matches;
+    }
+    return result;
+}
+
+long StringTable::find_by_address(uint64_t address) const {
+    auto it = std::lower_bound(by_address_.begin(), by_address_.end(), address,
+        [this](uint32_t index, uint64_t addr) { return strings_[index].virtual_address < addr; });
+    if (it != by_address_.end() && strings_[*it].virtual_address == address) {
+        return static_cast<long>(*it);
+    }
+    return -1;
+}
+
+std::vector<long> StringTable::find_by_addresses(const std::vector<uint64_t>& addresses) const {
+    std::vector<long> result(addresses.size(), -1);
+    size_t cursor = 0;
+    for (size_t i = 0; i < addresses.size() && cursor < by_address_.size(); ++i) {
+        while (cursor < by_address_.size() && strings_[by_address_[cursor]].virtual_address < addresses[i]) {
+            ++cursor;
+        }
+        if (cursor < by_address_.size() && strings_[by_address_[cursor]].virtual_address == addresses[i]) {
+            result[i] = static_cast<long>(by_address_[cursor]);
+        }
+    }
+    return result;
+}
+
+void StringTable::collect_references(const std::vector<DisassembledInstruction>& instructions,
+                                     std::vector<StringReference>& out) const {
+    for (const auto& instr : instructions) {
+        if (instr.data_target == 0) continue;
+
+        long direct = find_by_address(instr.data_target);
+        if (direct >= 0) {
+            out.emplace_back(static_cast<uint32_t>(direct), instr.address);
+            continue;
+        }
+
+        // A literal-pool word holding an absolute string address
+        if (instr.data_size == 4) {
+            const uint8_t* literal = parser_.get_data_at_address(instr.data_target, 4);
+            if (literal == nullptr) continue;
+            uint32_t value;
+            memcpy(&value, literal, sizeof(value));
+            long loaded = find_by_address(value);
+            if (loaded >= 0) {
+                out.emplace_back(static_cast<uint32_t>(loaded), instr.address);
+            }
+        }
+    }
+}
+
+void StringTable::set_references(std::vector<StringReference> references) {
+    std::sort(references.begin(), references.end());
+    references.erase(std::unique(references.begin(), references.end()), references.end());
+
+    reference_offsets_.assign(strings_.size() + 1, 0);
+    for (const auto& ref : references) {
+        ++reference_offsets_[ref.first + 1];
+    }
+    std::partial_sum(reference_offsets_.begin(), reference_offsets_.end(), reference_offsets_.begin());
+
+    reference_sites_.resize(references.size());
+    for (size_t i = 0; i < references.size(); ++i) {
+        reference_sites_[i] = references[i].second;
+    }
+    references_ready_ = true;
+    update_memory_charge();
+    log_info("String references attached: " + std::to_string(references.size()));
+}
+
+void StringTable::replace_references(uint64_t source_start, uint64_t source_end,
+                                     std::vector<StringReference> references) {
+    if (!references_ready_) {
+        log_error("replace_references called before the string references were set.");
+        return;
+    }
+    for (uint32_t index = 0; index < strings_.size(); ++index) {
+        for (uint32_t i = reference_offsets_[index]; i < reference_offsets_[index + 1]; ++i) {
+            uint64_t site = reference_sites_[i];
+            if (site < source_start || site >= source_end) references.emplace_back(index, site);
+        }
+    }
+    set_references(std::move(references));
+}
+
+std::vector<uint64_t> StringTable::references_to(uint32_t index) const {
+    if (!references_ready_ || index >= strings_.size()) return {};
+    return std::vector<uint64_t>(reference_sites_.begin() + reference_offsets_[index],
+                                 reference_sites_.begin() + reference_offsets_[index + 1]);
+}
+
+size_t StringTable::reference_count(uint32_t index) const {
+    if (!references_ready_ || index >= strings_.size()) return 0;
+    return reference_offsets_[index + 1] - reference_offsets_[index];
+}
@@ -0,0 +1,222 @@
+#include "../include/symbol_index.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+constexpr std::string_view kUnknownSection = "unknown";
+
+} // namespace
+
+SymbolIndex::SymbolIndex(const ElfParser& parser)
+    : parser_(parser), demangler_(parser.get_file().data, parser.get_file().size) {
+    const auto& symbols = parser_.get_symbols();
+    const size_t count = symbols.size();
+
+    size_t total_name_bytes = 0;
+    for (const auto& sym : symbols) {
+        total_name_bytes += sym.name.size();
+    }
+
+    names_.blob.reserve(total_name_bytes);
+    names_.offsets.reserve(count + 1);
+    types_.reserve(count);
+    bindings_.reserve(count);
+
+    for (const auto& sym : symbols) {
+        names_.offsets.push_back(static_cast<uint32_t>(names_.blob.size()));
+        names_.blob += fold_ascii_case(sym.name);
+        types_.push_back(sym.st_info & 0xF);
+        bindings_.push_back(sym.st_info >> 4);
+    }
+    names_.offsets.push_back(static_cast<uint32_t>(names_.blob.size()));
+
+    sort_by_name(names_);
+    by_address_.resize(count);
+    std::iota(by_address_.begin(), by_address_.end(), 0u);
+    by_size_ = by_address_;
+
+    // Stable sorts keep ties in symbol table order, so paging is deterministic.
+    std::stable_sort(by_address_.begin(), by_address_.end(), [&symbols](uint32_t a, uint32_t b) {
+        return symbols[a].st_value < symbols[b].st_value;
+    });
+    std::stable_sort(by_size_.begin(), by_size_.end(), [&symbols](uint32_t a, uint32_t b) {
+        return symbols[a].st_size < symbols[b].st_size;
+    });
+    if (!by_size_.empty()) max_size_ = symbols[by_size_.back()].st_size;
+
+    memory_.set(capacity_bytes(names_.blob, names_.offsets, names_.by_name, types_, bindings_,
+                               by_address_, by_size_));
+    log_info("Symbol index built for " + std::to_string(count) + " symbols.");
+}
+
+void SymbolIndex::sort_by_name(NameColumn& column) {
+    column.by_name.resize(column.offsets.size() - 1);
+    std::iota(column.by_name.begin(), column.by_name.end(), 0u);
+    std::stable_sort(column.by_name.begin(), column.by_name.end(), [&column](uint32_t a, uint32_t b) {
+        return column.name(a) < column.name(b);
+    });
+}
+
+void SymbolIndex::prepare_demangled_names(TaskScheduler& scheduler, TaskPriority priority) const {
+    if (has_demangled_names()) return;
+    std::lock_guard<std::mutex> lock(demangled_mutex_);
+    if (has_demangled_names()) return;
+
+    const auto& symbols = parser_.get_symbols();
+    std::vector<std::string_view> names;
+    names.reserve(symbols.size());
+    for (const auto& sym : symbols) names.push_back(sym.name);
+    demangler_.demangle_all(names, scheduler, priority);
+
+    NameColumn column;
+    column.offsets.reserve(symbols.size() + 1);
+    for (const auto& sym : symbols) {
+        column.offsets.push_back(static_cast<uint32_t>(column.blob.size()));
+        column.blob += fold_ascii_case(demangler_.demangle(sym.name));
+    }
+    column.offsets.push_back(static_cast<uint32_t>(column.blob.size()));
+    sort_by_name(column);
+
+    demangled_names_ = std::move(column);
+    demangled_memory_.set(capacity_bytes(demangled_names_.blob, demangled_names_.offsets, demangled_names_.by_name));
+    demangled_ready_.store(true, std::memory_order_release);
+    log_info("Demangled names ready for " + std::to_string(symbols.size()) + " symbols.");
+}
+
+std::vector<uint32_t> SymbolIndex::in_address_range(uint64_t start, uint64_t end) const {
+    const auto& symbols = parser_.get_symbols();
+    auto by_value = [&symbols](uint32_t index, uint64_t value) { return symbols[index].st_value < value; };
+    auto first = std::lower_bound(by_address_.begin(), by_address_.end(), start, by_value);
+    auto last = std::lower_bound(first, by_address_.end(), end, by_value);
+    return std::vector<uint32_t>(first, last);
+}
+
+long SymbolIndex::containing(uint64_t address) const {
+    const auto& symbols = parser_.get_symbols();
+    // A Thumb function at `address` has the value address + 1
+    auto it = std::upper_bound(by_address_.begin(), by_address_.end(), address + 1,
+        [&symbols](uint64_t value, uint32_t index) { return value < symbols[index].st_value; });
+    while (it != by_address_.begin()) {
+        uint32_t index = *--it;
+        const SymbolEntry& sym = symbols[index];
+        if (sym.st_value + max_size_ < address) break; // Nothing earlier reaches this far
+        bool function = types_[index] == STT_FUNC;
+        if (!function && types_[index] != STT_OBJECT) continue;
+        uint64_t start = function ? sym.st_value & ~1ULL : sym.st_value;
+        if (start <= address && address - start < sym.st_size) return static_cast<long>(index);
+    }
+    return -1;
+}
+
+std::string_view SymbolIndex::section_name_for(uint32_t index) const {
+    const auto& sections = parser_.get_section_headers();
+    uint16_t shndx = symbol(index).st_shndx;
+    return shndx < sections.size() ? sections[shndx].name : kUnknownSection;
+}
+
+int SymbolIndex::section_index_by_name(const std::string& section_name) const {
+    const auto& sections = parser_.get_section_headers();
+    for (size_t i = 0; i < sections.size(); ++i) {
+        if (sections[i].name == section_name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+const SymbolIndex::NameColumn& SymbolIndex::column_for(const SymbolQuery& query) const {
+    return query.demangled && has_demangled_names() ? demangled_names_ : names_;
+}
+
+const std::vector<uint32_t>& SymbolIndex::permutation_for(SymbolSortKey key, const NameColumn& column) const {
+    switch (key) {
+        case SymbolSortKey::Address: return by_address_;
+        case SymbolSortKey::Size: return by_size_;
+        case SymbolSortKey::Name: break;
+    }
+    return column.by_name;
+}
+
+bool SymbolIndex::passes_filters(uint32_t index, const SymbolQuery& query, const NameColumn& column,
+                                 const TextMatcher& matcher) const {
+    if (query.type >= 0 && types_[index] != query.type) return false;
+    if (query.binding >= 0 && bindings_[index] != query.binding) return false;
+    if (query.section_index >= 0 && symbol(index).st_shndx != query.section_index) return false;
+    return matcher.matches(column.name(index));
+}
+
+SymbolQueryResult SymbolIndex::query(const SymbolQuery& query) const {
+    SymbolQueryResult result;
+    const NameColumn& column = column_for(query);
+    TextMatcher matcher(query.text, query.match_mode);
+    if (!matcher.is_valid()) {
+        return result;
+    }
+
+    const size_t page_end = query.offset + query.limit;
+    auto collect = [&](uint32_t index) {
+        if (result.total_matches >= query.offset && result.total_matches < page_end) {
+            result.symbol_indices.push_back(index);
+        }
+        ++result.total_matches;
+    };
+
+    // Walks a permutation range in the requested direction.
+    auto walk = [&](const uint32_t* first, const uint32_t* last, auto&& visit) {
+        if (query.descending) {
+            for (const uint32_t* it = last; it != first;) visit(*--it);
+        } else {
+            for (const uint32_t* it = first; it != last; ++it) visit(*it);
+        }
+    };
+
+    const uint32_t* first = column.by_name.data();
+    const uint32_t* last = column.by_name.data() + column.by_name.size();
+    bool narrowed = false;
+
+    if (!matcher.required_prefix().empty()) {
+        // All names sharing the prefix form one contiguous run of by_name.
+        const std::string& prefix = matcher.required_prefix();
+        first = std::lower_bound(first, last, prefix, [&column](uint32_t idx, const std::string& p) {
+            return column.name(idx) < p;
+        });
+        last = std::upper_bound(first, last, prefix, [&column](const std::string& p, uint32_t idx) {
+            return p < column.name(idx).substr(0, p.size());
+        });
+        narrowed = true;
+    }
+
+    if (query.sort_key == SymbolSortKey::Name || !narrowed) {
+        const auto& order = permutation_for(query.sort_key, column);
+        if (!narrowed) {
+            first = order.data();
+            last = order.data() + order.size();
+        }
+        walk(first, last, [&](uint32_t index) {
+            if (passes_filters(index, query, column, matcher)) collect(index);
+        });
+        return result;
+    }
+
+    // Prefix range in name order, but a different sort key was requested:
+    // mark the survivors and re-walk them in the target permutation.
+    std::vector<uint8_t> selected(size(), 0);
+    size_t candidates = 0;
+    for (const uint32_t* it = first; it != last; ++it) {
+        if (passes_filters(*it, query, column, matcher)) {
+            selected[*it] = 1;
+            ++candidates;
+        }
+    }
+    if (candidates == 0) {
+        return result;
+    }
+
+    const auto& order = permutation_for(query.sort_key, column);
+    walk(order.data(), order.data() + order.size(), [&](uint32_t index) {
+        if (selected[index]) collect(index);
+    });
+    return result;
+}
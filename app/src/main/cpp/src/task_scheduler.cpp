@@ -0,0 +1,239 @@
+#include "../include/task_scheduler.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Worker index of the current thread within `t_scheduler`, -1 elsewhere
+thread_local const TaskScheduler* t_scheduler = nullptr;
+thread_local long t_worker_index = -1;
+
+long read_max_frequency(unsigned cpu) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/cpuinfo_max_freq");
+    long frequency = -1;
+    in >> frequency;
+    return in ? frequency : -1;
+}
+
+} // namespace
+
+bool TaskHandle::is_done() const {
+    if (!state_) return true;
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->done;
+}
+
+bool TaskHandle::was_cancelled() const {
+    if (!state_) return false;
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->cancelled;
+}
+
+void TaskHandle::wait() const {
+    if (!state_) return;
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->done_condition.wait(lock, [this] { return state_->done; });
+}
+
+size_t TaskScheduler::default_worker_count() {
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<long> frequencies;
+    for (unsigned cpu = 0; cpu < cpus; ++cpu) {
+        long frequency = read_max_frequency(cpu);
+        if (frequency > 0) frequencies.push_back(frequency);
+    }
+
+    size_t count = cpus;
+    if (frequencies.size() == cpus) {
+        // big.LITTLE: everything faster than the slowest cluster
+        long slowest = *std::min_element(frequencies.begin(), frequencies.end());
+        size_t big = std::count_if(frequencies.begin(), frequencies.end(),
+                                   [slowest](long frequency) { return frequency > slowest; });
+        if (big > 0) count = big;
+    }
+    return std::min<size_t>(std::max<size_t>(count, 2), 8);
+}
+
+TaskScheduler::TaskScheduler(size_t worker_count) {
+    worker_count = std::max<size_t>(worker_count, 1);
+    background_limit_ = std::max<size_t>(worker_count - 1, 1);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_[i]->thread = std::thread([this, i] { worker_loop(i); });
+    }
+    log_info("TaskScheduler created with " + std::to_string(worker_count) + " workers.");
+}
+
+TaskScheduler::~TaskScheduler() {
+    shutdown();
+}
+
+TaskHandle TaskScheduler::submit(std::function<void()> function, TaskPriority priority,
+                                 std::shared_ptr<CancellationGroup> group) {
+    TaskHandle handle;
+    handle.state_ = std::make_shared<TaskHandle::State>();
+    size_t lane = static_cast<size_t>(priority);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        if (stop_) {
+            log_error("submit on a stopped TaskScheduler");
+            handle.state_->done = true;
+            handle.state_->cancelled = true;
+            return handle;
+        }
+        size_t index = t_scheduler == this ? static_cast<size_t>(t_worker_index)
+                                           : next_worker_++ % workers_.size();
+        {
+            std::lock_guard<std::mutex> worker_lock(workers_[index]->mutex);
+            workers_[index]->lanes[lane].push_back({std::move(function), handle.state_, std::move(group)});
+        }
+        ++pending_[lane];
+    }
+    wake_.notify_one();
+    return handle;
+}
+
+bool TaskScheduler::try_take(size_t index, TaskPriority priority, Task& out) {
+    size_t lane = static_cast<size_t>(priority);
+    for (size_t k = 0; k < workers_.size(); ++k) {
+        Worker& worker = *workers_[(index + k) % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto& queue = worker.lanes[lane];
+        if (queue.empty()) continue;
+        // Own work newest first, stolen work oldest first
+        if (k == 0) {
+            out = std::move(queue.back());
+            queue.pop_back();
+        } else {
+            out = std::move(queue.front());
+            queue.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::run(Task& task) {
+    bool cancelled = task.group && task.group->is_cancelled();
+    if (!cancelled) {
+        try {
+            task.function();
+        } catch (const std::exception& e) {
+            log_error(std::string("Task failed: ") + e.what());
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(task.state->mutex);
+        task.state->done = true;
+        task.state->cancelled = cancelled;
+    }
+    task.state->done_condition.notify_all();
+}
+
+void TaskScheduler::worker_loop(size_t index) {
+    t_scheduler = this;
+    t_worker_index = static_cast<long>(index);
+
+    while (true) {
+        // Reserve a task of the most urgent runnable lane, then find it
+        // outside the lock; every reservation is backed by a queued task.
+        TaskPriority lane;
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] {
+                return stop_ || pending_[0] > 0 || (pending_[1] > 0 && running_background_ < background_limit_);
+            });
+            if (pending_[0] > 0) {
+                lane = TaskPriority::Interactive;
+            } else if (pending_[1] > 0 && running_background_ < background_limit_) {
+                lane = TaskPriority::Background;
+                ++running_background_;
+            } else if (pending_[1] == 0) {
+                return; // Stopped and drained
+            } else {
+                // Stopped, but the background lane is saturated; wait for a slot
+                wake_.wait(lock);
+                continue;
+            }
+            --pending_[static_cast<size_t>(lane)];
+        }
+
+        Task task;
+        while (!try_take(index, lane, task)) {
+            std::this_thread::yield();
+        }
+        run(task);
+
+        if (lane == TaskPriority::Background) {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                --running_background_;
+            }
+            wake_.notify_all();
+        }
+    }
+}
+
+void TaskScheduler::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body,
+                                 TaskPriority priority) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+
+    struct Shared {
+        std::function<void(size_t, size_t)> body;
+        size_t count, grain, pieces;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+        std::mutex mutex;
+        std::condition_variable all_done;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->body = body;
+    shared->count = count;
+    shared->grain = grain;
+    shared->pieces = (count + grain - 1) / grain;
+
+    // Helpers that start after the work is gone return at once
+    auto run_pieces = [shared]() {
+        for (size_t piece = shared->next++; piece < shared->pieces; piece = shared->next++) {
+            size_t begin = piece * shared->grain;
+            try {
+                shared->body(begin, std::min(shared->count, begin + shared->grain));
+            } catch (const std::exception& e) {
+                log_error(std::string("parallel_for body failed: ") + e.what());
+            }
+            if (++shared->finished == shared->pieces) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->all_done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers_.size(), shared->pieces) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        submit(run_pieces, priority);
+    }
+    run_pieces();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->all_done.wait(lock, [&shared] { return shared->finished == shared->pieces; });
+}
+
+void TaskScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        if (stop_) return;
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    log_info("TaskScheduler shut down.");
+}
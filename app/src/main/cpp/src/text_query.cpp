@@ -0,0 +1,66 @@
+#include "../include/text_query.h"
+#include "../include/utils.h"
+#include <cstring>
+
+std::string fold_ascii_case(std::string_view text) {
+    std::string folded(text);
+    for (auto& c : folded) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return folded;
+}
+
+TextMatcher::TextMatcher(const std::string& pattern, TextMatchMode mode)
+    : mode_(mode), valid_(true) {
+    if (mode_ == TextMatchMode::Regex) {
+        // Regex patterns are matched case-insensitively against folded text,
+        // so keep the pattern verbatim (character classes like \S must survive).
+        pattern_ = pattern;
+        if (!pattern_.empty()) {
+            try {
+                regex_ = std::make_unique<std::regex>(
+                    pattern_, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+            } catch (const std::regex_error& e) {
+                log_error("Invalid regex in query: " + pattern_ + " (" + e.what() + ")");
+                valid_ = false;
+            }
+        }
+        if (valid_ && pattern_.size() > 1 && pattern_[0] == '^' &&
+            pattern_.find('|') == std::string::npos) {
+            // Stop at the first metacharacter; a quantifier makes the
+            // preceding character optional, so drop it as well. Alternation
+            // can escape the anchor, so such patterns get no prefix at all.
+            size_t end = 1;
+            while (end < pattern_.size() && !std::strchr(".[]()*+?{}|^$\\", pattern_[end])) {
+                ++end;
+            }
+            if (end < pattern_.size() && std::strchr("*?{", pattern_[end])) {
+                --end;
+            }
+            required_prefix_ = fold_ascii_case(std::string_view(pattern_).substr(1, end - 1));
+        }
+    } else {
+        pattern_ = fold_ascii_case(pattern);
+        if (mode_ == TextMatchMode::Prefix) {
+            required_prefix_ = pattern_;
+        }
+    }
+}
+
+bool TextMatcher::matches(std::string_view folded_text) const {
+    if (!valid_) return false;
+    if (pattern_.empty()) return true;
+
+    switch (mode_) {
+        case TextMatchMode::Prefix:
+            return folded_text.size() >= pattern_.size() &&
+                   folded_text.compare(0, pattern_.size(), pattern_) == 0;
+        case TextMatchMode::Substring:
+            return folded_text.find(pattern_) != std::string_view::npos;
+        case TextMatchMode::Regex:
+            return std::regex_search(folded_text.begin(), folded_text.end(), *regex_);
+    }
+    return false;
+}
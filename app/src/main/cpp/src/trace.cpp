@@ -0,0 +1,285 @@
+#include "../include/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kCounterCount = static_cast<size_t>(TraceCounter::Count);
+
+} // namespace
+
+const char* trace_counter_name(TraceCounter counter) {
+    static const char* names[] = {
+        "sections_parsed", "symbols_parsed", "instructions_decoded", "bytes_decoded",
+        "jni_calls", "minor_faults", "major_faults"
+    };
+    size_t index = static_cast<size_t>(counter);
+    return index < kCounterCount ? names[index] : "unknown";
+}
+
+#if defined(KTIMAZ_ENABLE_TRACING)
+
+namespace {
+
+constexpr size_t kMaxSites = 256;          // Later sites share the last id
+constexpr size_t kRingCapacity = 4096;     // Events kept per thread
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+// Fields are atomics so a reader racing the owner never sees half a value;
+// the write count tells it which slots may have been overwritten meanwhile.
+struct EventSlot {
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> duration_ns{0};
+    std::atomic<uint64_t> faults{0}; // Minor in the low half, major in the high half
+    std::atomic<uint16_t> site{0};
+};
+
+struct SiteTotals {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+};
+
+// Written only by its thread. Kept after the thread exits so its events
+// stay exportable; threads here are pooled, so the set stays small.
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::unique_ptr<EventSlot[]> ring{new EventSlot[kRingCapacity]};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> cleared_before{0}; // Events before this were reset
+    SiteTotals sites[kMaxSites];
+    std::atomic<uint64_t> counters[kCounterCount] = {};
+};
+
+std::mutex g_registry_mutex;
+std::vector<const char*> g_site_names;
+std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+
+ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto created = std::make_shared<ThreadBuffer>();
+        created->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        g_buffers.push_back(created);
+        buffer = created.get();
+    }
+    return *buffer;
+}
+
+void thread_faults(uint64_t& minor, uint64_t& major) {
+#ifdef RUSAGE_THREAD
+    rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        minor = static_cast<uint64_t>(usage.ru_minflt);
+        major = static_cast<uint64_t>(usage.ru_majflt);
+        return;
+    }
+#endif
+    minor = major = 0;
+}
+
+void append_escaped(std::string& out, const char* text) {
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') out += '\\';
+        out += *text;
+    }
+}
+
+void append_microseconds(std::string& out, uint64_t ns) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000),
+             static_cast<unsigned long long>(ns % 1000));
+    out += buffer;
+}
+
+} // namespace
+
+uint16_t trace_register_site(const char* name) {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    if (g_site_names.size() == kMaxSites - 1) {
+        g_site_names.push_back("(other)");
+    }
+    if (g_site_names.size() >= kMaxSites) {
+        return static_cast<uint16_t>(kMaxSites - 1);
+    }
+    g_site_names.push_back(name);
+    return static_cast<uint16_t>(g_site_names.size() - 1);
+}
+
+void trace_count(TraceCounter counter, uint64_t delta) {
+    thread_buffer().counters[static_cast<size_t>(counter)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+TraceScope::TraceScope(uint16_t site, bool faults) : site_(site), faults_(faults) {
+    if (faults_) thread_faults(minor_faults_, major_faults_);
+    start_ns_ = now_ns();
+}
+
+TraceScope::~TraceScope() {
+    uint64_t duration = now_ns() - start_ns_;
+    ThreadBuffer& buffer = thread_buffer();
+    uint64_t faults = 0;
+    if (faults_) {
+        uint64_t minor, major;
+        thread_faults(minor, major);
+        minor -= minor_faults_;
+        major -= major_faults_;
+        buffer.counters[static_cast<size_t>(TraceCounter::MinorFaults)].fetch_add(minor, std::memory_order_relaxed);
+        buffer.counters[static_cast<size_t>(TraceCounter::MajorFaults)].fetch_add(major, std::memory_order_relaxed);
+        faults = std::min<uint64_t>(minor, UINT32_MAX) | (std::min<uint64_t>(major, UINT32_MAX) << 32);
+    }
+
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    EventSlot& slot = buffer.ring[index % kRingCapacity];
+    slot.site.store(site_, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns_, std::memory_order_relaxed);
+    slot.duration_ns.store(duration, std::memory_order_relaxed);
+    slot.faults.store(faults, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+
+    SiteTotals& totals = buffer.sites[site_];
+    totals.count.fetch_add(1, std::memory_order_relaxed);
+    totals.total_ns.fetch_add(duration, std::memory_order_relaxed);
+    if (duration > totals.max_ns.load(std::memory_order_relaxed)) {
+        totals.max_ns.store(duration, std::memory_order_relaxed);
+    }
+}
+
+bool tracing_enabled() {
+    return true;
+}
+
+TraceStats trace_stats() {
+    TraceStats stats;
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (size_t site = 0; site < g_site_names.size(); ++site) {
+        TraceSiteStats entry;
+        entry.name = g_site_names[site];
+        for (const auto& buffer : g_buffers) {
+            const SiteTotals& totals = buffer->sites[site];
+            entry.count += totals.count.load(std::memory_order_relaxed);
+            entry.total_ns += totals.total_ns.load(std::memory_order_relaxed);
+            entry.max_ns = std::max(entry.max_ns, totals.max_ns.load(std::memory_order_relaxed));
+        }
+        if (entry.count > 0) stats.sites.push_back(std::move(entry));
+    }
+    for (const auto& buffer : g_buffers) {
+        for (size_t i = 0; i < kCounterCount; ++i) {
+            stats.counters[i] += buffer->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+    return stats;
+}
+
+std::string trace_export_chrome_json() {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first_event = true;
+    auto begin_event = [&]() {
+        if (!first_event) out += ",\n";
+        first_event = false;
+    };
+
+    uint64_t last_ns = 0;
+    for (const auto& buffer : g_buffers) {
+        std::string tid = std::to_string(buffer->tid);
+        begin_event();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid +
+               ",\"args\":{\"name\":\"native-" + tid + "\"}}";
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = std::max(written > kRingCapacity ? written - kRingCapacity : 0,
+                                  buffer->cleared_before.load(std::memory_order_relaxed));
+        struct Event { uint64_t start, duration, faults; uint16_t site; };
+        std::vector<Event> events;
+        events.reserve(written - std::min(first, written));
+        for (uint64_t i = first; i < written; ++i) {
+            const EventSlot& slot = buffer->ring[i % kRingCapacity];
+            events.push_back({slot.start_ns.load(std::memory_order_relaxed),
+                              slot.duration_ns.load(std::memory_order_relaxed),
+                              slot.faults.load(std::memory_order_relaxed),
+                              slot.site.load(std::memory_order_relaxed)});
+        }
+        // The owner may have lapped the ring while we copied; slots it could
+        // have been writing (one more than it has published) are dropped
+        uint64_t now_written = buffer->written.load(std::memory_order_acquire);
+        uint64_t intact_from = now_written + 1 > kRingCapacity ? now_written + 1 - kRingCapacity : 0;
+        size_t skip = intact_from > first ? static_cast<size_t>(std::min<uint64_t>(intact_from - first, events.size())) : 0;
+
+        for (size_t i = skip; i < events.size(); ++i) {
+            const Event& event = events[i];
+            if (event.site >= g_site_names.size()) continue;
+            begin_event();
+            out += "{\"name\":\"";
+            append_escaped(out, g_site_names[event.site]);
+            out += "\",\"cat\":\"native\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+            append_microseconds(out, event.start);
+            out += ",\"dur\":";
+            append_microseconds(out, event.duration);
+            if (event.faults != 0) {
+                out += ",\"args\":{\"minor_faults\":" + std::to_string(event.faults & UINT32_MAX) +
+                       ",\"major_faults\":" + std::to_string(event.faults >> 32) + "}";
+            }
+            out += "}";
+            last_ns = std::max(last_ns, event.start + event.duration);
+        }
+    }
+
+    // Counter totals as one sample at the end of the trace
+    begin_event();
+    out += "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":";
+    append_microseconds(out, last_ns);
+    out += ",\"args\":{";
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        uint64_t total = 0;
+        for (const auto& buffer : g_buffers) total += buffer->counters[i].load(std::memory_order_relaxed);
+        if (i > 0) out += ",";
+        out += "\"" + std::string(trace_counter_name(static_cast<TraceCounter>(i))) + "\":" + std::to_string(total);
+    }
+    out += "}}]}\n";
+    return out;
+}
+
+void trace_reset() {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (const auto& buffer : g_buffers) {
+        buffer->cleared_before.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+        for (auto& totals : buffer->sites) {
+            totals.count.store(0, std::memory_order_relaxed);
+            totals.total_ns.store(0, std::memory_order_relaxed);
+            totals.max_ns.store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : buffer->counters) counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+bool tracing_enabled() {
+    return false;
+}
+
+TraceStats trace_stats() {
+    return {};
+}
+
+std::string trace_export_chrome_json() {
+    return {};
+}
+
+void trace_reset() {}
+
+#endif
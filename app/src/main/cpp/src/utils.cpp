@@ -1,22 +1,31 @@
 #include "../include/utils.h"
-#include <android/log.h> // For Android logging
+#include "../include/trace.h"
 #include <sys/mman.h>    // For mmap, munmap
 #include <sys/stat.h>    // For stat
 #include <fcntl.h>       // For open, O_RDONLY
 #include <unistd.h>      // For close
 #include <stdexcept>     // For std::runtime_error
-#include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
-#include <functional>
+#include <atomic>
+#include <cstdio>
+
+#ifdef __ANDROID__
+#include <android/log.h> // For Android logging
 
 // Android log tags
 #define LOG_TAG "NativeDisassembler"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+
+// Host builds log to stderr; info messages only when asked for
+static std::atomic<bool> g_verbose_logging{false};
+#define LOGI(format, ...) do { if (g_verbose_logging) fprintf(stderr, "I " format "\n", __VA_ARGS__); } while (0)
+#define LOGE(format, ...) fprintf(stderr, "E " format "\n", __VA_ARGS__)
+#endif
 
 MappedFile map_file(const std::string& file_path) {
+    KTIMAZ_TRACE_SCOPE_FAULTS("file.map");
     MappedFile mapped_file = {nullptr, 0, -1};
 
     int fd = open(file_path.c_str(), O_RDONLY);
@@ -75,66 +84,87 @@ void log_info(const std::string& message) {
     LOGI("%s", message.c_str());
 }
 
-std::string jstring_to_cpp_string(JNIEnv* env, jstring jstr) {
-    if (!jstr) return "";
-    const char* c_str = env->GetStringUTFChars(jstr, nullptr);
-    std::string cpp_str(c_str);
-    env->ReleaseStringUTFChars(jstr, c_str);
-    return cpp_str;
+void set_verbose_logging(bool enabled) {
+#ifndef __ANDROID__
+    g_verbose_logging = enabled;
+#else
+    (void)enabled; // logcat filters by priority itself
+#endif
 }
 
-jstring cpp_string_to_jstring(JNIEnv* env, const std::string& cpp_str) {
-    return env->NewStringUTF(cpp_str.c_str());
+void append_hex(std::string& out, uint64_t value, int min_digits) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    char buffer[16];
+    int length = 0;
+    do {
+        buffer[15 - length++] = kDigits[value & 0xF];
+        value >>= 4;
+    } while (length < 16 && (value != 0 || length < min_digits));
+    out.append(buffer + 16 - length, length);
 }
 
-// SimpleThreadPool implementation
-SimpleThreadPool::SimpleThreadPool(int num_threads) : stop(false) {
-    for (int i = 0; i < num_threads; ++i) {
-        workers.emplace_back([this] {
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(this->queue_mutex);
-                    this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-                    if (this->stop && this->tasks.empty()) {
-                        return;
-                    }
-                    task = this->tasks.front();
-                    this->tasks.pop();
-                }
-                task();
+void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (size_t i = 0; i < text.size();) {
+        auto c = static_cast<uint8_t>(text[i]);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+            ++i;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+            ++i;
+        } else if (c < 0x80) {
+            out += static_cast<char>(c);
+            ++i;
+        } else {
+            size_t length = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+            bool valid = length != 0 && i + length <= text.size();
+            for (size_t k = 1; valid && k < length; ++k) {
+                valid = (static_cast<uint8_t>(text[i + k]) & 0xC0) == 0x80;
+            }
+            if (valid) {
+                out.append(text.data() + i, length);
+                i += length;
+            } else {
+                out += "\\ufffd";
+                ++i;
             }
-        });
-    }
-    LOGI("SimpleThreadPool created with %d threads.", num_threads);
-}
-
-SimpleThreadPool::~SimpleThreadPool() {
-    shutdown();
-}
-
-void SimpleThreadPool::enqueue(std::function<void()> task) {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        if (stop) {
-            log_error("enqueue on stopped ThreadPool");
-            return;
         }
-        tasks.push(std::move(task));
     }
-    condition.notify_one();
+    out += '"';
 }
 
-void SimpleThreadPool::shutdown() {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        stop = true;
-    }
-    condition.notify_all();
-    for (std::thread& worker : workers) {
-        if (worker.joinable()) {
-            worker.join();
+void utf8_to_utf16(std::string_view utf8, std::vector<uint16_t>& out) {
+    out.reserve(out.size() + utf8.size());
+    for (size_t i = 0; i < utf8.size();) {
+        uint8_t c = static_cast<uint8_t>(utf8[i]);
+        uint32_t code_point;
+        size_t length;
+        if (c < 0x80) { code_point = c; length = 1; }
+        else if ((c & 0xE0) == 0xC0) { code_point = c & 0x1F; length = 2; }
+        else if ((c & 0xF0) == 0xE0) { code_point = c & 0x0F; length = 3; }
+        else if ((c & 0xF8) == 0xF0) { code_point = c & 0x07; length = 4; }
+        else { code_point = 0xFFFD; length = 1; }
+
+        if (i + length > utf8.size()) {
+            code_point = 0xFFFD;
+            length = utf8.size() - i;
+        } else {
+            for (size_t k = 1; k < length; ++k) {
+                code_point = (code_point << 6) | (static_cast<uint8_t>(utf8[i + k]) & 0x3F);
+            }
+        }
+        i += length;
+
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            out.push_back(static_cast<uint16_t>(0xD800 + (code_point >> 10)));
+            out.push_back(static_cast<uint16_t>(0xDC00 + (code_point & 0x3FF)));
+        } else {
+            out.push_back(static_cast<uint16_t>(code_point));
         }
     }
-    LOGI("SimpleThreadPool shut down.");
-}
\ No newline at end of file
+}
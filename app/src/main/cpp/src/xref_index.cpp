@@ -0,0 +1,177 @@
+#include "../include/xref_index.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+bool xref_less(const Xref& a, const Xref& b) {
+    if (a.target != b.target) return a.target < b.target;
+    if (a.source != b.source) return a.source < b.source;
+    return a.kind < b.kind;
+}
+
+bool xref_equal(const Xref& a, const Xref& b) {
+    return a.target == b.target && a.source == b.source && a.kind == b.kind;
+}
+
+} // namespace
+
+void XrefIndex::collect(const ElfParser& parser, const std::vector<DisassembledInstruction>& instructions,
+                        std::vector<Xref>& out) {
+    const auto& sections = parser.get_section_headers();
+    for (const auto& instr : instructions) {
+        if (instr.branch_target != 0) {
+            if (instr.branch_kind == BranchKind::Call) {
+                out.push_back({instr.branch_target, instr.address, XrefKind::Call});
+            } else if (instr.branch_kind == BranchKind::Jump) {
+                out.push_back({instr.branch_target, instr.address, XrefKind::Jump});
+            }
+        }
+
+        if (instr.data_target == 0) continue;
+        out.push_back({instr.data_target, instr.address,
+                       instr.data_size > 0 ? XrefKind::Read : XrefKind::Address});
+
+        // A literal-pool word holding an address inside the image
+        if (instr.data_size == 4) {
+            const uint8_t* literal = parser.get_data_at_address(instr.data_target, 4);
+            if (literal == nullptr) continue;
+            uint32_t value;
+            memcpy(&value, literal, sizeof(value));
+            if (value == 0) continue;
+
+            uint64_t target = value;
+            int section_index = parser.find_section_by_address(target);
+            if (section_index < 0 && (target & 1)) {
+                section_index = parser.find_section_by_address(target & ~1ULL);
+            }
+            if (section_index < 0) continue;
+            // Odd pointers into code are Thumb function addresses
+            if ((target & 1) && (sections[section_index].sh_flags & SHF_EXECINSTR)) {
+                target &= ~1ULL;
+            }
+            out.push_back({target, instr.address, XrefKind::Pointer});
+        }
+    }
+}
+
+void XrefIndex::add(const std::vector<Xref>& references) {
+    if (finalized_) {
+        log_error("add called on a finalized xref index.");
+        return;
+    }
+    pending_.insert(pending_.end(), references.begin(), references.end());
+}
+
+void XrefIndex::finalize() {
+    if (finalized_) return;
+    std::sort(pending_.begin(), pending_.end(), xref_less);
+    build(pending_);
+    std::vector<Xref>().swap(pending_);
+    finalized_ = true;
+    log_info("Xref index built: " + std::to_string(sources_.size()) + " references to " +
+             std::to_string(targets_.size()) + " targets");
+}
+
+void XrefIndex::build(std::vector<Xref>& sorted_references) {
+    sorted_references.erase(std::unique(sorted_references.begin(), sorted_references.end(), xref_equal),
+                            sorted_references.end());
+
+    targets_.clear();
+    offsets_.clear();
+    sources_.resize(sorted_references.size());
+    kinds_.resize(sorted_references.size());
+    for (size_t i = 0; i < sorted_references.size(); ++i) {
+        const Xref& ref = sorted_references[i];
+        if (targets_.empty() || targets_.back() != ref.target) {
+            targets_.push_back(ref.target);
+            offsets_.push_back(static_cast<uint32_t>(i));
+        }
+        sources_[i] = ref.source;
+        kinds_[i] = ref.kind;
+    }
+    offsets_.push_back(static_cast<uint32_t>(sorted_references.size()));
+    targets_.shrink_to_fit();
+    offsets_.shrink_to_fit();
+    memory_.set(capacity_bytes(targets_, offsets_, sources_, kinds_));
+}
+
+std::vector<Xref> XrefIndex::expand() const {
+    std::vector<Xref> references;
+    references.reserve(sources_.size());
+    for (size_t t = 0; t < targets_.size(); ++t) {
+        for (uint32_t i = offsets_[t]; i < offsets_[t + 1]; ++i) {
+            references.push_back({targets_[t], sources_[i], kinds_[i]});
+        }
+    }
+    return references;
+}
+
+XrefPage XrefIndex::query(uint64_t target_start, uint64_t target_end, size_t offset, size_t limit) const {
+    XrefPage page;
+    if (!finalized_ || target_end <= target_start) return page;
+
+    size_t first_target = std::lower_bound(targets_.begin(), targets_.end(), target_start) - targets_.begin();
+    size_t last_target = std::lower_bound(targets_.begin(), targets_.end(), target_end) - targets_.begin();
+    uint32_t begin = offsets_[first_target];
+    uint32_t end = offsets_[last_target];
+    page.total_matches = end - begin;
+    if (offset >= page.total_matches) return page;
+
+    uint32_t first = begin + static_cast<uint32_t>(offset);
+    uint32_t last = static_cast<uint32_t>(std::min<size_t>(end, first + limit));
+    // Target of the first entry on the page; later ones advance through offsets_
+    size_t t = std::upper_bound(offsets_.begin() + first_target, offsets_.begin() + last_target + 1, first) -
+               offsets_.begin() - 1;
+    page.references.reserve(last - first);
+    for (uint32_t i = first; i < last; ++i) {
+        while (offsets_[t + 1] <= i) ++t;
+        page.references.push_back({targets_[t], sources_[i], kinds_[i]});
+    }
+    return page;
+}
+
+size_t XrefIndex::count_to(uint64_t target) const {
+    auto it = std::lower_bound(targets_.begin(), targets_.end(), target);
+    if (it == targets_.end() || *it != target) return 0;
+    size_t t = it - targets_.begin();
+    return offsets_[t + 1] - offsets_[t];
+}
+
+std::vector<uint64_t> XrefIndex::targets_of_kind(XrefKind kind) const {
+    std::vector<uint64_t> result;
+    for (size_t t = 0; t < targets_.size(); ++t) {
+        for (uint32_t i = offsets_[t]; i < offsets_[t + 1]; ++i) {
+            if (kinds_[i] == kind) {
+                result.push_back(targets_[t]);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<Xref> XrefIndex::replace_sources(uint64_t source_start, uint64_t source_end,
+                                             std::vector<Xref> references) {
+    if (!finalized_) {
+        log_error("replace_sources called before the xref index was finalized.");
+        return {};
+    }
+
+    std::vector<Xref> kept = expand();
+    auto replaced = std::stable_partition(kept.begin(), kept.end(), [&](const Xref& ref) {
+        return ref.source < source_start || ref.source >= source_end;
+    });
+    std::vector<Xref> removed(replaced, kept.end());
+    kept.erase(replaced, kept.end());
+
+    std::sort(references.begin(), references.end(), xref_less);
+    std::vector<Xref> merged;
+    merged.reserve(kept.size() + references.size());
+    std::merge(kept.begin(), kept.end(), references.begin(), references.end(),
+               std::back_inserter(merged), xref_less);
+    build(merged);
+    return removed;
+}
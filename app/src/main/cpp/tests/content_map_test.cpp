@@ -0,0 +1,84 @@
+// ContentMap::refresh after byte patches against a map built from scratch
+// over the patched file.
+
+#include <string>
+#include <vector>
+
+#include "../include/code_sweep.h"
+#include "../include/content_map.h"
+#include "../include/task_scheduler.h"
+#include "test_support.h"
+
+namespace {
+
+bool same_blocks(const ContentMap& a, const ContentMap& b) {
+    if (a.block_count() != b.block_count()) return false;
+    for (size_t i = 0; i < a.block_count(); ++i) {
+        const ContentBlock& x = a.block(i);
+        const ContentBlock& y = b.block(i);
+        if (x.entropy != y.entropy || x.code_score != y.code_score || x.content != y.content) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    SyntheticElfSpec spec;
+    spec.code_bytes = 512 * 1024;
+    spec.code_sections = 2;
+    spec.symbols = 500;
+    spec.dynamic_symbols = 50;
+    spec.rodata_bytes = 64 * 1024;
+    const std::string path = test_file_path("content-map.elf");
+    CHECK(write_synthetic_elf(path, spec), "could not write the test file");
+
+    // Patches are written into the mapping, so test over a writable copy
+    std::vector<uint8_t> bytes;
+    MappedFile mapped = map_file(path);
+    if (mapped.data != nullptr) {
+        bytes.assign(mapped.data, mapped.data + mapped.size);
+        unmap_file(mapped);
+    }
+    unlink(path.c_str());
+    CHECK(!bytes.empty(), "could not read the test file");
+    if (bytes.empty()) return test_result("content_map_test");
+
+    MappedFile file = {bytes.data(), bytes.size(), -1};
+    ElfParser parser(file);
+    CHECK(parser.parse(), "could not parse the test file");
+    ModeMap mode_map(parser, default_code_mode(parser));
+    TaskScheduler scheduler(2);
+    ContentMap content(parser, mode_map, scheduler, TaskPriority::Interactive);
+
+    // Zero a few blocks, fill some with noise, and make small edits that
+    // straddle block boundaries
+    SyntheticRandom random(kSyntheticSeed);
+    struct Patch {
+        uint64_t offset;
+        uint64_t size;
+        int kind; // 0 zeros, 1 noise, 2 copy of other bytes
+    };
+    const Patch patches[] = {
+        {0x3000, 3 * ContentMap::kBlockBytes, 0},
+        {0x20000, 2 * ContentMap::kBlockBytes, 1},
+        {ContentMap::kBlockBytes * 9 - 3, 8, 1},
+        {0x40000 + 100, 1000, 2},
+        {bytes.size() - 10, 10, 0},
+    };
+    for (const Patch& patch : patches) {
+        for (uint64_t i = 0; i < patch.size; ++i) {
+            uint8_t& byte = bytes[patch.offset + i];
+            byte = patch.kind == 0 ? 0 : patch.kind == 1 ? static_cast<uint8_t>(random.next())
+                                                          : bytes[random.below(static_cast<uint32_t>(bytes.size()))];
+        }
+        content.refresh(parser, mode_map, patch.offset, patch.size);
+        ContentMap rebuilt(parser, mode_map, scheduler, TaskPriority::Interactive);
+        CHECK(same_blocks(content, rebuilt),
+              "refresh after patching " + std::to_string(patch.size) + " bytes at " + hex(patch.offset) +
+              " differs from a rebuilt map");
+    }
+    CHECK(content.class_at(0x3000) == ContentClass::ZeroFill, "zeroed blocks are not zero fill");
+    CHECK(content.class_at(0x20000) == ContentClass::Compressed, "noise blocks are not compressed");
+    return test_result("content_map_test");
+}
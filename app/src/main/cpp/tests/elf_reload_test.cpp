@@ -0,0 +1,106 @@
+// Reloading through reload_elf_file after failed loads: a failure must
+// leave no parser behind, since its names would point into a file that is
+// no longer mapped, and the next good load must work as the first did.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/elf_parser.h"
+#include "test_support.h"
+
+namespace {
+
+bool write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool inside(std::string_view name, const MappedFile& file) {
+    auto begin = reinterpret_cast<const char*>(file.data);
+    return name.empty() || (name.data() >= begin && name.data() + name.size() <= begin + file.size);
+}
+
+// Every name of the loaded file lies in its current mapping.
+void check_loaded(const std::string& label, const MappedFile& file, const std::unique_ptr<ElfParser>& parser) {
+    CHECK(parser != nullptr && file.data != nullptr, label + ": not loaded");
+    if (parser == nullptr || file.data == nullptr) return;
+    CHECK(parser->get_section_headers().size() > 1 && !parser->get_symbols().empty(),
+          label + ": no sections or symbols");
+    bool names_inside = true;
+    for (const SectionHeader& section : parser->get_section_headers()) names_inside &= inside(section.name, file);
+    for (const SymbolEntry& symbol : parser->get_symbols()) names_inside &= inside(symbol.name, file);
+    CHECK(names_inside, label + ": names point outside the mapped file");
+}
+
+void check_failed(const std::string& label, bool loaded, const MappedFile& file,
+                  const std::unique_ptr<ElfParser>& parser, const std::string& error) {
+    CHECK(!loaded, label + ": load succeeded");
+    CHECK(parser == nullptr, label + ": a parser was left behind");
+    CHECK(file.data == nullptr && file.fd == -1, label + ": a mapping was left behind");
+    CHECK(!error.empty(), label + ": no error message");
+}
+
+} // namespace
+
+int main() {
+    SyntheticElfSpec spec;
+    spec.code_bytes = 256 * 1024;
+    spec.code_sections = 2;
+    spec.symbols = 500;
+    spec.dynamic_symbols = 50;
+    spec.rodata_bytes = 4096;
+    const std::string first = test_file_path("reload-first.elf");
+    const std::string second = test_file_path("reload-second.elf");
+    const std::string garbage = test_file_path("reload-garbage.bin");
+    const std::string truncated = test_file_path("reload-truncated.bin");
+    const std::string missing = test_file_path("reload-missing.elf");
+
+    bool written = write_synthetic_elf(first, spec);
+    spec.thumb = false;
+    spec.seed = kSyntheticSeed + 1;
+    written &= write_synthetic_elf(second, spec);
+    written &= write_file(garbage, std::vector<uint8_t>(4096, 0x5A));
+    written &= write_file(truncated, {0x7F, 'E', 'L', 'F', 1, 1, 1});
+    CHECK(written, "could not write the test files");
+
+    MappedFile file = {nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser;
+    std::string error;
+
+    CHECK(reload_elf_file(first, file, parser, error), "first load failed: " + error);
+    check_loaded("first load", file, parser);
+
+    struct Failure {
+        const char* label;
+        const std::string& path;
+    };
+    for (const Failure& failure : {Failure{"missing file", missing}, Failure{"not an ELF", garbage},
+                                   Failure{"truncated header", truncated}}) {
+        error.clear();
+        bool loaded = reload_elf_file(failure.path, file, parser, error);
+        check_failed(std::string("reload of ") + failure.label, loaded, file, parser, error);
+
+        // The next good load works whether or not something was loaded before.
+        error.clear();
+        const std::string& next = failure.path == garbage ? second : first;
+        CHECK(reload_elf_file(next, file, parser, error),
+              std::string("load after ") + failure.label + " failed: " + error);
+        check_loaded(std::string("load after ") + failure.label, file, parser);
+    }
+
+    // Failing twice in a row from the empty state.
+    error.clear();
+    check_failed("reload of missing file", reload_elf_file(missing, file, parser, error), file, parser, error);
+    error.clear();
+    check_failed("second failure in a row", reload_elf_file(garbage, file, parser, error), file, parser, error);
+
+    parser.reset();
+    if (file.data) unmap_file(file);
+    for (const std::string& path : {first, second, garbage, truncated}) unlink(path.c_str());
+    return test_result("elf_reload_test");
+}
@@ -0,0 +1,75 @@
+// FunctionTable extents against the sizes of the symbols they came from:
+// a sized function symbol must come out as exactly one function of that
+// extent, whatever call targets or prologues were found inside it.
+
+#include <string>
+
+#include "../include/code_sweep.h"
+#include "../include/function_table.h"
+#include "../include/function_diff.h"
+#include "../include/task_scheduler.h"
+#include "test_support.h"
+
+namespace {
+
+void check_symbol_extents(const char* name, const SyntheticElfSpec& spec) {
+    SyntheticElfFile elf(name, spec);
+    CHECK(elf.ok(), std::string(name) + ": synthetic ELF not loaded");
+    if (!elf.ok()) return;
+    const ElfParser& parser = elf.parser();
+
+    ModeMap mode_map(parser, default_code_mode(parser));
+    TaskScheduler scheduler(2);
+    auto table = build_function_table(parser, mode_map, scheduler, TaskPriority::Interactive);
+    CHECK(table != nullptr && table->size() > 0, std::string(name) + ": no functions");
+    if (table == nullptr) return;
+
+    const auto& sections = parser.get_section_headers();
+    for (size_t i = 1; i < table->size(); ++i) {
+        const FunctionInfo& previous = table->function(static_cast<uint32_t>(i - 1));
+        const FunctionInfo& current = table->function(static_cast<uint32_t>(i));
+        CHECK(previous.start < previous.end && previous.end <= current.start,
+              std::string(name) + ": functions at " + hex(previous.start) + " and " + hex(current.start) +
+              " overlap or are out of order");
+    }
+
+    size_t sized = 0;
+    for (const SymbolEntry& symbol : parser.get_symbols()) {
+        if ((symbol.st_info & 0xF) != STT_FUNC || symbol.st_size == 0 ||
+            symbol.st_shndx == 0 || symbol.st_shndx >= sections.size()) {
+            continue;
+        }
+        uint64_t start = symbol.st_value & ~1ULL;
+        uint64_t end = start + symbol.st_size;
+        // A function never runs past its section, so such symbols are cut.
+        const SectionHeader& section = sections[symbol.st_shndx];
+        if (start < section.sh_addr || end > section.sh_addr + section.sh_size) continue;
+        ++sized;
+
+        long index = table->find_containing(start);
+        CHECK(index >= 0, std::string(name) + ": no function contains " + std::string(symbol.name) +
+              " at " + hex(start));
+        if (index < 0) continue;
+        const FunctionInfo& function = table->function(static_cast<uint32_t>(index));
+        CHECK(function.start == start && function.end == end,
+              std::string(name) + ": " + std::string(symbol.name) + " is [" + hex(start) + ", " + hex(end) +
+              ") but its function is [" + hex(function.start) + ", " + hex(function.end) + ")");
+    }
+    CHECK(sized > 0, std::string(name) + ": no sized function symbols to check");
+}
+
+} // namespace
+
+int main() {
+    SyntheticElfSpec spec;
+    spec.code_bytes = 2ULL << 20;
+    spec.code_sections = 4;
+    spec.symbols = 3000;
+    spec.dynamic_symbols = 300;
+    spec.rodata_bytes = 64 * 1024;
+    check_symbol_extents("functions-thumb", spec);
+
+    spec.thumb = false;
+    check_symbol_extents("functions-arm", spec);
+    return test_result("function_table_test");
+}
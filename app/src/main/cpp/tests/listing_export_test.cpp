@@ -0,0 +1,92 @@
+// Listings exported in many small chunks against the same listing exported
+// with every section in a single chunk: cutting must not change a byte.
+
+#include <cstdio>
+#include <string>
+
+#include "../include/code_sweep.h"
+#include "../include/listing_export.h"
+#include "../include/task_scheduler.h"
+#include "test_support.h"
+
+namespace {
+
+// Exports into a temporary file and returns its contents.
+bool export_to_string(const ElfParser& parser, const ModeMap& mode_map, TaskScheduler& scheduler,
+                      const ListingExportOptions& options, std::string& text, ListingExportStats& stats) {
+    FILE* file = tmpfile();
+    if (file == nullptr) return false;
+    bool ok = export_listing(fileno(file), parser, mode_map, scheduler, options, &stats);
+    text.clear();
+    rewind(file);
+    char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, read);
+    fclose(file);
+    return ok;
+}
+
+void check_chunking(const char* name, const SyntheticElfSpec& spec) {
+    SyntheticElfFile elf(name, spec);
+    CHECK(elf.ok(), std::string(name) + ": synthetic ELF not loaded");
+    if (!elf.ok()) return;
+    const ElfParser& parser = elf.parser();
+    ModeMap mode_map(parser, default_code_mode(parser));
+    TaskScheduler scheduler(4);
+    DemangleCache demangler(elf.file().data, elf.file().size);
+
+    for (ListingFormat format : {ListingFormat::Text, ListingFormat::JsonLines}) {
+        std::string label = std::string(name) + (format == ListingFormat::Text ? " text" : " jsonl");
+        // No operand resolver: comments of a chunk's first instructions may
+        // lack PIC pairs loaded in the previous chunk, by design.
+        ListingExportOptions options;
+        options.format = format;
+        options.demangler = &demangler;
+
+        options.chunk_bytes = 1ULL << 30;
+        std::string single;
+        ListingExportStats single_stats;
+        CHECK(export_to_string(parser, mode_map, scheduler, options, single, single_stats),
+              label + ": single-chunk export failed");
+
+        for (size_t chunk_bytes : {size_t{256}, size_t{4096}, size_t{64 * 1024}}) {
+            options.chunk_bytes = chunk_bytes;
+            std::string chunked;
+            ListingExportStats chunked_stats;
+            CHECK(export_to_string(parser, mode_map, scheduler, options, chunked, chunked_stats),
+                  label + ": export in " + std::to_string(chunk_bytes) + "-byte chunks failed");
+
+            size_t mismatch = 0;
+            while (mismatch < single.size() && mismatch < chunked.size() && single[mismatch] == chunked[mismatch]) {
+                ++mismatch;
+            }
+            size_t line_start = single.rfind('\n', mismatch == 0 ? 0 : mismatch - 1);
+            line_start = line_start == std::string::npos ? 0 : line_start + 1;
+            CHECK(chunked == single,
+                  label + ": " + std::to_string(chunk_bytes) + "-byte chunks differ from a single pass at byte " +
+                  std::to_string(mismatch) + ", line \"" +
+                  single.substr(line_start, single.find('\n', line_start) - line_start) + "\"");
+            CHECK(chunked_stats.instructions == single_stats.instructions &&
+                  chunked_stats.bytes_written == single_stats.bytes_written &&
+                  single_stats.bytes_written == single.size(),
+                  label + ": stats differ in " + std::to_string(chunk_bytes) + "-byte chunks");
+        }
+        CHECK(single_stats.instructions > 0, label + ": nothing exported");
+    }
+}
+
+} // namespace
+
+int main() {
+    SyntheticElfSpec spec;
+    spec.code_bytes = 1ULL << 20;
+    spec.code_sections = 3;
+    spec.symbols = 2000;
+    spec.dynamic_symbols = 200;
+    spec.rodata_bytes = 16 * 1024;
+    check_chunking("listing-thumb", spec);
+
+    spec.thumb = false;
+    check_chunking("listing-arm", spec);
+    return test_result("listing_export_test");
+}
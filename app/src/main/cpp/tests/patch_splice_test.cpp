@@ -0,0 +1,94 @@
+// Splicing the re-decoded affected span of a byte patch into a listing
+// against decoding the whole patched run again, for ARM and Thumb code.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#include "../include/arm_disassembler.h"
+#include "../include/code_sweep.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr uint64_t kRunStart = 0x10000;
+constexpr int kPatches = 200;
+
+bool same_instruction(const DisassembledInstruction& a, const DisassembledInstruction& b) {
+    return a.address == b.address && a.size == b.size && a.bytes == b.bytes &&
+           std::string_view(a.mnemonic) == std::string_view(b.mnemonic) &&
+           std::string_view(a.operands) == std::string_view(b.operands) &&
+           a.branch_target == b.branch_target && a.data_target == b.data_target;
+}
+
+std::string describe(const DisassembledInstruction& instr) {
+    return hex(instr.address) + " " + std::string(std::string_view(instr.mnemonic)) + " " +
+           std::string(std::string_view(instr.operands));
+}
+
+void check_splices(const char* name, SyntheticCode kind, bool thumb, uint64_t seed) {
+    std::vector<uint8_t> code = synthetic_code(kind, seed, 64 * 1024);
+    const uint64_t run_end = kRunStart + code.size();
+    SyntheticRandom random(seed ^ 0x5A5A5A5AULL);
+    ArmDisassembler disassembler;
+
+    std::vector<DisassembledInstruction> listing;
+    std::vector<DisassembledInstruction> full;
+    std::vector<DisassembledInstruction> span_instructions;
+    disassembler.disassemble_block_into(code.data(), code.size(), kRunStart, thumb, listing);
+
+    for (int patch = 0; patch < kPatches; ++patch) {
+        // Short patches, half of them copying bytes from elsewhere in the
+        // stream so valid (often 32-bit) encodings get written too.
+        size_t length = 1 + random.below(8);
+        size_t offset = random.below(static_cast<uint32_t>(code.size() - length));
+        size_t source = random.below(static_cast<uint32_t>(code.size() - length));
+        bool copy = random.below(2) == 0;
+        for (size_t i = 0; i < length; ++i) {
+            code[offset + i] = copy ? code[source + i] : static_cast<uint8_t>(random.next());
+        }
+
+        uint64_t span_start = 0;
+        uint64_t span_end = 0;
+        affected_instruction_span(code.data(), kRunStart, run_end, thumb, kRunStart + offset,
+                                  kRunStart + offset + length, span_start, span_end);
+        CHECK(span_start <= kRunStart + offset && span_end >= kRunStart + offset + length &&
+              span_start >= kRunStart && span_end <= run_end,
+              std::string(name) + ": span [" + hex(span_start) + ", " + hex(span_end) +
+              ") does not cover the patch at " + hex(kRunStart + offset));
+
+        disassembler.disassemble_block_into(code.data() + (span_start - kRunStart), span_end - span_start,
+                                            span_start, thumb, span_instructions);
+        auto by_address = [](const DisassembledInstruction& instr, uint64_t address) {
+            return instr.address < address;
+        };
+        auto first = std::lower_bound(listing.begin(), listing.end(), span_start, by_address);
+        auto last = std::lower_bound(first, listing.end(), span_end, by_address);
+        first = listing.erase(first, last);
+        listing.insert(first, span_instructions.begin(), span_instructions.end());
+
+        disassembler.disassemble_block_into(code.data(), code.size(), kRunStart, thumb, full);
+        bool same = listing.size() == full.size();
+        size_t mismatch = 0;
+        for (; same && mismatch < full.size(); ++mismatch) {
+            same = same_instruction(listing[mismatch], full[mismatch]);
+        }
+        CHECK(same, std::string(name) + ": patch " + std::to_string(patch) + " at " +
+              hex(kRunStart + offset) + " spliced as [" + hex(span_start) + ", " + hex(span_end) + ") " +
+              (listing.size() != full.size()
+                   ? "has " + std::to_string(listing.size()) + " instructions, not " + std::to_string(full.size())
+                   : "differs at " + describe(listing[mismatch - 1]) + " vs " + describe(full[mismatch - 1])));
+        if (!same) listing = full; // Report each bad splice once
+    }
+}
+
+} // namespace
+
+int main() {
+    check_splices("arm", SyntheticCode::ArmMix, false, kSyntheticSeed);
+    check_splices("thumb16", SyntheticCode::Thumb16Mix, true, kSyntheticSeed + 1);
+    check_splices("thumb2", SyntheticCode::Thumb2Mix, true, kSyntheticSeed + 2);
+    check_splices("thumb-random", SyntheticCode::Random, true, kSyntheticSeed + 3);
+    return test_result("patch_splice_test");
+}
@@ -0,0 +1,231 @@
+// InstructionSearchIndex results against a linear filter over the decoded
+// instructions, before and after patched ranges are replaced.
+
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#include "../include/arm_disassembler.h"
+#include "../include/code_sweep.h"
+#include "../include/instruction_search_index.h"
+#include "test_support.h"
+
+namespace {
+
+using Predicate = std::function<bool(const DisassembledInstruction&)>;
+
+struct Run {
+    uint64_t start;
+    bool thumb;
+    std::vector<uint8_t> code;
+};
+
+struct Query {
+    std::string text;
+    Predicate matches;
+};
+
+bool equal_ignoring_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (toupper(static_cast<unsigned char>(a[i])) != toupper(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+std::vector<std::string_view> operand_tokens(const DisassembledInstruction& instr) {
+    std::vector<std::string_view> tokens;
+    std::string_view operands = instr.operands;
+    size_t i = 0;
+    while (i < operands.size()) {
+        while (i < operands.size() && std::string_view(" \t,[]{}!").find(operands[i]) != std::string_view::npos) ++i;
+        size_t start = i;
+        while (i < operands.size() && std::string_view(" \t,[]{}!").find(operands[i]) == std::string_view::npos) ++i;
+        if (i > start) tokens.push_back(operands.substr(start, i - start));
+    }
+    return tokens;
+}
+
+int register_number(std::string_view token) {
+    if (equal_ignoring_case(token, "SP")) return 13;
+    if (equal_ignoring_case(token, "LR")) return 14;
+    if (equal_ignoring_case(token, "PC")) return 15;
+    for (int reg = 0; reg <= 15; ++reg) {
+        if (equal_ignoring_case(token, "R" + std::to_string(reg))) return reg;
+    }
+    return -1;
+}
+
+bool immediate_value(std::string_view token, uint64_t& value) {
+    if (!token.empty() && token[0] == '#') token.remove_prefix(1);
+    bool negative = !token.empty() && token[0] == '-';
+    if (negative) token.remove_prefix(1);
+    if (token.empty() || token[0] < '0' || token[0] > '9') return false;
+    bool hex_form = token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X');
+    std::string digits(token.substr(hex_form ? 2 : 0));
+    char* end = nullptr;
+    uint64_t parsed = strtoull(digits.c_str(), &end, hex_form ? 16 : 10);
+    if (end == digits.c_str() || *end != '\0') return false;
+    value = negative ? 0 - parsed : parsed;
+    return true;
+}
+
+Predicate mnemonic_is(std::string mnemonic) {
+    return [mnemonic](const DisassembledInstruction& instr) {
+        return equal_ignoring_case(std::string_view(instr.mnemonic), mnemonic);
+    };
+}
+
+Predicate uses_register(int reg) {
+    return [reg](const DisassembledInstruction& instr) {
+        for (std::string_view token : operand_tokens(instr)) {
+            uint64_t value;
+            if (!immediate_value(token, value) && register_number(token) == reg) return true;
+        }
+        return false;
+    };
+}
+
+Predicate uses_immediate(uint64_t immediate) {
+    return [immediate](const DisassembledInstruction& instr) {
+        for (std::string_view token : operand_tokens(instr)) {
+            uint64_t value;
+            if (immediate_value(token, value) && value == immediate) return true;
+        }
+        return false;
+    };
+}
+
+Predicate uses_word(std::string word) {
+    return [word](const DisassembledInstruction& instr) {
+        for (std::string_view token : operand_tokens(instr)) {
+            if (equal_ignoring_case(token, word)) return true;
+        }
+        return false;
+    };
+}
+
+Predicate address_contains(std::string fragment) {
+    return [fragment](const DisassembledInstruction& instr) {
+        std::string text;
+        append_hex(text, instr.address);
+        return text.find(fragment) != std::string::npos;
+    };
+}
+
+Predicate all_of(std::vector<Predicate> predicates) {
+    return [predicates](const DisassembledInstruction& instr) {
+        return std::all_of(predicates.begin(), predicates.end(), [&](const Predicate& p) { return p(instr); });
+    };
+}
+
+std::vector<Query> queries() {
+    return {
+        {"LDR", mnemonic_is("LDR")},
+        {"push", mnemonic_is("PUSH")},
+        {"BL", mnemonic_is("BL")},
+        {"MOV R0", all_of({mnemonic_is("MOV"), uses_register(0)})},
+        {"ldr pc", all_of({mnemonic_is("LDR"), uses_register(15)})},
+        {"R7", uses_register(7)},
+        {"SP", uses_register(13)},
+        {"ADD SP #8", all_of({mnemonic_is("ADD"), uses_register(13), uses_immediate(8)})},
+        {"#0", uses_immediate(0)},
+        {"#4", uses_immediate(4)},
+        {"0x10", uses_immediate(16)},
+        {"LDR LSL", all_of({mnemonic_is("LDR"), uses_word("LSL")})},
+        {"@1a", address_contains("1a")},
+        {"@2f4", address_contains("2f4")},
+        {"@21a4", address_contains("21a4")},
+        {"@0x00020f0", address_contains("20f0")},
+        {"STR @3c", all_of({mnemonic_is("STR"), address_contains("3c")})},
+        {"CMP R3 @24", all_of({mnemonic_is("CMP"), uses_register(3), address_contains("24")})},
+    };
+}
+
+void check_queries(const char* stage, const InstructionSearchIndex& index,
+                   const std::vector<DisassembledInstruction>& instructions) {
+    struct Range {
+        uint64_t start;
+        uint64_t end; // 0: unbounded
+    };
+    const Range ranges[] = {{0, 0}, {0x8400, 0x20800}, {0x21000, 0x2a000}};
+    size_t total = 0;
+    for (const Query& query : queries()) {
+        for (const Range& range : ranges) {
+            std::vector<uint64_t> expected;
+            for (const auto& instr : instructions) {
+                if (instr.address < range.start || (range.end != 0 && instr.address >= range.end)) continue;
+                if (query.matches(instr)) expected.push_back(instr.address);
+            }
+            total += expected.size();
+            std::string label = std::string(stage) + ": \"" + query.text + "\" in [" + hex(range.start) + ", " +
+                                hex(range.end) + ")";
+
+            InstructionSearchResult all = index.search(query.text, range.start, range.end, 0, SIZE_MAX);
+            CHECK(all.total_matches == expected.size() && all.addresses == expected,
+                  label + " gives " + std::to_string(all.total_matches) + " matches, the filter " +
+                  std::to_string(expected.size()));
+
+            InstructionSearchResult page = index.search(query.text, range.start, range.end, 3, 5);
+            std::vector<uint64_t> expected_page;
+            for (size_t i = 3; i < expected.size() && i < 8; ++i) expected_page.push_back(expected[i]);
+            CHECK(page.total_matches == expected.size() && page.addresses == expected_page,
+                  label + ": page 3+5 differs from the filter");
+        }
+    }
+    CHECK(total > 0, std::string(stage) + ": no query matched anything");
+}
+
+std::vector<DisassembledInstruction> decode_all(ArmDisassembler& disassembler, const std::vector<Run>& runs) {
+    std::vector<DisassembledInstruction> all;
+    for (const Run& run : runs) {
+        auto decoded = disassembler.disassemble_block(run.code.data(), run.code.size(), run.start, run.thumb);
+        all.insert(all.end(), decoded.begin(), decoded.end());
+    }
+    std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.address < b.address; });
+    return all;
+}
+
+} // namespace
+
+int main() {
+    std::vector<Run> runs = {
+        {0x8000, false, synthetic_code(SyntheticCode::ArmMix, kSyntheticSeed, 32 * 1024)},
+        {0x20000, true, synthetic_code(SyntheticCode::Thumb2Mix, kSyntheticSeed + 1, 64 * 1024)},
+    };
+    ArmDisassembler disassembler;
+
+    // Runs are added out of address order; finalize() sorts documents.
+    InstructionSearchIndex index;
+    for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+        index.add_instructions(disassembler.disassemble_block(run->code.data(), run->code.size(),
+                                                              run->start, run->thumb));
+    }
+    index.finalize();
+    std::vector<DisassembledInstruction> instructions = decode_all(disassembler, runs);
+    CHECK(index.instruction_count() == instructions.size(), "instruction count differs from the decode");
+    check_queries("built", index, instructions);
+
+    // Patch both runs and replace the affected spans, some of them twice.
+    SyntheticRandom random(kSyntheticSeed ^ 0xC0DEULL);
+    for (int patch = 0; patch < 40; ++patch) {
+        Run& run = runs[random.below(2)];
+        size_t length = 1 + random.below(6);
+        size_t offset = random.below(static_cast<uint32_t>(std::min<size_t>(run.code.size(), 0x3000) - length));
+        for (size_t i = 0; i < length; ++i) run.code[offset + i] = static_cast<uint8_t>(random.next());
+
+        uint64_t span_start = 0;
+        uint64_t span_end = 0;
+        affected_instruction_span(run.code.data(), run.start, run.start + run.code.size(), run.thumb,
+                                  run.start + offset, run.start + offset + length, span_start, span_end);
+        index.replace_range(span_start, span_end,
+                            disassembler.disassemble_block(run.code.data() + (span_start - run.start),
+                                                           span_end - span_start, span_start, run.thumb));
+    }
+    check_queries("patched", index, decode_all(disassembler, runs));
+    return test_result("search_index_test");
+}
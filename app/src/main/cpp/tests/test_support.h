@@ -0,0 +1,77 @@
+#ifndef MOBILE_ARM_DISASSEMBLER_TEST_SUPPORT_H
+#define MOBILE_ARM_DISASSEMBLER_TEST_SUPPORT_H
+
+#include <unistd.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../bench/synthetic_code.h"
+
+// Minimal support for the host tests: each test is an executable that
+// reports every failed check and exits non-zero if there was one.
+
+inline int g_test_failures = 0;
+
+#define CHECK(condition, description)                                                  \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            ++g_test_failures;                                                         \
+            fprintf(stderr, "%s:%d: FAILED %s: %s\n", __FILE__, __LINE__, #condition,  \
+                    std::string(description).c_str());                                 \
+        }                                                                              \
+    } while (0)
+
+inline int test_result(const char* name) {
+    if (g_test_failures == 0) {
+        printf("%s: passed\n", name);
+        return 0;
+    }
+    printf("%s: %d failed checks\n", name, g_test_failures);
+    return 1;
+}
+
+inline std::string hex(uint64_t value) {
+    std::string text = "0x";
+    append_hex(text, value);
+    return text;
+}
+
+// A per-process path for a scratch file in the working directory.
+inline std::string test_file_path(const std::string& name) {
+    return "ktimaz-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+// A synthetic ELF written to the working directory, mapped and parsed;
+// the file is removed again on destruction.
+class SyntheticElfFile {
+public:
+    SyntheticElfFile(const std::string& name, const SyntheticElfSpec& spec)
+        : path_(test_file_path(name + ".elf")) {
+        if (!write_synthetic_elf(path_, spec)) return;
+        file_ = map_file(path_);
+        if (file_.data == nullptr) return;
+        parser_ = std::make_unique<ElfParser>(file_);
+        if (!parser_->parse()) parser_.reset();
+    }
+    ~SyntheticElfFile() {
+        parser_.reset();
+        if (file_.data != nullptr) unmap_file(file_);
+        unlink(path_.c_str());
+    }
+    SyntheticElfFile(const SyntheticElfFile&) = delete;
+    SyntheticElfFile& operator=(const SyntheticElfFile&) = delete;
+
+    bool ok() const { return parser_ != nullptr; }
+    const ElfParser& parser() const { return *parser_; }
+    const MappedFile& file() const { return file_; }
+
+private:
+    std::string path_;
+    MappedFile file_ = {nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser_;
+};
+
+#endif //MOBILE_ARM_DISASSEMBLER_TEST_SUPPORT_H
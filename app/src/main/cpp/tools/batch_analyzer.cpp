@@ -0,0 +1,418 @@
+// ktimaz-analyze: headless batch analysis of ELF files.
+//
+// Analyses every file given (directories are walked for ELF files) on all
+// cores and writes one JSON object per file and line (JSON Lines), in
+// completion order: sections, symbols, discovered functions and per-stage
+// timings. A summary goes to stderr. Exit status is 0 when every file was
+// analysed, 1 when some failed and 2 on bad usage.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/arm_disassembler.h"
+#include "../include/code_sweep.h"
+#include "../include/xref_index.h"
+#include "../include/function_table.h"
+#include "../include/task_scheduler.h"
+#include "../include/arena.h"
+
+namespace {
+
+constexpr uint16_t EM_ARM = 40;
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string output_path;   // Empty for stdout
+    size_t jobs = 0;           // 0: one per core
+    bool sections = true;
+    bool symbols = true;
+    bool functions = true;
+    bool force_arm = false;    // Sweep code whatever e_machine says
+};
+
+// Per-stage wall times of one file, in milliseconds.
+struct StageTimes {
+    double map = 0, parse = 0, mode_map = 0, sweep = 0, functions = 0, total = 0;
+
+    StageTimes& operator+=(const StageTimes& other) {
+        map += other.map;
+        parse += other.parse;
+        mode_map += other.mode_map;
+        sweep += other.sweep;
+        functions += other.functions;
+        total += other.total;
+        return *this;
+    }
+};
+
+class Stopwatch {
+public:
+    // Milliseconds since construction or the previous lap().
+    double lap() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - last_).count();
+        last_ = now;
+        return ms;
+    }
+
+private:
+    std::chrono::steady_clock::time_point last_ = std::chrono::steady_clock::now();
+};
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-analyze [options] <file|directory>...\n"
+        "  -o FILE            write the JSON Lines report to FILE instead of stdout\n"
+        "  -j N               analyse N files at a time (default: one per core)\n"
+        "  --files-from FILE  also read input paths from FILE, one per line ('-' for stdin)\n"
+        "  --no-sections      leave section lists out of the report\n"
+        "  --no-symbols       leave symbol lists out of the report\n"
+        "  --no-functions     leave function lists out of the report\n"
+        "  --summary          counts and timings only (all three of the above)\n"
+        "  --force-arm        sweep code of non-ARM files as ARM/Thumb too\n"
+        "  -v                 verbose logging\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+        if (arg == "-o") {
+            if (!value(options.output_path)) return false;
+        } else if (arg == "-j") {
+            if (!value(text)) return false;
+            options.jobs = static_cast<size_t>(std::max(1L, strtol(text.c_str(), nullptr, 10)));
+        } else if (arg == "--files-from") {
+            if (!value(text)) return false;
+            std::ifstream file_list;
+            std::istream* in = &std::cin;
+            if (text != "-") {
+                file_list.open(text);
+                if (!file_list) {
+                    fprintf(stderr, "cannot read %s\n", text.c_str());
+                    return false;
+                }
+                in = &file_list;
+            }
+            for (std::string line; std::getline(*in, line);) {
+                if (!line.empty()) options.inputs.push_back(line);
+            }
+        } else if (arg == "--no-sections") {
+            options.sections = false;
+        } else if (arg == "--no-symbols") {
+            options.symbols = false;
+        } else if (arg == "--no-functions") {
+            options.functions = false;
+        } else if (arg == "--summary") {
+            options.sections = options.symbols = options.functions = false;
+        } else if (arg == "--force-arm") {
+            options.force_arm = true;
+        } else if (arg == "-v") {
+            set_verbose_logging(true);
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (!arg.empty() && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+bool has_elf_magic(const std::filesystem::path& path) {
+    char magic[4] = {};
+    std::ifstream file(path, std::ios::binary);
+    return file.read(magic, sizeof(magic)) && memcmp(magic, "\x7F" "ELF", 4) == 0;
+}
+
+// Files named on the command line are taken as they are; directories
+// contribute the regular files in them that start with the ELF magic.
+std::vector<std::string> collect_files(const std::vector<std::string>& inputs) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (!fs::is_directory(input, error)) {
+            files.push_back(input);
+            continue;
+        }
+        for (auto it = fs::recursive_directory_iterator(input, fs::directory_options::skip_permission_denied, error);
+             it != fs::recursive_directory_iterator(); it.increment(error)) {
+            if (error) break;
+            if (it->is_regular_file(error) && has_elf_magic(it->path())) {
+                files.push_back(it->path().string());
+            }
+        }
+        if (error) fprintf(stderr, "error walking %s: %s\n", input.c_str(), error.message().c_str());
+    }
+    return files;
+}
+
+void append_number(std::string& out, const char* key, uint64_t value) {
+    out += '"';
+    out += key;
+    out += "\":";
+    out += std::to_string(value);
+}
+
+void append_ms(std::string& out, const char* key, double ms) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "\"%s\":%.3f", key, ms);
+    out += buffer;
+}
+
+std::string_view symbol_name(const ElfParser& parser, int32_t index) {
+    if (index < 0 || static_cast<size_t>(index) >= parser.get_symbols().size()) return {};
+    return parser.get_symbols()[index].name;
+}
+
+// Analyses one file into a single report line; returns false on failure
+// (the line then carries the error).
+bool analyse_file(TaskScheduler& scheduler, const Options& options, const std::string& path,
+                  std::string& report, StageTimes& times) {
+    Stopwatch total, stage;
+    report = "{";
+    report += "\"path\":";
+    append_json_string(report, path);
+
+    MappedFile file = map_file(path);
+    times.map = stage.lap();
+    if (file.data == nullptr) {
+        report += ",\"ok\":false,\"error\":\"cannot map file\"}";
+        return false;
+    }
+
+    bool ok = true;
+    try {
+        ElfParser parser(file);
+        if (!parser.parse()) throw std::runtime_error("ELF parsing failed");
+        times.parse = stage.lap();
+
+        const ElfHeader& header = parser.get_header();
+        const auto& sections = parser.get_section_headers();
+        const auto& symbols = parser.get_symbols();
+        bool sweep_code = header.e_machine == EM_ARM || options.force_arm;
+
+        // Code analysis: decode all executable sections (in parallel, for
+        // the odd huge file), collect call xrefs, build the function table
+        size_t instruction_count = 0, xref_count = 0;
+        std::unique_ptr<FunctionTable> functions;
+        if (sweep_code) {
+            ModeMap mode_map(parser, default_code_mode(parser));
+            times.mode_map = stage.lap();
+
+            std::vector<SweepChunk> chunks = plan_sweep_chunks(parser, mode_map, executable_section_indices(parser));
+            XrefIndex xrefs;
+            std::mutex merge_mutex;
+            std::atomic<size_t> decoded{0};
+            ObjectPool<std::vector<DisassembledInstruction>> buffers;
+            scheduler.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+                ArmDisassembler disassembler;
+                std::vector<Xref> local_xrefs;
+                std::vector<DisassembledInstruction>* buffer = buffers.acquire();
+                for (size_t i = begin; i < end; ++i) {
+                    sweep_chunk(parser, disassembler, chunks[i],
+                        [&](size_t, const std::vector<DisassembledInstruction>& instructions) {
+                            decoded += instructions.size();
+                            XrefIndex::collect(parser, instructions, local_xrefs);
+                        }, *buffer);
+                }
+                buffers.release(buffer);
+                std::lock_guard<std::mutex> lock(merge_mutex);
+                xrefs.add(local_xrefs);
+            });
+            xrefs.finalize();
+            instruction_count = decoded;
+            xref_count = xrefs.size();
+            times.sweep = stage.lap();
+
+            functions = std::make_unique<FunctionTable>(parser, mode_map, xrefs.targets_of_kind(XrefKind::Call));
+            times.functions = stage.lap();
+        }
+
+        report += ",\"ok\":true,";
+        append_number(report, "size", file.size);
+        report += ',';
+        append_number(report, "machine", header.e_machine);
+        report += ',';
+        append_number(report, "class", header.is_64bit ? 64 : 32);
+        report += ',';
+        append_number(report, "entry", header.e_entry);
+
+        report += ",\"counts\":{";
+        append_number(report, "sections", sections.size());
+        report += ',';
+        append_number(report, "symbols", symbols.size());
+        report += ',';
+        append_number(report, "instructions", instruction_count);
+        report += ',';
+        append_number(report, "xrefs", xref_count);
+        report += ',';
+        append_number(report, "functions", functions ? functions->size() : 0);
+        report += '}';
+
+        if (options.sections) {
+            report += ",\"sections\":[";
+            for (size_t i = 0; i < sections.size(); ++i) {
+                const SectionHeader& section = sections[i];
+                if (i > 0) report += ',';
+                report += "{\"name\":";
+                append_json_string(report, section.name);
+                report += ',';
+                append_number(report, "type", section.sh_type);
+                report += ',';
+                append_number(report, "flags", section.sh_flags);
+                report += ',';
+                append_number(report, "addr", section.sh_addr);
+                report += ',';
+                append_number(report, "offset", section.sh_offset);
+                report += ',';
+                append_number(report, "size", section.sh_size);
+                report += '}';
+            }
+            report += ']';
+        }
+
+        if (options.symbols) {
+            report += ",\"symbols\":[";
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                const SymbolEntry& symbol = symbols[i];
+                if (i > 0) report += ',';
+                report += "{\"name\":";
+                append_json_string(report, symbol.name);
+                report += ',';
+                append_number(report, "value", symbol.st_value);
+                report += ',';
+                append_number(report, "size", symbol.st_size);
+                report += ',';
+                append_number(report, "type", symbol.st_info & 0xF);
+                report += ',';
+                append_number(report, "bind", symbol.st_info >> 4);
+                report += ',';
+                append_number(report, "shndx", symbol.st_shndx);
+                report += '}';
+            }
+            report += ']';
+        }
+
+        if (options.functions && functions) {
+            report += ",\"functions\":[";
+            for (size_t i = 0; i < functions->size(); ++i) {
+                const FunctionInfo& function = functions->function(static_cast<uint32_t>(i));
+                if (i > 0) report += ',';
+                report += '{';
+                append_number(report, "start", function.start);
+                report += ',';
+                append_number(report, "end", function.end);
+                report += function.thumb ? ",\"thumb\":true" : ",\"thumb\":false";
+                std::string_view name = symbol_name(parser, function.symbol_index);
+                if (!name.empty()) {
+                    report += ",\"name\":";
+                    append_json_string(report, name);
+                }
+                report += '}';
+            }
+            report += ']';
+        }
+    } catch (const std::exception& e) {
+        report += ",\"ok\":false,\"error\":";
+        append_json_string(report, e.what());
+        ok = false;
+    }
+    unmap_file(file);
+
+    times.total = total.lap();
+    report += ",\"timing_ms\":{";
+    append_ms(report, "map", times.map);
+    report += ',';
+    append_ms(report, "parse", times.parse);
+    report += ',';
+    append_ms(report, "mode_map", times.mode_map);
+    report += ',';
+    append_ms(report, "sweep", times.sweep);
+    report += ',';
+    append_ms(report, "functions", times.functions);
+    report += ',';
+    append_ms(report, "total", times.total);
+    report += "}}";
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    FILE* output = stdout;
+    if (!options.output_path.empty()) {
+        output = fopen(options.output_path.c_str(), "w");
+        if (!output) {
+            fprintf(stderr, "cannot write %s\n", options.output_path.c_str());
+            return 2;
+        }
+    }
+
+    std::vector<std::string> files = collect_files(options.inputs);
+    size_t jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    TaskScheduler scheduler(jobs);
+
+    Stopwatch wall;
+    std::mutex output_mutex; // Guards output and the totals below
+    size_t failed = 0;
+    uint64_t bytes = 0;
+    StageTimes total_times;
+
+    // One file per piece; each report is written as soon as it is done, so
+    // memory stays bounded by the files in flight
+    scheduler.parallel_for(files.size(), 1, [&](size_t begin, size_t end) {
+        std::string report;
+        for (size_t i = begin; i < end; ++i) {
+            StageTimes times;
+            bool ok = analyse_file(scheduler, options, files[i], report, times);
+            std::error_code error;
+            uintmax_t size = std::filesystem::file_size(files[i], error);
+
+            std::lock_guard<std::mutex> lock(output_mutex);
+            fwrite(report.data(), 1, report.size(), output);
+            fputc('\n', output);
+            if (!ok) ++failed;
+            if (!error) bytes += size;
+            total_times += times;
+        }
+    });
+
+    if (output != stdout) fclose(output);
+    else fflush(stdout);
+
+    double seconds = wall.lap() / 1000.0;
+    fprintf(stderr,
+        "%zu files (%zu failed), %.1f MB in %.2f s on %zu threads: %.1f files/s, %.1f MB/s\n"
+        "stage totals (CPU ms across threads): map %.0f, parse %.0f, mode map %.0f, sweep %.0f, functions %.0f\n",
+        files.size(), failed, bytes / 1048576.0, seconds, jobs,
+        seconds > 0 ? files.size() / seconds : 0.0, seconds > 0 ? bytes / 1048576.0 / seconds : 0.0,
+        total_times.map, total_times.parse, total_times.mode_map, total_times.sweep, total_times.functions);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// ktimaz-diff: which functions changed between two builds of a binary.
+//
+// Both files are swept for their functions, every function is fingerprinted
+// and the two sets are matched (see diff_functions). One line per added,
+// removed or changed function goes to the output, as text or JSON Lines,
+// and the totals to stderr. Exit status is 0 when the diff was produced, 1
+// when a file cannot be read or written and 2 on bad usage.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/code_sweep.h"
+#include "../include/function_table.h"
+#include "../include/function_diff.h"
+#include "../include/task_scheduler.h"
+
+namespace {
+
+struct Options {
+    std::string old_path;
+    std::string new_path;
+    std::string output_path; // Empty for stdout
+    size_t jobs = 0;         // 0: one per core
+    bool json_lines = false;
+    bool all = false;        // Unchanged functions too
+};
+
+// One side of the diff, loaded and analysed.
+struct Binary {
+    MappedFile file{nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser;
+    std::unique_ptr<ModeMap> mode_map;
+    std::unique_ptr<FunctionTable> functions;
+
+    ~Binary() {
+        functions.reset();
+        mode_map.reset();
+        parser.reset();
+        unmap_file(file);
+    }
+};
+
+const char* const kChangeNames[] = {"unchanged", "changed", "added", "removed"};
+const char* const kMatchNames[] = {"none", "symbol", "hash", "shape", "neighbours"};
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-diff [options] <old file> <new file>\n"
+        "  --jsonl            write JSON Lines instead of text\n"
+        "  --all              list unchanged functions too\n"
+        "  -o FILE            write to FILE instead of stdout\n"
+        "  -j N               use N threads (default: one per core)\n"
+        "  -v                 verbose logging\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jsonl") {
+            options.json_lines = true;
+        } else if (arg == "--all") {
+            options.all = true;
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) return false;
+            options.output_path = argv[++i];
+        } else if (arg == "-j") {
+            if (i + 1 >= argc) return false;
+            options.jobs = static_cast<size_t>(std::max(1L, strtol(argv[++i], nullptr, 10)));
+        } else if (arg == "-v") {
+            set_verbose_logging(true);
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) return false;
+    options.old_path = positional[0];
+    options.new_path = positional[1];
+    return true;
+}
+
+void load(Binary& binary, const std::string& path, TaskScheduler& scheduler) {
+    binary.file = map_file(path);
+    if (binary.file.data == nullptr) throw std::runtime_error("cannot map " + path);
+    binary.parser = std::make_unique<ElfParser>(binary.file);
+    if (!binary.parser->parse()) throw std::runtime_error(path + ": ELF parsing failed");
+    binary.mode_map = std::make_unique<ModeMap>(*binary.parser, default_code_mode(*binary.parser));
+    binary.functions = build_function_table(*binary.parser, *binary.mode_map, scheduler, TaskPriority::Interactive);
+}
+
+void append_function(std::string& line, const Binary& binary, int64_t index, bool json) {
+    if (index < 0) {
+        line += json ? "null" : "-";
+        return;
+    }
+    const FunctionInfo& info = binary.functions->function(static_cast<uint32_t>(index));
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), json ? "{\"address\":%llu,\"size\":%llu}" : "0x%llX/%llu",
+             static_cast<unsigned long long>(info.start), static_cast<unsigned long long>(info.end - info.start));
+    line += buffer;
+}
+
+void format_entry(std::string& line, const FunctionDiffEntry& entry, const Binary& old_binary,
+                  const Binary& new_binary, bool json) {
+    std::string name = entry.new_index >= 0 ? new_binary.functions->name(static_cast<uint32_t>(entry.new_index))
+                                            : old_binary.functions->name(static_cast<uint32_t>(entry.old_index));
+    const char* change = kChangeNames[static_cast<int>(entry.change)];
+    const char* match = kMatchNames[static_cast<int>(entry.matched_by)];
+    line.clear();
+    if (json) {
+        line += "{\"change\":\"";
+        line += change;
+        line += "\",\"match\":\"";
+        line += match;
+        line += "\",\"name\":";
+        append_json_string(line, name);
+        line += ",\"old\":";
+        append_function(line, old_binary, entry.old_index, true);
+        line += ",\"new\":";
+        append_function(line, new_binary, entry.new_index, true);
+        line += "}\n";
+        return;
+    }
+    // change  name  old address/size -> new address/size  (evidence)
+    line += change;
+    line.append(10 - line.size(), ' ');
+    line += name;
+    line += "  ";
+    append_function(line, old_binary, entry.old_index, false);
+    line += " -> ";
+    append_function(line, new_binary, entry.new_index, false);
+    if (entry.matched_by != FunctionMatch::None) {
+        line += "  (";
+        line += match;
+        line += ')';
+    }
+    line += '\n';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    TaskScheduler scheduler(options.jobs ? options.jobs : TaskScheduler::default_worker_count());
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Binary old_binary, new_binary;
+        load(old_binary, options.old_path, scheduler);
+        load(new_binary, options.new_path, scheduler);
+        FunctionDiffResult result = diff_functions({*old_binary.parser, *old_binary.mode_map, *old_binary.functions},
+                                                   {*new_binary.parser, *new_binary.mode_map, *new_binary.functions},
+                                                   scheduler, TaskPriority::Interactive);
+
+        bool to_stdout = options.output_path.empty() || options.output_path == "-";
+        FILE* out = to_stdout ? stdout : fopen(options.output_path.c_str(), "w");
+        if (!out) throw std::runtime_error("cannot write " + options.output_path);
+        std::string line;
+        bool ok = true;
+        for (const FunctionDiffEntry& entry : result.entries) {
+            if (entry.change == FunctionChange::Unchanged && !options.all) continue;
+            format_entry(line, entry, old_binary, new_binary, options.json_lines);
+            ok = fwrite(line.data(), 1, line.size(), out) == line.size() && ok;
+        }
+        ok = (to_stdout ? fflush(out) : fclose(out)) == 0 && ok;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "%zu unchanged, %zu changed, %zu added, %zu removed in %.2f s%s\n", result.unchanged,
+                result.changed, result.added, result.removed, seconds, ok ? "" : " (write failed)");
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,137 @@
+// ktimaz-listing: writes the full disassembly listing of one ELF file.
+//
+// The listing is streamed (see export_listing), so this runs in a few
+// megabytes whatever the size of the file. Exit status is 0 on success, 1
+// when the file cannot be read or written and 2 on bad usage.
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/code_sweep.h"
+#include "../include/operand_resolver.h"
+#include "../include/task_scheduler.h"
+#include "../include/listing_export.h"
+#include "../include/demangler.h"
+
+namespace {
+
+struct Options {
+    std::string input_path;
+    std::string output_path;  // Empty or "-" for stdout
+    std::vector<std::string> sections;
+    ListingExportOptions listing;
+    size_t jobs = 0;          // 0: one per core
+    bool comments = true;
+    bool demangle = false;
+};
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-listing [options] <file> [output]\n"
+        "  --jsonl            write JSON Lines instead of text\n"
+        "  --section NAME     list only section NAME (repeatable; default: all code sections)\n"
+        "  --no-comments      leave out resolved-operand comments\n"
+        "  -C, --demangle     show C++ labels demangled\n"
+        "  -j N               format on N threads (default: one per core)\n"
+        "  -v                 verbose logging\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jsonl") {
+            options.listing.format = ListingFormat::JsonLines;
+        } else if (arg == "--section") {
+            if (i + 1 >= argc) return false;
+            options.sections.push_back(argv[++i]);
+        } else if (arg == "--no-comments") {
+            options.comments = false;
+        } else if (arg == "-C" || arg == "--demangle") {
+            options.demangle = true;
+        } else if (arg == "-j") {
+            if (i + 1 >= argc) return false;
+            options.jobs = static_cast<size_t>(std::max(1L, strtol(argv[++i], nullptr, 10)));
+        } else if (arg == "-v") {
+            set_verbose_logging(true);
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty() || positional.size() > 2) return false;
+    options.input_path = positional[0];
+    if (positional.size() == 2) options.output_path = positional[1];
+    return true;
+}
+
+bool find_sections(const ElfParser& parser, const std::vector<std::string>& names, std::vector<size_t>& indices) {
+    const auto& headers = parser.get_section_headers();
+    for (const std::string& name : names) {
+        size_t index = 0;
+        while (index < headers.size() && headers[index].name != name) ++index;
+        if (index == headers.size()) {
+            fprintf(stderr, "no section %s\n", name.c_str());
+            return false;
+        }
+        indices.push_back(index);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    MappedFile file = map_file(options.input_path);
+    if (file.data == nullptr) {
+        fprintf(stderr, "cannot map %s\n", options.input_path.c_str());
+        return 1;
+    }
+
+    int status = 1;
+    try {
+        ElfParser parser(file);
+        if (!parser.parse()) throw std::runtime_error("ELF parsing failed");
+        if (!find_sections(parser, options.sections, options.listing.sections)) throw std::runtime_error("bad section");
+
+        bool to_stdout = options.output_path.empty() || options.output_path == "-";
+        int fd = to_stdout ? STDOUT_FILENO : open(options.output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw std::runtime_error("cannot write " + options.output_path);
+
+        ModeMap mode_map(parser, default_code_mode(parser));
+        OperandResolver resolver(parser);
+        if (options.comments) options.listing.resolver = &resolver;
+        DemangleCache demangler(file.data, file.size);
+        if (options.demangle) options.listing.demangler = &demangler;
+        TaskScheduler scheduler(options.jobs ? options.jobs : TaskScheduler::default_worker_count());
+
+        ListingExportStats stats;
+        bool ok = export_listing(fd, parser, mode_map, scheduler, options.listing, &stats);
+        if (!to_stdout && close(fd) != 0) ok = false;
+        fprintf(stderr, "%llu lines, %llu bytes%s\n", static_cast<unsigned long long>(stats.instructions),
+                static_cast<unsigned long long>(stats.bytes_written), ok ? "" : " (write failed)");
+        status = ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s: %s\n", options.input_path.c_str(), e.what());
+    }
+    unmap_file(file);
+    return status;
+}
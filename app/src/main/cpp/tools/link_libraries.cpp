@@ -0,0 +1,260 @@
+// ktimaz-link: which library provides each import, across a set of shared
+// objects such as the lib/<abi>/ directory of an app.
+//
+// Every file given (directories are walked for ELF files) is parsed for its
+// dynamic section and versioned dynamic symbols, and the imports of each
+// are resolved against the others (see LinkGraph). One report per library
+// goes to the output, as text or JSON Lines, and the totals to stderr.
+// Exit status is 0 when every file was read, 1 when some could not be and
+// 2 on bad usage.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/dynamic_info.h"
+#include "../include/link_graph.h"
+#include "../include/task_scheduler.h"
+
+namespace {
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string output_path; // Empty for stdout
+    size_t jobs = 0;         // 0: one per core
+    bool json_lines = false;
+    bool list_imports = false; // Text: one line per import
+};
+
+struct Library {
+    MappedFile file{nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser;
+
+    ~Library() {
+        parser.reset();
+        unmap_file(file);
+    }
+};
+
+const char* const kBindingNames[] = {"unresolved", "needed", "elsewhere"};
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-link [options] <file|directory>...\n"
+        "  --jsonl            write JSON Lines instead of text\n"
+        "  --imports          text: list every import and its provider\n"
+        "  -o FILE            write to FILE instead of stdout\n"
+        "  -j N               use N threads (default: one per core)\n"
+        "  -v                 verbose logging\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jsonl") {
+            options.json_lines = true;
+        } else if (arg == "--imports") {
+            options.list_imports = true;
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) return false;
+            options.output_path = argv[++i];
+        } else if (arg == "-j") {
+            if (i + 1 >= argc) return false;
+            options.jobs = static_cast<size_t>(std::max(1L, strtol(argv[++i], nullptr, 10)));
+        } else if (arg == "-v") {
+            set_verbose_logging(true);
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+bool has_elf_magic(const std::filesystem::path& path) {
+    char magic[4] = {};
+    std::ifstream file(path, std::ios::binary);
+    return file.read(magic, sizeof(magic)) && memcmp(magic, "\x7F" "ELF", 4) == 0;
+}
+
+// Files named on the command line are taken as they are; directories
+// contribute the regular files in them that start with the ELF magic.
+std::vector<std::string> collect_files(const std::vector<std::string>& inputs) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (!fs::is_directory(input, error)) {
+            files.push_back(input);
+            continue;
+        }
+        for (auto it = fs::recursive_directory_iterator(input, fs::directory_options::skip_permission_denied, error);
+             it != fs::recursive_directory_iterator(); it.increment(error)) {
+            if (error) break;
+            if (it->is_regular_file(error) && has_elf_magic(it->path())) {
+                files.push_back(it->path().string());
+            }
+        }
+        if (error) fprintf(stderr, "error walking %s: %s\n", input.c_str(), error.message().c_str());
+    }
+    return files;
+}
+
+// name, name@VERSION
+void append_versioned(std::string& out, const DynamicSymbol& symbol) {
+    out += symbol.name;
+    if (symbol.version.empty()) return;
+    out += '@';
+    out += symbol.version;
+}
+
+void format_text(std::string& out, const LinkGraph& graph, uint32_t index, bool list_imports) {
+    const LinkedLibrary& library = graph.library(index);
+    const DynamicInfo& dynamic = *library.dynamic;
+    out += library.name;
+    out += "  ";
+    out += library.path;
+    out += '\n';
+    for (size_t i = 0; i < dynamic.needed().size(); ++i) {
+        out += "  needs ";
+        out += dynamic.needed()[i];
+        if (library.needed[i] >= 0) {
+            out += " -> ";
+            out += graph.library(library.needed[i]).path;
+        } else {
+            out += "  (not opened)";
+        }
+        out += '\n';
+    }
+    size_t counts[3] = {};
+    for (const ImportResolution& resolution : library.imports) ++counts[static_cast<int>(resolution.binding)];
+    out += "  " + std::to_string(dynamic.exports().size()) + " exports, " +
+           std::to_string(library.imports.size()) + " imports: " + std::to_string(counts[1]) + " via needed, " +
+           std::to_string(counts[2]) + " elsewhere, " + std::to_string(counts[0]) + " unresolved\n";
+    if (!list_imports) return;
+    for (size_t i = 0; i < library.imports.size(); ++i) {
+        const ImportResolution& resolution = library.imports[i];
+        out += "    ";
+        append_versioned(out, dynamic.imports()[i]);
+        if (resolution.library < 0) {
+            out += dynamic.imports()[i].weak ? "  (unresolved, weak)\n" : "  (unresolved)\n";
+            continue;
+        }
+        out += " -> ";
+        out += graph.library(resolution.library).name;
+        if (resolution.binding == ImportBinding::Elsewhere) out += "  (elsewhere)";
+        out += '\n';
+    }
+}
+
+void format_json(std::string& out, const LinkGraph& graph, uint32_t index) {
+    const LinkedLibrary& library = graph.library(index);
+    const DynamicInfo& dynamic = *library.dynamic;
+    out += "{\"path\":";
+    append_json_string(out, library.path);
+    out += ",\"soname\":";
+    if (dynamic.soname().empty()) out += "null";
+    else append_json_string(out, dynamic.soname());
+    out += ",\"needed\":[";
+    for (size_t i = 0; i < dynamic.needed().size(); ++i) {
+        if (i) out += ',';
+        out += "{\"name\":";
+        append_json_string(out, dynamic.needed()[i]);
+        out += ",\"path\":";
+        if (library.needed[i] >= 0) append_json_string(out, graph.library(library.needed[i]).path);
+        else out += "null";
+        out += '}';
+    }
+    out += "],\"exports\":" + std::to_string(dynamic.exports().size()) + ",\"imports\":[";
+    for (size_t i = 0; i < library.imports.size(); ++i) {
+        const DynamicSymbol& import = dynamic.imports()[i];
+        const ImportResolution& resolution = library.imports[i];
+        if (i) out += ',';
+        out += "{\"name\":";
+        append_json_string(out, import.name);
+        out += ",\"version\":";
+        if (import.version.empty()) out += "null";
+        else append_json_string(out, import.version);
+        out += import.weak ? ",\"weak\":true" : ",\"weak\":false";
+        out += ",\"provider\":";
+        if (resolution.library >= 0) append_json_string(out, graph.library(resolution.library).name);
+        else out += "null";
+        out += ",\"binding\":\"";
+        out += kBindingNames[static_cast<int>(resolution.binding)];
+        out += "\"}";
+    }
+    out += "]}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    TaskScheduler scheduler(options.jobs ? options.jobs : TaskScheduler::default_worker_count());
+    std::vector<std::string> files = collect_files(options.inputs);
+    std::vector<std::unique_ptr<Library>> libraries;
+    LinkGraph graph;
+    bool all_read = true;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : files) {
+        auto library = std::make_unique<Library>();
+        library->file = map_file(path);
+        try {
+            if (library->file.data == nullptr) throw std::runtime_error("cannot map");
+            library->parser = std::make_unique<ElfParser>(library->file);
+            if (!library->parser->parse()) throw std::runtime_error("ELF parsing failed");
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s: %s\n", path.c_str(), e.what());
+            all_read = false;
+            continue;
+        }
+        graph.add_library(path, *library->parser);
+        libraries.push_back(std::move(library));
+    }
+    auto parsed = std::chrono::steady_clock::now();
+    LinkStats stats = graph.link(scheduler, TaskPriority::Interactive);
+    auto linked = std::chrono::steady_clock::now();
+
+    bool to_stdout = options.output_path.empty() || options.output_path == "-";
+    FILE* out = to_stdout ? stdout : fopen(options.output_path.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", options.output_path.c_str());
+        return 1;
+    }
+    std::string text;
+    bool written = true;
+    for (uint32_t i = 0; i < graph.size(); ++i) {
+        text.clear();
+        if (options.json_lines) format_json(text, graph, i);
+        else format_text(text, graph, i, options.list_imports);
+        written = fwrite(text.data(), 1, text.size(), out) == text.size() && written;
+    }
+    written = (to_stdout ? fflush(out) : fclose(out)) == 0 && written;
+
+    auto ms = [](auto from, auto to) { return std::chrono::duration<double, std::milli>(to - from).count(); };
+    fprintf(stderr,
+            "%zu libraries, %zu imports: %zu via needed, %zu elsewhere, %zu unresolved; "
+            "%zu needed libraries not opened; parsed in %.1f ms, linked in %.1f ms%s\n",
+            graph.size(), stats.imports, stats.needed, stats.elsewhere, stats.unresolved, stats.missing_libraries,
+            ms(start, parsed), ms(parsed, linked), written ? "" : " (write failed)");
+    return all_read && written ? 0 : 1;
+}
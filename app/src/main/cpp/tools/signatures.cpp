@@ -0,0 +1,201 @@
+// ktimaz-sig: builds library signature databases and names the functions of
+// stripped binaries with them.
+//
+//   ktimaz-sig make -o DB reference...   compile the named functions of
+//                                        the references into DB
+//   ktimaz-sig match DB binary           list the functions DB identifies
+//
+// References are ELF files with symbols: shared libraries, executables or
+// objects (extract static archives with `ar x` first). Exit status is 0 on
+// success, 1 when a file cannot be read or written and 2 on bad usage.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/utils.h"
+#include "../include/elf_parser.h"
+#include "../include/code_sweep.h"
+#include "../include/function_table.h"
+#include "../include/function_diff.h"
+#include "../include/signature_database.h"
+#include "../include/task_scheduler.h"
+
+namespace {
+
+struct Options {
+    std::string command;
+    std::string database_path;
+    std::string output_path;        // Empty for stdout
+    std::vector<std::string> inputs;
+    size_t jobs = 0;                // 0: one per core
+    bool json_lines = false;
+    bool all = false;               // Match functions that have symbols too
+};
+
+// A binary, loaded and with its function table built.
+struct Binary {
+    MappedFile file{nullptr, 0, -1};
+    std::unique_ptr<ElfParser> parser;
+    std::unique_ptr<ModeMap> mode_map;
+    std::unique_ptr<FunctionTable> functions;
+
+    ~Binary() {
+        functions.reset();
+        mode_map.reset();
+        parser.reset();
+        unmap_file(file);
+    }
+};
+
+void print_usage() {
+    fprintf(stderr,
+        "usage: ktimaz-sig make [options] -o DB <reference>...\n"
+        "       ktimaz-sig match [options] DB <binary>\n"
+        "  --jsonl            match: write JSON Lines instead of text\n"
+        "  --all              match: functions with symbols too\n"
+        "  -o FILE            make: the database; match: output (default stdout)\n"
+        "  -j N               use N threads (default: one per core)\n"
+        "  -v                 verbose logging\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    if (argc < 2) return false;
+    options.command = argv[1];
+    if (options.command != "make" && options.command != "match") return false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jsonl") {
+            options.json_lines = true;
+        } else if (arg == "--all") {
+            options.all = true;
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) return false;
+            options.output_path = argv[++i];
+        } else if (arg == "-j") {
+            if (i + 1 >= argc) return false;
+            options.jobs = static_cast<size_t>(std::max(1L, strtol(argv[++i], nullptr, 10)));
+        } else if (arg == "-v") {
+            set_verbose_logging(true);
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    if (options.command == "make") {
+        options.database_path = options.output_path;
+        return !options.database_path.empty() && !options.inputs.empty();
+    }
+    if (options.inputs.size() != 2) return false;
+    options.database_path = options.inputs[0];
+    options.inputs.erase(options.inputs.begin());
+    return true;
+}
+
+void load(Binary& binary, const std::string& path, TaskScheduler& scheduler) {
+    binary.file = map_file(path);
+    if (binary.file.data == nullptr) throw std::runtime_error("cannot map " + path);
+    binary.parser = std::make_unique<ElfParser>(binary.file);
+    if (!binary.parser->parse()) throw std::runtime_error(path + ": ELF parsing failed");
+    binary.mode_map = std::make_unique<ModeMap>(*binary.parser, default_code_mode(*binary.parser));
+    binary.functions = build_function_table(*binary.parser, *binary.mode_map, scheduler, TaskPriority::Interactive);
+}
+
+int make_database(const Options& options, TaskScheduler& scheduler) {
+    SignatureDatabase database;
+    for (const std::string& path : options.inputs) {
+        Binary reference;
+        load(reference, path, scheduler);
+        size_t added = database.add_library(*reference.parser, *reference.mode_map, *reference.functions,
+                                            scheduler, TaskPriority::Interactive);
+        fprintf(stderr, "%s: %zu signatures\n", path.c_str(), added);
+    }
+    database.compile();
+    if (!database.save(options.database_path)) return 1;
+    fprintf(stderr, "%zu signatures, %zu trie nodes\n", database.size(), database.trie_nodes());
+    return 0;
+}
+
+int match_binary(const Options& options, TaskScheduler& scheduler) {
+    SignatureDatabase database;
+    if (!database.load(options.database_path)) throw std::runtime_error("cannot load " + options.database_path);
+    Binary binary;
+    load(binary, options.inputs[0], scheduler);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SignatureMatch> matches = database.match(*binary.parser, *binary.functions, scheduler,
+                                                         TaskPriority::Interactive, !options.all);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool to_stdout = options.output_path.empty() || options.output_path == "-";
+    FILE* out = to_stdout ? stdout : fopen(options.output_path.c_str(), "w");
+    if (!out) throw std::runtime_error("cannot write " + options.output_path);
+    std::string line;
+    char buffer[32];
+    bool ok = true;
+    size_t agreeing = 0, named = 0;
+    for (const SignatureMatch& match : matches) {
+        std::string_view name = database.name(match.signature);
+        const FunctionInfo& info = binary.functions->function(match.function);
+        std::string_view symbol = info.symbol_index >= 0
+            ? binary.parser->get_symbols()[info.symbol_index].name : std::string_view();
+        if (!symbol.empty()) {
+            ++named;
+            agreeing += symbol == name;
+        }
+        line.clear();
+        if (options.json_lines) {
+            snprintf(buffer, sizeof(buffer), "{\"address\":%llu,\"name\":", static_cast<unsigned long long>(match.address));
+            line += buffer;
+            append_json_string(line, name);
+            line += ",\"symbol\":";
+            if (symbol.empty()) line += "null";
+            else append_json_string(line, symbol);
+            line += "}\n";
+        } else {
+            // address  name  (symbol: existing name)
+            snprintf(buffer, sizeof(buffer), "0x%llX  ", static_cast<unsigned long long>(match.address));
+            line += buffer;
+            line += name;
+            if (!symbol.empty() && symbol != name) {
+                line += "  (symbol: ";
+                line += symbol;
+                line += ')';
+            }
+            line += '\n';
+        }
+        ok = fwrite(line.data(), 1, line.size(), out) == line.size() && ok;
+    }
+    ok = (to_stdout ? fflush(out) : fclose(out)) == 0 && ok;
+
+    fprintf(stderr, "%zu of %zu functions matched in %.2f s", matches.size(), binary.functions->size(), seconds);
+    if (named > 0) fprintf(stderr, ", %zu of %zu with symbols agree", agreeing, named);
+    fprintf(stderr, "%s\n", ok ? "" : " (write failed)");
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    TaskScheduler scheduler(options.jobs ? options.jobs : TaskScheduler::default_worker_count());
+    try {
+        return options.command == "make" ? make_database(options, scheduler) : match_binary(options, scheduler);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -1,11 +1,13 @@
 package com.imtiaz.ktimazrev
 
+import android.app.ActivityManager
 import android.content.Intent
 import android.net.Uri
 import android.os.Bundle
 import android.provider.Settings
 import android.widget.Toast
 import androidx.activity.ComponentActivity
+import androidx.activity.viewModels
 import androidx.activity.compose.setContent
 import androidx.activity.result.contract.ActivityResultContracts
 import androidx.compose.foundation.layout.*
@@ -22,6 +24,7 @@ import androidx.compose.ui.tooling.preview.Preview
 import androidx.compose.ui.unit.dp
 import androidx.lifecycle.compose.collectAsStateWithLifecycle
 import androidx.lifecycle.viewmodel.compose.viewModel
+import com.imtiaz.ktimazrev.model.AnalysisStage
 import com.imtiaz.ktimazrev.ui.*
 import com.imtiaz.ktimazrev.ui.theme.MobileARMDisassemblerTheme
 import com.imtiaz.ktimazrev.utils.FilePicker
@@ -32,6 +35,9 @@ class MainActivity : ComponentActivity() {
 
     private lateinit var filePicker: FilePicker
 
+    // Same instance AppScreen gets from viewModel(); native caches follow the system's trim requests
+    private val fileLoaderViewModel: FileLoaderViewModel by viewModels()
+
     private val requestPermissionLauncher = registerForActivityResult(
         ActivityResultContracts.RequestPermission(),
     ) { isGranted: Boolean ->
@@ -50,6 +56,7 @@ class MainActivity : ComponentActivity() {
         super.onCreate(savedInstanceState)
         filePicker = FilePicker(this)
         requestStoragePermission()
+        configureNativeMemoryBudget()
 
         setContent {
             MobileARMDisassemblerTheme {
@@ -63,6 +70,17 @@ class MainActivity : ComponentActivity() {
         }
     }
 
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        fileLoaderViewModel.onTrimMemory(level)
+    }
+
+    private fun configureNativeMemoryBudget() {
+        val memoryInfo = ActivityManager.MemoryInfo()
+        getSystemService(ActivityManager::class.java).getMemoryInfo(memoryInfo)
+        fileLoaderViewModel.configureNativeMemoryBudget(memoryInfo.totalMem)
+    }
+
     private fun requestStoragePermission() {
         if (android.os.Build.VERSION.SDK_INT < android.os.Build.VERSION_CODES.R) {
             requestPermissionLauncher.launch(android.Manifest.permission.READ_EXTERNAL_STORAGE)
@@ -79,15 +97,24 @@ fun AppScreen(
 ) {
     val loadingState by fileLoaderViewModel.loadingState.collectAsStateWithLifecycle()
     val elfSectionNames by fileLoaderViewModel.elfSectionNames.collectAsStateWithLifecycle()
-    val elfSymbols by fileLoaderViewModel.elfSymbols.collectAsStateWithLifecycle()
+    val queriedSymbols by fileLoaderViewModel.queriedSymbols.collectAsStateWithLifecycle()
+    val queriedSymbolTotal by fileLoaderViewModel.queriedSymbolTotal.collectAsStateWithLifecycle()
+    val symbolQuery by fileLoaderViewModel.symbolQuery.collectAsStateWithLifecycle()
+    val queriedStrings by fileLoaderViewModel.queriedStrings.collectAsStateWithLifecycle()
+    val queriedStringTotal by fileLoaderViewModel.queriedStringTotal.collectAsStateWithLifecycle()
+    val stringQuery by fileLoaderViewModel.stringQuery.collectAsStateWithLifecycle()
     val currentFilePath by fileLoaderViewModel.currentFilePath.collectAsStateWithLifecycle()
+    val analysisStages by fileLoaderViewModel.analysisStages.collectAsStateWithLifecycle()
 
     val instructions by disassemblyViewModel.filteredInstructions.collectAsStateWithLifecycle()
     val hexDumpData by disassemblyViewModel.hexDumpData.collectAsStateWithLifecycle()
     val bookmarks by disassemblyViewModel.bookmarks.collectAsStateWithLifecycle()
+    val listingLabels by disassemblyViewModel.listingLabels.collectAsStateWithLifecycle()
     val currentTab by disassemblyViewModel.currentTab.collectAsStateWithLifecycle()
     val searchQuery by disassemblyViewModel.searchQuery.collectAsStateWithLifecycle()
     val currentSection by disassemblyViewModel.currentSection.collectAsStateWithLifecycle()
+    val sectionInstructions by disassemblyViewModel.instructions.collectAsStateWithLifecycle()
+    val cfgSummary by disassemblyViewModel.cfgSummary.collectAsStateWithLifecycle()
 
     val snackbarHostState = remember { SnackbarHostState() }
     val scope = rememberCoroutineScope()
@@ -132,6 +159,7 @@ fun AppScreen(
                                 MainTab.Disassembly -> Icon(Icons.Default.Code, contentDescription = null)
                                 MainTab.HexView -> Icon(Icons.Default.ViewModule, contentDescription = null)
                                 MainTab.Symbols -> Icon(Icons.Default.List, contentDescription = null)
+                                MainTab.Strings -> Icon(Icons.Default.TextFields, contentDescription = null)
                                 MainTab.Bookmarks -> Icon(Icons.Default.Bookmark, contentDescription = null)
                                 MainTab.GraphView -> Icon(Icons.Default.AccountTree, contentDescription = null)
                             }
@@ -142,6 +170,7 @@ fun AppScreen(
                                     MainTab.Disassembly -> stringResource(R.string.disassembly_view_tab)
                                     MainTab.HexView -> stringResource(R.string.hex_view_tab)
                                     MainTab.Symbols -> stringResource(R.string.symbols_tab)
+                                    MainTab.Strings -> stringResource(R.string.strings_tab)
                                     MainTab.Bookmarks -> stringResource(R.string.bookmarks_tab)
                                     MainTab.GraphView -> stringResource(R.string.graph_view_tab)
                                 },
@@ -192,28 +221,77 @@ fun AppScreen(
                             )
                         }
 
+                        // Background analysis keeps adding results while the file is browsable
+                        if (analysisStages != AnalysisStage.ALL_MASK) {
+                            val done = Integer.bitCount(analysisStages)
+                            val total = AnalysisStage.entries.size
+                            LinearProgressIndicator(
+                                progress = { done.toFloat() / total },
+                                modifier = Modifier.fillMaxWidth().padding(horizontal = 16.dp),
+                            )
+                            Text(
+                                text = stringResource(R.string.analysis_progress, done, total),
+                                style = MaterialTheme.typography.bodySmall,
+                                modifier = Modifier.padding(horizontal = 16.dp, vertical = 4.dp),
+                            )
+                        }
+
                         if (elfSectionNames.isNotEmpty()) {
                             SectionSelector(
                                 sectionNames = elfSectionNames,
                                 selectedSection = currentSection,
                                 onSectionSelected = { section ->
-                                    disassemblyViewModel.loadDisassemblyForSection(section, 0L, false)
+                                    disassemblyViewModel.loadDisassemblyForSection(section)
                                 },
                             )
                         }
 
-                        if (currentTab == MainTab.Disassembly || currentTab == MainTab.Symbols) {
+                        if (currentTab == MainTab.Disassembly) {
                             SearchBar(
                                 query = searchQuery,
                                 onQueryChange = { disassemblyViewModel.updateSearchQuery(it) },
                             )
+                        } else if (currentTab == MainTab.Symbols) {
+                            SearchBar(
+                                query = symbolQuery.text,
+                                onQueryChange = { fileLoaderViewModel.updateSymbolQuery(symbolQuery.copy(text = it)) },
+                            )
+                        } else if (currentTab == MainTab.Strings) {
+                            SearchBar(
+                                query = stringQuery.text,
+                                onQueryChange = { fileLoaderViewModel.updateStringQuery(stringQuery.copy(text = it)) },
+                            )
+                        }
+
+                        // Strings are extracted in the background, so refresh whenever the tab is opened
+                        LaunchedEffect(currentTab) {
+                            if (currentTab == MainTab.Strings) fileLoaderViewModel.updateStringQuery()
+                        }
+
+                        val modeMapReady = analysisStages and AnalysisStage.ModeMap.bit != 0
+                        LaunchedEffect(modeMapReady) {
+                            if (modeMapReady) disassemblyViewModel.onModeMapReady()
+                        }
+
+                        // Rows are labelled from the symbol index, which may still be building
+                        val symbolIndexReady = analysisStages and AnalysisStage.SymbolIndex.bit != 0
+                        LaunchedEffect(symbolIndexReady) {
+                            if (symbolIndexReady) disassemblyViewModel.refreshListingLabels()
+                        }
+
+                        // The graph shows the function containing the first instruction of the section
+                        LaunchedEffect(currentTab, sectionInstructions) {
+                            val first = sectionInstructions.firstOrNull()
+                            if (currentTab == MainTab.GraphView && first != null) {
+                                disassemblyViewModel.openGraph(first.address)
+                            }
                         }
 
                         when (currentTab) {
                             MainTab.Disassembly -> {
                                 DisassemblyView(
                                     instructions = instructions,
-                                    symbols = elfSymbols,
+                                    labels = listingLabels,
                                     bookmarks = bookmarks,
                                     onAddBookmark = { address, name, comment ->
                                         disassemblyViewModel.addBookmark(address, name, comment)
@@ -221,6 +299,8 @@ fun AppScreen(
                                             snackbarHostState.showSnackbar("Bookmark added")
                                         }
                                     },
+                                    getXrefs = { disassemblyViewModel.getXrefsTo(it) },
+                                    symbolContaining = { disassemblyViewModel.getSymbolContainingNative(it) },
                                 )
                             }
                             MainTab.HexView -> {
@@ -230,7 +310,19 @@ fun AppScreen(
                                 )
                             }
                             MainTab.Symbols -> {
-                                SymbolsView(symbols = elfSymbols)
+                                SymbolsView(
+                                    symbols = queriedSymbols,
+                                    totalCount = queriedSymbolTotal,
+                                    onLoadMore = { fileLoaderViewModel.loadMoreSymbols() },
+                                )
+                            }
+                            MainTab.Strings -> {
+                                StringsView(
+                                    strings = queriedStrings,
+                                    totalCount = queriedStringTotal,
+                                    onLoadMore = { fileLoaderViewModel.loadMoreStrings() },
+                                    getReferences = { fileLoaderViewModel.getStringReferences(it) },
+                                )
                             }
                             MainTab.Bookmarks -> {
                                 BookmarksView(
@@ -241,8 +333,10 @@ fun AppScreen(
                             }
                             MainTab.GraphView -> {
                                 GraphCanvas(
-                                    instructions = instructions,
-                                    symbols = elfSymbols,
+                                    summary = cfgSummary,
+                                    loadViewport = { x0, y0, x1, y1 ->
+                                        disassemblyViewModel.getCfgViewport(x0, y0, x1, y1)
+                                    },
                                 )
                             }
                         }
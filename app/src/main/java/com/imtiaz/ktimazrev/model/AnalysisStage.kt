@@ -0,0 +1,23 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native AnalysisStage values (in ordinal order); a finished
+// stage sets bit (1 shl ordinal) of the completed-stage mask.
+enum class AnalysisStage {
+    SymbolIndex,
+    ModeMap,
+    Strings,
+    Sweep,
+    Functions,
+    CallGraph,
+    EntryCfg,
+    ContentMap,
+    ;
+
+    val bit: Int get() = 1 shl ordinal
+
+    companion object {
+        val ALL_MASK: Int = (1 shl entries.size) - 1
+
+        fun fromNative(value: Int): AnalysisStage? = entries.getOrNull(value)
+    }
+}
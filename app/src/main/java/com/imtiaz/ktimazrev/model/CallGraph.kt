@@ -0,0 +1,39 @@
+package com.imtiaz.ktimazrev.model
+
+// Bits of CallGraphPage.flags.
+object CallGraphNodeFlags {
+    const val IMPORT = 0x1
+    const val RECURSIVE = 0x2
+}
+
+// Mirrors the native CallGraphQuery values.
+enum class CallGraphQuery(val nativeValue: Int) {
+    Callers(0),
+    Callees(1),
+    ReachableFrom(2),
+    Reaching(3),
+}
+
+data class CallGraphNode(
+    val id: Int,
+    val address: Long,
+    val name: String,
+    val flags: Int,
+) {
+    val isImport: Boolean get() = flags and CallGraphNodeFlags.IMPORT != 0
+    val isRecursive: Boolean get() = flags and CallGraphNodeFlags.RECURSIVE != 0
+}
+
+// One page of call graph nodes as parallel arrays; node ids are indices into
+// the function table. For a call path, the nodes in call order.
+class CallGraphPage(
+    val totalCount: Int,
+    val nodes: IntArray,
+    val addresses: LongArray,
+    val names: Array<String>,
+    val flags: IntArray,
+) {
+    val size: Int get() = nodes.size
+
+    fun node(index: Int) = CallGraphNode(nodes[index], addresses[index], names[index], flags[index])
+}
@@ -0,0 +1,38 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native ContentClass values (in ordinal order).
+enum class ContentClass {
+    Code,
+    Data,
+    // Near-random bytes: compressed, encrypted or packed
+    Compressed,
+    ZeroFill,
+}
+
+// Consecutive stretch of the file with one content class.
+data class ContentRegion(
+    val fileOffset: Long,
+    val size: Long,
+    val content: ContentClass,
+    // Mean Shannon entropy, 0 to 8 bits per byte
+    val entropy: Float,
+    // Mean code-likeness, 0 to 1
+    val codeScore: Float,
+) {
+    companion object {
+        private const val FIELDS_PER_REGION = 5
+
+        // Layout written by getContentRegionsNative.
+        fun fromNative(values: LongArray): List<ContentRegion> =
+            List(values.size / FIELDS_PER_REGION) { i ->
+                val at = i * FIELDS_PER_REGION
+                ContentRegion(
+                    fileOffset = values[at],
+                    size = values[at + 1],
+                    content = ContentClass.entries.getOrElse(values[at + 2].toInt()) { ContentClass.Data },
+                    entropy = values[at + 3] / 256f,
+                    codeScore = values[at + 4] / 255f,
+                )
+            }
+    }
+}
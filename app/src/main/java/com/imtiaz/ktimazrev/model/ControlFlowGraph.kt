@@ -0,0 +1,47 @@
+package com.imtiaz.ktimazrev.model
+
+// Layout coordinates are in text units: x and width in characters,
+// y and height in lines.
+data class CfgSummary(
+    val entry: Long,
+    val blockCount: Int,
+    val edgeCount: Int,
+    val loopCount: Int,
+    val width: Int,
+    val height: Int,
+    val truncated: Boolean,
+)
+
+object CfgBlockFlags {
+    const val ENTRY = 0x1
+    const val LOOP_HEADER = 0x2
+    const val EXIT = 0x4
+    const val HAS_CALL = 0x8
+}
+
+enum class CfgEdgeKind {
+    Unconditional,
+    Taken,
+    NotTaken,
+    Fallthrough,
+}
+
+// Blocks and edges intersecting one viewport query, as parallel arrays.
+// edgeCoords holds x1, y1, x2, y2 for each edge.
+class CfgViewport(
+    val blockIds: IntArray,
+    val blockAddresses: LongArray,
+    val blockX: IntArray,
+    val blockY: IntArray,
+    val blockWidth: IntArray,
+    val blockHeight: IntArray,
+    val blockFlags: IntArray,
+    val blockText: Array<String>,
+    val edgeCoords: IntArray,
+    val edgeKinds: IntArray,
+) {
+    val blockCount: Int get() = blockIds.size
+    val edgeCount: Int get() = edgeKinds.size
+
+    fun edgeKind(index: Int): CfgEdgeKind = CfgEdgeKind.entries[edgeKinds[index]]
+}
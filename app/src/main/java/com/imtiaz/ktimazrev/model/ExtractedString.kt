@@ -0,0 +1,33 @@
+package com.imtiaz.ktimazrev.model
+
+// Ordinals must match StringEncoding in native string_table.h
+enum class StringEncoding {
+    Ascii,
+    Utf8,
+    Utf16Le
+}
+
+data class ExtractedString(
+    val index: Int, // Position in the native string table, used to fetch references
+    val address: Long, // Virtual address, 0 if the section is not loaded
+    val fileOffset: Long,
+    val sectionName: String,
+    val encodingOrdinal: Int,
+    val text: String,
+    val referenceCount: Int // -1 until code references have been collected
+) {
+    val encoding: StringEncoding get() = StringEncoding.entries[encodingOrdinal]
+}
+
+// One page of a native string query; totalCount covers all pages.
+class StringPage(
+    val totalCount: Int,
+    val strings: Array<ExtractedString>
+)
+
+data class StringQuery(
+    val text: String = "",
+    val matchMode: TextMatchMode = TextMatchMode.Substring,
+    val sectionName: String = "", // Empty for any section
+    val encoding: Int = -1 // StringEncoding ordinal, -1 for any
+)
@@ -0,0 +1,60 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native FunctionChange values (in ordinal order).
+enum class FunctionChange {
+    Unchanged,
+    Changed,
+    // Only in the new build
+    Added,
+    // Only in the old build
+    Removed,
+}
+
+// Mirrors the native FunctionMatch values: which evidence paired the two.
+enum class FunctionMatch {
+    None,
+    Symbol,
+    Hash,
+    Shape,
+    Neighbours,
+}
+
+// One function that differs between the builds; ranges are null on the
+// side the function is missing from.
+data class FunctionDiffEntry(
+    val change: FunctionChange,
+    val matchedBy: FunctionMatch,
+    val name: String,
+    val oldStart: Long?,
+    val oldEnd: Long?,
+    val newStart: Long?,
+    val newEnd: Long?,
+)
+
+// Result of diffFunctionsNative as parallel arrays: changed, added and
+// removed functions, with the number of unchanged ones.
+class FunctionDiff(
+    val unchangedCount: Int,
+    // FunctionChange ordinal | FunctionMatch ordinal shl 8
+    val changes: IntArray,
+    val oldStarts: LongArray,
+    val oldEnds: LongArray,
+    val newStarts: LongArray,
+    val newEnds: LongArray,
+    val names: Array<String>,
+) {
+    val size: Int get() = changes.size
+
+    fun entry(index: Int): FunctionDiffEntry {
+        val bits = changes[index]
+        return FunctionDiffEntry(
+            change = FunctionChange.entries.getOrElse(bits and 0xFF) { FunctionChange.Changed },
+            matchedBy = FunctionMatch.entries.getOrElse(bits shr 8) { FunctionMatch.None },
+            name = names[index],
+            oldStart = oldStarts[index].takeIf { it >= 0 },
+            oldEnd = oldEnds[index].takeIf { it >= 0 },
+            newStart = newStarts[index].takeIf { it >= 0 },
+            newEnd = newEnds[index].takeIf { it >= 0 },
+        )
+    }
+}
@@ -0,0 +1,36 @@
+package com.imtiaz.ktimazrev.model
+
+// Bits of FunctionPage.flags: where the start came from, the mode, and
+// whether the name came from a library signature.
+object FunctionFlags {
+    const val FROM_SYMBOL = 0x1
+    const val FROM_EXIDX = 0x2
+    const val FROM_EH_FRAME = 0x4
+    const val FROM_CALL = 0x8
+    const val FROM_PROLOGUE = 0x10
+    const val THUMB = 0x100
+    const val RECOVERED_NAME = 0x200
+}
+
+data class FunctionInfo(
+    val start: Long,
+    val end: Long,
+    val flags: Int,
+    val name: String,
+) {
+    val isThumb: Boolean get() = flags and FunctionFlags.THUMB != 0
+    val hasRecoveredName: Boolean get() = flags and FunctionFlags.RECOVERED_NAME != 0
+}
+
+// One page of the native function table, as parallel arrays sorted by start.
+class FunctionPage(
+    val totalCount: Int,
+    val starts: LongArray,
+    val ends: LongArray,
+    val flags: IntArray,
+    val names: Array<String>,
+) {
+    val size: Int get() = starts.size
+
+    fun function(index: Int) = FunctionInfo(starts[index], ends[index], flags[index], names[index])
+}
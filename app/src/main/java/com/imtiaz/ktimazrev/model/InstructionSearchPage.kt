@@ -0,0 +1,8 @@
+package com.imtiaz.ktimazrev.model
+
+// One page of native instruction search hits, in address order.
+// totalCount covers every match in the searched range, not just this page.
+class InstructionSearchPage(
+    val totalCount: Int,
+    val addresses: LongArray
+)
@@ -0,0 +1,55 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native ImportBinding values (in ordinal order).
+enum class ImportBinding {
+    Unresolved,
+    // By the library's own DT_NEEDED closure
+    Needed,
+    // Only by an opened library outside that closure
+    Elsewhere,
+}
+
+// One import of a library; provider is null when unresolved.
+data class LibraryImport(
+    val library: Int,
+    val name: String,
+    val version: String?,
+    val weak: Boolean,
+    val provider: Int?,
+    val binding: ImportBinding,
+)
+
+// Result of linkLibrariesNative as parallel arrays. Libraries are indexed
+// in the order given; needed entries and imports refer to them by index.
+class LibraryLinks(
+    val paths: Array<String>,
+    // Soname, else the file name
+    val names: Array<String>,
+    val exportCounts: IntArray,
+    // Owning library, DT_NEEDED name and the library it names (-1 if not opened)
+    val neededOwners: IntArray,
+    val neededNames: Array<String>,
+    val neededLibraries: IntArray,
+    // Owning library, name, version ("" if unversioned), provider (-1 if
+    // unresolved) and ImportBinding ordinal | 0x100 when weak
+    val importOwners: IntArray,
+    val importNames: Array<String>,
+    val importVersions: Array<String>,
+    val importProviders: IntArray,
+    val importFlags: IntArray,
+) {
+    val libraryCount: Int get() = paths.size
+    val importCount: Int get() = importOwners.size
+
+    fun import(index: Int): LibraryImport {
+        val flags = importFlags[index]
+        return LibraryImport(
+            library = importOwners[index],
+            name = importNames[index],
+            version = importVersions[index].ifEmpty { null },
+            weak = flags and 0x100 != 0,
+            provider = importProviders[index].takeIf { it >= 0 },
+            binding = ImportBinding.entries.getOrElse(flags and 0xFF) { ImportBinding.Unresolved },
+        )
+    }
+}
@@ -0,0 +1,31 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native MemoryCategory values (in ordinal order).
+enum class MemoryCategory {
+    Symbols,
+    Strings,
+    Decode,
+    SearchIndex,
+    Xrefs,
+    Functions,
+    Cfg,
+}
+
+// Native bytes held per subsystem, now and at the peak since start-up.
+data class NativeMemoryUsage(
+    val bytes: Map<MemoryCategory, Long>,
+    val peakBytes: Map<MemoryCategory, Long>,
+) {
+    val totalBytes: Long get() = bytes.values.sum()
+
+    companion object {
+        // `values` holds the live bytes of every category followed by the peaks.
+        fun fromNative(values: LongArray): NativeMemoryUsage {
+            val categories = MemoryCategory.entries
+            return NativeMemoryUsage(
+                bytes = categories.associateWith { values.getOrElse(it.ordinal) { 0L } },
+                peakBytes = categories.associateWith { values.getOrElse(categories.size + it.ordinal) { 0L } },
+            )
+        }
+    }
+}
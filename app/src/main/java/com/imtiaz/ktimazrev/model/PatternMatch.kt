@@ -0,0 +1,9 @@
+package com.imtiaz.ktimazrev.model
+
+// A byte-pattern hit; virtualAddress is 0 for offsets outside loaded
+// sections and sectionIndex is -1 when no section covers the offset.
+data class PatternMatch(
+    val fileOffset: Long,
+    val virtualAddress: Long,
+    val sectionIndex: Int,
+)
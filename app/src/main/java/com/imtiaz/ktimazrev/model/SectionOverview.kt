@@ -0,0 +1,51 @@
+package com.imtiaz.ktimazrev.model
+
+// Summary of one stretch of a section, for minimaps and heat strips.
+data class OverviewBucket(
+    val branches: Int,
+    val calls: Int,
+    val loadsStores: Int,
+    val other: Int,
+    val unknown: Int,
+    val dataBytes: Int,
+    val zeroBytes: Int,
+    val symbols: Int,
+    // Shannon entropy, 0 to 8 bits per byte
+    val entropy: Float,
+) {
+    val instructions: Int get() = branches + calls + loadsStores + other + unknown
+}
+
+// One zoom level of a section overview: bucket i covers
+// [startAddress + i * bucketBytes, startAddress + (i + 1) * bucketBytes).
+class SectionOverview(
+    val startAddress: Long,
+    val bucketBytes: Long,
+    val buckets: List<OverviewBucket>,
+) {
+    companion object {
+        private const val HEADER_SIZE = 3
+        private const val FIELDS_PER_BUCKET = 9
+
+        // Layout written by getSectionOverviewNative.
+        fun fromNative(values: LongArray): SectionOverview {
+            val count = values[2].toInt()
+            val buckets =
+                List(count) { i ->
+                    val at = HEADER_SIZE + i * FIELDS_PER_BUCKET
+                    OverviewBucket(
+                        branches = values[at].toInt(),
+                        calls = values[at + 1].toInt(),
+                        loadsStores = values[at + 2].toInt(),
+                        other = values[at + 3].toInt(),
+                        unknown = values[at + 4].toInt(),
+                        dataBytes = values[at + 5].toInt(),
+                        zeroBytes = values[at + 6].toInt(),
+                        symbols = values[at + 7].toInt(),
+                        entropy = values[at + 8] / 256f,
+                    )
+                }
+            return SectionOverview(values[0], values[1], buckets)
+        }
+    }
+}
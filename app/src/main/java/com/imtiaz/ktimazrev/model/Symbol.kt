@@ -4,5 +4,9 @@ data class Symbol(
     val name: String,
     val value: Long, // Virtual address of the symbol
     val size: Long,  // Size of the symbol
-    val sectionName: String // Section this symbol belongs to
-)
\ No newline at end of file
+    val sectionName: String, // Section this symbol belongs to
+    val demangledName: String? = null, // C++ names in symbol queries; null otherwise
+    val index: Int = -1 // In the native symbol table; unique per symbol
+) {
+    val displayName: String get() = demangledName ?: name
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+package com.imtiaz.ktimazrev.model
+
+// One page of a native symbol query; totalCount is the number of matches
+// across all pages, not just the symbols returned here.
+class SymbolPage(
+    val totalCount: Int,
+    val symbols: Array<Symbol>
+)
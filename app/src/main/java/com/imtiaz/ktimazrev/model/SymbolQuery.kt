@@ -0,0 +1,26 @@
+package com.imtiaz.ktimazrev.model
+
+// Ordinals must match TextMatchMode in native text_query.h
+enum class TextMatchMode {
+    Prefix,
+    Substring,
+    Regex
+}
+
+// Ordinals must match SymbolSortKey in native symbol_index.h
+enum class SymbolSortKey {
+    Name,
+    Address,
+    Size
+}
+
+data class SymbolQuery(
+    val text: String = "",
+    val matchMode: TextMatchMode = TextMatchMode.Substring,
+    val type: Int = -1, // STT_* value, -1 for any
+    val binding: Int = -1, // STB_* value, -1 for any
+    val sectionName: String = "", // Empty for any section
+    val sortKey: SymbolSortKey = SymbolSortKey.Name,
+    val descending: Boolean = false,
+    val demangled: Boolean = true // Match and sort C++ names demangled
+)
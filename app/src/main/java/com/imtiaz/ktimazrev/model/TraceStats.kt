@@ -0,0 +1,29 @@
+package com.imtiaz.ktimazrev.model
+
+// Mirrors the native TraceCounter values (in ordinal order).
+enum class TraceCounter {
+    SectionsParsed,
+    SymbolsParsed,
+    InstructionsDecoded,
+    BytesDecoded,
+    JniCalls,
+    MinorFaults,
+    MajorFaults,
+}
+
+// Snapshot of the native instrumentation: per traced site (parser stages,
+// decoder, JNI entry points) the number of calls and their total and longest
+// time, as parallel arrays, plus counter totals. Empty unless the native
+// library was built with KTIMAZ_ENABLE_TRACING, as debug builds are.
+class TraceStats(
+    val enabled: Boolean,
+    val siteNames: Array<String>,
+    val counts: LongArray,
+    val totalNanos: LongArray,
+    val maxNanos: LongArray,
+    val counters: LongArray,
+) {
+    val siteCount: Int get() = siteNames.size
+
+    fun counter(counter: TraceCounter): Long = counters.getOrElse(counter.ordinal) { 0L }
+}
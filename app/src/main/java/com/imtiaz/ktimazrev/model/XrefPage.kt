@@ -0,0 +1,21 @@
+package com.imtiaz.ktimazrev.model
+
+enum class XrefKind {
+    Call,
+    Jump,
+    Read,
+    Address,
+    Pointer,
+}
+
+// One page of references, as parallel arrays ordered by target then source.
+class XrefPage(
+    val totalCount: Int,
+    val sources: LongArray,
+    val targets: LongArray,
+    val kinds: IntArray,
+) {
+    val size: Int get() = sources.size
+
+    fun kind(index: Int): XrefKind = XrefKind.entries[kinds[index]]
+}
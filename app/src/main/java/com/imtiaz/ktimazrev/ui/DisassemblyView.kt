@@ -22,6 +22,7 @@ import com.imtiaz.ktimazrev.R
 import com.imtiaz.ktimazrev.model.Bookmark
 import com.imtiaz.ktimazrev.model.Instruction
 import com.imtiaz.ktimazrev.model.Symbol
+import com.imtiaz.ktimazrev.model.XrefPage
 import com.imtiaz.ktimazrev.model.toHexString
 import com.imtiaz.ktimazrev.model.toRawBytesHexString
 
@@ -29,9 +30,11 @@ import com.imtiaz.ktimazrev.model.toRawBytesHexString
 @Composable
 fun DisassemblyView(
     instructions: List<Instruction>,
-    symbols: List<Symbol>,
+    labels: Map<Long, Symbol>, // By address, for rows and branch targets
     bookmarks: List<Bookmark>,
-    onAddBookmark: (address: Long, name: String, comment: String) -> Unit
+    onAddBookmark: (address: Long, name: String, comment: String) -> Unit,
+    getXrefs: (address: Long) -> XrefPage? = { null },
+    symbolContaining: (address: Long) -> Symbol? = { null }
 ) {
     if (instructions.isEmpty()) {
         Text(
@@ -48,7 +51,7 @@ fun DisassemblyView(
         contentPadding = PaddingValues(8.dp)
     ) {
         itemsIndexed(instructions) { index, instruction ->
-            val symbolAtAddress = symbols.firstOrNull { it.value == instruction.address }
+            val symbolAtAddress = labels[instruction.address]
             val bookmarkAtAddress = bookmarks.firstOrNull { it.address == instruction.address }
 
             // Display symbol name if exists at this address
@@ -67,6 +70,7 @@ fun DisassemblyView(
 
             // Individual instruction row
             var showBookmarkDialog by remember { mutableStateOf(false) }
+            var xrefs by remember { mutableStateOf<XrefPage?>(null) }
 
             Row(
                 modifier = Modifier
@@ -74,8 +78,7 @@ fun DisassemblyView(
                     .background(if (bookmarkAtAddress != null) MaterialTheme.colorScheme.secondaryContainer else Color.Transparent)
                     .combinedClickable(
                         onClick = {
-                            // Handle click (e.g., navigate to xrefs, or simply select)
-                            // println("Clicked instruction at 0x${instruction.address.toHexString()}")
+                            xrefs = getXrefs(instruction.address)
                         },
                         onLongClick = {
                             showBookmarkDialog = true
@@ -138,7 +141,7 @@ fun DisassemblyView(
 
                 // Comment (e.g., resolved symbol for branch target)
                 if (instruction.isBranch && instruction.branchTarget != 0L) {
-                    val targetSymbol = symbols.firstOrNull { it.value == instruction.branchTarget }?.name
+                    val targetSymbol = labels[instruction.branchTarget and 1L.inv()]?.name
                     if (targetSymbol != null) {
                         Text(
                             text = "; -> $targetSymbol",
@@ -159,6 +162,15 @@ fun DisassemblyView(
                 }
             }
 
+            xrefs?.let { page ->
+                XrefDialog(
+                    address = instruction.address,
+                    page = page,
+                    symbolContaining = symbolContaining,
+                    onDismiss = { xrefs = null }
+                )
+            }
+
             if (showBookmarkDialog) {
                 BookmarkDialog(
                     address = instruction.address,
@@ -221,4 +233,49 @@ fun BookmarkDialog(
             }
         }
     )
-}
\ No newline at end of file
+}
+
+@Composable
+fun XrefDialog(
+    address: Long,
+    page: XrefPage,
+    symbolContaining: (address: Long) -> Symbol?,
+    onDismiss: () -> Unit
+) {
+    AlertDialog(
+        onDismissRequest = onDismiss,
+        title = { Text(text = "References to ${address.toHexString()} (${page.totalCount})") },
+        text = {
+            if (page.size == 0) {
+                Text("No references found.")
+            } else {
+                LazyColumn(modifier = Modifier.heightIn(max = 400.dp)) {
+                    items(page.size) { i ->
+                        val source = page.sources[i]
+                        val function = remember(source) { symbolContaining(source) }
+                        Text(
+                            text = "${source.toHexString()}  ${page.kind(i).name.uppercase()}" +
+                                (function?.let { "  ${it.name}" } ?: ""),
+                            fontFamily = FontFamily.Monospace,
+                            fontSize = 12.sp
+                        )
+                    }
+                    if (page.totalCount > page.size) {
+                        item {
+                            Text(
+                                text = "... ${page.totalCount - page.size} more",
+                                fontSize = 12.sp,
+                                color = MaterialTheme.colorScheme.onSurfaceVariant
+                            )
+                        }
+                    }
+                }
+            }
+        },
+        confirmButton = {
+            Button(onClick = onDismiss) {
+                Text("Close")
+            }
+        }
+    )
+}
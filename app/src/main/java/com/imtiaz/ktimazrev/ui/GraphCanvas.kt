@@ -9,26 +9,40 @@ import androidx.compose.material3.Text
 import androidx.compose.runtime.*
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.geometry.Offset
+import androidx.compose.ui.geometry.Size
 import androidx.compose.ui.graphics.Color
+import androidx.compose.ui.graphics.drawscope.Stroke
 import androidx.compose.ui.graphics.drawscope.drawIntoCanvas
+import androidx.compose.ui.graphics.drawscope.withTransform
 import androidx.compose.ui.graphics.nativeCanvas
 import androidx.compose.ui.graphics.toArgb
 import androidx.compose.ui.input.pointer.pointerInput
+import androidx.compose.ui.layout.onSizeChanged
 import androidx.compose.ui.platform.LocalDensity
-import androidx.compose.ui.text.font.FontFamily
 import androidx.compose.ui.text.style.TextAlign
 import androidx.compose.ui.tooling.preview.Preview
-import androidx.compose.ui.unit.dp
+import androidx.compose.ui.unit.IntRect
+import androidx.compose.ui.unit.IntSize
 import androidx.compose.ui.unit.sp
-import com.imtiaz.ktimazrev.model.Instruction
-import com.imtiaz.ktimazrev.model.Symbol
-import com.imtiaz.ktimazrev.model.toHexString
+import com.imtiaz.ktimazrev.model.CfgBlockFlags
+import com.imtiaz.ktimazrev.model.CfgEdgeKind
+import com.imtiaz.ktimazrev.model.CfgSummary
+import com.imtiaz.ktimazrev.model.CfgViewport
 import com.imtiaz.ktimazrev.ui.theme.MobileARMDisassemblerTheme
-import kotlin.math.max
+import com.imtiaz.ktimazrev.utils.AppThreadPool
+import kotlinx.coroutines.withContext
+import kotlin.math.floor
+
+// Viewport queries are snapped to tiles of this many layout units (plus one
+// tile of margin) so panning only goes back to native code at tile borders.
+private const val VIEWPORT_TILE = 64
 
 @Composable
-fun GraphCanvas(instructions: List<Instruction>, symbols: List<Symbol>) {
-    if (instructions.isEmpty()) {
+fun GraphCanvas(
+    summary: CfgSummary?,
+    loadViewport: (x0: Int, y0: Int, x1: Int, y1: Int) -> CfgViewport?,
+) {
+    if (summary == null) {
         Text(
             text = "No graph data available. Load an ELF file and section.",
             modifier = Modifier.fillMaxSize().wrapContentSize(),
@@ -38,86 +52,107 @@ fun GraphCanvas(instructions: List<Instruction>, symbols: List<Symbol>) {
         return
     }
 
-    var scale by remember { mutableStateOf(1f) }
-    var offset by remember { mutableStateOf(Offset.Zero) }
+    var scale by remember(summary.entry) { mutableStateOf(1f) }
+    var offset by remember(summary.entry) { mutableStateOf(Offset.Zero) }
+    var canvasSize by remember { mutableStateOf(IntSize.Zero) }
 
     val density = LocalDensity.current
-    val instructionHeight = with(density) { 20.sp.toPx() } // Approximate height per instruction line
-    val nodePadding = with(density) { 10.dp.toPx() }
-    val nodeWidth = with(density) { 250.dp.toPx() } // Fixed width for nodes
+    val textColor = MaterialTheme.colorScheme.onBackground
+    val blockColor = MaterialTheme.colorScheme.surfaceVariant
+    val borderColor = MaterialTheme.colorScheme.outline
+    val loopColor = MaterialTheme.colorScheme.tertiary
+    val entryColor = MaterialTheme.colorScheme.primary
+
+    val textPaint = remember(density, textColor) {
+        Paint().apply {
+            color = textColor.toArgb()
+            textSize = with(density) { 12.sp.toPx() }
+            typeface = android.graphics.Typeface.MONOSPACE
+            isAntiAlias = true
+        }
+    }
+    // Pixel size of one layout unit
+    val charWidth = remember(textPaint) { textPaint.measureText("M") }
+    val lineHeight = with(density) { 16.sp.toPx() }
+
+    val visibleTiles by remember(summary.entry, charWidth, lineHeight) {
+        derivedStateOf {
+            if (canvasSize == IntSize.Zero) return@derivedStateOf null
+            val left = -offset.x / scale / charWidth
+            val top = -offset.y / scale / lineHeight
+            val right = left + canvasSize.width / scale / charWidth
+            val bottom = top + canvasSize.height / scale / lineHeight
+            IntRect(
+                floor(left / VIEWPORT_TILE).toInt() - 1,
+                floor(top / VIEWPORT_TILE).toInt() - 1,
+                floor(right / VIEWPORT_TILE).toInt() + 2,
+                floor(bottom / VIEWPORT_TILE).toInt() + 2,
+            )
+        }
+    }
 
-    // Simplified node layout - just linear for now
-    val nodes = remember(instructions) {
-        val map = mutableMapOf<Long, Offset>()
-        var y = nodePadding
-        instructions.forEach { instr ->
-            map[instr.address] = Offset(nodePadding, y)
-            y += instructionHeight
+    var viewport by remember(summary.entry) { mutableStateOf<CfgViewport?>(null) }
+    LaunchedEffect(summary.entry, visibleTiles) {
+        val tiles = visibleTiles ?: return@LaunchedEffect
+        viewport = withContext(AppThreadPool.IO) {
+            loadViewport(
+                tiles.left * VIEWPORT_TILE,
+                tiles.top * VIEWPORT_TILE,
+                tiles.right * VIEWPORT_TILE,
+                tiles.bottom * VIEWPORT_TILE,
+            )
         }
-        map
     }
 
     Canvas(
         modifier = Modifier
             .fillMaxSize()
-            .pointerInput(Unit) {
+            .onSizeChanged { canvasSize = it }
+            .pointerInput(summary.entry) {
                 detectTransformGestures { _, pan, zoom, _ ->
-                    scale = max(0.5f, scale * zoom) // Prevent too small zoom
-                    offset += pan / scale // Adjust pan based on current scale
+                    scale = (scale * zoom).coerceIn(0.1f, 4f)
+                    offset += pan
                 }
             }
     ) {
-        val transformedOffset = offset
-        val transformedScale = scale
+        val current = viewport ?: return@Canvas
 
-        drawIntoCanvas { canvas ->
-            val paint = Paint().apply {
-                color = android.graphics.Color.WHITE
-                textSize = with(density) { 12.sp.toPx() }
-                typeface = android.graphics.Typeface.MONOSPACE
-            }
-            val branchPaint = Paint().apply {
-                color = android.graphics.Color.RED
-                strokeWidth = 2f
+        withTransform({
+            translate(offset.x, offset.y)
+            scale(scale, scale, Offset.Zero)
+        }) {
+            for (i in 0 until current.edgeCount) {
+                val color = when (current.edgeKind(i)) {
+                    CfgEdgeKind.Taken -> Color(0xFF4CAF50)
+                    CfgEdgeKind.NotTaken -> Color(0xFFF44336)
+                    CfgEdgeKind.Unconditional -> Color(0xFF2196F3)
+                    CfgEdgeKind.Fallthrough -> borderColor
+                }
+                drawLine(
+                    color = color,
+                    start = Offset(current.edgeCoords[i * 4] * charWidth, current.edgeCoords[i * 4 + 1] * lineHeight),
+                    end = Offset(current.edgeCoords[i * 4 + 2] * charWidth, current.edgeCoords[i * 4 + 3] * lineHeight),
+                    strokeWidth = 2f / scale,
+                )
             }
 
-            // Draw nodes (simplified as just instruction lines)
-            instructions.forEach { instr ->
-                val nodePos = nodes[instr.address]
-                if (nodePos != null) {
-                    val displayX = nodePos.x * transformedScale + transformedOffset.x
-                    val displayY = nodePos.y * transformedScale + transformedOffset.y
-
-                    if (displayX < size.width && displayY < size.height &&
-                        displayX + nodeWidth * transformedScale > 0 && displayY + instructionHeight * transformedScale > 0) {
-                        // Draw instruction text
-                        val instructionText = "${instr.address.toHexString()}: ${instr.mnemonic} ${instr.operands}"
-                        canvas.nativeCanvas.drawText(
-                            instructionText,
-                            displayX,
-                            displayY + instructionHeight / 2, // Centered vertically
-                            paint.apply { color = MaterialTheme.colorScheme.onBackground.toArgb() }
-                        )
-
-                        // Draw branch lines
-                        if (instr.isBranch && instr.branchTarget != 0L) {
-                            val targetNodePos = nodes[instr.branchTarget]
-                            if (targetNodePos != null) {
-                                val targetDisplayX = targetNodePos.x * transformedScale + transformedOffset.x
-                                val targetDisplayY = targetNodePos.y * transformedScale + transformedOffset.y
-
-                                val startPoint = Offset(displayX + nodeWidth * transformedScale, displayY + instructionHeight / 2)
-                                val endPoint = Offset(targetDisplayX, targetDisplayY + instructionHeight / 2)
+            for (i in 0 until current.blockCount) {
+                val topLeft = Offset(current.blockX[i] * charWidth, current.blockY[i] * lineHeight)
+                val size = Size(current.blockWidth[i] * charWidth, current.blockHeight[i] * lineHeight)
+                val flags = current.blockFlags[i]
+                val outline = when {
+                    flags and CfgBlockFlags.ENTRY != 0 -> entryColor
+                    flags and CfgBlockFlags.LOOP_HEADER != 0 -> loopColor
+                    else -> borderColor
+                }
+                drawRect(color = blockColor, topLeft = topLeft, size = size)
+                drawRect(color = outline, topLeft = topLeft, size = size, style = Stroke(width = 2f / scale))
 
-                                drawLine(
-                                    color = Color(branchPaint.color),
-                                    start = startPoint,
-                                    end = endPoint,
-                                    strokeWidth = branchPaint.strokeWidth,
-                                    alpha = 0.7f
-                                )
-                            }
-                        }
+                drawIntoCanvas { canvas ->
+                    var baseline = topLeft.y + lineHeight * 1.25f
+                    current.blockText[i].lineSequence().forEach { line ->
+                        canvas.nativeCanvas.drawText(line, topLeft.x + charWidth, baseline, textPaint)
+                        baseline += lineHeight
                     }
                 }
             }
@@ -129,13 +164,19 @@ fun GraphCanvas(instructions: List<Instruction>, symbols: List<Symbol>) {
 @Composable
 fun GraphCanvasPreview() {
     MobileARMDisassemblerTheme {
-        val sampleInstructions = listOf(
-            Instruction(0x1000, "MOV", "R0, #0", rawBytes = 0xE3A00000, byteLength = 4, isBranch = false),
-            Instruction(0x1004, "ADD", "R1, R0, #1", rawBytes = 0xE2801001, byteLength = 4, isBranch = false),
-            Instruction(0x1008, "CMP", "R1, #10", rawBytes = 0xE351000A, byteLength = 4, isBranch = false),
-            Instruction(0x100C, "BLT", "0x1000", rawBytes = 0xDA000000, byteLength = 4, isBranch = true, branchTarget = 0x1000),
-            Instruction(0x1010, "BX", "LR", rawBytes = 0xE12FFF1E, byteLength = 4, isBranch = true, branchTarget = 0L)
+        val summary = CfgSummary(0x1000, 2, 1, 0, 30, 8, false)
+        val viewport = CfgViewport(
+            blockIds = intArrayOf(0, 1),
+            blockAddresses = longArrayOf(0x1000, 0x1008),
+            blockX = intArrayOf(0, 0),
+            blockY = intArrayOf(0, 5),
+            blockWidth = intArrayOf(28, 28),
+            blockHeight = intArrayOf(3, 2),
+            blockFlags = intArrayOf(CfgBlockFlags.ENTRY, CfgBlockFlags.EXIT),
+            blockText = arrayOf("00001000  MOV R0, #0x0\n00001004  CMP R1, #0xA", "00001008  BX LR"),
+            edgeCoords = intArrayOf(14, 3, 14, 5),
+            edgeKinds = intArrayOf(CfgEdgeKind.Fallthrough.ordinal),
         )
-        GraphCanvas(instructions = sampleInstructions, symbols = emptyList())
+        GraphCanvas(summary = summary, loadViewport = { _, _, _, _ -> viewport })
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,104 @@
+package com.imtiaz.ktimazrev.ui
+
+import androidx.compose.foundation.clickable
+import androidx.compose.foundation.layout.*
+import androidx.compose.foundation.lazy.LazyColumn
+import androidx.compose.foundation.lazy.items
+import androidx.compose.foundation.lazy.rememberLazyListState
+import androidx.compose.material3.MaterialTheme
+import androidx.compose.material3.Text
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.LaunchedEffect
+import androidx.compose.runtime.derivedStateOf
+import androidx.compose.runtime.getValue
+import androidx.compose.runtime.mutableStateOf
+import androidx.compose.runtime.remember
+import androidx.compose.runtime.setValue
+import androidx.compose.ui.Modifier
+import androidx.compose.ui.text.font.FontFamily
+import androidx.compose.ui.text.style.TextAlign
+import androidx.compose.ui.text.style.TextOverflow
+import androidx.compose.ui.unit.dp
+import com.imtiaz.ktimazrev.model.ExtractedString
+import com.imtiaz.ktimazrev.model.toHexString
+
+@Composable
+fun StringsView(
+    strings: List<ExtractedString>,
+    totalCount: Int = strings.size,
+    onLoadMore: () -> Unit = {},
+    getReferences: (ExtractedString) -> List<Long> = { emptyList() }
+) {
+    if (strings.isEmpty()) {
+        Text(
+            text = "No strings found. Strings are extracted in the background after loading an ELF file.",
+            modifier = Modifier.fillMaxSize().wrapContentSize(),
+            color = MaterialTheme.colorScheme.onBackground,
+            textAlign = TextAlign.Center
+        )
+        return
+    }
+
+    // Pages are fetched from the native string table as the list nears its end
+    val listState = rememberLazyListState()
+    val nearEnd by remember(strings, totalCount) {
+        derivedStateOf {
+            val lastVisible = listState.layoutInfo.visibleItemsInfo.lastOrNull()?.index ?: 0
+            strings.size < totalCount && lastVisible >= strings.size - 20
+        }
+    }
+    LaunchedEffect(nearEnd) {
+        if (nearEnd) onLoadMore()
+    }
+
+    // Tapping a string expands the list of instructions that reference it
+    var expandedIndex by remember { mutableStateOf(-1) }
+    var references by remember { mutableStateOf<List<Long>>(emptyList()) }
+
+    LazyColumn(
+        modifier = Modifier.fillMaxSize(),
+        state = listState,
+        contentPadding = PaddingValues(8.dp)
+    ) {
+        items(strings) { string ->
+            Column(
+                modifier = Modifier
+                    .fillMaxWidth()
+                    .clickable {
+                        if (expandedIndex == string.index) {
+                            expandedIndex = -1
+                        } else {
+                            expandedIndex = string.index
+                            references = getReferences(string)
+                        }
+                    }
+                    .padding(vertical = 8.dp, horizontal = 4.dp)
+            ) {
+                Text(
+                    text = string.text,
+                    style = MaterialTheme.typography.bodyMedium,
+                    fontFamily = FontFamily.Monospace,
+                    maxLines = 2,
+                    overflow = TextOverflow.Ellipsis,
+                    color = MaterialTheme.colorScheme.onSurface
+                )
+                val refs = if (string.referenceCount < 0) "pending" else string.referenceCount.toString()
+                Text(
+                    text = "Address: ${string.address.toHexString()} | ${string.sectionName} | ${string.encoding} | Refs: $refs",
+                    style = MaterialTheme.typography.bodySmall,
+                    color = MaterialTheme.colorScheme.onSurfaceVariant
+                )
+                if (expandedIndex == string.index) {
+                    references.forEach { address ->
+                        Text(
+                            text = "  referenced at ${address.toHexString()}",
+                            style = MaterialTheme.typography.bodySmall,
+                            fontFamily = FontFamily.Monospace,
+                            color = MaterialTheme.colorScheme.primary
+                        )
+                    }
+                }
+            }
+        }
+    }
+}
@@ -4,9 +4,14 @@ import androidx.compose.foundation.clickable
 import androidx.compose.foundation.layout.*
 import androidx.compose.foundation.lazy.LazyColumn
 import androidx.compose.foundation.lazy.items
+import androidx.compose.foundation.lazy.rememberLazyListState
 import androidx.compose.material3.MaterialTheme
 import androidx.compose.material3.Text
 import androidx.compose.runtime.Composable
+import androidx.compose.runtime.LaunchedEffect
+import androidx.compose.runtime.derivedStateOf
+import androidx.compose.runtime.getValue
+import androidx.compose.runtime.remember
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.text.style.TextAlign
@@ -15,7 +20,11 @@ import com.imtiaz.ktimazrev.model.Symbol
 import com.imtiaz.ktimazrev.model.toHexString
 
 @Composable
-fun SymbolsView(symbols: List<Symbol>) {
+fun SymbolsView(
+    symbols: List<Symbol>,
+    totalCount: Int = symbols.size,
+    onLoadMore: () -> Unit = {}
+) {
     if (symbols.isEmpty()) {
         Text(
             text = "No symbols found or loaded. Please load an ELF file.",
@@ -26,11 +35,25 @@ fun SymbolsView(symbols: List<Symbol>) {
         return
     }
 
+    // Pages are fetched from the native symbol index as the list nears its end
+    val listState = rememberLazyListState()
+    val nearEnd by remember(symbols, totalCount) {
+        derivedStateOf {
+            val lastVisible = listState.layoutInfo.visibleItemsInfo.lastOrNull()?.index ?: 0
+            symbols.size < totalCount && lastVisible >= symbols.size - 20
+        }
+    }
+    LaunchedEffect(nearEnd) {
+        if (nearEnd) onLoadMore()
+    }
+
     LazyColumn(
         modifier = Modifier.fillMaxSize(),
+        state = listState,
         contentPadding = PaddingValues(8.dp)
     ) {
-        items(symbols, key = { it.name + it.value }) { symbol ->
+        // Names and addresses repeat (.symtab and .dynsym), indices do not
+        items(symbols, key = { it.index }) { symbol ->
             Row(
                 modifier = Modifier
                     .fillMaxWidth()
@@ -40,7 +63,7 @@ fun SymbolsView(symbols: List<Symbol>) {
             ) {
                 Column {
                     Text(
-                        text = symbol.name,
+                        text = symbol.displayName,
                         style = MaterialTheme.typography.titleMedium,
                         fontWeight = FontWeight.Bold,
                         color = MaterialTheme.colorScheme.onSurface
@@ -1,16 +1,30 @@
 package com.imtiaz.ktimazrev.viewmodel
 
+import android.os.ParcelFileDescriptor
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
 import com.imtiaz.ktimazrev.model.Bookmark
+import com.imtiaz.ktimazrev.model.CallGraphPage
+import com.imtiaz.ktimazrev.model.CallGraphQuery
+import com.imtiaz.ktimazrev.model.CfgSummary
+import com.imtiaz.ktimazrev.model.CfgViewport
+import com.imtiaz.ktimazrev.model.ContentRegion
+import com.imtiaz.ktimazrev.model.FunctionDiff
+import com.imtiaz.ktimazrev.model.FunctionPage
 import com.imtiaz.ktimazrev.model.Instruction
+import com.imtiaz.ktimazrev.model.InstructionSearchPage
+import com.imtiaz.ktimazrev.model.LibraryLinks
+import com.imtiaz.ktimazrev.model.PatternMatch
+import com.imtiaz.ktimazrev.model.SectionOverview
 import com.imtiaz.ktimazrev.model.Symbol
+import com.imtiaz.ktimazrev.model.XrefPage
 import com.imtiaz.ktimazrev.model.toHexString
 import com.imtiaz.ktimazrev.utils.AppThreadPool
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
 import kotlinx.coroutines.flow.combine
+import kotlinx.coroutines.flow.flowOn
 import kotlinx.coroutines.flow.stateIn
 import kotlinx.coroutines.launch
 
@@ -19,6 +33,11 @@ class DisassemblyViewModel : ViewModel() {
     private val _instructions = MutableStateFlow<List<Instruction>>(emptyList())
     val instructions: StateFlow<List<Instruction>> = _instructions.asStateFlow()
 
+    // Symbols labelling rows of the shown listing and the targets of its
+    // branches, by address.
+    private val _listingLabels = MutableStateFlow<Map<Long, Symbol>>(emptyMap())
+    val listingLabels: StateFlow<Map<Long, Symbol>> = _listingLabels.asStateFlow()
+
     private val _bookmarks = MutableStateFlow<List<Bookmark>>(emptyList())
     val bookmarks: StateFlow<List<Bookmark>> = _bookmarks.asStateFlow()
 
@@ -34,29 +53,73 @@ class DisassemblyViewModel : ViewModel() {
     private val _currentTab = MutableStateFlow(MainTab.Disassembly)
     val currentTab: StateFlow<MainTab> = _currentTab.asStateFlow()
 
-    // Combined flow for filtered instructions based on search query
+    // Streamed results of the current byte-pattern search.
+    private val _patternMatches = MutableStateFlow<List<PatternMatch>>(emptyList())
+    val patternMatches: StateFlow<List<PatternMatch>> = _patternMatches.asStateFlow()
+
+    private val _patternSearchRunning = MutableStateFlow(false)
+    val patternSearchRunning: StateFlow<Boolean> = _patternSearchRunning.asStateFlow()
+
+    private val _patternSearchError = MutableStateFlow<String?>(null)
+    val patternSearchError: StateFlow<String?> = _patternSearchError.asStateFlow()
+
+    // Control flow graph of the function currently shown in the graph view.
+    private val _cfgSummary = MutableStateFlow<CfgSummary?>(null)
+    val cfgSummary: StateFlow<CfgSummary?> = _cfgSummary.asStateFlow()
+
+    // Byte patches: the last rejection reason and what undo/redo can do.
+    private val _patchError = MutableStateFlow<String?>(null)
+    val patchError: StateFlow<String?> = _patchError.asStateFlow()
+
+    private val _canUndoPatch = MutableStateFlow(false)
+    val canUndoPatch: StateFlow<Boolean> = _canUndoPatch.asStateFlow()
+
+    private val _canRedoPatch = MutableStateFlow(false)
+    val canRedoPatch: StateFlow<Boolean> = _canRedoPatch.asStateFlow()
+
+    // How the shown section was decoded, to show it again after a patch.
+    private var currentBaseAddress = SECTION_ADDRESS
+    private var currentThumbMode = false
+
+    // Guards activePatternSearchId so callbacks for a search that has just
+    // been started are not dropped before its id is known.
+    private val patternSearchLock = Any()
+    private var activePatternSearchId = -1L
+
+    // Batches of the active search, guarded by patternSearchLock. Each
+    // batch is published as a view over the batches so far, not a copy of
+    // every match.
+    private val patternMatchBatches = ArrayList<List<PatternMatch>>()
+
+    // Combined flow for filtered instructions based on search query.
+    // Once the native inverted index is built, queries are answered there;
+    // until then fall back to a plain substring scan of the loaded section.
     val filteredInstructions: StateFlow<List<Instruction>> =
         combine(
             _instructions,
             _searchQuery,
         ) { instructions, query ->
-            if (query.isBlank()) {
+            if (query.isBlank() || instructions.isEmpty()) {
                 instructions
             } else {
-                instructions.filter {
-                    it.mnemonic.contains(query, ignoreCase = true) ||
-                        it.operands.contains(query, ignoreCase = true) ||
-                        it.comment.contains(query, ignoreCase = true) ||
-                        it.address.toHexString().contains(query, ignoreCase = true)
-                }
+                searchLoadedInstructions(instructions, query)
+                    ?: instructions.filter {
+                        it.mnemonic.contains(query, ignoreCase = true) ||
+                            it.operands.contains(query, ignoreCase = true) ||
+                            it.comment.contains(query, ignoreCase = true) ||
+                            it.address.toHexString().contains(query, ignoreCase = true)
+                    }
             }
-        }.stateIn(
-            scope = viewModelScope,
-            started = kotlinx.coroutines.flow.SharingStarted.WhileSubscribed(),
-            initialValue = emptyList(),
-        )
+        }.flowOn(AppThreadPool.Default)
+            .stateIn(
+                scope = viewModelScope,
+                started = kotlinx.coroutines.flow.SharingStarted.WhileSubscribed(),
+                initialValue = emptyList(),
+            )
 
     // --- Native Methods (declared in JNI) ---
+    // baseAddress SECTION_ADDRESS decodes at the section's own address in
+    // the modes of its mapping symbols (isThumbMode is ignored).
     external fun getDisassembledInstructionsNative(
         sectionName: String,
         baseAddress: Long,
@@ -69,14 +132,437 @@ class DisassemblyViewModel : ViewModel() {
         length: Int,
     ): ByteArray?
 
+    external fun isSearchIndexReadyNative(): Boolean
+
+    // Symbols with values in [start, end), by address; null until the
+    // symbol index is built.
+    external fun getSymbolsInRangeNative(
+        start: Long,
+        end: Long,
+    ): Array<Symbol>?
+
+    // Symbols at any of addresses (Thumb functions at address + 1).
+    external fun getSymbolsAtNative(addresses: LongArray): Array<Symbol>?
+
+    // Function or object symbol containing address, or null.
+    external fun getSymbolContainingNative(address: Long): Symbol?
+
+    // Searches the whole binary; rangeEnd == 0 means no upper bound.
+    external fun searchInstructionsNative(
+        query: String,
+        rangeStart: Long,
+        rangeEnd: Long,
+        offset: Int,
+        limit: Int,
+    ): InstructionSearchPage?
+
+    // Returns null if the pattern is valid, otherwise a description of the problem.
+    external fun validatePatternNative(pattern: String): String?
+
+    // Starts an asynchronous scan; an empty sectionName scans the whole file.
+    // Returns the search id, or -1 if the scan could not be started.
+    external fun startPatternSearchNative(
+        pattern: String,
+        sectionName: String,
+    ): Long
+
+    external fun cancelPatternSearchNative(searchId: Long)
+
+    // References to targets in [targetStart, targetEnd); null until the
+    // background sweep has built the xref index.
+    external fun getXrefsNative(
+        targetStart: Long,
+        targetEnd: Long,
+        offset: Int,
+        limit: Int,
+    ): XrefPage?
+
+    // Discovered functions sorted by start; null until the background sweep
+    // has built the function table.
+    external fun getFunctionsNative(
+        offset: Int,
+        limit: Int,
+    ): FunctionPage?
+
+    // Call graph node for "0x<address>" inside a function or an exact
+    // function/import name; -1 if unknown or the graph is not built yet.
+    external fun findCallGraphNodeNative(nameOrAddress: String): Int
+
+    // Direct or transitive callers/callees of node (kind is a
+    // CallGraphQuery value), paged.
+    external fun queryCallGraphNative(
+        node: Int,
+        kind: Int,
+        offset: Int,
+        limit: Int,
+    ): CallGraphPage?
+
+    // Shortest call chain from one node to another; empty if there is none.
+    external fun callPathNative(
+        from: Int,
+        to: Int,
+    ): CallGraphPage?
+
+    // Functions added, removed or changed since the build at oldPath, which
+    // is loaded and swept on the calling thread. Null until the function
+    // table is built or if oldPath is not a readable ELF file.
+    external fun diffFunctionsNative(oldPath: String): FunctionDiff?
+
+    // Names the unnamed functions that the signature database at
+    // databasePath (built with ktimaz-sig) identifies. Returns how many, or
+    // -1 before the function table is built or if the database is invalid.
+    external fun applySignaturesNative(databasePath: String): Int
+
+    // Resolves the imports of the shared libraries at paths against each
+    // other; independent of the loaded file. Null if none can be read.
+    external fun linkLibrariesNative(paths: Array<String>): LibraryLinks?
+
+    // Listing of the discovered function containing address.
+    external fun disassembleFunctionNative(address: Long): Array<Instruction>?
+
+    // Builds the graph of the function containing address (odd = Thumb).
+    external fun buildCfgNative(address: Long): CfgSummary?
+
+    // Blocks and edges of the graph built for entry that intersect the
+    // rectangle, in layout units. Returns null once another graph is built.
+    external fun getCfgViewportNative(
+        entry: Long,
+        x0: Int,
+        y0: Int,
+        x1: Int,
+        y1: Int,
+    ): CfgViewport?
+
+    // Writes bytes at address in the loaded file's mapping (the file on disk
+    // is unchanged) and refreshes what was derived from them. Returns null
+    // on success, otherwise why the patch was rejected.
+    external fun patchBytesNative(
+        address: Long,
+        bytes: ByteArray,
+    ): String?
+
+    external fun undoPatchNative(): Boolean
+
+    external fun redoPatchNative(): Boolean
+
+    // [patches that can be undone, patches that can be redone]
+    external fun getPatchHistoryNative(): IntArray?
+
+    // Patched bytes as (address, length) pairs.
+    external fun getPatchedRangesNative(): LongArray?
+
+    // Writes the loaded file with its patches applied to outputPath.
+    external fun exportPatchedFileNative(outputPath: String): Boolean
+
+    // Streams the disassembly of sectionName (every code section when empty)
+    // to the open descriptor fd as LISTING_FORMAT_*. Returns the number of
+    // lines written, or -1.
+    external fun exportListingNative(
+        fd: Int,
+        sectionName: String,
+        format: Int,
+    ): Long
+
+    // Flattened SectionOverview (see SectionOverview.fromNative); null
+    // before the sweep stage has run.
+    external fun getSectionOverviewNative(
+        sectionName: String,
+        minBuckets: Int,
+    ): LongArray?
+
+    // [file offset, size, class, entropy (1/256 bits), code score (0..255)]
+    // per region of the content map; null until it has been computed.
+    external fun getContentRegionsNative(): LongArray?
+
+    // Counts of each byte value in the file range, or null if it is out of
+    // the file.
+    external fun getByteHistogramNative(
+        offset: Long,
+        size: Long,
+    ): IntArray?
+
+    // --- JNI Callbacks (called from native background thread) ---
+
+    @Suppress("unused")
+    fun onPatternMatches(
+        searchId: Long,
+        offsets: LongArray,
+        addresses: LongArray,
+        sections: IntArray,
+    ) {
+        val batch = List(offsets.size) { PatternMatch(offsets[it], addresses[it], sections[it]) }
+        synchronized(patternSearchLock) {
+            if (searchId != activePatternSearchId) return
+            patternMatchBatches.add(batch)
+            _patternMatches.value = BatchedList(patternMatchBatches.toList())
+        }
+    }
+
+    @Suppress("unused")
+    fun onPatternSearchFinished(
+        searchId: Long,
+        totalMatches: Long,
+        cancelled: Boolean,
+    ) {
+        synchronized(patternSearchLock) {
+            if (searchId != activePatternSearchId) return
+            _patternSearchRunning.value = false
+        }
+    }
+
     // --- Public Functions for UI Interaction ---
 
+    fun startPatternSearch(
+        pattern: String,
+        sectionName: String = "",
+    ) {
+        cancelPatternSearch()
+        synchronized(patternSearchLock) { patternMatchBatches.clear() }
+        _patternMatches.value = emptyList()
+        _patternSearchError.value = validatePatternNative(pattern)
+        if (_patternSearchError.value != null) return
+
+        synchronized(patternSearchLock) {
+            _patternSearchRunning.value = true
+            activePatternSearchId = startPatternSearchNative(pattern, sectionName)
+            if (activePatternSearchId < 0) {
+                _patternSearchRunning.value = false
+                _patternSearchError.value = "Pattern search could not be started"
+            }
+        }
+    }
+
+    fun cancelPatternSearch() {
+        val searchId =
+            synchronized(patternSearchLock) {
+                val id = activePatternSearchId
+                activePatternSearchId = -1L
+                _patternSearchRunning.value = false
+                id
+            }
+        if (searchId >= 0) cancelPatternSearchNative(searchId)
+    }
+
+    override fun onCleared() {
+        cancelPatternSearch()
+        super.onCleared()
+    }
+
+    fun getXrefsTo(
+        address: Long,
+        offset: Int = 0,
+        limit: Int = XREF_PAGE_SIZE,
+    ): XrefPage? = getXrefsNative(address, address + 1, offset, limit)
+
+    fun queryCallGraph(
+        nameOrAddress: String,
+        kind: CallGraphQuery,
+        offset: Int = 0,
+        limit: Int = CALL_GRAPH_PAGE_SIZE,
+    ): CallGraphPage? {
+        val node = findCallGraphNodeNative(nameOrAddress)
+        if (node < 0) return null
+        return queryCallGraphNative(node, kind.nativeValue, offset, limit)
+    }
+
+    fun findCallPath(
+        from: String,
+        to: String,
+    ): CallGraphPage? {
+        val fromNode = findCallGraphNodeNative(from)
+        val toNode = findCallGraphNodeNative(to)
+        if (fromNode < 0 || toNode < 0) return null
+        return callPathNative(fromNode, toNode)
+    }
+
+    // Shows just the function containing address instead of a whole section.
+    fun loadFunction(address: Long) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            val listing = disassembleFunctionNative(address) ?: return@launch
+            _instructions.value = listing.toList()
+            refreshListingLabels()
+        }
+    }
+
+    // Looks up the labels of the shown listing; again once the symbol
+    // index is built if it was not yet.
+    fun refreshListingLabels() {
+        viewModelScope.launch(AppThreadPool.IO) {
+            val listing = _instructions.value
+            if (listing.isEmpty()) {
+                _listingLabels.value = emptyMap()
+                return@launch
+            }
+            val start = listing.first().address
+            val end = listing.last().address + listing.last().byteLength
+            val symbols = getSymbolsInRangeNative(start, end) ?: return@launch
+            val targets =
+                listing
+                    .asSequence()
+                    .filter { it.isBranch && it.branchTarget != 0L }
+                    .filter { it.branchTarget < start || it.branchTarget >= end }
+                    .map { it.branchTarget and 1L.inv() }
+                    .distinct()
+                    .toList()
+                    .toLongArray()
+            val targetSymbols = if (targets.isEmpty()) emptyArray() else getSymbolsAtNative(targets) ?: emptyArray()
+            if (listing !== _instructions.value) return@launch
+            _listingLabels.value =
+                buildMap {
+                    for (symbol in symbols + targetSymbols) {
+                        // Mapping symbols ($a, $t, $d) are not labels; Thumb
+                        // functions have odd values
+                        if (symbol.name.startsWith("$")) continue
+                        putIfAbsent(symbol.value and 1L.inv(), symbol)
+                    }
+                }
+        }
+    }
+
+    fun openGraph(address: Long) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            _cfgSummary.value = buildCfgNative(address)
+        }
+    }
+
+    fun getCfgViewport(
+        x0: Int,
+        y0: Int,
+        x1: Int,
+        y1: Int,
+    ): CfgViewport? {
+        val summary = _cfgSummary.value ?: return null
+        return getCfgViewportNative(summary.entry, x0, y0, x1, y1)
+    }
+
+    fun searchWholeBinary(
+        query: String,
+        offset: Int = 0,
+        limit: Int = 500,
+    ): InstructionSearchPage? =
+        if (isSearchIndexReadyNative()) searchInstructionsNative(query, 0L, 0L, offset, limit) else null
+
+    private fun searchLoadedInstructions(
+        instructions: List<Instruction>,
+        query: String,
+    ): List<Instruction>? {
+        if (!isSearchIndexReadyNative()) return null
+        val first = instructions.first().address
+        val last = instructions.last().address
+        val page = searchInstructionsNative(query, first, last + 1, 0, instructions.size) ?: return null
+        val hits = page.addresses.toHashSet()
+        return instructions.filter { it.address in hits }
+    }
+
+    fun patchBytes(
+        address: Long,
+        bytes: ByteArray,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            _patchError.value = patchBytesNative(address, bytes)
+            if (_patchError.value == null) onPatchesChanged()
+        }
+    }
+
+    fun undoPatch() {
+        viewModelScope.launch(AppThreadPool.IO) {
+            if (undoPatchNative()) onPatchesChanged()
+        }
+    }
+
+    fun redoPatch() {
+        viewModelScope.launch(AppThreadPool.IO) {
+            if (redoPatchNative()) onPatchesChanged()
+        }
+    }
+
+    fun exportPatchedFile(
+        outputPath: String,
+        onFinished: (Boolean) -> Unit,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            onFinished(exportPatchedFileNative(outputPath))
+        }
+    }
+
+    // Overview of sectionName with at least minBuckets buckets where the
+    // section is big enough, e.g. one per pixel row of a minimap. Cheap
+    // enough to call on every zoom change.
+    fun sectionOverview(
+        sectionName: String,
+        minBuckets: Int,
+    ): SectionOverview? = getSectionOverviewNative(sectionName, minBuckets)?.let(SectionOverview::fromNative)
+
+    fun contentRegions(): List<ContentRegion>? = getContentRegionsNative()?.let(ContentRegion::fromNative)
+
+    // Writes the listing to output (e.g. from a SAF document) and closes it.
+    fun exportListing(
+        output: ParcelFileDescriptor,
+        sectionName: String,
+        jsonLines: Boolean,
+        onFinished: (Long) -> Unit,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            val format = if (jsonLines) LISTING_FORMAT_JSON_LINES else LISTING_FORMAT_TEXT
+            val lines = output.use { exportListingNative(it.fd, sectionName, format) }
+            onFinished(lines)
+        }
+    }
+
+    // Compares the loaded file with an older build of it.
+    fun diffFunctions(
+        oldPath: String,
+        onFinished: (FunctionDiff?) -> Unit,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            onFinished(diffFunctionsNative(oldPath))
+        }
+    }
+
+    fun applySignatures(
+        databasePath: String,
+        onFinished: (Int) -> Unit,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            onFinished(applySignaturesNative(databasePath))
+        }
+    }
+
+    fun linkLibraries(
+        paths: List<String>,
+        onFinished: (LibraryLinks?) -> Unit,
+    ) {
+        viewModelScope.launch(AppThreadPool.IO) {
+            onFinished(linkLibrariesNative(paths.toTypedArray()))
+        }
+    }
+
+    // The native side has already spliced the new bytes into its listing,
+    // so showing the section again decodes nothing.
+    private fun onPatchesChanged() {
+        val history = getPatchHistoryNative() ?: intArrayOf(0, 0)
+        _canUndoPatch.value = history[0] > 0
+        _canRedoPatch.value = history[1] > 0
+        val section = _currentSection.value ?: return
+        loadDisassemblyForSection(section, currentBaseAddress, currentThumbMode)
+        _cfgSummary.value?.let { openGraph(it.entry) }
+    }
+
+    // A mapped listing shown before the mode map was built used the file's
+    // default mode; the native side decodes it again now.
+    fun onModeMapReady() {
+        val section = _currentSection.value ?: return
+        if (currentBaseAddress == SECTION_ADDRESS) loadDisassemblyForSection(section)
+    }
+
     fun loadDisassemblyForSection(
         sectionName: String,
-        baseAddress: Long,
+        baseAddress: Long = SECTION_ADDRESS,
         isThumbMode: Boolean = false,
     ) {
         _currentSection.value = sectionName
+        currentBaseAddress = baseAddress
+        currentThumbMode = isThumbMode
         viewModelScope.launch(AppThreadPool.IO) {
             try {
                 // For demonstration, we'll request a fixed amount of data for hex dump too
@@ -90,6 +576,7 @@ class DisassemblyViewModel : ViewModel() {
                     isThumbMode,
                 )
                 _instructions.value = disassembledArray?.toList() ?: emptyList()
+                refreshListingLabels()
                 println("Disassembled ${instructions.value.size} instructions for section $sectionName")
             } catch (e: Exception) {
                 e.printStackTrace()
@@ -117,12 +604,51 @@ class DisassemblyViewModel : ViewModel() {
     fun selectTab(tab: MainTab) {
         _currentTab.value = tab
     }
+
+    companion object {
+        private const val XREF_PAGE_SIZE = 200
+        private const val CALL_GRAPH_PAGE_SIZE = 200
+
+        // Listings at the addresses the indexes, xrefs and graphs use
+        const val SECTION_ADDRESS = -1L
+
+        // Must match ListingFormat in listing_export.h
+        const val LISTING_FORMAT_TEXT = 0
+        const val LISTING_FORMAT_JSON_LINES = 1
+    }
 }
 
 enum class MainTab {
     Disassembly,
     HexView,
     Symbols,
+    Strings,
     Bookmarks,
     GraphView,
-}
\ No newline at end of file
+}
+
+// Read-only concatenation of immutable batches.
+private class BatchedList<T>(
+    private val batches: List<List<T>>,
+) : AbstractList<T>() {
+    private val starts = IntArray(batches.size)
+    override val size: Int
+
+    init {
+        var total = 0
+        batches.forEachIndexed { i, batch ->
+            starts[i] = total
+            total += batch.size
+        }
+        size = total
+    }
+
+    override fun get(index: Int): T {
+        if (index < 0 || index >= size) throw IndexOutOfBoundsException("$index of $size")
+        var batch = starts.binarySearch(index)
+        if (batch < 0) batch = -batch - 2
+        // Empty batches share a start with the next one
+        while (batches[batch].isEmpty() || index - starts[batch] >= batches[batch].size) ++batch
+        return batches[batch][index - starts[batch]]
+    }
+}
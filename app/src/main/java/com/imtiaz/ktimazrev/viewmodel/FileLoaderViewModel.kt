@@ -2,7 +2,15 @@ package com.imtiaz.ktimazrev.viewmodel
 
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
+import com.imtiaz.ktimazrev.model.AnalysisStage
+import com.imtiaz.ktimazrev.model.ExtractedString
+import com.imtiaz.ktimazrev.model.NativeMemoryUsage
+import com.imtiaz.ktimazrev.model.StringPage
+import com.imtiaz.ktimazrev.model.StringQuery
 import com.imtiaz.ktimazrev.model.Symbol
+import com.imtiaz.ktimazrev.model.SymbolPage
+import com.imtiaz.ktimazrev.model.SymbolQuery
+import com.imtiaz.ktimazrev.model.TraceStats
 import com.imtiaz.ktimazrev.utils.AppThreadPool
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
@@ -17,18 +25,87 @@ class FileLoaderViewModel : ViewModel() {
     private val _currentFilePath = MutableStateFlow<String?>(null)
     val currentFilePath: StateFlow<String?> = _currentFilePath.asStateFlow()
 
+    // Mask of AnalysisStage bits published so far for the current file
+    private val _analysisStages = MutableStateFlow(0)
+    val analysisStages: StateFlow<Int> = _analysisStages.asStateFlow()
+
     private val _elfSectionNames = MutableStateFlow<List<String>>(emptyList())
     val elfSectionNames: StateFlow<List<String>> = _elfSectionNames.asStateFlow()
 
-    private val _elfSymbols = MutableStateFlow<List<Symbol>>(emptyList())
-    val elfSymbols: StateFlow<List<Symbol>> = _elfSymbols.asStateFlow()
+    private val _symbolQuery = MutableStateFlow(SymbolQuery())
+    val symbolQuery: StateFlow<SymbolQuery> = _symbolQuery.asStateFlow()
+
+    // Symbols matching the current query, accumulated page by page
+    private val _queriedSymbols = MutableStateFlow<List<Symbol>>(emptyList())
+    val queriedSymbols: StateFlow<List<Symbol>> = _queriedSymbols.asStateFlow()
+
+    private val _queriedSymbolTotal = MutableStateFlow(0)
+    val queriedSymbolTotal: StateFlow<Int> = _queriedSymbolTotal.asStateFlow()
+
+    @Volatile
+    private var symbolQueryGeneration = 0
+
+    private val _stringQuery = MutableStateFlow(StringQuery())
+    val stringQuery: StateFlow<StringQuery> = _stringQuery.asStateFlow()
+
+    // Strings matching the current query, accumulated page by page
+    private val _queriedStrings = MutableStateFlow<List<ExtractedString>>(emptyList())
+    val queriedStrings: StateFlow<List<ExtractedString>> = _queriedStrings.asStateFlow()
+
+    private val _queriedStringTotal = MutableStateFlow(0)
+    val queriedStringTotal: StateFlow<Int> = _queriedStringTotal.asStateFlow()
+
+    @Volatile
+    private var stringQueryGeneration = 0
 
     // Native methods (declared in JNI)
     external fun loadFileAndParseNative(filePath: String)
 
     external fun getElfSectionNamesNative(): Array<String>?
 
-    external fun getElfSymbolsNative(): Array<Symbol>?
+    external fun querySymbolsNative(
+        text: String,
+        matchMode: Int,
+        type: Int,
+        binding: Int,
+        sectionName: String,
+        sortKey: Int,
+        descending: Boolean,
+        demangled: Boolean,
+        offset: Int,
+        limit: Int,
+    ): SymbolPage?
+
+    // Returns null until the background string extraction has finished.
+    external fun queryStringsNative(
+        text: String,
+        matchMode: Int,
+        sectionName: String,
+        encoding: Int,
+        offset: Int,
+        limit: Int,
+    ): StringPage?
+
+    // Addresses of instructions referencing the string, ascending.
+    external fun getStringReferencesNative(stringIndex: Int): LongArray?
+
+    // Live bytes per native MemoryCategory, followed by the peak bytes.
+    external fun getNativeMemoryUsageNative(): LongArray
+
+    // Byte budget for native caches (decoded pages, graphs, search index,
+    // string table); anything over it is evicted and rebuilt on demand.
+    external fun setNativeMemoryBudgetNative(budgetBytes: Long)
+
+    // Shrinks native caches for a ComponentCallbacks2 trim level; returns the bytes freed.
+    external fun trimNativeMemoryNative(level: Int): Long
+
+    // Native instrumentation; only records anything in debug builds.
+    external fun getTraceStatsNative(): TraceStats?
+
+    // Writes buffered trace events as Chrome trace JSON; false when tracing is compiled out.
+    external fun exportTraceNative(outputPath: String): Boolean
+
+    external fun resetTraceNative()
 
     // Initialize native library
     init {
@@ -37,6 +114,7 @@ class FileLoaderViewModel : ViewModel() {
 
     fun loadFile(filePath: String) {
         _currentFilePath.value = filePath
+        _analysisStages.value = 0
         viewModelScope.launch(AppThreadPool.IO) {
             _loadingState.value = LoadingState.Loading(0)
             loadFileAndParseNative(filePath)
@@ -63,7 +141,7 @@ class FileLoaderViewModel : ViewModel() {
         viewModelScope.launch(AppThreadPool.Main) {
             if (success) {
                 _loadingState.value = LoadingState.Success
-                // Fetch section names and symbols after successful parsing
+                // Fetch section names and the first symbol page after successful parsing
                 loadElfMetadata()
             } else {
                 _loadingState.value = LoadingState.Error("Parsing failed.")
@@ -71,6 +149,18 @@ class FileLoaderViewModel : ViewModel() {
         }
     }
 
+    // The native analysis pipeline published a stage; refresh what depends on it.
+    @Suppress("unused") // Called by native code
+    fun onAnalysisStageFinished(stage: Int) {
+        val finished = AnalysisStage.fromNative(stage) ?: return
+        _analysisStages.value = _analysisStages.value or finished.bit
+        when (finished) {
+            AnalysisStage.SymbolIndex -> updateSymbolQuery(_symbolQuery.value)
+            AnalysisStage.Strings, AnalysisStage.Sweep -> updateStringQuery()
+            else -> Unit
+        }
+    }
+
     @Suppress("unused") // Called by native code
     fun onFileReadError(errorMessage: String) {
         viewModelScope.launch(AppThreadPool.Main) {
@@ -82,16 +172,131 @@ class FileLoaderViewModel : ViewModel() {
         viewModelScope.launch(AppThreadPool.IO) {
             try {
                 val sectionNames = getElfSectionNamesNative()?.toList() ?: emptyList()
-                val symbols = getElfSymbolsNative()?.toList() ?: emptyList()
 
                 _elfSectionNames.value = sectionNames
-                _elfSymbols.value = symbols
+                updateSymbolQuery(_symbolQuery.value)
             } catch (e: Exception) {
                 e.printStackTrace()
                 _loadingState.value = LoadingState.Error("Failed to load ELF metadata: ${e.message}")
             }
         }
     }
+
+    fun updateSymbolQuery(query: SymbolQuery) {
+        _symbolQuery.value = query
+        val generation = ++symbolQueryGeneration
+        viewModelScope.launch(AppThreadPool.IO) {
+            val page = fetchSymbolPage(query, 0) ?: return@launch
+            if (generation == symbolQueryGeneration) {
+                _queriedSymbolTotal.value = page.totalCount
+                _queriedSymbols.value = page.symbols.toList()
+            }
+        }
+    }
+
+    fun loadMoreSymbols() {
+        val loaded = _queriedSymbols.value.size
+        if (loaded >= _queriedSymbolTotal.value) return
+        val query = _symbolQuery.value
+        val generation = symbolQueryGeneration
+        viewModelScope.launch(AppThreadPool.IO) {
+            val page = fetchSymbolPage(query, loaded) ?: return@launch
+            if (generation == symbolQueryGeneration && _queriedSymbols.value.size == loaded) {
+                _queriedSymbols.value = _queriedSymbols.value + page.symbols
+            }
+        }
+    }
+
+    private fun fetchSymbolPage(
+        query: SymbolQuery,
+        offset: Int,
+    ): SymbolPage? =
+        try {
+            querySymbolsNative(
+                query.text,
+                query.matchMode.ordinal,
+                query.type,
+                query.binding,
+                query.sectionName,
+                query.sortKey.ordinal,
+                query.descending,
+                query.demangled,
+                offset,
+                SYMBOL_PAGE_SIZE,
+            )
+        } catch (e: Exception) {
+            e.printStackTrace()
+            null
+        }
+
+    fun updateStringQuery(query: StringQuery = _stringQuery.value) {
+        _stringQuery.value = query
+        val generation = ++stringQueryGeneration
+        viewModelScope.launch(AppThreadPool.IO) {
+            val page = fetchStringPage(query, 0) ?: return@launch
+            if (generation == stringQueryGeneration) {
+                _queriedStringTotal.value = page.totalCount
+                _queriedStrings.value = page.strings.toList()
+            }
+        }
+    }
+
+    fun loadMoreStrings() {
+        val loaded = _queriedStrings.value.size
+        if (loaded >= _queriedStringTotal.value) return
+        val query = _stringQuery.value
+        val generation = stringQueryGeneration
+        viewModelScope.launch(AppThreadPool.IO) {
+            val page = fetchStringPage(query, loaded) ?: return@launch
+            if (generation == stringQueryGeneration && _queriedStrings.value.size == loaded) {
+                _queriedStrings.value = _queriedStrings.value + page.strings
+            }
+        }
+    }
+
+    fun getStringReferences(string: ExtractedString): List<Long> =
+        getStringReferencesNative(string.index)?.toList() ?: emptyList()
+
+    fun nativeMemoryUsage(): NativeMemoryUsage = NativeMemoryUsage.fromNative(getNativeMemoryUsageNative())
+
+    // Sizes the native cache budget from the device's RAM.
+    fun configureNativeMemoryBudget(totalDeviceMemory: Long) {
+        setNativeMemoryBudgetNative(
+            (totalDeviceMemory / NATIVE_BUDGET_RAM_DIVISOR).coerceIn(MIN_NATIVE_BUDGET, MAX_NATIVE_BUDGET),
+        )
+    }
+
+    fun onTrimMemory(level: Int) {
+        trimNativeMemoryNative(level)
+    }
+
+    private fun fetchStringPage(
+        query: StringQuery,
+        offset: Int,
+    ): StringPage? =
+        try {
+            queryStringsNative(
+                query.text,
+                query.matchMode.ordinal,
+                query.sectionName,
+                query.encoding,
+                offset,
+                STRING_PAGE_SIZE,
+            )
+        } catch (e: Exception) {
+            e.printStackTrace()
+            null
+        }
+
+    companion object {
+        private const val SYMBOL_PAGE_SIZE = 200
+        private const val STRING_PAGE_SIZE = 200
+
+        // An eighth of RAM: 512 MB on a 4 GB phone, within these bounds
+        private const val NATIVE_BUDGET_RAM_DIVISOR = 8L
+        private const val MIN_NATIVE_BUDGET = 64L shl 20
+        private const val MAX_NATIVE_BUDGET = 1L shl 30
+    }
 }
 
 sealed class LoadingState {